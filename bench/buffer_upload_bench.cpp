@@ -0,0 +1,504 @@
+// 每帧数据上传方式的基准测试
+//
+// 用法: buffer_upload_bench [--max-size BYTES] [--frames N]
+//   --max-size  最大负载, 默认 64 MiB (从 64 B 开始每次乘 16)
+//   --frames    每项测量的帧数上限, 默认 200 (大负载会自动减少)
+//
+// 负载按 64 字节 (一个 mat4) 一个物体组织, 着色器每个物体画一个点并读取它的整个 mat4,
+// 保证数据确实被 GPU 用到。对比的方式:
+//   uniform        每个物体 glUniformMatrix4fv + 一次绘制 (task4 的做法), 负载超过 4 MiB 时跳过
+//   ubo-subdata    一个 UBO, 每帧 glBufferSubData, 按块 glBindBufferRange 绘制
+//   ubo-orphan     同上, 但先 glBufferData(NULL) 孤立旧存储, 避免等待上一帧读取完成
+//   ubo-persistent 持久映射的三段环形 UBO (GL 4.4), memcpy 后用栅栏保护正在使用的段
+//   tbo-subdata    纹理缓冲 (texelFetch), 每帧 glBufferSubData
+//   ssbo-subdata   着色器存储缓冲 (GL 4.3), 每帧 glBufferSubData
+//   vbo-immediate  每帧新建 VBO + VAO (mat4 作为实例属性), 绘制后立即 glDelete*
+//   vbo-deferred   同上, 但用 common/gl_handle.h 的句柄, 删除推迟到这一帧的栅栏触发之后
+// 每行输出: CPU 提交时间/帧, GPU 时间/帧 (GL_TIME_ELAPSED), 从开始上传到 GPU 用完数据的延迟
+// (栅栏等待, 取中位数), 以及按较慢一方计算的吞吐量。
+// 最后按类别打印各方式分配的缓冲的显存峰值 (common/gpu_memory.h), 以及两种 vbo 方式删除时
+// GPU 仍在使用该对象的次数: immediate 的这些删除要么让驱动等待, 要么由驱动另行跟踪; deferred 的
+// 对应数字就是延迟删除队列避免的等待。
+
+#include "common/gl43.h"
+#include "common/gl_handle.h"
+#include "common/gpu_memory.h"
+#include <GLFW/glfw3.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+typedef std::chrono::steady_clock Clock;
+
+static const size_t kObjectBytes = 64;
+
+static unsigned int compileProgram(const std::string& vertexSource) {
+    static const char* fragmentSource =
+        "#version 330 core\n"
+        "out vec4 FragColor;\n"
+        "void main() { FragColor = vec4(1.0); }\n";
+    const char* sources[2] = { vertexSource.c_str(), fragmentSource };
+    GLenum types[2] = { GL_VERTEX_SHADER, GL_FRAGMENT_SHADER };
+    unsigned int program = glCreateProgram();
+    for (int i = 0; i < 2; ++i) {
+        unsigned int shader = glCreateShader(types[i]);
+        glShaderSource(shader, 1, &sources[i], NULL);
+        glCompileShader(shader);
+        int success;
+        glGetShaderiv(shader, GL_COMPILE_STATUS, &success);
+        if (!success) {
+            char infoLog[1024];
+            glGetShaderInfoLog(shader, sizeof(infoLog), NULL, infoLog);
+            std::cerr << "着色器编译失败:\n" << infoLog << std::endl;
+        }
+        glAttachShader(program, shader);
+        glDeleteShader(shader);
+    }
+    glLinkProgram(program);
+    int success;
+    glGetProgramiv(program, GL_LINK_STATUS, &success);
+    if (!success) {
+        char infoLog[1024];
+        glGetProgramInfoLog(program, sizeof(infoLog), NULL, infoLog);
+        std::cerr << "着色器链接失败:\n" << infoLog << std::endl;
+        glDeleteProgram(program);
+        return 0;
+    }
+    return program;
+}
+
+// 每个物体的 mat4 四列求和后变成点的位置 (乘一个很小的系数, 点始终落在 1x1 视口内)
+static const char* kPositionFromObject = "gl_Position = vec4((m[0] + m[1] + m[2] + m[3]).xyz * 1e-12, 1.0);\n";
+
+// 一种上传方式: prepare 分配资源, frame 上传一帧数据并发出使用它的绘制
+class UploadStrategy {
+public:
+    virtual ~UploadStrategy() {}
+    virtual const char* name() const = 0;
+    virtual bool supports(size_t bytes) const { return true; }
+    virtual bool prepare(size_t bytes) = 0;
+    virtual void frame(const unsigned char* data, size_t bytes) = 0;
+    virtual void release() = 0;
+};
+
+class UniformStrategy : public UploadStrategy {
+public:
+    const char* name() const { return "uniform"; }
+    bool supports(size_t bytes) const { return bytes <= ((size_t)4 << 20); }
+    bool prepare(size_t) {
+        program_ = compileProgram(std::string("#version 330 core\nuniform mat4 object;\nvoid main() {\nmat4 m = object;\n")
+                                  + kPositionFromObject + "}\n");
+        location_ = glGetUniformLocation(program_, "object");
+        return program_ != 0;
+    }
+    void frame(const unsigned char* data, size_t bytes) {
+        glUseProgram(program_);
+        for (size_t offset = 0; offset < bytes; offset += kObjectBytes) {
+            glUniformMatrix4fv(location_, 1, GL_FALSE, (const float*)(data + offset));
+            glDrawArrays(GL_POINTS, 0, 1);
+        }
+    }
+    void release() { glDeleteProgram(program_); }
+
+private:
+    unsigned int program_ = 0;
+    int location_ = -1;
+};
+
+// UBO 的三种写法共用: 按 GL_MAX_UNIFORM_BLOCK_SIZE 分块绑定并绘制
+class UniformBufferStrategy : public UploadStrategy {
+public:
+    enum Mode { SubData, Orphan, Persistent };
+    explicit UniformBufferStrategy(Mode mode) : mode_(mode) {}
+
+    const char* name() const {
+        return mode_ == SubData ? "ubo-subdata" : mode_ == Orphan ? "ubo-orphan" : "ubo-persistent";
+    }
+    bool supports(size_t) const { return mode_ != Persistent || hasBufferStorage(); }
+
+    bool prepare(size_t bytes) {
+        GLint maxBlock = 0, alignment = 0;
+        glGetIntegerv(GL_MAX_UNIFORM_BLOCK_SIZE, &maxBlock);
+        glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &alignment);
+        blockObjects_ = (size_t)std::min<GLint>(maxBlock, 65536) / kObjectBytes;
+        blockBytes_ = blockObjects_ * kObjectBytes; // 64 的倍数, 满足常见的 256 字节对齐
+        if (blockBytes_ % alignment != 0) return false;
+
+        char header[128];
+        std::snprintf(header, sizeof(header), "#version 330 core\nlayout(std140) uniform Objects { mat4 objects[%zu]; };\n",
+                      blockObjects_);
+        program_ = compileProgram(std::string(header) + "void main() {\nmat4 m = objects[gl_VertexID];\n"
+                                  + kPositionFromObject + "}\n");
+        if (!program_) return false;
+        glUniformBlockBinding(program_, glGetUniformBlockIndex(program_, "Objects"), 0);
+
+        // 环形缓冲每段按块大小对齐, 这样每段的起点都可以直接绑定
+        regionBytes_ = (bytes + blockBytes_ - 1) / blockBytes_ * blockBytes_;
+        glGenBuffers(1, &buffer_);
+        glBindBuffer(GL_UNIFORM_BUFFER, buffer_);
+        if (mode_ == Persistent) {
+            GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+            glBufferStorage(GL_UNIFORM_BUFFER, regionBytes_ * kRegions, NULL, flags);
+            gpuMemory().track(GpuObjectKind::Buffer, buffer_, GpuCategory::UniformBuffer, regionBytes_ * kRegions);
+            mapped_ = (unsigned char*)glMapBufferRange(GL_UNIFORM_BUFFER, 0, regionBytes_ * kRegions, flags);
+            if (!mapped_) return false;
+        } else {
+            gpuBufferData(GL_UNIFORM_BUFFER, buffer_, regionBytes_, NULL, GL_STREAM_DRAW, GpuCategory::UniformBuffer);
+        }
+        glBindBuffer(GL_UNIFORM_BUFFER, 0);
+        return true;
+    }
+
+    void frame(const unsigned char* data, size_t bytes) {
+        size_t base = 0;
+        glBindBuffer(GL_UNIFORM_BUFFER, buffer_);
+        if (mode_ == Persistent) {
+            // 等待这一段上次的绘制完成后再覆盖
+            int region = frameIndex_++ % kRegions;
+            if (fences_[region]) {
+                glClientWaitSync(fences_[region], GL_SYNC_FLUSH_COMMANDS_BIT, (GLuint64)-1);
+                glDeleteSync(fences_[region]);
+                fences_[region] = 0;
+            }
+            base = region * regionBytes_;
+            std::memcpy(mapped_ + base, data, bytes);
+        } else {
+            if (mode_ == Orphan)
+                glBufferData(GL_UNIFORM_BUFFER, regionBytes_, NULL, GL_STREAM_DRAW);
+            glBufferSubData(GL_UNIFORM_BUFFER, 0, bytes, data);
+        }
+
+        glUseProgram(program_);
+        for (size_t offset = 0; offset < bytes; offset += blockBytes_) {
+            size_t chunk = std::min(blockBytes_, bytes - offset);
+            glBindBufferRange(GL_UNIFORM_BUFFER, 0, buffer_, base + offset, blockBytes_);
+            glDrawArrays(GL_POINTS, 0, (GLsizei)(chunk / kObjectBytes));
+        }
+        glBindBuffer(GL_UNIFORM_BUFFER, 0);
+
+        if (mode_ == Persistent)
+            fences_[(frameIndex_ - 1) % kRegions] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    }
+
+    void release() {
+        for (int i = 0; i < kRegions; ++i) {
+            if (fences_[i]) glDeleteSync(fences_[i]);
+            fences_[i] = 0;
+        }
+        if (mapped_) {
+            glBindBuffer(GL_UNIFORM_BUFFER, buffer_);
+            glUnmapBuffer(GL_UNIFORM_BUFFER);
+            glBindBuffer(GL_UNIFORM_BUFFER, 0);
+            mapped_ = nullptr;
+        }
+        gpuDeleteBuffers(1, &buffer_);
+        glDeleteProgram(program_);
+        buffer_ = program_ = 0;
+        frameIndex_ = 0;
+    }
+
+private:
+    static const int kRegions = 3;
+    Mode mode_;
+    unsigned int program_ = 0;
+    unsigned int buffer_ = 0;
+    size_t blockObjects_ = 0;
+    size_t blockBytes_ = 0;
+    size_t regionBytes_ = 0;
+    unsigned char* mapped_ = nullptr;
+    GLsync fences_[kRegions] = { 0, 0, 0 };
+    int frameIndex_ = 0;
+};
+
+// 一次绘制读完整个缓冲: 纹理缓冲或 SSBO
+class WholeBufferStrategy : public UploadStrategy {
+public:
+    explicit WholeBufferStrategy(bool storageBuffer) : ssbo_(storageBuffer) {}
+
+    const char* name() const { return ssbo_ ? "ssbo-subdata" : "tbo-subdata"; }
+    bool supports(size_t bytes) const {
+        if (ssbo_) {
+            GLint major = 0, minor = 0;
+            glGetIntegerv(GL_MAJOR_VERSION, &major);
+            glGetIntegerv(GL_MINOR_VERSION, &minor);
+            if (major < 4 || (major == 4 && minor < 3)) return false;
+            GLint64 maxBlock = 0;
+            glGetInteger64v(GL_MAX_SHADER_STORAGE_BLOCK_SIZE, &maxBlock);
+            return bytes <= (size_t)maxBlock;
+        }
+        GLint maxTexels = 0;
+        glGetIntegerv(GL_MAX_TEXTURE_BUFFER_SIZE, &maxTexels);
+        return bytes / 16 <= (size_t)maxTexels;
+    }
+
+    bool prepare(size_t bytes) {
+        if (ssbo_) {
+            program_ = compileProgram(std::string("#version 430 core\nlayout(std430, binding = 0) buffer Objects { mat4 objects[]; };\n"
+                                                  "void main() {\nmat4 m = objects[gl_VertexID];\n") + kPositionFromObject + "}\n");
+        } else {
+            program_ = compileProgram(std::string("#version 330 core\nuniform samplerBuffer objects;\nvoid main() {\nmat4 m;\n"
+                                                  "for (int i = 0; i < 4; ++i) m[i] = texelFetch(objects, gl_VertexID * 4 + i);\n")
+                                      + kPositionFromObject + "}\n");
+        }
+        if (!program_) return false;
+        target_ = ssbo_ ? GL_SHADER_STORAGE_BUFFER : GL_TEXTURE_BUFFER;
+        glGenBuffers(1, &buffer_);
+        glBindBuffer(target_, buffer_);
+        gpuBufferData(target_, buffer_, bytes, NULL, GL_STREAM_DRAW, GpuCategory::StorageBuffer);
+        glBindBuffer(target_, 0);
+        if (!ssbo_) {
+            glGenTextures(1, &texture_);
+            glBindTexture(GL_TEXTURE_BUFFER, texture_);
+            glTexBuffer(GL_TEXTURE_BUFFER, GL_RGBA32F, buffer_);
+            glBindTexture(GL_TEXTURE_BUFFER, 0);
+        }
+        return true;
+    }
+
+    void frame(const unsigned char* data, size_t bytes) {
+        glBindBuffer(target_, buffer_);
+        glBufferSubData(target_, 0, bytes, data);
+        glBindBuffer(target_, 0);
+        glUseProgram(program_);
+        if (ssbo_) {
+            glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, buffer_);
+        } else {
+            glActiveTexture(GL_TEXTURE0);
+            glBindTexture(GL_TEXTURE_BUFFER, texture_);
+        }
+        glDrawArrays(GL_POINTS, 0, (GLsizei)(bytes / kObjectBytes));
+    }
+
+    void release() {
+        glDeleteTextures(1, &texture_);
+        gpuDeleteBuffers(1, &buffer_);
+        glDeleteProgram(program_);
+        texture_ = buffer_ = program_ = 0;
+    }
+
+private:
+    bool ssbo_;
+    GLenum target_ = 0;
+    unsigned int program_ = 0;
+    unsigned int buffer_ = 0;
+    unsigned int texture_ = 0;
+};
+
+// 每帧新建顶点缓冲: 模拟 task4 画轨道的做法。对象在刚发出的绘制还没执行时就被释放,
+// 两种方式的区别只在于释放时立即 glDelete* 还是交给删除队列。
+class TransientBufferStrategy : public UploadStrategy {
+public:
+    explicit TransientBufferStrategy(bool deferred) : deferred_(deferred) {}
+
+    const char* name() const { return deferred_ ? "vbo-deferred" : "vbo-immediate"; }
+
+    bool prepare(size_t) {
+        program_ = compileProgram(std::string("#version 330 core\nlayout(location = 0) in mat4 object;\nvoid main() {\nmat4 m = object;\n")
+                                  + kPositionFromObject + "}\n");
+        return program_ != 0;
+    }
+
+    void frame(const unsigned char* data, size_t bytes) {
+        GLint previousVAO = 0;
+        glGetIntegerv(GL_VERTEX_ARRAY_BINDING, &previousVAO);
+        {
+            GlVertexArray vao = GlVertexArray::create();
+            GlBuffer vbo = GlBuffer::create();
+            glBindVertexArray(vao.get());
+            glBindBuffer(GL_ARRAY_BUFFER, vbo.get());
+            gpuBufferData(GL_ARRAY_BUFFER, vbo.get(), bytes, data, GL_STREAM_DRAW, GpuCategory::VertexBuffer);
+            for (int column = 0; column < 4; ++column) {
+                glEnableVertexAttribArray(column);
+                glVertexAttribPointer(column, 4, GL_FLOAT, GL_FALSE, kObjectBytes, (void*)(column * 4 * sizeof(float)));
+            }
+            glUseProgram(program_);
+            glDrawArrays(GL_POINTS, 0, (GLsizei)(bytes / kObjectBytes));
+            glBindBuffer(GL_ARRAY_BUFFER, 0);
+            glBindVertexArray(previousVAO);
+
+            if (!deferred_) {
+                // 与删除队列同样的判断: 上一帧还没执行完, 刚发出的绘制一定也没有
+                if (lastFence_ && glClientWaitSync(lastFence_, 0, 0) == GL_TIMEOUT_EXPIRED) busyDeletes_ += 2;
+                GLuint buffer = vbo.release(), vertexArray = vao.release();
+                gpuDeleteBuffers(1, &buffer);
+                glDeleteVertexArrays(1, &vertexArray);
+            }
+        }
+        if (deferred_) {
+            glDeletionQueue().endFrame();
+        } else {
+            if (lastFence_) glDeleteSync(lastFence_);
+            lastFence_ = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+        }
+    }
+
+    void release() {
+        if (lastFence_) glDeleteSync(lastFence_);
+        lastFence_ = 0;
+        if (deferred_) glDeletionQueue().finish();
+        glDeleteProgram(program_);
+        program_ = 0;
+    }
+
+    // immediate: 删除时 GPU 仍在使用的对象数 (累计所有负载)
+    size_t busyDeletes() const { return busyDeletes_; }
+
+private:
+    bool deferred_;
+    unsigned int program_ = 0;
+    GLsync lastFence_ = 0;
+    size_t busyDeletes_ = 0;
+};
+
+struct Measurement {
+    double cpuMs = 0.0;
+    double gpuMs = 0.0;
+    double latencyMs = 0.0;
+};
+
+static Measurement measure(UploadStrategy& strategy, std::vector<unsigned char>& data, size_t bytes, int frames) {
+    Measurement m;
+    unsigned int query;
+    glGenQueries(1, &query);
+
+    // 预热: 首次分配和着色器编译不计入
+    for (int i = 0; i < 3; ++i) strategy.frame(data.data(), bytes);
+    glFinish();
+
+    glBeginQuery(GL_TIME_ELAPSED, query);
+    Clock::time_point start = Clock::now();
+    for (int i = 0; i < frames; ++i) {
+        std::memcpy(data.data(), &i, sizeof(i)); // 每帧内容都不同
+        strategy.frame(data.data(), bytes);
+    }
+    m.cpuMs = std::chrono::duration<double, std::milli>(Clock::now() - start).count() / frames;
+    glEndQuery(GL_TIME_ELAPSED);
+    GLuint64 elapsed = 0;
+    glGetQueryObjectui64v(query, GL_QUERY_RESULT, &elapsed);
+    m.gpuMs = elapsed / 1e6 / frames;
+    glDeleteQueries(1, &query);
+
+    // 延迟: 管线空闲时开始上传, 到使用这些数据的绘制在 GPU 上完成
+    std::vector<double> latencies;
+    for (int i = 0; i < 5; ++i) {
+        glFinish();
+        Clock::time_point t0 = Clock::now();
+        strategy.frame(data.data(), bytes);
+        GLsync fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+        glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, (GLuint64)-1);
+        glDeleteSync(fence);
+        latencies.push_back(std::chrono::duration<double, std::milli>(Clock::now() - t0).count());
+    }
+    std::sort(latencies.begin(), latencies.end());
+    m.latencyMs = latencies[latencies.size() / 2];
+    return m;
+}
+
+static std::string formatBytes(size_t bytes) {
+    char text[32];
+    if (bytes >= ((size_t)1 << 20)) std::snprintf(text, sizeof(text), "%zu MiB", bytes >> 20);
+    else if (bytes >= 1024) std::snprintf(text, sizeof(text), "%zu KiB", bytes >> 10);
+    else std::snprintf(text, sizeof(text), "%zu B", bytes);
+    return text;
+}
+
+int main(int argc, char** argv) {
+    size_t maxSize = (size_t)64 << 20;
+    int maxFrames = 200;
+    for (int i = 1; i < argc; ++i) {
+        if (std::strcmp(argv[i], "--max-size") == 0 && i + 1 < argc) maxSize = (size_t)std::strtoull(argv[++i], nullptr, 10);
+        else if (std::strcmp(argv[i], "--frames") == 0 && i + 1 < argc) maxFrames = std::max(1, std::atoi(argv[++i]));
+        else {
+            std::cerr << "未知参数: " << argv[i] << std::endl;
+            return 1;
+        }
+    }
+
+    glfwInit();
+    glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+    glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+#ifdef __APPLE__
+    glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE);
+#endif
+    // 尽量要高版本的上下文, 不支持的方式会被跳过
+    const int versions[][2] = { { 4, 6 }, { 4, 4 }, { 4, 3 }, { 3, 3 } };
+    GLFWwindow* window = NULL;
+    for (int i = 0; i < 4 && !window; ++i) {
+        glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, versions[i][0]);
+        glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, versions[i][1]);
+        window = glfwCreateWindow(64, 64, "buffer_upload_bench", NULL, NULL);
+    }
+    if (window == NULL) {
+        std::cerr << "无法创建 OpenGL 上下文" << std::endl;
+        glfwTerminate();
+        return -1;
+    }
+    glfwMakeContextCurrent(window);
+    glfwSwapInterval(0);
+    if (!gladLoadGLLoader((GLADloadproc)glfwGetProcAddress)) {
+        std::cerr << "Failed to initialize GLAD" << std::endl;
+        return -1;
+    }
+    loadGl43((GLADloadproc)glfwGetProcAddress);
+
+    std::cout << "GL " << glGetString(GL_VERSION) << " / " << glGetString(GL_RENDERER) << std::endl;
+    glViewport(0, 0, 1, 1);
+    unsigned int vao;
+    glGenVertexArrays(1, &vao);
+    glBindVertexArray(vao);
+
+    std::vector<std::unique_ptr<UploadStrategy> > strategies;
+    strategies.emplace_back(new UniformStrategy());
+    strategies.emplace_back(new UniformBufferStrategy(UniformBufferStrategy::SubData));
+    strategies.emplace_back(new UniformBufferStrategy(UniformBufferStrategy::Orphan));
+    strategies.emplace_back(new UniformBufferStrategy(UniformBufferStrategy::Persistent));
+    strategies.emplace_back(new WholeBufferStrategy(false));
+    strategies.emplace_back(new WholeBufferStrategy(true));
+    TransientBufferStrategy* immediate = new TransientBufferStrategy(false);
+    strategies.emplace_back(immediate);
+    strategies.emplace_back(new TransientBufferStrategy(true));
+
+    std::printf("%-15s %9s %7s %11s %11s %11s %11s\n", "strategy", "payload", "frames", "CPU ms", "GPU ms", "latency ms", "MiB/s");
+    for (size_t bytes = 64; bytes <= maxSize; bytes *= 16) {
+        std::vector<unsigned char> data(bytes);
+        for (size_t i = 0; i + 4 <= bytes; i += 4) {
+            float value = (float)(i % 1024);
+            std::memcpy(&data[i], &value, 4);
+        }
+        // 总传输量约 256 MiB, 帧数至少 8
+        int frames = (int)std::max<size_t>(8, std::min<size_t>(maxFrames, ((size_t)256 << 20) / bytes));
+
+        for (size_t s = 0; s < strategies.size(); ++s) {
+            UploadStrategy& strategy = *strategies[s];
+            if (!strategy.supports(bytes)) {
+                std::printf("%-15s %9s %7s %11s\n", strategy.name(), formatBytes(bytes).c_str(), "-", "不支持/跳过");
+                continue;
+            }
+            if (!strategy.prepare(bytes)) {
+                std::printf("%-15s %9s %7s %11s\n", strategy.name(), formatBytes(bytes).c_str(), "-", "初始化失败");
+                strategy.release();
+                continue;
+            }
+            Measurement m = measure(strategy, data, bytes, frames);
+            strategy.release();
+            double slowest = std::max(m.cpuMs, m.gpuMs);
+            std::printf("%-15s %9s %7d %11.4f %11.4f %11.4f %11.1f\n", strategy.name(), formatBytes(bytes).c_str(), frames,
+                        m.cpuMs, m.gpuMs, m.latencyMs, bytes / (1024.0 * 1024.0) / (slowest / 1000.0));
+        }
+    }
+
+    std::cout << "[vbo-immediate] 删除时 GPU 仍在使用的对象 " << immediate->busyDeletes() << " 个" << std::endl;
+    glDeletionQueue().printStats(std::cout, "vbo-deferred");
+    strategies.clear();
+    gpuMemory().printBreakdown(std::cout);
+    glDeleteVertexArrays(1, &vao);
+    glfwTerminate();
+    return 0;
+}
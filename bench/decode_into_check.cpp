@@ -0,0 +1,164 @@
+// 解码到调用者缓冲区 (stbi_load_*_into) 的正确性检查
+//
+// 用法: decode_into_check [file ...]
+//   默认检查 pyramid_texture.jpg (构建时复制到可执行文件旁边), 另外总是检查程序内生成的
+//   灰度 / 灰度+alpha / RGB / RGBA 四种 PNG (不压缩的 deflate 块, 走 PNG 直接解码的路径)。
+//
+// 每个输入在 垂直翻转 开/关 x 请求 1/2/3/4 通道 x 行距 (紧密 / 多 1 字节 / 4 字节对齐 / 多 64 字节)
+// 下比较 stbi_load_from_memory_into 与 stbi_load_from_memory 的结果, 并确认行间的填充字节
+// 没有被改写。任何一项不一致时打印该组合并返回 1。
+
+#define STB_IMAGE_IMPLEMENTATION
+#include "stb_image.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+struct Input {
+    std::string name;
+    std::vector<unsigned char> bytes;
+};
+
+static unsigned int crc32(const unsigned char* data, size_t size, unsigned int crc = 0) {
+    crc = ~crc;
+    for (size_t i = 0; i < size; ++i) {
+        crc ^= data[i];
+        for (int k = 0; k < 8; ++k) crc = (crc >> 1) ^ (0xedb88320u & (0u - (crc & 1u)));
+    }
+    return ~crc;
+}
+
+static void putBigEndian(std::vector<unsigned char>& out, unsigned int value) {
+    for (int shift = 24; shift >= 0; shift -= 8) out.push_back((unsigned char)(value >> shift));
+}
+
+static void pngChunk(std::vector<unsigned char>& png, const char* type, const std::vector<unsigned char>& data) {
+    putBigEndian(png, (unsigned int)data.size());
+    size_t start = png.size();
+    png.insert(png.end(), type, type + 4);
+    png.insert(png.end(), data.begin(), data.end());
+    putBigEndian(png, crc32(&png[start], png.size() - start));
+}
+
+// 8 位 PNG, 每行使用不同的过滤类型, 用不压缩的 deflate 块存储
+static std::vector<unsigned char> makePng(int width, int height, int channels) {
+    static const unsigned char colorType[5] = { 0, 0, 4, 2, 6 };
+    std::vector<unsigned char> raw;
+    for (int y = 0; y < height; ++y) {
+        raw.push_back((unsigned char)(y % 5)); // 过滤类型 0..4, 解码器只需反过滤, 内容任意
+        for (int x = 0; x < width * channels; ++x) raw.push_back((unsigned char)((x * 7 + y * 13) ^ (x * y)));
+    }
+
+    std::vector<unsigned char> z = { 0x78, 0x01 };
+    for (size_t pos = 0; pos < raw.size(); pos += 65535) {
+        size_t len = std::min<size_t>(65535, raw.size() - pos);
+        z.push_back(pos + len == raw.size() ? 1 : 0);
+        z.push_back((unsigned char)len);
+        z.push_back((unsigned char)(len >> 8));
+        z.push_back((unsigned char)~len);
+        z.push_back((unsigned char)(~len >> 8));
+        z.insert(z.end(), raw.begin() + pos, raw.begin() + pos + len);
+    }
+    unsigned int a = 1, b = 0;
+    for (size_t i = 0; i < raw.size(); ++i) {
+        a = (a + raw[i]) % 65521;
+        b = (b + a) % 65521;
+    }
+    putBigEndian(z, b << 16 | a);
+
+    std::vector<unsigned char> png = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1a, '\n' };
+    std::vector<unsigned char> header;
+    putBigEndian(header, (unsigned int)width);
+    putBigEndian(header, (unsigned int)height);
+    header.push_back(8);
+    header.push_back(colorType[channels]);
+    header.push_back(0);
+    header.push_back(0);
+    header.push_back(0);
+    pngChunk(png, "IHDR", header);
+    pngChunk(png, "IDAT", z);
+    pngChunk(png, "IEND", std::vector<unsigned char>());
+    return png;
+}
+
+// 返回不一致的组合数
+static int check(const Input& input) {
+    static const char* strideNames[4] = { "紧密", "+1", "4 对齐", "+64" };
+    int failures = 0, cases = 0;
+    for (int flip = 0; flip <= 1; ++flip) {
+        stbi_set_flip_vertically_on_load(flip);
+        for (int channels = 1; channels <= 4; ++channels) {
+            int width, height, n;
+            stbi_uc* expected = stbi_load_from_memory(input.bytes.data(), (int)input.bytes.size(), &width, &height, &n, channels);
+            if (!expected) {
+                std::cerr << input.name << ": stbi_load 失败: " << stbi_failure_reason() << std::endl;
+                return 1;
+            }
+            size_t row = (size_t)width * channels;
+            size_t strides[4] = { row, row + 1, (row + 3) & ~(size_t)3, row + 64 };
+            for (int s = 0; s < 4; ++s) {
+                const unsigned char fill = 0xa5;
+                size_t stride = strides[s];
+                std::vector<unsigned char> out(stride * (height - 1) + row, fill);
+                int w, h;
+                bool ok = stbi_load_from_memory_into(input.bytes.data(), (int)input.bytes.size(), out.data(), stride,
+                                                     out.size(), &w, &h, NULL, channels) != 0;
+                size_t pixelDiffs = 0, paddingWrites = 0;
+                for (int y = 0; ok && y < height; ++y) {
+                    const unsigned char* got = &out[(size_t)y * stride];
+                    pixelDiffs += (size_t)(std::memcmp(got, expected + (size_t)y * row, row) != 0);
+                    for (size_t x = row; x < stride && (size_t)y * stride + x < out.size(); ++x)
+                        paddingWrites += got[x] != fill;
+                }
+                ++cases;
+                if (!ok || w != width || h != height || pixelDiffs || paddingWrites) {
+                    std::printf("  不一致: %s 翻转 %d, %d 通道, 行距 %s (%zu): %s, %zu 行不同, %zu 个填充字节被改写\n",
+                                input.name.c_str(), flip, channels, strideNames[s], stride,
+                                ok ? "解码成功" : stbi_failure_reason(), pixelDiffs, paddingWrites);
+                    ++failures;
+                }
+            }
+            stbi_image_free(expected);
+        }
+    }
+    stbi_set_flip_vertically_on_load(0);
+    std::printf("%-24s %d 项, %d 项不一致\n", input.name.c_str(), cases, failures);
+    return failures;
+}
+
+int main(int argc, char** argv) {
+    std::vector<Input> inputs;
+    std::vector<std::string> files;
+    for (int i = 1; i < argc; ++i) files.push_back(argv[i]);
+    if (files.empty()) files.push_back("pyramid_texture.jpg");
+    for (size_t i = 0; i < files.size(); ++i) {
+        std::ifstream in(files[i].c_str(), std::ios::binary);
+        Input input;
+        input.name = files[i];
+        input.bytes.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+        if (input.bytes.empty()) {
+            std::cerr << "无法读取 " << files[i] << std::endl;
+            return 1;
+        }
+        inputs.push_back(input);
+    }
+    // 奇数宽度, 行字节数不是 4 的倍数
+    static const char* pngNames[5] = { "", "png gray 37x23", "png gray+alpha 37x23", "png rgb 37x23", "png rgba 37x23" };
+    for (int channels = 1; channels <= 4; ++channels) {
+        Input input;
+        input.name = pngNames[channels];
+        input.bytes = makePng(37, 23, channels);
+        inputs.push_back(input);
+    }
+
+    int failures = 0;
+    for (size_t i = 0; i < inputs.size(); ++i) failures += check(inputs[i]);
+    return failures ? 1 : 0;
+}
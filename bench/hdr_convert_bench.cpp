@@ -0,0 +1,152 @@
+// HDR (Radiance RGBE) 转半精度浮点的基准测试
+//
+// 用法: hdr_convert_bench [--size N] [--iterations N]
+//   --size        图像边长, 默认 4096
+//   --iterations  每项重复次数, 取中位数, 默认 5
+//
+// 对比:
+//   只转换: stb 的 float 展开 (每像素 ldexp, 同 stbi__hdr_convert) / 标量 RGBE->half / SIMD RGBE->half
+//   完整加载: stbi_loadf (float RGB, 之后由 GL 转换) / stbi_load_hdr_rgbe + rgbeToHalfRgb (GL_RGB16F 直接上传)
+// 测试图像在内存中生成并编码成 RLE 扫描行格式的 .hdr。同时检查 SIMD 与标量结果逐位一致,
+// 以及与 stb 的 float 结果转半精度后一致。hdr_convert_bench_f16c 是打开 -mf16c 的版本。
+
+#define STB_IMAGE_IMPLEMENTATION
+#include "stb_image.h"
+#include "common/half_float.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+typedef std::chrono::steady_clock Clock;
+
+// 新式 RLE 扫描行: 每行先写 2,2,宽度, 再按通道写, 这里只用不超过 128 字节的原样块
+static std::vector<unsigned char> encodeHdr(const std::vector<unsigned char>& rgbe, int width, int height) {
+    std::string header = "#?RADIANCE\nFORMAT=32-bit_rle_rgbe\n\n-Y " + std::to_string(height) + " +X " + std::to_string(width) + "\n";
+    std::vector<unsigned char> file(header.begin(), header.end());
+    for (int y = 0; y < height; ++y) {
+        file.push_back(2);
+        file.push_back(2);
+        file.push_back((unsigned char)(width >> 8));
+        file.push_back((unsigned char)(width & 0xFF));
+        for (int c = 0; c < 4; ++c) {
+            for (int x = 0; x < width;) {
+                int n = std::min(128, width - x);
+                file.push_back((unsigned char)n);
+                for (int i = 0; i < n; ++i) file.push_back(rgbe[((size_t)y * width + x + i) * 4 + c]);
+                x += n;
+            }
+        }
+    }
+    return file;
+}
+
+static void stbFloatExpand(const unsigned char* rgbe, float* out, size_t pixels) {
+    for (size_t i = 0; i < pixels; ++i, rgbe += 4, out += 3) {
+        if (rgbe[3] != 0) {
+            float f1 = (float)std::ldexp(1.0f, rgbe[3] - (int)(128 + 8));
+            out[0] = rgbe[0] * f1;
+            out[1] = rgbe[1] * f1;
+            out[2] = rgbe[2] * f1;
+        } else {
+            out[0] = out[1] = out[2] = 0.0f;
+        }
+    }
+}
+
+template <typename Fn>
+static double medianMs(int iterations, const Fn& fn) {
+    std::vector<double> times;
+    for (int i = 0; i < iterations; ++i) {
+        Clock::time_point start = Clock::now();
+        fn();
+        times.push_back(std::chrono::duration<double, std::milli>(Clock::now() - start).count());
+    }
+    std::sort(times.begin(), times.end());
+    return times[times.size() / 2];
+}
+
+static const char* simdPath() {
+#if defined(HALF_FLOAT_SSE2) && defined(__F16C__)
+    return "F16C";
+#elif defined(HALF_FLOAT_SSE2)
+    return "SSE2";
+#else
+    return "scalar";
+#endif
+}
+
+int main(int argc, char** argv) {
+    int size = 4096;
+    int iterations = 5;
+    for (int i = 1; i < argc; ++i) {
+        if (std::strcmp(argv[i], "--size") == 0 && i + 1 < argc) size = std::max(8, std::atoi(argv[++i]));
+        else if (std::strcmp(argv[i], "--iterations") == 0 && i + 1 < argc) iterations = std::max(1, std::atoi(argv[++i]));
+        else {
+            std::cerr << "未知参数: " << argv[i] << std::endl;
+            return 1;
+        }
+    }
+
+    // 亮度大多在 [2^-8, 2^8], 夹杂纯黑、极暗 (非规格化半精度) 和超出半精度范围的像素
+    const size_t pixels = (size_t)size * size;
+    std::vector<unsigned char> rgbe(pixels * 4);
+    std::mt19937 rng(3);
+    for (size_t i = 0; i < pixels; ++i) {
+        unsigned r = rng();
+        int exponent = 120 + (int)(r % 17);
+        if (r % 97 == 0) exponent = 0;
+        else if (r % 89 == 0) exponent = 100 + (int)(r % 12);
+        else if (r % 83 == 0) exponent = 140 + (int)(r % 40);
+        rgbe[i * 4 + 0] = (unsigned char)(128 + rng() % 128);
+        rgbe[i * 4 + 1] = (unsigned char)(rng() % 256);
+        rgbe[i * 4 + 2] = (unsigned char)(rng() % 256);
+        rgbe[i * 4 + 3] = (unsigned char)exponent;
+    }
+
+    std::vector<float> floats(pixels * 3);
+    std::vector<uint16_t> scalarHalf(pixels * 3), simdHalf(pixels * 3);
+    double floatMs = medianMs(iterations, [&]() { stbFloatExpand(rgbe.data(), floats.data(), pixels); });
+    double scalarMs = medianMs(iterations, [&]() { rgbeToHalfRgbScalar(rgbe.data(), scalarHalf.data(), pixels); });
+    double simdMs = medianMs(iterations, [&]() { rgbeToHalfRgb(rgbe.data(), simdHalf.data(), pixels); });
+
+    size_t mismatches = 0;
+    for (size_t i = 0; i < pixels * 3; ++i) {
+        if (simdHalf[i] != scalarHalf[i] || halfFromFloat(floats[i]) != scalarHalf[i]) mismatches++;
+    }
+
+    std::cout << "转换路径: " << simdPath() << ", 图像 " << size << "x" << size << std::endl;
+    std::printf("%-22s %10s %12s %12s\n", "convert only", "ms", "Mpixel/s", "out MiB");
+    std::printf("%-22s %10.2f %12.1f %12.1f\n", "stb float expand", floatMs, pixels / 1e3 / floatMs, pixels * 12 / 1048576.0);
+    std::printf("%-22s %10.2f %12.1f %12.1f\n", "rgbe->half scalar", scalarMs, pixels / 1e3 / scalarMs, pixels * 6 / 1048576.0);
+    std::printf("%-22s %10.2f %12.1f %12.1f\n", "rgbe->half simd", simdMs, pixels / 1e3 / simdMs, pixels * 6 / 1048576.0);
+
+    std::vector<unsigned char> file = encodeHdr(rgbe, size, size);
+    double loadFloatMs = medianMs(iterations, [&]() {
+        int w, h, n;
+        float* data = stbi_loadf_from_memory(file.data(), (int)file.size(), &w, &h, &n, 3);
+        stbi_image_free(data);
+    });
+    double loadHalfMs = medianMs(iterations, [&]() {
+        int w, h;
+        unsigned char* data = stbi_load_hdr_rgbe_from_memory(file.data(), (int)file.size(), &w, &h);
+        if (data) rgbeToHalfRgb(data, simdHalf.data(), (size_t)w * h);
+        stbi_image_free(data);
+    });
+    std::printf("%-22s %10s\n", "full load", "ms");
+    std::printf("%-22s %10.2f\n", "stbi_loadf (float)", loadFloatMs);
+    std::printf("%-22s %10.2f\n", "rgbe + half", loadHalfMs);
+
+    if (mismatches) {
+        std::cerr << mismatches << " 个通道与标量/参考结果不一致" << std::endl;
+        return 1;
+    }
+    return 0;
+}
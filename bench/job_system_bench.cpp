@@ -0,0 +1,166 @@
+// 任务系统 (common/job_system.h) 从 1 到 N 个线程的扩展性测试
+//
+// 用法: job_system_bench [--max-threads N] [--iterations N]
+//   --max-threads  最多使用的线程数 (含调用线程), 默认 hardware_concurrency
+//   --iterations   每项重复次数, 取中位数, 默认 5
+//
+// 每个线程数新建一个 JobSystem, 依次运行:
+//   sphere    parallelFor 按行生成 2048x1024 的球体网格 (与 task1 generateSphere 相同的布局), 每任务 32 行
+//   resample  parallelFor 把 4096x4096 RGBA 用 lanczos3 缩小到 0.7 倍 (task2 的纹理预算路径), 每任务 16 行
+//   bodies    JobGroup: 256K 个天体每 1024 个一块计算模型矩阵, 卫星块依赖所属的行星块
+//   overhead  parallelFor 对 4M 个元素做一次加法, 每任务 256 个: 几乎只剩调度开销
+// 输出耗时、相对 1 个线程的加速比、并行效率和每次运行的窃取次数。
+
+#include "common/image_resample.h"
+#include "common/job_system.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+typedef std::chrono::steady_clock Clock;
+
+static const double kPi = 3.14159265358979323846;
+
+struct Workload {
+    const char* name;
+    void (*run)(JobSystem& system);
+};
+
+static void sphereWorkload(JobSystem& system) {
+    const int sectors = 2048, stacks = 1024;
+    static std::vector<float> vertices;
+    static std::vector<unsigned int> indices;
+    vertices.assign((size_t)(stacks + 1) * (sectors + 1) * 6, 0.0f);
+    indices.assign((size_t)(2 * stacks - 2) * sectors * 3, 0u);
+    float sectorStep = 2.0f * (float)kPi / sectors, stackStep = (float)kPi / stacks;
+    parallelFor(0, stacks + 1, 32, [&](size_t first, size_t last) {
+        for (int i = (int)first; i < (int)last; ++i) {
+            float stackAngle = (float)kPi / 2.0f - i * stackStep;
+            float xy = cosf(stackAngle), z = sinf(stackAngle);
+            float* v = &vertices[(size_t)i * (sectors + 1) * 6];
+            for (int j = 0; j <= sectors; ++j, v += 6) {
+                float x = xy * cosf(j * sectorStep), y = xy * sinf(j * sectorStep);
+                v[0] = v[3] = x;
+                v[1] = v[4] = y;
+                v[2] = v[5] = z;
+            }
+            if (i == stacks) continue;
+            unsigned int k1 = i * (sectors + 1), k2 = k1 + sectors + 1;
+            unsigned int* out = &indices[(size_t)(2 * i - std::min(i, 1)) * sectors * 3];
+            for (int j = 0; j < sectors; ++j, ++k1, ++k2) {
+                if (i != 0) { *out++ = k1; *out++ = k2; *out++ = k1 + 1; }
+                if (i != stacks - 1) { *out++ = k1 + 1; *out++ = k2; *out++ = k2 + 1; }
+            }
+        }
+    }, system);
+}
+
+static void resampleWorkload(JobSystem& system) {
+    const int size = 4096, dstSize = size * 7 / 10, channels = 4;
+    static std::vector<unsigned char> src, dst;
+    if (src.empty()) {
+        src.resize((size_t)size * size * channels);
+        for (size_t i = 0; i < src.size(); ++i) src[i] = (unsigned char)((i * 2654435761u) >> 24);
+        dst.resize((size_t)dstSize * dstSize * channels);
+    }
+    resampleImageWith(src.data(), size, size, (size_t)size * channels, dst.data(), dstSize, dstSize,
+                      (size_t)dstSize * channels, channels,
+                      [&system](int begin, int end, const std::function<void(int, int)>& rows) {
+        parallelFor(begin, end, 16, [&rows](size_t first, size_t last) { rows((int)first, (int)last); }, system);
+    });
+}
+
+// 简化的天体变换: 公转 + 自转 + 缩放, 卫星在所属行星的位置上再公转
+static void bodiesWorkload(JobSystem& system) {
+    const size_t bodies = (size_t)1 << 18, block = 1024;
+    static std::vector<float> planets, moons; // 每个 4x4 矩阵 16 个 float
+    planets.assign(bodies * 16, 0.0f);
+    moons.assign(bodies * 16, 0.0f);
+    const float time = 12.5f;
+    JobGroup group(system);
+    for (size_t first = 0; first < bodies; first += block) {
+        size_t last = std::min(bodies, first + block);
+        JobGroup::Id planet = group.add([first, last, time]() {
+            for (size_t b = first; b < last; ++b) {
+                float angle = time * (0.1f + b * 1e-6f), spin = time * 0.7f, radius = 5.0f + b * 1e-4f;
+                float* m = &planets[b * 16];
+                m[0] = cosf(spin) * 0.3f; m[2] = -sinf(spin) * 0.3f; m[5] = 0.3f;
+                m[8] = sinf(spin) * 0.3f; m[10] = cosf(spin) * 0.3f; m[15] = 1.0f;
+                m[12] = radius * cosf(angle); m[14] = radius * sinf(angle);
+            }
+        });
+        group.add([first, last, time]() {
+            for (size_t b = first; b < last; ++b) {
+                const float* p = &planets[b * 16];
+                float angle = time * 2.5f + b * 1e-3f;
+                float* m = &moons[b * 16];
+                m[0] = m[5] = m[10] = 0.05f;
+                m[15] = 1.0f;
+                m[12] = p[12] + 0.8f * cosf(angle);
+                m[14] = p[14] + 0.8f * sinf(angle);
+            }
+        }, { planet });
+    }
+    group.wait();
+}
+
+static void overheadWorkload(JobSystem& system) {
+    static std::vector<float> values((size_t)4 << 20, 1.0f);
+    parallelFor(0, values.size(), 256, [](size_t first, size_t last) {
+        for (size_t i = first; i < last; ++i) values[i] += 1.0f;
+    }, system);
+}
+
+int main(int argc, char** argv) {
+    int maxThreads = std::max(1, (int)std::thread::hardware_concurrency());
+    int iterations = 5;
+    for (int i = 1; i < argc; ++i) {
+        if (std::strcmp(argv[i], "--max-threads") == 0 && i + 1 < argc) maxThreads = std::max(1, std::atoi(argv[++i]));
+        else if (std::strcmp(argv[i], "--iterations") == 0 && i + 1 < argc) iterations = std::max(1, std::atoi(argv[++i]));
+        else {
+            std::cerr << "未知参数: " << argv[i] << std::endl;
+            return 1;
+        }
+    }
+
+    const Workload workloads[] = {
+        { "sphere", sphereWorkload },
+        { "resample", resampleWorkload },
+        { "bodies", bodiesWorkload },
+        { "overhead", overheadWorkload },
+    };
+    const int workloadCount = (int)(sizeof(workloads) / sizeof(workloads[0]));
+
+    std::cout << "硬件线程 " << std::thread::hardware_concurrency() << ", 测试 1.." << maxThreads << " 个线程, 每项 "
+              << iterations << " 次取中位数" << std::endl;
+    std::printf("%-9s %7s %10s %8s %10s %12s\n", "workload", "threads", "ms", "speedup", "efficiency", "steals/run");
+
+    std::vector<double> baseline(workloadCount, 0.0);
+    for (int threads = 1; threads <= maxThreads; ++threads) {
+        JobSystem system(threads);
+        for (int w = 0; w < workloadCount; ++w) {
+            workloads[w].run(system); // 预热: 分配缓冲, 唤醒工作线程
+            size_t stealsBefore = system.steals();
+            std::vector<double> times;
+            for (int i = 0; i < iterations; ++i) {
+                Clock::time_point start = Clock::now();
+                workloads[w].run(system);
+                times.push_back(std::chrono::duration<double, std::milli>(Clock::now() - start).count());
+            }
+            std::sort(times.begin(), times.end());
+            double ms = times[times.size() / 2];
+            if (threads == 1) baseline[w] = ms;
+            double speedup = baseline[w] / ms;
+            std::printf("%-9s %7d %10.3f %7.2fx %9.0f%% %12.1f\n", workloads[w].name, threads, ms, speedup,
+                        100.0 * speedup / threads, (double)(system.steals() - stealsBefore) / iterations);
+        }
+    }
+    return 0;
+}
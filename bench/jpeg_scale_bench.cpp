@@ -0,0 +1,108 @@
+// JPEG 缩小解码 (stbi_set_jpeg_scale_denom) 的基准测试
+//
+// 用法: jpeg_scale_bench [--file path.jpg] [--iterations N]
+//   --file        测试图像, 默认 pyramid_texture.jpg (构建时复制到可执行文件旁边)
+//   --iterations  每项重复次数, 取中位数, 默认 5
+//
+// 对 1/2, 1/4, 1/8 三种比例比较:
+//   完整解码 + 缩小  stbi_load 得到原尺寸, 再用 common/image_resample.h 单线程缩到同样尺寸
+//   缩小解码        解码时直接用缩小的 IDCT (1/8 只用 DC 系数)
+// 并给出两者之间的 PSNR, 用来确认缩小解码的画质与先解码再缩小相当。
+
+#define STB_IMAGE_IMPLEMENTATION
+#include "stb_image.h"
+#include "common/image_resample.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <vector>
+
+typedef std::chrono::steady_clock Clock;
+
+template <typename Fn>
+static double medianMs(int iterations, const Fn& fn) {
+    std::vector<double> times;
+    for (int i = 0; i < iterations; ++i) {
+        Clock::time_point start = Clock::now();
+        fn();
+        times.push_back(std::chrono::duration<double, std::milli>(Clock::now() - start).count());
+    }
+    std::sort(times.begin(), times.end());
+    return times[times.size() / 2];
+}
+
+static double psnr(const unsigned char* a, const unsigned char* b, size_t count) {
+    double se = 0.0;
+    for (size_t i = 0; i < count; ++i) {
+        double d = (double)a[i] - b[i];
+        se += d * d;
+    }
+    return se == 0.0 ? 99.0 : 10.0 * std::log10(255.0 * 255.0 * count / se);
+}
+
+int main(int argc, char** argv) {
+    const char* path = "pyramid_texture.jpg";
+    int iterations = 5;
+    for (int i = 1; i < argc; ++i) {
+        if (std::strcmp(argv[i], "--file") == 0 && i + 1 < argc) path = argv[++i];
+        else if (std::strcmp(argv[i], "--iterations") == 0 && i + 1 < argc) iterations = std::max(1, std::atoi(argv[++i]));
+        else {
+            std::cerr << "未知参数: " << argv[i] << std::endl;
+            return 1;
+        }
+    }
+
+    std::ifstream in(path, std::ios::binary);
+    std::vector<unsigned char> file((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+    int width, height, channels;
+    if (file.empty() || !stbi_info_from_memory(file.data(), (int)file.size(), &width, &height, &channels)) {
+        std::cerr << "无法读取 " << path << std::endl;
+        return 1;
+    }
+
+    stbi_set_jpeg_scale_denom(1);
+    double fullMs = medianMs(iterations, [&]() {
+        int w, h, n;
+        stbi_image_free(stbi_load_from_memory(file.data(), (int)file.size(), &w, &h, &n, channels));
+    });
+
+    std::cout << path << ": " << width << "x" << height << ", " << channels << " 通道, 完整解码 " << fullMs << " ms" << std::endl;
+    std::printf("%-6s %11s %-9s %14s %14s %9s %10s\n", "scale", "dst", "filter", "full+resize ms", "reduced ms", "speedup", "PSNR dB");
+
+    for (int denom = 2; denom <= 8; denom *= 2) {
+        stbi_set_jpeg_scale_denom(denom);
+        int dstWidth, dstHeight, n;
+        stbi_uc* reduced = stbi_load_from_memory(file.data(), (int)file.size(), &dstWidth, &dstHeight, &n, channels);
+        double reducedMs = medianMs(iterations, [&]() {
+            int w, h, c;
+            stbi_image_free(stbi_load_from_memory(file.data(), (int)file.size(), &w, &h, &c, channels));
+        });
+
+        stbi_set_jpeg_scale_denom(1);
+        std::vector<unsigned char> resized((size_t)dstWidth * dstHeight * channels);
+        ResampleFilter filter = chooseResampleFilter(width, height, dstWidth, dstHeight);
+        double resizeMs = medianMs(iterations, [&]() {
+            int w, h, c;
+            stbi_uc* full = stbi_load_from_memory(file.data(), (int)file.size(), &w, &h, &c, channels);
+            resampleImage(full, w, h, (size_t)w * channels, resized.data(), dstWidth, dstHeight,
+                          (size_t)dstWidth * channels, channels, 1);
+            stbi_image_free(full);
+        });
+
+        char scale[8], dims[32];
+        std::snprintf(scale, sizeof(scale), "1/%d", denom);
+        std::snprintf(dims, sizeof(dims), "%dx%d", dstWidth, dstHeight);
+        std::printf("%-6s %11s %-9s %14.2f %14.2f %8.2fx %10.1f\n", scale, dims,
+                    filter == ResampleFilter::Box ? "box" : "lanczos3", resizeMs, reducedMs, resizeMs / reducedMs,
+                    psnr(reduced, resized.data(), resized.size()));
+        stbi_image_free(reduced);
+    }
+    return 0;
+}
@@ -0,0 +1,106 @@
+// 渐进式 JPEG 逐扫描解码 (stbi_progressive_*) 的基准测试
+//
+// 用法: progressive_jpeg_bench --file path.jpg [--iterations N]
+//   --file        渐进式 JPEG (基线 JPEG 不适用, 仓库里的 pyramid_texture.jpg 就是基线的)
+//   --iterations  重复次数, 取中位数, 默认 5
+//
+// 输出每个扫描解码完成的时刻, 以及此时生成 1/8 尺寸和原尺寸图像各需多久;
+// 最后对比 "首次可见" (第一个扫描 + 1/8 图像, task2 第一次上传的内容) 与 stbi_load 完整解码的耗时。
+
+#define STB_IMAGE_IMPLEMENTATION
+#include "stb_image.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <vector>
+
+typedef std::chrono::steady_clock Clock;
+
+static double msSince(Clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+}
+
+static double median(std::vector<double> values) {
+    std::sort(values.begin(), values.end());
+    return values[values.size() / 2];
+}
+
+int main(int argc, char** argv) {
+    const char* path = NULL;
+    int iterations = 5;
+    for (int i = 1; i < argc; ++i) {
+        if (std::strcmp(argv[i], "--file") == 0 && i + 1 < argc) path = argv[++i];
+        else if (std::strcmp(argv[i], "--iterations") == 0 && i + 1 < argc) iterations = std::max(1, std::atoi(argv[++i]));
+        else {
+            std::cerr << "未知参数: " << argv[i] << std::endl;
+            return 1;
+        }
+    }
+    if (!path) {
+        std::cerr << "需要用 --file 指定一个渐进式 JPEG" << std::endl;
+        return 1;
+    }
+
+    std::ifstream in(path, std::ios::binary);
+    std::vector<unsigned char> file((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+    stbi_progressive* probe = file.empty() ? NULL : stbi_progressive_open_memory(file.data(), (int)file.size(), 0);
+    if (!probe) {
+        std::cerr << "无法打开 " << path << " (" << stbi_failure_reason() << ")" << std::endl;
+        return 1;
+    }
+    stbi_progressive_close(probe);
+
+    std::vector<double> fullTimes;
+    int width = 0, height = 0, channels = 0;
+    for (int i = 0; i < iterations; ++i) {
+        Clock::time_point start = Clock::now();
+        stbi_image_free(stbi_load_from_memory(file.data(), (int)file.size(), &width, &height, &channels, 0));
+        fullTimes.push_back(msSince(start));
+    }
+
+    // scanTimes[k][i]: 第 i 次运行中第 k 个扫描完成的时刻 (不含生成图像的时间)
+    std::vector<std::vector<double> > scanTimes, smallTimes, fullImageTimes;
+    for (int i = 0; i < iterations; ++i) {
+        double spent = 0.0;   // 已花在解码扫描上的时间
+        Clock::time_point start = Clock::now();
+        stbi_progressive* p = stbi_progressive_open_memory(file.data(), (int)file.size(), 0);
+        for (int k = 0; stbi_progressive_scan(p); ++k) {
+            spent += msSince(start);
+            if (scanTimes.size() <= (size_t)k) {
+                scanTimes.resize(k + 1);
+                smallTimes.resize(k + 1);
+                fullImageTimes.resize(k + 1);
+            }
+            scanTimes[k].push_back(spent);
+
+            int w, h, n;
+            Clock::time_point imageStart = Clock::now();
+            stbi_image_free(stbi_progressive_image(p, 8, &w, &h, &n));
+            smallTimes[k].push_back(msSince(imageStart));
+            imageStart = Clock::now();
+            stbi_image_free(stbi_progressive_image(p, 1, &w, &h, &n));
+            fullImageTimes[k].push_back(msSince(imageStart));
+            start = Clock::now();
+        }
+        stbi_progressive_close(p);
+    }
+
+    double fullMs = median(fullTimes);
+    std::cout << path << ": " << width << "x" << height << ", " << channels << " 通道, " << scanTimes.size()
+              << " 个扫描, stbi_load 完整解码 " << fullMs << " ms" << std::endl;
+    std::printf("%-5s %14s %14s %14s\n", "scan", "decoded at ms", "1/8 image ms", "full image ms");
+    for (size_t k = 0; k < scanTimes.size(); ++k)
+        std::printf("%-5d %14.2f %14.2f %14.2f\n", (int)k + 1, median(scanTimes[k]), median(smallTimes[k]), median(fullImageTimes[k]));
+
+    double firstVisible = median(scanTimes[0]) + median(smallTimes[0]);
+    double finalImage = median(scanTimes.back()) + median(fullImageTimes.back());
+    std::printf("首次可见 %.2f ms (完整解码的 %.0f%%), 全部扫描 + 最终图像 %.2f ms\n", firstVisible,
+                100.0 * firstVisible / fullMs, finalImage);
+    return 0;
+}
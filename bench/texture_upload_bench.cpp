@@ -0,0 +1,377 @@
+// 纹理上传方式的基准测试, 结果写成 JSON 便于跟踪
+//
+// 用法: texture_upload_bench [--json PATH] [--max-size N] [--iterations N]
+//   --json        结果文件, 默认 texture_upload_bench.json
+//   --max-size    最大边长, 默认 8192 (从 256 开始每次乘 2)
+//   --iterations  每项测量的上传次数上限, 默认 20 (大纹理自动减少, 至少 3 次)
+//
+// 对比的维度:
+//   分配方式  teximage: 每次上传都 glTexImage2D 重新定义 (task2 的做法)
+//             storage:  glTexStorage2D 一次分配不可变存储, 之后只 glTexSubImage2D (GL 4.2)
+//   传输方式  sync:           直接从客户端内存 glTexSubImage2D, 由驱动复制
+//             pbo:            单个 PBO, 写入前等待上一次上传读完 (完全串行)
+//             pbo-double:     两个 PBO 交替, 写一个的同时 GPU 读另一个
+//             pbo-persistent: 持久映射的两段 PBO (GL 4.4), 省去每次 map/unmap
+//   像素格式  rgb / rgba / bgra (bgra 用 GL_UNSIGNED_INT_8_8_8_8_REV, 通常是驱动的原生布局)
+//   对齐      aligned: 数据起点 4 字节对齐, GL_UNPACK_ALIGNMENT 4
+//             unaligned: 数据起点偏移 1 字节, GL_UNPACK_ALIGNMENT 1
+// 另外单独测量每个尺寸 glGenerateMipmap 的耗时。
+// CPU 时间只包括提交 (含写入 PBO 的 memcpy), 总时间包括 glFinish 等 GPU 完成, 吞吐量按总时间计算。
+// 最后按类别打印纹理和 PBO 的显存峰值 (common/gpu_memory.h), 同样写入 JSON。
+
+#include "common/gl43.h"
+#include "common/gpu_memory.h"
+#include <GLFW/glfw3.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <vector>
+
+typedef std::chrono::steady_clock Clock;
+
+enum Transfer { Sync, Pbo, PboDouble, PboPersistent };
+enum Format { Rgb, Rgba, Bgra };
+
+struct UploadCase {
+    bool texStorage;
+    Transfer transfer;
+    Format format;
+    bool aligned;
+};
+
+struct CaseResult {
+    UploadCase upload;
+    int size;
+    int iterations;
+    double cpuMs;    // 每次上传
+    double gpuMs;
+    double totalMs;
+    double mibPerSecond;
+};
+
+struct MipmapResult {
+    int size;
+    int levels;
+    double cpuMs;
+    double gpuMs;
+};
+
+static const char* kTransferNames[] = { "sync", "pbo", "pbo-double", "pbo-persistent" };
+static const char* kFormatNames[] = { "rgb", "rgba", "bgra" };
+
+static int bytesPerPixel(Format format) { return format == Rgb ? 3 : 4; }
+
+static void formatEnums(Format format, GLenum& internalFormat, GLenum& pixelFormat, GLenum& type) {
+    internalFormat = format == Rgb ? GL_RGB8 : GL_RGBA8;
+    pixelFormat = format == Rgb ? GL_RGB : format == Rgba ? GL_RGBA : GL_BGRA;
+    type = format == Bgra ? GL_UNSIGNED_INT_8_8_8_8_REV : GL_UNSIGNED_BYTE;
+}
+
+static bool contextAtLeast(int major, int minor) {
+    GLint ctxMajor = 0, ctxMinor = 0;
+    glGetIntegerv(GL_MAJOR_VERSION, &ctxMajor);
+    glGetIntegerv(GL_MINOR_VERSION, &ctxMinor);
+    return ctxMajor > major || (ctxMajor == major && ctxMinor >= minor);
+}
+
+static int mipLevels(int size) {
+    int levels = 1;
+    while (size > 1) { size >>= 1; ++levels; }
+    return levels;
+}
+
+static void waitAndDelete(GLsync& fence) {
+    if (!fence) return;
+    glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, (GLuint64)-1);
+    glDeleteSync(fence);
+    fence = 0;
+}
+
+// 一项测量: 分配纹理和 PBO, 预热一次后计时 iterations 次上传
+static CaseResult runCase(const UploadCase& c, int size, int iterations, const std::vector<unsigned char>& source) {
+    GLenum internalFormat, pixelFormat, type;
+    formatEnums(c.format, internalFormat, pixelFormat, type);
+    const size_t imageBytes = (size_t)size * size * bytesPerPixel(c.format);
+    const size_t offset = c.aligned ? 0 : 1;
+    const int slotCount = c.transfer == Pbo ? 1 : c.transfer == Sync ? 0 : 2;
+    const size_t slotBytes = imageBytes + offset;
+
+    glPixelStorei(GL_UNPACK_ALIGNMENT, c.aligned ? 4 : 1);
+
+    unsigned int texture;
+    glGenTextures(1, &texture);
+    glBindTexture(GL_TEXTURE_2D, texture);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    if (c.texStorage)
+        glTexStorage2D(GL_TEXTURE_2D, 1, internalFormat, size, size);
+    // teximage 每次上传都以同样大小重新定义第 0 级, 只需登记一次
+    gpuTrackTexture(texture, internalFormat, size, size, 1, GpuCategory::Texture);
+
+    unsigned int pbos[2] = { 0, 0 };
+    GLsync fences[2] = { 0, 0 };
+    unsigned char* persistent = nullptr;
+    if (c.transfer == PboPersistent) {
+        // 一个缓冲分两段, 第 i 段从 i * slotBytes 开始
+        GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+        glGenBuffers(1, pbos);
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, pbos[0]);
+        glBufferStorage(GL_PIXEL_UNPACK_BUFFER, slotBytes * 2, nullptr, flags);
+        gpuMemory().track(GpuObjectKind::Buffer, pbos[0], GpuCategory::PixelBuffer, slotBytes * 2);
+        persistent = (unsigned char*)glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, slotBytes * 2, flags);
+    } else if (slotCount > 0) {
+        glGenBuffers(slotCount, pbos);
+        for (int i = 0; i < slotCount; ++i) {
+            glBindBuffer(GL_PIXEL_UNPACK_BUFFER, pbos[i]);
+            gpuBufferData(GL_PIXEL_UNPACK_BUFFER, pbos[i], slotBytes, nullptr, GL_STREAM_DRAW, GpuCategory::PixelBuffer);
+        }
+    }
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+
+    int frame = 0;
+    auto upload = [&]() {
+        const unsigned char* pixels = source.data() + offset;
+        int slot = 0;
+        if (c.transfer != Sync) {
+            slot = frame % (c.transfer == Pbo ? 1 : 2);
+            waitAndDelete(fences[slot]);
+            if (c.transfer == PboPersistent) {
+                glBindBuffer(GL_PIXEL_UNPACK_BUFFER, pbos[0]);
+                std::memcpy(persistent + slot * slotBytes + offset, pixels, imageBytes);
+                pixels = (const unsigned char*)(slot * slotBytes + offset);
+            } else {
+                // 栅栏已经保证 GPU 读完了这个 PBO, 可以不同步地映射
+                glBindBuffer(GL_PIXEL_UNPACK_BUFFER, pbos[slot]);
+                void* mapped = glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, slotBytes,
+                                                GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT | GL_MAP_UNSYNCHRONIZED_BIT);
+                std::memcpy((unsigned char*)mapped + offset, pixels, imageBytes);
+                glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+                pixels = (const unsigned char*)offset;
+            }
+        }
+        if (c.texStorage)
+            glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, size, size, pixelFormat, type, pixels);
+        else
+            glTexImage2D(GL_TEXTURE_2D, 0, internalFormat, size, size, 0, pixelFormat, type, pixels);
+        if (c.transfer != Sync) {
+            fences[slot] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+            glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+        }
+        ++frame;
+    };
+
+    upload();
+    glFinish();
+
+    unsigned int query;
+    glGenQueries(1, &query);
+    glBeginQuery(GL_TIME_ELAPSED, query);
+    Clock::time_point start = Clock::now();
+    for (int i = 0; i < iterations; ++i) upload();
+    double cpuMs = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+    glEndQuery(GL_TIME_ELAPSED);
+    glFinish();
+    double totalMs = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+    GLuint64 elapsed = 0;
+    glGetQueryObjectui64v(query, GL_QUERY_RESULT, &elapsed);
+    glDeleteQueries(1, &query);
+
+    for (int i = 0; i < 2; ++i) {
+        if (fences[i]) glDeleteSync(fences[i]);
+    }
+    if (persistent) {
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, pbos[0]);
+        glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+    }
+    gpuDeleteBuffers(2, pbos);
+    gpuDeleteTextures(1, &texture);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+
+    CaseResult r;
+    r.upload = c;
+    r.size = size;
+    r.iterations = iterations;
+    r.cpuMs = cpuMs / iterations;
+    r.gpuMs = elapsed / 1e6 / iterations;
+    r.totalMs = totalMs / iterations;
+    r.mibPerSecond = imageBytes / (1024.0 * 1024.0) / (r.totalMs / 1000.0);
+    return r;
+}
+
+static MipmapResult runMipmap(int size, int iterations, const std::vector<unsigned char>& source, bool texStorage) {
+    MipmapResult r;
+    r.size = size;
+    r.levels = mipLevels(size);
+
+    unsigned int texture;
+    glGenTextures(1, &texture);
+    glBindTexture(GL_TEXTURE_2D, texture);
+    if (texStorage) {
+        glTexStorage2D(GL_TEXTURE_2D, r.levels, GL_RGBA8, size, size);
+        glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, size, size, GL_RGBA, GL_UNSIGNED_BYTE, source.data());
+    } else {
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, size, size, 0, GL_RGBA, GL_UNSIGNED_BYTE, source.data());
+    }
+    glGenerateMipmap(GL_TEXTURE_2D);
+    gpuTrackTexture(texture, GL_RGBA8, size, size, r.levels, GpuCategory::Texture);
+    glFinish();
+
+    unsigned int query;
+    glGenQueries(1, &query);
+    glBeginQuery(GL_TIME_ELAPSED, query);
+    Clock::time_point start = Clock::now();
+    for (int i = 0; i < iterations; ++i) glGenerateMipmap(GL_TEXTURE_2D);
+    r.cpuMs = std::chrono::duration<double, std::milli>(Clock::now() - start).count() / iterations;
+    glEndQuery(GL_TIME_ELAPSED);
+    GLuint64 elapsed = 0;
+    glGetQueryObjectui64v(query, GL_QUERY_RESULT, &elapsed);
+    r.gpuMs = elapsed / 1e6 / iterations;
+    glDeleteQueries(1, &query);
+    gpuDeleteTextures(1, &texture);
+    return r;
+}
+
+static std::string jsonString(const char* text) {
+    std::string out = "\"";
+    for (const char* p = text ? text : ""; *p; ++p) {
+        if (*p == '"' || *p == '\\') out += '\\';
+        if ((unsigned char)*p >= 0x20) out += *p;
+    }
+    return out + "\"";
+}
+
+static bool writeJson(const char* path, const std::vector<CaseResult>& cases, const std::vector<MipmapResult>& mipmaps) {
+    FILE* file = std::fopen(path, "w");
+    if (!file) return false;
+    std::fprintf(file, "{\n  \"gl_version\": %s,\n  \"renderer\": %s,\n  \"uploads\": [\n",
+                 jsonString((const char*)glGetString(GL_VERSION)).c_str(),
+                 jsonString((const char*)glGetString(GL_RENDERER)).c_str());
+    for (size_t i = 0; i < cases.size(); ++i) {
+        const CaseResult& r = cases[i];
+        std::fprintf(file,
+                     "    {\"size\": %d, \"alloc\": \"%s\", \"transfer\": \"%s\", \"format\": \"%s\", \"aligned\": %s, "
+                     "\"iterations\": %d, \"cpu_ms\": %.4f, \"gpu_ms\": %.4f, \"total_ms\": %.4f, \"mib_per_s\": %.1f}%s\n",
+                     r.size, r.upload.texStorage ? "storage" : "teximage", kTransferNames[r.upload.transfer],
+                     kFormatNames[r.upload.format], r.upload.aligned ? "true" : "false", r.iterations,
+                     r.cpuMs, r.gpuMs, r.totalMs, r.mibPerSecond, i + 1 < cases.size() ? "," : "");
+    }
+    std::fprintf(file, "  ],\n  \"mipmaps\": [\n");
+    for (size_t i = 0; i < mipmaps.size(); ++i) {
+        const MipmapResult& r = mipmaps[i];
+        std::fprintf(file, "    {\"size\": %d, \"levels\": %d, \"cpu_ms\": %.4f, \"gpu_ms\": %.4f}%s\n",
+                     r.size, r.levels, r.cpuMs, r.gpuMs, i + 1 < mipmaps.size() ? "," : "");
+    }
+    std::fprintf(file, "  ],\n  \"gpu_memory_peak_mib\": {");
+    bool first = true;
+    for (int c = 0; c < (int)GpuCategory::Count; ++c) {
+        size_t peak = gpuMemory().categoryPeakBytes((GpuCategory)c);
+        if (peak == 0) continue;
+        std::fprintf(file, "%s\"%s\": %.2f", first ? "" : ", ", gpuCategoryName((GpuCategory)c), peak / 1048576.0);
+        first = false;
+    }
+    std::fprintf(file, "}\n}\n");
+    std::fclose(file);
+    return true;
+}
+
+int main(int argc, char** argv) {
+    const char* jsonPath = "texture_upload_bench.json";
+    int maxSize = 8192;
+    int maxIterations = 20;
+    for (int i = 1; i < argc; ++i) {
+        if (std::strcmp(argv[i], "--json") == 0 && i + 1 < argc) jsonPath = argv[++i];
+        else if (std::strcmp(argv[i], "--max-size") == 0 && i + 1 < argc) maxSize = std::atoi(argv[++i]);
+        else if (std::strcmp(argv[i], "--iterations") == 0 && i + 1 < argc) maxIterations = std::max(1, std::atoi(argv[++i]));
+        else {
+            std::cerr << "未知参数: " << argv[i] << std::endl;
+            return 1;
+        }
+    }
+
+    glfwInit();
+    glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+    glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+#ifdef __APPLE__
+    glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE);
+#endif
+    // 尽量要高版本的上下文, 不支持的方式会被跳过
+    const int versions[][2] = { { 4, 6 }, { 4, 4 }, { 4, 3 }, { 3, 3 } };
+    GLFWwindow* window = NULL;
+    for (int i = 0; i < 4 && !window; ++i) {
+        glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, versions[i][0]);
+        glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, versions[i][1]);
+        window = glfwCreateWindow(64, 64, "texture_upload_bench", NULL, NULL);
+    }
+    if (window == NULL) {
+        std::cerr << "无法创建 OpenGL 上下文" << std::endl;
+        glfwTerminate();
+        return -1;
+    }
+    glfwMakeContextCurrent(window);
+    if (!gladLoadGLLoader((GLADloadproc)glfwGetProcAddress)) {
+        std::cerr << "Failed to initialize GLAD" << std::endl;
+        return -1;
+    }
+    loadGl43((GLADloadproc)glfwGetProcAddress);
+    const bool haveTexStorage = gl43Api().TexStorage2D && contextAtLeast(4, 2);
+    const bool havePersistent = hasBufferStorage();
+
+    GLint maxTextureSize = 0;
+    glGetIntegerv(GL_MAX_TEXTURE_SIZE, &maxTextureSize);
+    std::cout << "GL " << glGetString(GL_VERSION) << " / " << glGetString(GL_RENDERER) << std::endl;
+    if (!haveTexStorage) std::cout << "上下文低于 4.2, 只测 teximage" << std::endl;
+
+    // 每种格式: teximage 和 storage 各测所有传输方式, 再加 sync / pbo-double 的非对齐版本
+    std::vector<UploadCase> uploadCases;
+    for (int f = Rgb; f <= Bgra; ++f) {
+        for (int storage = 0; storage < 2; ++storage) {
+            for (int t = Sync; t <= PboPersistent; ++t) {
+                UploadCase c = { storage != 0, (Transfer)t, (Format)f, true };
+                uploadCases.push_back(c);
+            }
+        }
+        UploadCase syncUnaligned = { true, Sync, (Format)f, false };
+        UploadCase pboUnaligned = { true, PboDouble, (Format)f, false };
+        uploadCases.push_back(syncUnaligned);
+        uploadCases.push_back(pboUnaligned);
+    }
+
+    std::vector<CaseResult> results;
+    std::vector<MipmapResult> mipmaps;
+    std::printf("%6s %-9s %-15s %-5s %-9s %5s %10s %10s %10s %10s\n",
+                "size", "alloc", "transfer", "fmt", "align", "iter", "CPU ms", "GPU ms", "total ms", "MiB/s");
+    for (int size = 256; size <= maxSize && size <= maxTextureSize; size *= 2) {
+        // 源数据按 RGBA 大小准备, 多留 1 字节给非对齐的情况
+        std::vector<unsigned char> source((size_t)size * size * 4 + 1);
+        for (size_t i = 0; i < source.size(); ++i) source[i] = (unsigned char)(i * 31 + (i >> 12));
+        const size_t rgbaBytes = (size_t)size * size * 4;
+        int iterations = (int)std::max<size_t>(3, std::min<size_t>(maxIterations, ((size_t)1 << 30) / rgbaBytes));
+
+        for (size_t i = 0; i < uploadCases.size(); ++i) {
+            const UploadCase& c = uploadCases[i];
+            if ((c.texStorage && !haveTexStorage) || (c.transfer == PboPersistent && !havePersistent)) continue;
+            CaseResult r = runCase(c, size, iterations, source);
+            results.push_back(r);
+            std::printf("%6d %-9s %-15s %-5s %-9s %5d %10.3f %10.3f %10.3f %10.1f\n", size,
+                        c.texStorage ? "storage" : "teximage", kTransferNames[c.transfer], kFormatNames[c.format],
+                        c.aligned ? "aligned" : "unaligned", iterations, r.cpuMs, r.gpuMs, r.totalMs, r.mibPerSecond);
+        }
+
+        MipmapResult m = runMipmap(size, iterations, source, haveTexStorage);
+        mipmaps.push_back(m);
+        std::printf("%6d mipmap (%d 级) CPU %.3f ms, GPU %.3f ms\n", size, m.levels, m.cpuMs, m.gpuMs);
+    }
+
+    gpuMemory().printBreakdown(std::cout);
+    if (writeJson(jsonPath, results, mipmaps)) std::cout << "结果已写入 " << jsonPath << std::endl;
+    else std::cerr << "无法写入 " << jsonPath << std::endl;
+
+    glfwTerminate();
+    return 0;
+}
@@ -0,0 +1,219 @@
+#ifndef COMMON_ASYNC_LOAD_H
+#define COMMON_ASYNC_LOAD_H
+
+// 基于 C++20 协程的资源加载
+//
+// 一次加载写成一个返回 LoadTask<T> 的协程, 按阶段切换线程:
+//   co_await readFileAsync(path)      在任务系统的工作线程上读取整个文件, 之后继续在该工作线程上执行
+//   co_await resumeOnWorker()         切到工作线程: 解码、生成网格等纯 CPU 工作
+//   co_await resumeOnGlThread(queue)  切回 GL 线程: 创建对象、上传。已经在 GL 线程上时不切换
+// GL 线程由 GlThreadQueue 代表, 排队的协程只在 GL 线程调用 runPending() 时恢复。
+//
+// LoadTask 创建后立即开始执行 (直到第一次切换线程), 所以启动时依次发起全部加载, 再用 waitAll()
+// 一起等待: 各加载的读文件和解码在工作线程上并行, GL 线程在等待期间执行各加载的 GL 阶段,
+// 首帧前的等待时间从各加载耗时之和变为其中最长的一个。printLoadTimes() 打印两者的对比。
+//
+// 协程内不使用异常 (失败时返回 0 / false 并打印原因, 与同步版本一致), 未捕获的异常直接终止进程。
+// LoadTask 必须在完成 (done()) 之后才能销毁; 被另一个协程 co_await 的 LoadTask 只能等待一次。
+
+#include "common/job_system.h"
+
+#include <atomic>
+#include <chrono>
+#include <coroutine>
+#include <cstdio>
+#include <deque>
+#include <exception>
+#include <initializer_list>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+template <typename T>
+class LoadTask {
+public:
+    struct promise_type;
+    typedef std::coroutine_handle<promise_type> Handle;
+    typedef std::chrono::steady_clock Clock;
+
+    struct FinalAwaiter {
+        bool await_ready() noexcept { return false; }
+        // 标记完成; 已经有协程在等待时直接转到它 (对称转移, 不增加调用栈深度)
+        std::coroutine_handle<> await_suspend(Handle handle) noexcept {
+            handle.promise().end = Clock::now();
+            void* waiter = handle.promise().continuation.exchange(doneMarker(), std::memory_order_acq_rel);
+            return waiter ? std::coroutine_handle<>::from_address(waiter) : std::noop_coroutine();
+        }
+        void await_resume() noexcept {}
+    };
+
+    struct promise_type {
+        T value{};
+        // nullptr: 运行中且无人等待; doneMarker(): 已完成; 其它: 等待者的协程地址
+        std::atomic<void*> continuation{nullptr};
+        Clock::time_point start = Clock::now();
+        Clock::time_point end;
+
+        LoadTask get_return_object() { return LoadTask(Handle::from_promise(*this)); }
+        std::suspend_never initial_suspend() noexcept { return {}; }
+        FinalAwaiter final_suspend() noexcept { return {}; }
+        void return_value(T result) { value = std::move(result); }
+        void unhandled_exception() { std::terminate(); }
+    };
+
+    LoadTask(LoadTask&& other) noexcept : handle_(other.handle_) { other.handle_ = nullptr; }
+    LoadTask& operator=(LoadTask&& other) noexcept {
+        if (this != &other) {
+            destroy();
+            handle_ = other.handle_;
+            other.handle_ = nullptr;
+        }
+        return *this;
+    }
+    LoadTask(const LoadTask&) = delete;
+    LoadTask& operator=(const LoadTask&) = delete;
+    ~LoadTask() { destroy(); }
+
+    bool done() const { return handle_.promise().continuation.load(std::memory_order_acquire) == doneMarker(); }
+
+    // 完成后的结果
+    T& get() { return handle_.promise().value; }
+
+    // 协程从开始到完成的耗时 (毫秒), 包括在队列中等待切换线程的时间
+    double elapsedMs() const {
+        const promise_type& p = handle_.promise();
+        return std::chrono::duration<double, std::milli>(p.end - p.start).count();
+    }
+
+    // 在另一个协程中 co_await: 完成后在完成它的线程上继续
+    bool await_ready() const noexcept { return done(); }
+    bool await_suspend(std::coroutine_handle<> waiter) noexcept {
+        void* expected = nullptr;
+        // 失败说明期间已经完成, 返回 false 直接继续
+        return handle_.promise().continuation.compare_exchange_strong(expected, waiter.address(), std::memory_order_acq_rel);
+    }
+    T await_resume() { return std::move(handle_.promise().value); }
+
+private:
+    explicit LoadTask(Handle handle) : handle_(handle) {}
+
+    static void* doneMarker() {
+        static char marker;
+        return &marker;
+    }
+
+    void destroy() {
+        if (handle_) handle_.destroy();
+        handle_ = nullptr;
+    }
+
+    Handle handle_;
+};
+
+// 代表 GL 线程 (持有上下文的线程) 的队列, 必须在 GL 线程上创建
+class GlThreadQueue {
+public:
+    GlThreadQueue() : owner_(std::this_thread::get_id()) {}
+    GlThreadQueue(const GlThreadQueue&) = delete;
+    GlThreadQueue& operator=(const GlThreadQueue&) = delete;
+
+    bool isGlThread() const { return std::this_thread::get_id() == owner_; }
+
+    void post(std::coroutine_handle<> handle) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        pending_.push_back(handle);
+    }
+
+    // 在 GL 线程上调用: 恢复当前排队的协程, 返回是否恢复了任何协程
+    bool runPending() {
+        std::deque<std::coroutine_handle<> > ready;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            ready.swap(pending_);
+        }
+        for (size_t i = 0; i < ready.size(); ++i) ready[i].resume();
+        return !ready.empty();
+    }
+
+private:
+    std::thread::id owner_;
+    std::mutex mutex_;
+    std::deque<std::coroutine_handle<> > pending_;
+};
+
+struct WorkerAwaiter {
+    JobSystem& system;
+
+    bool await_ready() const noexcept { return false; }
+    void await_suspend(std::coroutine_handle<> handle) {
+        system.submit([handle]() { handle.resume(); });
+    }
+    void await_resume() const noexcept {}
+};
+
+struct GlThreadAwaiter {
+    GlThreadQueue& queue;
+
+    bool await_ready() const noexcept { return queue.isGlThread(); }
+    void await_suspend(std::coroutine_handle<> handle) { queue.post(handle); }
+    void await_resume() const noexcept {}
+};
+
+// 总是切到任务系统的队列, 即使当前已经在工作线程上 (让出线程给其它加载)
+inline WorkerAwaiter resumeOnWorker(JobSystem& system = jobSystem()) { return WorkerAwaiter{ system }; }
+
+inline GlThreadAwaiter resumeOnGlThread(GlThreadQueue& queue) { return GlThreadAwaiter{ queue }; }
+
+// 已经有结果的加载, 用于有时不需要真正加载的分支
+template <typename T>
+inline LoadTask<T> loadReady(T value) {
+    co_return value;
+}
+
+// 在工作线程上读取整个文件, 失败 (或文件为空) 时返回空数组
+inline LoadTask<std::vector<unsigned char> > readFileAsync(std::string path, JobSystem& system = jobSystem()) {
+    co_await resumeOnWorker(system);
+    std::vector<unsigned char> bytes;
+    FILE* f = std::fopen(path.c_str(), "rb");
+    if (!f) co_return bytes;
+    if (std::fseek(f, 0, SEEK_END) == 0) {
+        long size = std::ftell(f);
+        if (size > 0 && std::fseek(f, 0, SEEK_SET) == 0) {
+            bytes.resize((size_t)size);
+            if (std::fread(bytes.data(), 1, bytes.size(), f) != bytes.size()) bytes.clear();
+        }
+    }
+    std::fclose(f);
+    co_return bytes;
+}
+
+// 在 GL 线程上等待全部加载完成: 期间执行排队的 GL 阶段, 没有时帮助执行任务系统的任务
+template <typename... T>
+inline void waitAll(GlThreadQueue& queue, const LoadTask<T>&... tasks) {
+    while (!(tasks.done() && ...)) {
+        if (!queue.runPending() && !jobSystem().runOne()) std::this_thread::yield();
+    }
+}
+
+struct LoadTiming {
+    const char* name;
+    double ms;
+};
+
+// 打印各加载耗时、串行执行时的总和与实际的等待时间
+inline void printLoadTimes(std::ostream& os, double wallMs, std::initializer_list<LoadTiming> loads) {
+    double sum = 0.0;
+    os << "[加载]";
+    const char* separator = " ";
+    for (const LoadTiming& load : loads) {
+        os << separator << load.name << " " << load.ms << " ms";
+        separator = ", ";
+        sum += load.ms;
+    }
+    os << "; 各项之和 " << sum << " ms, 实际等待 " << wallMs << " ms" << std::endl;
+}
+
+#endif
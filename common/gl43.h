@@ -0,0 +1,99 @@
+#ifndef COMMON_GL43_H
+#define COMMON_GL43_H
+
+// OpenGL 4.x 入口函数: 项目中的 glad 只生成到 3.3 core, 计算着色器等 4.x 功能在这里按需手动加载。
+// 需要先创建对应版本的上下文并调用 loadGl43(glfwGetProcAddress), 返回 false 表示驱动不支持。
+// 用法与 glad 一致: 直接调用 glDispatchCompute 等函数名。
+// 4.4 的 glBufferStorage 是可选的: 上下文低于 4.4 时为空指针, 使用前用 hasBufferStorage() 检查。
+
+#include "glad/glad.h"
+
+#ifndef GL_COMPUTE_SHADER
+#define GL_COMPUTE_SHADER 0x91B9
+#endif
+#ifndef GL_SHADER_STORAGE_BUFFER
+#define GL_SHADER_STORAGE_BUFFER 0x90D2
+#endif
+#ifndef GL_MAX_SHADER_STORAGE_BLOCK_SIZE
+#define GL_MAX_SHADER_STORAGE_BLOCK_SIZE 0x90DE
+#endif
+#ifndef GL_DISPATCH_INDIRECT_BUFFER
+#define GL_DISPATCH_INDIRECT_BUFFER 0x90EE
+#endif
+#ifndef GL_SHADER_STORAGE_BARRIER_BIT
+#define GL_SHADER_STORAGE_BARRIER_BIT 0x00002000
+#endif
+#ifndef GL_COMMAND_BARRIER_BIT
+#define GL_COMMAND_BARRIER_BIT 0x00000040
+#endif
+#ifndef GL_SHADER_IMAGE_ACCESS_BARRIER_BIT
+#define GL_SHADER_IMAGE_ACCESS_BARRIER_BIT 0x00000020
+#endif
+#ifndef GL_TEXTURE_FETCH_BARRIER_BIT
+#define GL_TEXTURE_FETCH_BARRIER_BIT 0x00000008
+#endif
+#ifndef GL_BUFFER_UPDATE_BARRIER_BIT
+#define GL_BUFFER_UPDATE_BARRIER_BIT 0x00000200
+#endif
+#ifndef GL_MAP_PERSISTENT_BIT
+#define GL_MAP_PERSISTENT_BIT 0x0040
+#endif
+#ifndef GL_MAP_COHERENT_BIT
+#define GL_MAP_COHERENT_BIT 0x0080
+#endif
+#ifndef GL_DYNAMIC_STORAGE_BIT
+#define GL_DYNAMIC_STORAGE_BIT 0x0100
+#endif
+#ifndef GL_CLIENT_STORAGE_BIT
+#define GL_CLIENT_STORAGE_BIT 0x0200
+#endif
+
+typedef void (APIENTRYP GL43DISPATCHCOMPUTEPROC)(GLuint groupsX, GLuint groupsY, GLuint groupsZ);
+typedef void (APIENTRYP GL43DISPATCHCOMPUTEINDIRECTPROC)(GLintptr indirect);
+typedef void (APIENTRYP GL43MEMORYBARRIERPROC)(GLbitfield barriers);
+typedef void (APIENTRYP GL43BINDIMAGETEXTUREPROC)(GLuint unit, GLuint texture, GLint level, GLboolean layered, GLint layer, GLenum access, GLenum format);
+typedef void (APIENTRYP GL43TEXSTORAGE2DPROC)(GLenum target, GLsizei levels, GLenum internalformat, GLsizei width, GLsizei height);
+typedef void (APIENTRYP GL43BUFFERSTORAGEPROC)(GLenum target, GLsizeiptr size, const void* data, GLbitfield flags);
+
+struct Gl43Api {
+    GL43DISPATCHCOMPUTEPROC DispatchCompute = nullptr;
+    GL43DISPATCHCOMPUTEINDIRECTPROC DispatchComputeIndirect = nullptr;
+    GL43MEMORYBARRIERPROC MemoryBarrier = nullptr;
+    GL43BINDIMAGETEXTUREPROC BindImageTexture = nullptr;
+    GL43TEXSTORAGE2DPROC TexStorage2D = nullptr;
+    GL43BUFFERSTORAGEPROC BufferStorage = nullptr; // 4.4, 可选
+};
+
+inline Gl43Api& gl43Api() {
+    static Gl43Api api;
+    return api;
+}
+
+inline bool loadGl43(GLADloadproc load) {
+    Gl43Api& api = gl43Api();
+    api.DispatchCompute = (GL43DISPATCHCOMPUTEPROC)load("glDispatchCompute");
+    api.DispatchComputeIndirect = (GL43DISPATCHCOMPUTEINDIRECTPROC)load("glDispatchComputeIndirect");
+    api.MemoryBarrier = (GL43MEMORYBARRIERPROC)load("glMemoryBarrier");
+    api.BindImageTexture = (GL43BINDIMAGETEXTUREPROC)load("glBindImageTexture");
+    api.TexStorage2D = (GL43TEXSTORAGE2DPROC)load("glTexStorage2D");
+    api.BufferStorage = (GL43BUFFERSTORAGEPROC)load("glBufferStorage");
+    return api.DispatchCompute && api.DispatchComputeIndirect && api.MemoryBarrier
+        && api.BindImageTexture && api.TexStorage2D;
+}
+
+#define glDispatchCompute gl43Api().DispatchCompute
+#define glDispatchComputeIndirect gl43Api().DispatchComputeIndirect
+#define glMemoryBarrier gl43Api().MemoryBarrier
+#define glBindImageTexture gl43Api().BindImageTexture
+#define glTexStorage2D gl43Api().TexStorage2D
+#define glBufferStorage gl43Api().BufferStorage
+
+// glfwGetProcAddress 可能对当前上下文不支持的函数也返回非空指针, 所以还要核对上下文版本
+inline bool hasBufferStorage() {
+    GLint major = 0, minor = 0;
+    glGetIntegerv(GL_MAJOR_VERSION, &major);
+    glGetIntegerv(GL_MINOR_VERSION, &minor);
+    return gl43Api().BufferStorage && (major > 4 || (major == 4 && minor >= 4));
+}
+
+#endif
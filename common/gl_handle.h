@@ -0,0 +1,195 @@
+#ifndef COMMON_GL_HANDLE_H
+#define COMMON_GL_HANDLE_H
+
+// GL 对象的 RAII 句柄与按帧栅栏延迟删除
+//
+// GlBuffer / GlVertexArray / GlTexture / GlFramebuffer / GlRenderbuffer 只能移动不能复制。
+// 析构、reset 或被移动赋值覆盖时不立即 glDelete*, 而是放进当前上下文的 GlDeletionQueue;
+// 每帧交换缓冲后 endFrame() 插入一个栅栏, 栅栏触发 (GPU 执行完这一帧) 之后才按类型批量删除。
+// 刚发出绘制就删除仍被 GPU 使用的对象时, 驱动要么等待 GPU, 要么在内部另做一份延迟释放的记录;
+// 交给队列之后删除总发生在 GPU 用完以后, 一帧内释放的同类对象也合并成一次 glDelete* 调用。
+// 句柄释放时立即从 common/gpu_memory.h 注销, 显存统计不包含等待删除的对象。
+//
+// 每个上下文一个队列: 默认是全局队列; 多个不共享对象的上下文 (task1 的多窗口) 各建一个队列,
+// 切换上下文时 makeCurrent()。退出前 (glfwTerminate 之前) 调用 finish() 等待并删除剩余的对象。
+
+#include "glad/glad.h"
+#include "common/gpu_memory.h"
+
+#include <cstddef>
+#include <deque>
+#include <ostream>
+#include <vector>
+
+enum class GlObjectType { Buffer, VertexArray, Texture, Framebuffer, Renderbuffer, Count };
+
+class GlDeletionQueue {
+public:
+    struct Stats {
+        size_t released = 0;       // 进入队列的对象数
+        size_t deleted = 0;        // 已删除的对象数
+        size_t deleteCalls = 0;    // glDelete* 调用次数
+        size_t stallsAvoided = 0;  // 释放时 GPU 还没执行完上一帧的对象数: 立即删除的话驱动必须等待或另行跟踪
+    };
+
+    GlDeletionQueue() {}
+    // 不调用 GL: 析构时上下文可能已经销毁, 剩余对象应在此之前 finish()
+    ~GlDeletionQueue() {
+        if (&current() == this) resetCurrent();
+    }
+
+    GlDeletionQueue(const GlDeletionQueue&) = delete;
+    GlDeletionQueue& operator=(const GlDeletionQueue&) = delete;
+
+    static GlDeletionQueue& current() { return *currentSlot(); }
+    void makeCurrent() { currentSlot() = this; }
+    static void resetCurrent() { currentSlot() = &globalQueue(); }
+
+    void enqueue(GlObjectType type, GLuint name) {
+        if (name == 0) return;
+        if (type == GlObjectType::Buffer) gpuMemory().untrack(GpuObjectKind::Buffer, name);
+        else if (type == GlObjectType::Texture) gpuMemory().untrack(GpuObjectKind::Texture, name);
+        else if (type == GlObjectType::Renderbuffer) gpuMemory().untrack(GpuObjectKind::Renderbuffer, name);
+        pending_[(int)type].push_back(name);
+        stats_.released++;
+        // 最近一帧的栅栏还没触发, 说明本帧 (以及用到这个对象的绘制) 一定还没执行完
+        if (!batches_.empty() && glClientWaitSync(batches_.back().fence, 0, 0) == GL_TIMEOUT_EXPIRED)
+            stats_.stallsAvoided++;
+    }
+
+    // 每帧交换缓冲后调用: 为本帧插入栅栏 (即使没有释放对象, 供下一帧的 enqueue 判断 GPU 进度),
+    // 并删除栅栏已经触发的批次
+    void endFrame() {
+        batches_.push_back(Batch());
+        Batch& batch = batches_.back();
+        for (int t = 0; t < (int)GlObjectType::Count; ++t) batch.objects[t].swap(pending_[t]);
+        batch.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+        collect(false);
+    }
+
+    // 等待所有栅栏并删除全部对象, 退出前或销毁上下文前调用
+    void finish() {
+        endFrame();
+        collect(true);
+    }
+
+    size_t pendingBatches() const { return batches_.size(); }
+    const Stats& stats() const { return stats_; }
+
+    void printStats(std::ostream& os, const char* title = "延迟删除") const {
+        os << "[" << title << "] 释放 " << stats_.released << " 个对象, 已删除 " << stats_.deleted << " 个, glDelete* 调用 "
+           << stats_.deleteCalls << " 次, 避免的驱动等待 " << stats_.stallsAvoided << " 次" << std::endl;
+    }
+
+private:
+    struct Batch {
+        GLsync fence = 0;
+        std::vector<GLuint> objects[(int)GlObjectType::Count];
+    };
+
+    static GlDeletionQueue& globalQueue() {
+        static GlDeletionQueue queue;
+        return queue;
+    }
+
+    static GlDeletionQueue*& currentSlot() {
+        static GlDeletionQueue* current = &globalQueue();
+        return current;
+    }
+
+    void collect(bool wait) {
+        while (!batches_.empty()) {
+            Batch& batch = batches_.front();
+            GLenum status = wait ? glClientWaitSync(batch.fence, GL_SYNC_FLUSH_COMMANDS_BIT, (GLuint64)-1)
+                                 : glClientWaitSync(batch.fence, 0, 0);
+            if (status == GL_TIMEOUT_EXPIRED) break;   // 后面的批次更晚, 也不会触发
+            for (int t = 0; t < (int)GlObjectType::Count; ++t) {
+                std::vector<GLuint>& names = batch.objects[t];
+                if (names.empty()) continue;
+                destroy((GlObjectType)t, (GLsizei)names.size(), names.data());
+                stats_.deleted += names.size();
+                stats_.deleteCalls++;
+            }
+            glDeleteSync(batch.fence);
+            batches_.pop_front();
+        }
+    }
+
+    static void destroy(GlObjectType type, GLsizei count, const GLuint* names) {
+        switch (type) {
+        case GlObjectType::Buffer: glDeleteBuffers(count, names); break;
+        case GlObjectType::VertexArray: glDeleteVertexArrays(count, names); break;
+        case GlObjectType::Texture: glDeleteTextures(count, names); break;
+        case GlObjectType::Framebuffer: glDeleteFramebuffers(count, names); break;
+        case GlObjectType::Renderbuffer: glDeleteRenderbuffers(count, names); break;
+        default: break;
+        }
+    }
+
+    std::vector<GLuint> pending_[(int)GlObjectType::Count];   // 本帧释放, 尚未插入栅栏
+    std::deque<Batch> batches_;
+    Stats stats_;
+};
+
+inline GlDeletionQueue& glDeletionQueue() { return GlDeletionQueue::current(); }
+
+template <GlObjectType Type>
+class GlHandle {
+public:
+    GlHandle() : name_(0) {}
+    // 接管一个已有的对象
+    explicit GlHandle(GLuint name) : name_(name) {}
+    ~GlHandle() { reset(); }
+
+    GlHandle(GlHandle&& other) noexcept : name_(other.name_) { other.name_ = 0; }
+    GlHandle& operator=(GlHandle&& other) noexcept {
+        if (this != &other) {
+            reset();
+            name_ = other.name_;
+            other.name_ = 0;
+        }
+        return *this;
+    }
+    GlHandle(const GlHandle&) = delete;
+    GlHandle& operator=(const GlHandle&) = delete;
+
+    static GlHandle create() {
+        GLuint name = 0;
+        switch (Type) {
+        case GlObjectType::Buffer: glGenBuffers(1, &name); break;
+        case GlObjectType::VertexArray: glGenVertexArrays(1, &name); break;
+        case GlObjectType::Texture: glGenTextures(1, &name); break;
+        case GlObjectType::Framebuffer: glGenFramebuffers(1, &name); break;
+        case GlObjectType::Renderbuffer: glGenRenderbuffers(1, &name); break;
+        default: break;
+        }
+        return GlHandle(name);
+    }
+
+    GLuint get() const { return name_; }
+    explicit operator bool() const { return name_ != 0; }
+
+    // 交给当前上下文的删除队列
+    void reset() {
+        if (name_ != 0) glDeletionQueue().enqueue(Type, name_);
+        name_ = 0;
+    }
+
+    // 放弃所有权, 由调用者负责删除
+    GLuint release() {
+        GLuint name = name_;
+        name_ = 0;
+        return name;
+    }
+
+private:
+    GLuint name_;
+};
+
+typedef GlHandle<GlObjectType::Buffer> GlBuffer;
+typedef GlHandle<GlObjectType::VertexArray> GlVertexArray;
+typedef GlHandle<GlObjectType::Texture> GlTexture;
+typedef GlHandle<GlObjectType::Framebuffer> GlFramebuffer;
+typedef GlHandle<GlObjectType::Renderbuffer> GlRenderbuffer;
+
+#endif
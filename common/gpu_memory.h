@@ -0,0 +1,267 @@
+#ifndef COMMON_GPU_MEMORY_H
+#define COMMON_GPU_MEMORY_H
+
+// 显存占用登记与按预算淘汰
+//
+// 缓冲、纹理和渲染缓冲通过下面的 gpuBufferData / gpuTexImage2D / gpuDelete* 等封装创建和删除,
+// 封装在调用 GL 的同时把对象大小登记到全局的 GpuMemoryRegistry, 按类别汇总当前值和峰值。
+// 大小是按内部格式估算的 (GL 无法查询驱动实际分配的字节数), 3 分量格式按驱动常见的 4 分量存储计算。
+//
+// 可淘汰的资源 (流式纹理、可重新生成的网格缓存等) 额外注册一个淘汰回调:
+// enforceBudget() 在总量超出预算时按最近最少使用的顺序调用回调, 回调负责删除 GL 对象 (经 gpuDelete* 注销),
+// 之后需要时由所有者重新创建。本帧 touch 过的资源不会被淘汰, 避免正在绘制的内容反复加载。
+// 只能在持有 GL 上下文的线程上使用; 登记以对象名为键, 所以多个不共享对象的上下文不要混用。
+
+#include "glad/glad.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <functional>
+#include <list>
+#include <ostream>
+#include <unordered_map>
+#include <vector>
+
+enum class GpuCategory {
+    VertexBuffer,
+    IndexBuffer,
+    UniformBuffer,
+    PixelBuffer,      // PBO 上传/回读暂存
+    StorageBuffer,    // SSBO 与纹理缓冲
+    Texture,
+    StreamedTexture,
+    RenderTarget,     // 作为帧缓冲附件的纹理和渲染缓冲
+    Count
+};
+
+inline const char* gpuCategoryName(GpuCategory category) {
+    static const char* const names[] = { "vertex buffer", "index buffer", "uniform buffer", "pixel buffer",
+                                         "storage buffer", "texture", "streamed texture", "render target" };
+    return names[(int)category];
+}
+
+enum class GpuObjectKind { Buffer, Texture, Renderbuffer };
+
+// 每个纹素的字节数
+inline size_t gpuTexelBytes(GLenum internalFormat) {
+    switch (internalFormat) {
+    case GL_R8: case GL_RED:
+        return 1;
+    case GL_RG8: case GL_R16F: case GL_RG:
+        return 2;
+    case GL_RGBA16F: case GL_RGB16F: case GL_RG32F:
+        return 8;
+    case GL_RGBA32F: case GL_RGB32F: case GL_RGBA32UI:
+        return 16;
+    default:    // RGBA8, RGB8, SRGB8_ALPHA8, R32F, R32UI, DEPTH24_STENCIL8, ...
+        return 4;
+    }
+}
+
+// levels 为 0 时按完整 mip 链计算
+inline size_t gpuTextureBytes(GLenum internalFormat, int width, int height, int levels = 1) {
+    size_t total = 0;
+    for (int level = 0; levels == 0 || level < levels; ++level) {
+        total += (size_t)width * height * gpuTexelBytes(internalFormat);
+        if (width == 1 && height == 1) break;
+        width = std::max(1, width / 2);
+        height = std::max(1, height / 2);
+    }
+    return total;
+}
+
+class GpuMemoryRegistry {
+public:
+    typedef std::function<void()> EvictCallback;
+
+    static GpuMemoryRegistry& instance() {
+        static GpuMemoryRegistry registry;
+        return registry;
+    }
+
+    // 总量上限 (字节), 0 表示不限制
+    void setBudget(size_t bytes) { budget_ = bytes; }
+    size_t budget() const { return budget_; }
+
+    // 登记或更新一个对象的大小; 已登记的对象改变类别时按新类别计
+    void track(GpuObjectKind kind, GLuint name, GpuCategory category, size_t bytes) {
+        if (name == 0) return;
+        Entry& e = entries_[key(kind, name)];
+        categoryBytes_[(int)e.category] -= e.bytes;
+        totalBytes_ = totalBytes_ - e.bytes + bytes;
+        e.category = category;
+        e.bytes = bytes;
+        e.lastUseFrame = frame_;
+        allocations_++;
+        categoryBytes_[(int)category] += bytes;
+        categoryPeak_[(int)category] = std::max(categoryPeak_[(int)category], categoryBytes_[(int)category]);
+        peakBytes_ = std::max(peakBytes_, totalBytes_);
+        if (e.evictable) touch(kind, name);
+    }
+
+    void untrack(GpuObjectKind kind, GLuint name) {
+        std::unordered_map<uint64_t, Entry>::iterator it = entries_.find(key(kind, name));
+        if (it == entries_.end()) return;
+        Entry& e = it->second;
+        totalBytes_ -= e.bytes;
+        categoryBytes_[(int)e.category] -= e.bytes;
+        if (e.evictable) lru_.erase(e.lruPosition);
+        entries_.erase(it);
+        frees_++;
+    }
+
+    // 把已登记的对象标记为可淘汰; evict 在 enforceBudget 中调用, 必须删除该对象 (并经 gpuDelete* 注销)
+    void setEvictable(GpuObjectKind kind, GLuint name, const EvictCallback& evict) {
+        std::unordered_map<uint64_t, Entry>::iterator it = entries_.find(key(kind, name));
+        if (it == entries_.end()) return;
+        Entry& e = it->second;
+        if (!e.evictable) e.lruPosition = lru_.insert(lru_.end(), it->first);
+        e.evictable = true;
+        e.evict = evict;
+    }
+
+    // 资源在本帧被使用, 移到 LRU 队尾
+    void touch(GpuObjectKind kind, GLuint name) {
+        std::unordered_map<uint64_t, Entry>::iterator it = entries_.find(key(kind, name));
+        if (it == entries_.end()) return;
+        Entry& e = it->second;
+        e.lastUseFrame = frame_;
+        if (e.evictable) lru_.splice(lru_.end(), lru_, e.lruPosition);
+    }
+
+    // 每帧开始时调用, 区分 "本帧用过" 的资源
+    void beginFrame() { ++frame_; }
+
+    // 超出预算时从最久未使用的可淘汰资源开始淘汰, 直到回到预算内或没有可淘汰的资源; 返回淘汰的字节数
+    size_t enforceBudget() {
+        size_t evicted = 0;
+        while (budget_ > 0 && totalBytes_ > budget_ && !lru_.empty()) {
+            uint64_t victim = lru_.front();
+            Entry& e = entries_[victim];
+            if (e.lastUseFrame == frame_) break;   // 其余的都在本帧用过
+            size_t before = totalBytes_;
+            EvictCallback evict = e.evict;
+            evict();
+            // 回调没有注销对象时自行注销, 保证循环能结束
+            if (entries_.count(victim)) untrack((GpuObjectKind)(victim >> 32), (GLuint)victim);
+            evicted += before - std::min(before, totalBytes_);
+            evictions_++;
+        }
+        evictedBytes_ += evicted;
+        return evicted;
+    }
+
+    size_t totalBytes() const { return totalBytes_; }
+    size_t peakBytes() const { return peakBytes_; }
+    size_t categoryBytes(GpuCategory category) const { return categoryBytes_[(int)category]; }
+    size_t categoryPeakBytes(GpuCategory category) const { return categoryPeak_[(int)category]; }
+    bool overBudget() const { return budget_ > 0 && totalBytes_ > budget_; }
+    size_t objectCount() const { return entries_.size(); }
+    // 分配次数 (每次 gpuBufferData / gpuTexImage2D 等登记, 包括重新分配) 与注销次数
+    uint64_t allocations() const { return allocations_; }
+    uint64_t frees() const { return frees_; }
+    int evictions() const { return evictions_; }
+    size_t evictedBytes() const { return evictedBytes_; }
+
+    // 按类别打印当前值、峰值和对象数
+    void printBreakdown(std::ostream& os, const char* title = "显存") const {
+        int counts[(int)GpuCategory::Count] = {};
+        for (std::unordered_map<uint64_t, Entry>::const_iterator it = entries_.begin(); it != entries_.end(); ++it)
+            counts[(int)it->second.category]++;
+        char line[128];
+        std::snprintf(line, sizeof(line), "共 %.2f MiB (峰值 %.2f MiB)", mib(totalBytes_), mib(peakBytes_));
+        os << "[" << title << "] " << line;
+        if (budget_ > 0) {
+            std::snprintf(line, sizeof(line), " / 预算 %.2f MiB%s", mib(budget_), overBudget() ? " (超出)" : "");
+            os << line;
+        }
+        std::snprintf(line, sizeof(line), ", 淘汰 %d 次共 %.2f MiB", evictions_, mib(evictedBytes_));
+        os << line << std::endl;
+        std::snprintf(line, sizeof(line), "    %-17s %8s %12s %12s\n", "category", "objects", "MiB", "peak MiB");
+        os << line;
+        for (int c = 0; c < (int)GpuCategory::Count; ++c) {
+            if (categoryPeak_[c] == 0 && counts[c] == 0) continue;
+            std::snprintf(line, sizeof(line), "    %-17s %8d %12.2f %12.2f\n", gpuCategoryName((GpuCategory)c),
+                          counts[c], mib(categoryBytes_[c]), mib(categoryPeak_[c]));
+            os << line;
+        }
+    }
+
+private:
+    struct Entry {
+        GpuCategory category = GpuCategory::Texture;
+        size_t bytes = 0;
+        uint64_t lastUseFrame = 0;
+        bool evictable = false;
+        EvictCallback evict;
+        std::list<uint64_t>::iterator lruPosition;
+    };
+
+    GpuMemoryRegistry() {
+        std::fill(categoryBytes_, categoryBytes_ + (int)GpuCategory::Count, (size_t)0);
+        std::fill(categoryPeak_, categoryPeak_ + (int)GpuCategory::Count, (size_t)0);
+    }
+
+    static uint64_t key(GpuObjectKind kind, GLuint name) { return ((uint64_t)kind << 32) | name; }
+    static double mib(size_t bytes) { return bytes / 1048576.0; }
+
+    std::unordered_map<uint64_t, Entry> entries_;
+    std::list<uint64_t> lru_;          // 可淘汰资源, 队首最久未使用
+    size_t budget_ = 0;
+    size_t totalBytes_ = 0;
+    size_t peakBytes_ = 0;
+    size_t categoryBytes_[(int)GpuCategory::Count];
+    size_t categoryPeak_[(int)GpuCategory::Count];
+    uint64_t frame_ = 0;
+    int evictions_ = 0;
+    size_t evictedBytes_ = 0;
+    uint64_t allocations_ = 0;
+    uint64_t frees_ = 0;
+};
+
+inline GpuMemoryRegistry& gpuMemory() { return GpuMemoryRegistry::instance(); }
+
+// 以下封装与对应的 GL 调用参数相同, 多出的对象名和类别用于登记 (GL 3.3 没有 DSA, 对象名无法从绑定点得到)
+
+// glBufferData 到已绑定在 target 上的 buffer; 重新分配时更新登记的大小
+inline void gpuBufferData(GLenum target, GLuint buffer, GLsizeiptr size, const void* data, GLenum usage, GpuCategory category) {
+    glBufferData(target, size, data, usage);
+    gpuMemory().track(GpuObjectKind::Buffer, buffer, category, (size_t)size);
+}
+
+// glTexImage2D 定义已绑定的 texture 的第 0 级; 之后 glGenerateMipmap 的话改用 gpuTrackTexture 登记整条 mip 链
+inline void gpuTexImage2D(GLenum target, GLuint texture, GLint internalFormat, GLsizei width, GLsizei height,
+                          GLenum format, GLenum type, const void* pixels, GpuCategory category) {
+    glTexImage2D(target, 0, internalFormat, width, height, 0, format, type, pixels);
+    gpuMemory().track(GpuObjectKind::Texture, texture, category, gpuTextureBytes((GLenum)internalFormat, width, height));
+}
+
+// 登记以其他方式分配的纹理 (逐级 glTexImage2D、glGenerateMipmap、glTexStorage2D), levels 为 0 表示完整 mip 链
+inline void gpuTrackTexture(GLuint texture, GLenum internalFormat, int width, int height, int levels, GpuCategory category) {
+    gpuMemory().track(GpuObjectKind::Texture, texture, category, gpuTextureBytes(internalFormat, width, height, levels));
+}
+
+inline void gpuRenderbufferStorage(GLuint renderbuffer, GLenum internalFormat, GLsizei width, GLsizei height) {
+    glRenderbufferStorage(GL_RENDERBUFFER, internalFormat, width, height);
+    gpuMemory().track(GpuObjectKind::Renderbuffer, renderbuffer, GpuCategory::RenderTarget,
+                      gpuTextureBytes(internalFormat, width, height));
+}
+
+inline void gpuDeleteBuffers(GLsizei count, const GLuint* buffers) {
+    for (GLsizei i = 0; i < count; ++i) gpuMemory().untrack(GpuObjectKind::Buffer, buffers[i]);
+    glDeleteBuffers(count, buffers);
+}
+
+inline void gpuDeleteTextures(GLsizei count, const GLuint* textures) {
+    for (GLsizei i = 0; i < count; ++i) gpuMemory().untrack(GpuObjectKind::Texture, textures[i]);
+    glDeleteTextures(count, textures);
+}
+
+inline void gpuDeleteRenderbuffers(GLsizei count, const GLuint* renderbuffers) {
+    for (GLsizei i = 0; i < count; ++i) gpuMemory().untrack(GpuObjectKind::Renderbuffer, renderbuffers[i]);
+    glDeleteRenderbuffers(count, renderbuffers);
+}
+
+#endif
@@ -0,0 +1,79 @@
+#ifndef COMMON_GPU_TIMER_H
+#define COMMON_GPU_TIMER_H
+
+// 基于 glQueryCounter(GL_TIMESTAMP) 的 GPU 分段计时
+// 每帧在若干位置打时间戳, 相邻标记之间为一个分段; 查询结果延迟几帧再读取, 不会让 CPU 等待 GPU
+
+#include "glad/glad.h"
+
+#include <vector>
+
+class GpuTimer {
+public:
+    // markersPerFrame: 每帧的时间戳数量 (分段数 = markersPerFrame - 1)
+    explicit GpuTimer(int markersPerFrame, int framesInFlight = 4)
+        : markers_(markersPerFrame), frames_(framesInFlight),
+          queries_(markersPerFrame * framesInFlight), issued_(framesInFlight, false),
+          sumsNs_(markersPerFrame > 1 ? markersPerFrame - 1 : 0, 0.0) {
+        glGenQueries((GLsizei)queries_.size(), queries_.data());
+    }
+
+    ~GpuTimer() {
+        glDeleteQueries((GLsizei)queries_.size(), queries_.data());
+    }
+
+    GpuTimer(const GpuTimer&) = delete;
+    GpuTimer& operator=(const GpuTimer&) = delete;
+
+    // 每帧开始时调用: 切换到下一个查询槽, 读取该槽上一轮 (framesInFlight 帧之前) 的结果
+    void beginFrame() {
+        current_ = (current_ + 1) % frames_;
+        if (issued_[current_]) {
+            collect(current_);
+            issued_[current_] = false;
+        }
+    }
+
+    // 在当前帧记录第 index 个时间戳
+    void mark(int index) {
+        glQueryCounter(queries_[current_ * markers_ + index], GL_TIMESTAMP);
+        if (index == markers_ - 1) issued_[current_] = true;
+    }
+
+    // 已收集帧中第 segment 段的平均耗时 (毫秒)
+    double averageMs(int segment) const {
+        return samples_ > 0 ? sumsNs_[segment] / samples_ / 1.0e6 : 0.0;
+    }
+
+    int samples() const { return samples_; }
+
+    void reset() {
+        for (size_t i = 0; i < sumsNs_.size(); ++i) sumsNs_[i] = 0.0;
+        samples_ = 0;
+    }
+
+private:
+    void collect(int frame) {
+        GLint available = 0;
+        glGetQueryObjectiv(queries_[frame * markers_ + markers_ - 1], GL_QUERY_RESULT_AVAILABLE, &available);
+        if (!available) return; // GPU 落后太多, 丢弃这一帧的样本而不是等待
+        std::vector<GLuint64> stamps(markers_);
+        for (int i = 0; i < markers_; ++i) {
+            glGetQueryObjectui64v(queries_[frame * markers_ + i], GL_QUERY_RESULT, &stamps[i]);
+        }
+        for (int i = 0; i + 1 < markers_; ++i) {
+            sumsNs_[i] += (double)(stamps[i + 1] - stamps[i]);
+        }
+        samples_++;
+    }
+
+    int markers_;
+    int frames_;
+    int current_ = 0;
+    int samples_ = 0;
+    std::vector<GLuint> queries_;
+    std::vector<bool> issued_;
+    std::vector<double> sumsNs_;
+};
+
+#endif
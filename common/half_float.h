@@ -0,0 +1,109 @@
+#ifndef COMMON_HALF_FLOAT_H
+#define COMMON_HALF_FLOAT_H
+
+// Radiance RGBE 像素转 GL_RGB16F 用的半精度浮点 (IEEE 754 binary16)
+// RGBE 每个通道的值是 m * 2^(e-136), e == 0 表示黑色。转换结果就近舍入到偶数,
+// 超出半精度范围的值截断到最大有限值 65504, 避免纹理过滤时出现 inf/NaN。
+// rgbeToHalfRgb 在编译器允许时使用 F16C (-mf16c) 或 SSE2, 否则用逐通道的标量版本, 三者结果逐位一致。
+// 半精度 RGB 每像素 6 字节, 是 stbi_loadf 展开成 float RGB (12 字节) 的一半。
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define HALF_FLOAT_SSE2
+#include <emmintrin.h>
+#endif
+#if defined(HALF_FLOAT_SSE2) && defined(__F16C__)
+#include <immintrin.h>
+#endif
+
+const float kHalfMax = 65504.0f;
+
+// value 需非负
+inline uint16_t halfFromFloat(float value) {
+    if (!(value > 0.0f)) return 0;
+    if (value > kHalfMax) value = kHalfMax;
+    uint32_t bits;
+    std::memcpy(&bits, &value, 4);
+    if (bits < (113u << 23)) {
+        // 小于 2^-14: 半精度非规格化数。加 0.5 后 float 的最低位正好是 2^-24, 舍入交给浮点加法
+        float shifted = value + 0.5f;
+        std::memcpy(&bits, &shifted, 4);
+        return (uint16_t)(bits - 0x3F000000u);
+    }
+    bits -= (127u - 15u) << 23;              // 指数偏置 127 -> 15
+    bits += 0xFFFu + ((bits >> 13) & 1u);    // 尾数舍到 10 位, 平局取偶
+    return (uint16_t)(bits >> 13);
+}
+
+// 2^(e-136); e <= 9 时结果远小于半精度能表示的最小值, 直接取 0
+inline float rgbeScale(unsigned char e) {
+    uint32_t bits = e > 9 ? (uint32_t)(e - 9) << 23 : 0;
+    float scale;
+    std::memcpy(&scale, &bits, 4);
+    return scale;
+}
+
+inline void rgbeToHalfRgbScalar(const unsigned char* rgbe, uint16_t* out, size_t pixels) {
+    for (size_t i = 0; i < pixels; ++i, rgbe += 4, out += 3) {
+        float scale = rgbeScale(rgbe[3]);
+        out[0] = halfFromFloat(rgbe[0] * scale);
+        out[1] = halfFromFloat(rgbe[1] * scale);
+        out[2] = halfFromFloat(rgbe[2] * scale);
+    }
+}
+
+#ifdef HALF_FLOAT_SSE2
+// 4 个 [0, 65504] 内的 float 转半精度, 结果在每个 32 位通道的低 16 位
+inline __m128i halfFromFloat4(__m128 value) {
+#ifdef __F16C__
+    return _mm_unpacklo_epi16(_mm_cvtps_ph(value, _MM_FROUND_TO_NEAREST_INT), _mm_setzero_si128());
+#else
+    __m128i bits = _mm_castps_si128(value);
+    __m128i normal = _mm_sub_epi32(bits, _mm_set1_epi32((127 - 15) << 23));
+    normal = _mm_add_epi32(normal, _mm_add_epi32(_mm_set1_epi32(0xFFF), _mm_and_si128(_mm_srli_epi32(bits, 13), _mm_set1_epi32(1))));
+    normal = _mm_srli_epi32(normal, 13);
+    __m128i denormal = _mm_sub_epi32(_mm_castps_si128(_mm_add_ps(value, _mm_set1_ps(0.5f))), _mm_set1_epi32(0x3F000000));
+    __m128i isNormal = _mm_cmpgt_epi32(bits, _mm_set1_epi32((113 << 23) - 1));
+    return _mm_or_si128(_mm_and_si128(isNormal, normal), _mm_andnot_si128(isNormal, denormal));
+#endif
+}
+#endif
+
+// rgbe: pixels * 4 字节; out: pixels * 3 个半精度数
+inline void rgbeToHalfRgb(const unsigned char* rgbe, uint16_t* out, size_t pixels) {
+    size_t i = 0;
+#ifdef HALF_FLOAT_SSE2
+    const __m128i zero = _mm_setzero_si128();
+    const __m128 maxValue = _mm_set1_ps(kHalfMax);
+    // 每次 4 个像素, 每个像素写 8 字节, 多出的第 4 个数由下一个像素覆盖, 所以至少留一个像素给标量循环
+    for (; i + 5 <= pixels; i += 4) {
+        __m128i src = _mm_loadu_si128((const __m128i*)(rgbe + i * 4));
+        __m128i lo = _mm_unpacklo_epi8(src, zero);
+        __m128i hi = _mm_unpackhi_epi8(src, zero);
+        __m128i pixel[4] = { _mm_unpacklo_epi16(lo, zero), _mm_unpackhi_epi16(lo, zero),
+                             _mm_unpacklo_epi16(hi, zero), _mm_unpackhi_epi16(hi, zero) };
+        __m128i half[4];
+        for (int p = 0; p < 4; ++p) {
+            // 把 e 广播到 4 个通道, 直接拼出 2^(e-136) 的位模式 (同 rgbeScale)
+            __m128i exponent = _mm_sub_epi32(_mm_shuffle_epi32(pixel[p], _MM_SHUFFLE(3, 3, 3, 3)), _mm_set1_epi32(9));
+            exponent = _mm_and_si128(exponent, _mm_cmpgt_epi32(exponent, zero));
+            __m128 scale = _mm_castsi128_ps(_mm_slli_epi32(exponent, 23));
+            half[p] = halfFromFloat4(_mm_min_ps(_mm_mul_ps(_mm_cvtepi32_ps(pixel[p]), scale), maxValue));
+        }
+        // 结果不超过 0x7BFF, 有符号饱和打包不会改变数值
+        __m128i h01 = _mm_packs_epi32(half[0], half[1]);
+        __m128i h23 = _mm_packs_epi32(half[2], half[3]);
+        uint16_t* dst = out + i * 3;
+        _mm_storel_epi64((__m128i*)dst, h01);
+        _mm_storel_epi64((__m128i*)(dst + 3), _mm_unpackhi_epi64(h01, h01));
+        _mm_storel_epi64((__m128i*)(dst + 6), h23);
+        _mm_storel_epi64((__m128i*)(dst + 9), _mm_unpackhi_epi64(h23, h23));
+    }
+#endif
+    rgbeToHalfRgbScalar(rgbe + i * 4, out + i * 3, pixels - i);
+}
+
+#endif
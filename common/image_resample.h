@@ -0,0 +1,260 @@
+#ifndef COMMON_IMAGE_RESAMPLE_H
+#define COMMON_IMAGE_RESAMPLE_H
+
+// 加载时按纹理预算缩小 8 位图像 (1~4 通道)
+//
+// 可分离重采样, 按输出行分给多个线程 (自带的 std::thread 拆分, 或调用者提供的 parallelFor):
+//   box      源尺寸正好是目标尺寸的整数倍时, 每个输出像素取对应 fx*fy 块的平均值 (整数运算, 结果精确)
+//   lanczos3 其余情况, 缩小时核宽按缩放比例展开, 先在竖直方向加权得到一行 float, 再在水平方向加权
+// 竖直方向的累加 (占大部分运算) 和 3/4 通道的水平加权使用 SSE2, 定义 IMAGE_RESAMPLE_NO_SIMD 时全部走标量,
+// 两者按相同顺序累加, 结果逐位一致。
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <thread>
+#include <vector>
+
+#if !defined(IMAGE_RESAMPLE_NO_SIMD) && (defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2))
+#define IMAGE_RESAMPLE_SSE2
+#include <emmintrin.h>
+#endif
+
+// 0 表示不限制
+struct TextureBudget {
+    int maxDimension = 0;   // 宽高的上限
+    size_t maxBytes = 0;    // 第 0 级的字节数上限 (不含 mipmap)
+};
+
+// 按预算计算目标尺寸, 保持宽高比; 需要缩小时返回 true
+inline bool fitTextureBudget(const TextureBudget& budget, int width, int height, int channels, int& outWidth, int& outHeight) {
+    double scale = 1.0;
+    if (budget.maxDimension > 0 && std::max(width, height) > budget.maxDimension)
+        scale = (double)budget.maxDimension / std::max(width, height);
+    double bytes = (double)width * height * channels;
+    if (budget.maxBytes > 0 && bytes * scale * scale > (double)budget.maxBytes)
+        scale = std::sqrt((double)budget.maxBytes / bytes);
+    outWidth = width;
+    outHeight = height;
+    if (scale >= 1.0) return false;
+    outWidth = std::max(1, (int)(width * scale));
+    outHeight = std::max(1, (int)(height * scale));
+    return outWidth < width || outHeight < height;
+}
+
+enum class ResampleFilter { Box, Lanczos3 };
+
+inline ResampleFilter chooseResampleFilter(int srcWidth, int srcHeight, int dstWidth, int dstHeight) {
+    // box 的竖直累加用 16 位整数, fy 不能超过 257 (257 * 255 < 65536)
+    bool integer = srcWidth % dstWidth == 0 && srcHeight % dstHeight == 0 && srcHeight / dstHeight <= 257;
+    return integer ? ResampleFilter::Box : ResampleFilter::Lanczos3;
+}
+
+namespace resample_detail {
+
+// 一维滤波: 输出位置 i 使用源位置 [first[i], first[i] + taps) 的加权和, 权重已归一化
+struct Contributions {
+    int taps;
+    std::vector<int> first;
+    std::vector<float> weights;     // outSize * taps
+};
+
+inline double lanczos3(double x) {
+    if (x < 0) x = -x;
+    if (x < 1e-8) return 1.0;
+    if (x >= 3.0) return 0.0;
+    const double pi = 3.14159265358979323846;
+    return 3.0 * std::sin(pi * x) * std::sin(pi * x / 3.0) / (pi * pi * x * x);
+}
+
+inline Contributions lanczosContributions(int srcSize, int dstSize) {
+    double scale = (double)dstSize / srcSize;
+    double support = scale < 1.0 ? 3.0 / scale : 3.0;   // 缩小时展宽核, 起到低通的作用
+    double stretch = scale < 1.0 ? scale : 1.0;
+    Contributions c;
+    c.taps = std::min(srcSize, (int)std::ceil(support) * 2 + 1);
+    c.first.resize(dstSize);
+    c.weights.assign((size_t)dstSize * c.taps, 0.0f);
+    std::vector<double> w(c.taps);
+    for (int i = 0; i < dstSize; ++i) {
+        double center = (i + 0.5) / scale;
+        int first = std::max(0, std::min(srcSize - c.taps, (int)std::floor(center - support + 0.5)));
+        double sum = 0.0;
+        for (int t = 0; t < c.taps; ++t) {
+            w[t] = lanczos3((first + t + 0.5 - center) * stretch);
+            sum += w[t];
+        }
+        c.first[i] = first;
+        for (int t = 0; t < c.taps; ++t) c.weights[(size_t)i * c.taps + t] = (float)(w[t] / sum);
+    }
+    return c;
+}
+
+inline unsigned char toByte(float v) {
+    v += 0.5f;
+    return (unsigned char)(v <= 0.0f ? 0 : v >= 255.0f ? 255 : (int)v);
+}
+
+struct Job {
+    const unsigned char* src;
+    int srcWidth, srcHeight;
+    size_t srcStride;
+    unsigned char* dst;
+    int dstWidth, dstHeight;
+    size_t dstStride;
+    int channels;
+    ResampleFilter filter;
+    const Contributions* horizontal;
+    const Contributions* vertical;
+};
+
+// 16 位累加: sums[k] += row[k]
+inline void accumulateRow16(uint16_t* sums, const unsigned char* row, size_t count) {
+    size_t k = 0;
+#ifdef IMAGE_RESAMPLE_SSE2
+    const __m128i zero = _mm_setzero_si128();
+    for (; k + 16 <= count; k += 16) {
+        __m128i v = _mm_loadu_si128((const __m128i*)(row + k));
+        __m128i* s = (__m128i*)(sums + k);
+        _mm_storeu_si128(s, _mm_add_epi16(_mm_loadu_si128(s), _mm_unpacklo_epi8(v, zero)));
+        _mm_storeu_si128(s + 1, _mm_add_epi16(_mm_loadu_si128(s + 1), _mm_unpackhi_epi8(v, zero)));
+    }
+#endif
+    for (; k < count; ++k) sums[k] = (uint16_t)(sums[k] + row[k]);
+}
+
+inline void boxRows(const Job& job, int begin, int end) {
+    const int c = job.channels;
+    const int fx = job.srcWidth / job.dstWidth, fy = job.srcHeight / job.dstHeight;
+    const size_t rowBytes = (size_t)job.srcWidth * c;
+    const uint32_t area = (uint32_t)fx * fy;
+    std::vector<uint16_t> sums(rowBytes);
+    for (int y = begin; y < end; ++y) {
+        std::fill(sums.begin(), sums.end(), (uint16_t)0);
+        for (int r = 0; r < fy; ++r)
+            accumulateRow16(sums.data(), job.src + (size_t)(y * fy + r) * job.srcStride, rowBytes);
+        unsigned char* out = job.dst + (size_t)y * job.dstStride;
+        const uint16_t* s = sums.data();
+        for (int x = 0; x < job.dstWidth; ++x, s += (size_t)fx * c) {
+            for (int ch = 0; ch < c; ++ch) {
+                uint32_t total = 0;
+                for (int i = 0; i < fx; ++i) total += s[i * c + ch];
+                out[x * c + ch] = (unsigned char)((total + area / 2) / area);
+            }
+        }
+    }
+}
+
+// acc[k] += weight * row[k]
+inline void accumulateRowFloat(float* acc, const unsigned char* row, float weight, size_t count) {
+    size_t k = 0;
+#ifdef IMAGE_RESAMPLE_SSE2
+    const __m128i zero = _mm_setzero_si128();
+    const __m128 w = _mm_set1_ps(weight);
+    for (; k + 16 <= count; k += 16) {
+        __m128i v = _mm_loadu_si128((const __m128i*)(row + k));
+        __m128i lo = _mm_unpacklo_epi8(v, zero), hi = _mm_unpackhi_epi8(v, zero);
+        __m128i parts[4] = { _mm_unpacklo_epi16(lo, zero), _mm_unpackhi_epi16(lo, zero),
+                             _mm_unpacklo_epi16(hi, zero), _mm_unpackhi_epi16(hi, zero) };
+        for (int p = 0; p < 4; ++p) {
+            float* a = acc + k + p * 4;
+            _mm_storeu_ps(a, _mm_add_ps(_mm_loadu_ps(a), _mm_mul_ps(w, _mm_cvtepi32_ps(parts[p]))));
+        }
+    }
+#endif
+    for (; k < count; ++k) acc[k] += weight * (float)row[k];
+}
+
+inline void lanczosRows(const Job& job, int begin, int end) {
+    const int c = job.channels;
+    const size_t rowBytes = (size_t)job.srcWidth * c;
+    const Contributions& h = *job.horizontal;
+    const Contributions& v = *job.vertical;
+    std::vector<float> column(rowBytes + 1);   // 多一个 float, 3 通道时整块读取最后一个像素不越界
+    for (int y = begin; y < end; ++y) {
+        std::fill(column.begin(), column.end(), 0.0f);
+        const float* vw = &v.weights[(size_t)y * v.taps];
+        for (int t = 0; t < v.taps; ++t) {
+            if (vw[t] != 0.0f)
+                accumulateRowFloat(column.data(), job.src + (size_t)(v.first[y] + t) * job.srcStride, vw[t], rowBytes);
+        }
+
+        unsigned char* out = job.dst + (size_t)y * job.dstStride;
+        for (int x = 0; x < job.dstWidth; ++x) {
+            const float* hw = &h.weights[(size_t)x * h.taps];
+            const float* in = &column[(size_t)h.first[x] * c];
+#ifdef IMAGE_RESAMPLE_SSE2
+            if (c >= 3) {
+                // 3 通道时第 4 个通道是下一个像素的数据, 算出来直接丢弃
+                __m128 sum = _mm_setzero_ps();
+                for (int t = 0; t < h.taps; ++t)
+                    sum = _mm_add_ps(sum, _mm_mul_ps(_mm_set1_ps(hw[t]), _mm_loadu_ps(in + t * c)));
+                // 加 0.5 后截断, 与 toByte 相同
+                __m128i q = _mm_cvttps_epi32(_mm_add_ps(sum, _mm_set1_ps(0.5f)));
+                q = _mm_packs_epi32(q, q);
+                int packed = _mm_cvtsi128_si32(_mm_packus_epi16(q, q));
+                std::memcpy(out + x * c, &packed, c);
+                continue;
+            }
+#endif
+            for (int ch = 0; ch < c; ++ch) {
+                float sum = 0.0f;
+                for (int t = 0; t < h.taps; ++t) sum += hw[t] * in[t * c + ch];
+                out[x * c + ch] = toByte(sum);
+            }
+        }
+    }
+}
+
+inline void resampleRows(const Job& job, int begin, int end) {
+    if (job.filter == ResampleFilter::Box) boxRows(job, begin, end);
+    else lanczosRows(job, begin, end);
+}
+
+} // namespace resample_detail
+
+// 把 src (srcWidth x srcHeight, 行距 srcStride 字节) 重采样到 dst (dstWidth x dstHeight, 行距 dstStride)
+// 两者通道数相同。parallelFor(begin, end, fn) 负责把输出行 [begin, end) 分成若干段并发调用 fn(段首, 段尾),
+// 例如 common/job_system.h 的 parallelFor。返回使用的滤波器
+template <typename ParallelFor>
+inline ResampleFilter resampleImageWith(const unsigned char* src, int srcWidth, int srcHeight, size_t srcStride,
+                                        unsigned char* dst, int dstWidth, int dstHeight, size_t dstStride,
+                                        int channels, const ParallelFor& parallelFor) {
+    resample_detail::Contributions horizontal, vertical;
+    resample_detail::Job job = { src, srcWidth, srcHeight, srcStride, dst, dstWidth, dstHeight, dstStride, channels,
+                                 chooseResampleFilter(srcWidth, srcHeight, dstWidth, dstHeight), &horizontal, &vertical };
+    if (job.filter == ResampleFilter::Lanczos3) {
+        horizontal = resample_detail::lanczosContributions(srcWidth, dstWidth);
+        vertical = resample_detail::lanczosContributions(srcHeight, dstHeight);
+    }
+    parallelFor(0, dstHeight, [&job](int begin, int end) { resample_detail::resampleRows(job, begin, end); });
+    return job.filter;
+}
+
+// 同上, threadCount 个线程平分输出行, 调用线程也参与。基准测试用它比较固定的线程数,
+// 任务中通过 resampleImageWith 把输出行交给 jobSystem()
+inline ResampleFilter resampleImage(const unsigned char* src, int srcWidth, int srcHeight, size_t srcStride,
+                                    unsigned char* dst, int dstWidth, int dstHeight, size_t dstStride,
+                                    int channels, int threadCount) {
+    threadCount = std::max(1, std::min(threadCount, dstHeight));
+    return resampleImageWith(src, srcWidth, srcHeight, srcStride, dst, dstWidth, dstHeight, dstStride, channels,
+                             [threadCount](int first, int last, const std::function<void(int, int)>& fn) {
+        int rowsPerThread = (last - first + threadCount - 1) / threadCount;
+        std::vector<std::thread> threads;
+        for (int t = 1; t < threadCount; ++t) {
+            int begin = first + t * rowsPerThread;
+            int end = std::min(last, begin + rowsPerThread);
+            if (begin >= end) break;
+            threads.push_back(std::thread(fn, begin, end));
+        }
+        fn(first, std::min(last, first + rowsPerThread));
+        for (size_t i = 0; i < threads.size(); ++i) {
+            threads[i].join();
+        }
+    });
+}
+
+#endif
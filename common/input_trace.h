@@ -0,0 +1,420 @@
+#ifndef COMMON_INPUT_TRACE_H
+#define COMMON_INPUT_TRACE_H
+
+// 输入与帧时间的录制/回放, 用于在不同构建之间重放同一段交互并对比帧耗时
+//
+// 录制时每帧记下: 模拟使用的时间 (glfwGetTime), 本帧轮询到的按下的键, 上一帧之后到达的
+// 键盘事件和窗口尺寸变化, 以及 CPU 帧间隔。回放时时间和按键都取自记录, 不再读取真实输入:
+// 模拟时钟和摄像机逐帧与录制时相同, 只有帧耗时随构建和机器变化。回放完最后一帧后关闭窗口,
+// finish() 打印录制与回放的帧间隔分布和逐帧差。
+//
+// 任务中的用法:
+//   attach(window, slot)       在任务和 LatencyTracker 的回调之后调用; 多窗口时 slot 区分窗口
+//   clock(glfwGetTime())       代替进入渲染循环前读取的时间 (回放时返回录制的起始时间)
+//   beginFrame(glfwGetTime())  每帧读取输入前调用, 返回本帧的模拟时间; 回放时在这里派发录制的事件。
+//                              读取输入后决定不绘制时不调用 endFrame(), 下一次 beginFrame() 保留其间的事件;
+//                              任务的帧间隔要从上一个绘制的帧算起, 与回放一致
+//   keyDown(window, key)       代替 glfwGetKey(window, key) == GLFW_PRESS
+//   endFrame()                 交换缓冲后调用
+// 回放时忽略真实的键盘事件和窗口尺寸变化, 窗口尺寸按记录用 glfwSetWindowSize 设置。
+// 按需重绘模式下录制的只有实际绘制的帧, 回放时应连续绘制 (不等待事件)。
+//
+// 文件格式 (本机字节序):
+//   头   "OGLTRACE" | uint32 版本 | char[16] 任务名 | double 起始时间
+//   每帧 double 时间 | float 帧间隔 ms | uint8 事件数 | uint8 按键数
+//        | 事件 { uint8 类型, uint8 slot, int16 a, int16 b, int16 c } (键: key/action/mods, 尺寸: 宽/高)
+//        | 按键 uint16 (slot << 12 | key)
+// 每帧没有输入时 14 字节。录制内容保存在内存中, finish() 时一次写出, 渲染循环中没有文件 IO。
+
+#include <GLFW/glfw3.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <ostream>
+#include <string>
+#include <vector>
+
+class InputTrace {
+public:
+    typedef std::chrono::steady_clock Clock;
+
+    enum Mode { Off, Record, Replay };
+    static const int kMaxSlots = 4;
+
+    InputTrace() {
+        for (int s = 0; s < kMaxSlots; ++s) {
+            windows_[s] = nullptr;
+            prevKey_[s] = nullptr;
+            prevSize_[s] = nullptr;
+        }
+    }
+
+    InputTrace(const InputTrace&) = delete;
+    InputTrace& operator=(const InputTrace&) = delete;
+
+    Mode mode() const { return mode_; }
+    bool recording() const { return mode_ == Record; }
+    bool replaying() const { return mode_ == Replay; }
+
+    // 开始录制, 文件在 finish() 时写出
+    bool record(const char* path, const char* task) {
+        mode_ = Record;
+        path_ = path;
+        task_ = task;
+        return true;
+    }
+
+    // 读取整个记录文件; 格式错误或任务名不符时打印原因并返回 false
+    bool replay(const char* path, const char* task) {
+        FILE* f = std::fopen(path, "rb");
+        if (!f) {
+            std::fprintf(stderr, "无法打开输入记录: %s\n", path);
+            return false;
+        }
+        std::vector<unsigned char> bytes;
+        unsigned char buffer[65536];
+        size_t n;
+        while ((n = std::fread(buffer, 1, sizeof(buffer), f)) > 0) bytes.insert(bytes.end(), buffer, buffer + n);
+        std::fclose(f);
+
+        const unsigned char* p = bytes.data();
+        const unsigned char* end = p + bytes.size();
+        char name[17] = {};
+        uint32_t version = 0;
+        if (end - p < kHeaderSize || std::memcmp(p, kMagic, 8) != 0) {
+            std::fprintf(stderr, "不是输入记录文件: %s\n", path);
+            return false;
+        }
+        p += 8;
+        read(p, version);
+        std::memcpy(name, p, 16);
+        p += 16;
+        read(p, startTime_);
+        if (version != kVersion) {
+            std::fprintf(stderr, "输入记录版本 %u 不受支持: %s\n", version, path);
+            return false;
+        }
+        if (std::strcmp(name, task) != 0) {
+            std::fprintf(stderr, "输入记录属于 %s, 不能用于 %s\n", name, task);
+            return false;
+        }
+
+        frames_.clear();
+        while (p < end) {
+            Frame frame;
+            uint8_t eventCount, keyCount;
+            if (end - p < 14) break;
+            read(p, frame.time);
+            read(p, frame.ms);
+            read(p, eventCount);
+            read(p, keyCount);
+            if (end - p < (ptrdiff_t)eventCount * 8 + (ptrdiff_t)keyCount * 2) break;
+            frame.events.resize(eventCount);
+            for (int i = 0; i < eventCount; ++i) {
+                Event& e = frame.events[i];
+                read(p, e.type);
+                read(p, e.slot);
+                read(p, e.a);
+                read(p, e.b);
+                read(p, e.c);
+            }
+            frame.keys.resize(keyCount);
+            for (int i = 0; i < keyCount; ++i) read(p, frame.keys[i]);
+            frames_.push_back(frame);
+        }
+        if (p != end) std::fprintf(stderr, "输入记录末尾不完整, 只回放前 %d 帧\n", (int)frames_.size());
+
+        mode_ = Replay;
+        path_ = path;
+        task_ = task;
+        next_ = 0;
+        replayMs_.assign(frames_.size(), 0.0f);
+        return true;
+    }
+
+    // 在任务自己的回调 (以及 LatencyTracker) 安装之后调用, 记录/回放该窗口的键盘事件和尺寸变化
+    void attach(GLFWwindow* window, int slot = 0) {
+        if (mode_ == Off || slot < 0 || slot >= kMaxSlots) return;
+        windows_[slot] = window;
+        prevKey_[slot] = glfwSetKeyCallback(window, keyCallback);
+        prevSize_[slot] = glfwSetWindowSizeCallback(window, sizeCallback);
+        if (mode_ == Record) {
+            // 初始尺寸作为第一帧的事件, 回放时先把窗口设成录制时的大小
+            int width, height;
+            glfwGetWindowSize(window, &width, &height);
+            pushEvent(kResize, slot, width, height, 0);
+        }
+    }
+
+    // 窗口销毁前调用
+    void detach(GLFWwindow* window) {
+        int slot = slotOf(window);
+        if (slot >= 0) windows_[slot] = nullptr;
+    }
+
+    // 进入渲染循环前读取的时间: 录制时记为起始时间, 回放时返回录制的起始时间
+    double clock(double now) {
+        if (mode_ == Replay) return next_ > 0 ? frames_[next_ - 1].time : startTime_;
+        if (mode_ == Record && !inFrame_) startTime_ = now;
+        return now;
+    }
+
+    // 每帧读取输入前调用, 返回本帧的模拟时间
+    double beginFrame(double now) {
+        if (mode_ == Record) {
+            current_.time = now;
+            current_.keys.clear();
+            if (inFrame_) {
+                // 上一轮读取了输入却没有绘制 (按需重绘), 没有 endFrame(): 它的事件并入这一帧,
+                // 回放时在这一帧开始派发, 不能丢掉 (例如其间松开的键)
+                size_t room = 255 - std::min<size_t>(255, current_.events.size());
+                current_.events.insert(current_.events.end(), pending_.begin(),
+                                       pending_.begin() + std::min(room, pending_.size()));
+            } else {
+                current_.events.swap(pending_);
+            }
+            pending_.clear();
+            inFrame_ = true;
+            return now;
+        }
+        if (mode_ != Replay || next_ >= frames_.size()) return now;
+        inFrame_ = true;
+        const Frame& frame = frames_[next_++];
+        for (size_t i = 0; i < frame.events.size(); ++i) {
+            const Event& e = frame.events[i];
+            GLFWwindow* window = e.slot < kMaxSlots ? windows_[e.slot] : nullptr;
+            if (!window) continue;
+            if (e.type == kKey && prevKey_[e.slot]) prevKey_[e.slot](window, e.a, 0, e.b, e.c);
+            else if (e.type == kResize) glfwSetWindowSize(window, e.a, e.b);
+        }
+        return frame.time;
+    }
+
+    // 代替 glfwGetKey(window, key) == GLFW_PRESS
+    bool keyDown(GLFWwindow* window, int key) {
+        if (mode_ == Off) return glfwGetKey(window, key) == GLFW_PRESS;
+        int slot = std::max(slotOf(window), 0);
+        uint16_t code = (uint16_t)(slot << 12 | (key & 0xfff));
+        if (mode_ == Replay) {
+            if (!inFrame_ || next_ == 0) return false;
+            const std::vector<uint16_t>& keys = frames_[next_ - 1].keys;
+            return std::find(keys.begin(), keys.end(), code) != keys.end();
+        }
+        bool down = glfwGetKey(window, key) == GLFW_PRESS;
+        // 帧外的查询 (按需重绘模式判断是否继续轮询) 不影响模拟, 不记录
+        if (down && inFrame_ && current_.keys.size() < 255
+            && std::find(current_.keys.begin(), current_.keys.end(), code) == current_.keys.end())
+            current_.keys.push_back(code);
+        return down;
+    }
+
+    // 交换缓冲后调用: 记下 CPU 帧间隔; 回放完最后一帧时关闭所有窗口
+    void endFrame() {
+        if (mode_ == Off || !inFrame_) return;
+        Clock::time_point now = Clock::now();
+        float ms = hasLastEnd_ ? std::chrono::duration<float, std::milli>(now - lastEnd_).count() : 0.0f;
+        lastEnd_ = now;
+        hasLastEnd_ = true;
+        inFrame_ = false;
+        if (mode_ == Record) {
+            current_.ms = ms;
+            appendFrame(current_);
+            return;
+        }
+        replayMs_[next_ - 1] = ms;
+        if (next_ == frames_.size()) {
+            for (int s = 0; s < kMaxSlots; ++s)
+                if (windows_[s]) glfwSetWindowShouldClose(windows_[s], GLFW_TRUE);
+        }
+    }
+
+    // 录制: 写出文件; 回放: 打印录制与回放的帧间隔对比
+    void finish(std::ostream& os) {
+        if (mode_ == Record) save(os);
+        else if (mode_ == Replay) compare(os);
+        mode_ = Off;
+    }
+
+private:
+    enum EventType : uint8_t { kKey = 1, kResize = 2 };
+    static constexpr const char* kMagic = "OGLTRACE";
+    static const uint32_t kVersion = 1;
+    static const int kHeaderSize = 8 + 4 + 16 + 8;
+
+    struct Event {
+        uint8_t type;
+        uint8_t slot;
+        int16_t a, b, c;
+    };
+
+    struct Frame {
+        double time = 0.0;
+        float ms = 0.0f;
+        std::vector<Event> events;
+        std::vector<uint16_t> keys;
+    };
+
+    template <typename T>
+    static void read(const unsigned char*& p, T& value) {
+        std::memcpy(&value, p, sizeof(T));
+        p += sizeof(T);
+    }
+
+    template <typename T>
+    void write(const T& value) {
+        const unsigned char* bytes = (const unsigned char*)&value;
+        data_.insert(data_.end(), bytes, bytes + sizeof(T));
+    }
+
+    int slotOf(GLFWwindow* window) const {
+        for (int s = 0; s < kMaxSlots; ++s)
+            if (windows_[s] == window) return s;
+        return -1;
+    }
+
+    void pushEvent(uint8_t type, int slot, int a, int b, int c) {
+        if (pending_.size() >= 255) return;
+        Event e = { type, (uint8_t)slot, (int16_t)a, (int16_t)b, (int16_t)c };
+        pending_.push_back(e);
+    }
+
+    void appendFrame(const Frame& frame) {
+        write(frame.time);
+        write(frame.ms);
+        write((uint8_t)frame.events.size());
+        write((uint8_t)frame.keys.size());
+        for (size_t i = 0; i < frame.events.size(); ++i) {
+            const Event& e = frame.events[i];
+            write(e.type);
+            write(e.slot);
+            write(e.a);
+            write(e.b);
+            write(e.c);
+        }
+        for (size_t i = 0; i < frame.keys.size(); ++i) write(frame.keys[i]);
+        recordedMs_.push_back(frame.ms);
+    }
+
+    void save(std::ostream& os) {
+        std::vector<unsigned char> header;
+        char name[16] = {};
+        uint32_t version = kVersion;
+        std::strncpy(name, task_.c_str(), sizeof(name) - 1);
+        header.insert(header.end(), kMagic, kMagic + 8);
+        header.insert(header.end(), (const unsigned char*)&version, (const unsigned char*)&version + 4);
+        header.insert(header.end(), name, name + 16);
+        header.insert(header.end(), (const unsigned char*)&startTime_, (const unsigned char*)&startTime_ + 8);
+
+        FILE* f = std::fopen(path_.c_str(), "wb");
+        bool ok = f && std::fwrite(header.data(), 1, header.size(), f) == header.size()
+                  && std::fwrite(data_.data(), 1, data_.size(), f) == data_.size();
+        if (f && std::fclose(f) != 0) ok = false;
+        if (!ok) {
+            os << "无法写入输入记录: " << path_ << std::endl;
+            return;
+        }
+        char line[160];
+        std::snprintf(line, sizeof(line), "[输入记录] %s: %d 帧, %.1f KiB -> %s", task_.c_str(), (int)recordedMs_.size(),
+                      (header.size() + data_.size()) / 1024.0, path_.c_str());
+        os << line << std::endl;
+        printDistribution(os, "录制", recordedMs_);
+    }
+
+    // 第一帧没有帧间隔, 不计入; 回放提前结束 (手动关闭窗口) 时只比较已回放的帧
+    void compare(std::ostream& os) {
+        std::vector<float> recorded, replayed;
+        double diffSum = 0.0, maxDiff = 0.0;
+        size_t maxDiffFrame = 0;
+        for (size_t i = 1; i < next_; ++i) {
+            recorded.push_back(frames_[i].ms);
+            replayed.push_back(replayMs_[i]);
+            double diff = (double)replayMs_[i] - frames_[i].ms;
+            diffSum += diff;
+            if (std::fabs(diff) > std::fabs(maxDiff)) {
+                maxDiff = diff;
+                maxDiffFrame = i;
+            }
+        }
+        char line[200];
+        std::snprintf(line, sizeof(line), "[输入回放] %s: 回放 %d/%d 帧 (%s)", task_.c_str(), (int)next_,
+                      (int)frames_.size(), path_.c_str());
+        os << line << std::endl;
+        printDistribution(os, "录制", recorded);
+        printDistribution(os, "回放", replayed);
+        if (!recorded.empty()) {
+            std::snprintf(line, sizeof(line), "    逐帧差 (回放 - 录制) 平均 %+.3f ms, 最大 %+.3f ms (第 %d 帧)",
+                          diffSum / recorded.size(), maxDiff, (int)maxDiffFrame);
+            os << line << std::endl;
+        }
+    }
+
+    static void printDistribution(std::ostream& os, const char* label, const std::vector<float>& ms) {
+        std::vector<float> sorted;
+        for (size_t i = 0; i < ms.size(); ++i)
+            if (ms[i] > 0.0f) sorted.push_back(ms[i]);
+        if (sorted.empty()) return;
+        std::sort(sorted.begin(), sorted.end());
+        double sum = 0.0;
+        for (size_t i = 0; i < sorted.size(); ++i) sum += sorted[i];
+        auto percentile = [&sorted](double q) { return sorted[std::min(sorted.size() - 1, (size_t)(q * sorted.size()))]; };
+        char line[200];
+        std::snprintf(line, sizeof(line), "    %s 帧间隔 ms: 平均 %.3f  p50 %.3f  p95 %.3f  p99 %.3f  最大 %.3f", label,
+                      sum / sorted.size(), percentile(0.5), percentile(0.95), percentile(0.99), sorted.back());
+        os << line << std::endl;
+    }
+
+    static void keyCallback(GLFWwindow* window, int key, int scancode, int action, int mods);
+    static void sizeCallback(GLFWwindow* window, int width, int height);
+
+    Mode mode_ = Off;
+    std::string path_;
+    std::string task_;
+    double startTime_ = 0.0;
+    bool inFrame_ = false;
+    Clock::time_point lastEnd_;
+    bool hasLastEnd_ = false;
+
+    // 录制
+    Frame current_;
+    std::vector<Event> pending_;
+    std::vector<unsigned char> data_;
+    std::vector<float> recordedMs_;
+
+    // 回放
+    std::vector<Frame> frames_;
+    size_t next_ = 0;
+    std::vector<float> replayMs_;
+
+    GLFWwindow* windows_[kMaxSlots];
+    GLFWkeyfun prevKey_[kMaxSlots];
+    GLFWwindowsizefun prevSize_[kMaxSlots];
+};
+
+inline InputTrace& inputTrace() {
+    static InputTrace trace;
+    return trace;
+}
+
+// 录制时记下事件再转发; 回放时丢弃真实事件, 只转发 beginFrame 派发的记录
+inline void InputTrace::keyCallback(GLFWwindow* window, int key, int scancode, int action, int mods) {
+    InputTrace& trace = inputTrace();
+    int slot = trace.slotOf(window);
+    if (slot < 0 || trace.mode_ == Replay) return;
+    if (trace.mode_ == Record) trace.pushEvent(kKey, slot, key, action, mods);
+    if (trace.prevKey_[slot]) trace.prevKey_[slot](window, key, scancode, action, mods);
+}
+
+// 回放时尺寸变化由 glfwSetWindowSize 产生, 不再记录
+inline void InputTrace::sizeCallback(GLFWwindow* window, int width, int height) {
+    InputTrace& trace = inputTrace();
+    int slot = trace.slotOf(window);
+    if (slot < 0) return;
+    if (trace.mode_ == Record) trace.pushEvent(kResize, slot, width, height, 0);
+    if (trace.prevSize_[slot]) trace.prevSize_[slot](window, width, height);
+}
+
+#endif
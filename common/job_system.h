@@ -0,0 +1,248 @@
+#ifndef COMMON_JOB_SYSTEM_H
+#define COMMON_JOB_SYSTEM_H
+
+// 工作窃取的任务系统
+//
+// 每个线程 (工作线程, 以及提交任务的外部线程共用的 0 号槽) 有自己的双端队列: 线程从自己队列的
+// 尾部取任务 (后进先出, 刚拆出来的任务数据还在缓存里), 自己的队列空了再从其它队列的头部窃取
+// (先进先出, 窃取到的是拆分早期较大的块)。
+//
+// JobGroup 收集一组任务, 任务可以依赖同组中先加入的任务; wait() 等待期间当前线程也执行队列里的
+// 任务, 所以主线程不会空等, 在任务里嵌套 parallelFor 也不会死锁。
+// parallelFor 把区间对半拆分直到不超过 grain, 区间本身不超过 grain 时直接在调用线程上执行,
+// 小网格之类的工作不会付出任何调度开销。
+//
+// jobSystem() 是进程内共享的实例, 线程数等于 hardware_concurrency (含调用线程);
+// 基准测试可以另建指定线程数的 JobSystem。
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <initializer_list>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+class JobSystem {
+public:
+    typedef std::function<void()> Job;
+
+    // threadCount 包括调用线程: 创建 threadCount - 1 个工作线程, <= 0 时使用全部硬件线程
+    explicit JobSystem(int threadCount = 0) {
+        if (threadCount <= 0) threadCount = std::max(1, (int)std::thread::hardware_concurrency());
+        for (int i = 0; i < threadCount; ++i) queues_.push_back(std::unique_ptr<Queue>(new Queue()));
+        for (int i = 1; i < threadCount; ++i) workers_.push_back(std::thread(&JobSystem::workerLoop, this, i));
+    }
+
+    // 调用前所有 JobGroup 都应已经 wait() 完
+    ~JobSystem() {
+        {
+            std::lock_guard<std::mutex> lock(sleepMutex_);
+            stop_ = true;
+        }
+        wake_.notify_all();
+        for (size_t i = 0; i < workers_.size(); ++i) workers_[i].join();
+    }
+
+    JobSystem(const JobSystem&) = delete;
+    JobSystem& operator=(const JobSystem&) = delete;
+
+    int threadCount() const { return (int)queues_.size(); }
+
+    // 放进当前线程的队列 (外部线程放进 0 号队列) 并唤醒一个空闲的工作线程
+    void submit(Job job) {
+        Queue& queue = *queues_[currentSlot()];
+        {
+            std::lock_guard<std::mutex> lock(queue.mutex);
+            queue.jobs.push_back(std::move(job));
+        }
+        queued_++;
+        {
+            // 空加锁: 工作线程检查 queued_ 和开始等待之间不会漏掉这次通知
+            std::lock_guard<std::mutex> lock(sleepMutex_);
+        }
+        wake_.notify_one();
+    }
+
+    // 执行一个任务: 先取自己队列的尾部, 再窃取其它队列的头部。没有任务时返回 false
+    bool runOne() {
+        int slot = currentSlot();
+        Job job;
+        if (!take(slot, true, job)) {
+            int count = threadCount();
+            bool stolen = false;
+            for (int k = 1; k < count && !stolen; ++k) stolen = take((slot + k) % count, false, job);
+            if (!stolen) return false;
+            steals_++;
+        }
+        job();
+        executed_++;
+        return true;
+    }
+
+    size_t executed() const { return executed_.load(); }
+    size_t steals() const { return steals_.load(); }
+
+private:
+    struct Queue {
+        std::mutex mutex;
+        std::deque<Job> jobs;
+    };
+
+    struct ThreadSlot {
+        const JobSystem* system;
+        int slot;
+    };
+
+    static ThreadSlot& threadSlot() {
+        static thread_local ThreadSlot slot = { nullptr, 0 };
+        return slot;
+    }
+
+    int currentSlot() const {
+        const ThreadSlot& slot = threadSlot();
+        return slot.system == this ? slot.slot : 0;
+    }
+
+    bool take(int slot, bool back, Job& job) {
+        Queue& queue = *queues_[slot];
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        if (queue.jobs.empty()) return false;
+        if (back) {
+            job = std::move(queue.jobs.back());
+            queue.jobs.pop_back();
+        } else {
+            job = std::move(queue.jobs.front());
+            queue.jobs.pop_front();
+        }
+        queued_--;
+        return true;
+    }
+
+    void workerLoop(int slot) {
+        ThreadSlot& self = threadSlot();
+        self.system = this;
+        self.slot = slot;
+        for (;;) {
+            if (runOne()) continue;
+            std::unique_lock<std::mutex> lock(sleepMutex_);
+            wake_.wait(lock, [this]() { return stop_ || queued_.load() > 0; });
+            if (stop_) return;
+        }
+    }
+
+    std::vector<std::unique_ptr<Queue> > queues_;
+    std::vector<std::thread> workers_;
+    std::atomic<size_t> queued_{0};
+    std::atomic<size_t> executed_{0};
+    std::atomic<size_t> steals_{0};
+    std::mutex sleepMutex_;
+    std::condition_variable wake_;
+    bool stop_ = false;
+};
+
+inline JobSystem& jobSystem() {
+    static JobSystem system;
+    return system;
+}
+
+// 一组任务及其依赖。add() 返回的 Id 只在本组内有效, 依赖只能指向已经加入的任务 (不会成环)。
+// 析构时等待全部任务完成。
+class JobGroup {
+public:
+    typedef size_t Id;
+
+    explicit JobGroup(JobSystem& system = jobSystem()) : system_(system) {}
+    ~JobGroup() { wait(); }
+
+    JobGroup(const JobGroup&) = delete;
+    JobGroup& operator=(const JobGroup&) = delete;
+
+    // 依赖全部完成后才提交 fn; 可以在本组的任务里继续 add
+    Id add(std::function<void()> fn, std::initializer_list<Id> dependencies = {}) {
+        std::unique_lock<std::mutex> lock(mutex_);
+        tasks_.emplace_back();
+        Task& task = tasks_.back();
+        Id id = tasks_.size() - 1;
+        task.fn = std::move(fn);
+        task.unresolved = 1; // 登记依赖期间先占住, 防止依赖恰好在这时完成而提前提交
+        for (Id dependency : dependencies) {
+            Task& before = tasks_[dependency];
+            if (before.done) continue;
+            before.dependents.push_back(&task);
+            task.unresolved++;
+        }
+        pending_++;
+        lock.unlock();
+        resolve(task);
+        return id;
+    }
+
+    // 等待组内全部任务完成, 期间执行队列里的任务 (不一定属于本组)
+    void wait() {
+        while (pending_.load() > 0) {
+            if (!system_.runOne()) std::this_thread::yield();
+        }
+    }
+
+private:
+    struct Task {
+        std::function<void()> fn;
+        std::atomic<int> unresolved{0};
+        std::vector<Task*> dependents; // 以下由 mutex_ 保护
+        bool done = false;
+    };
+
+    void resolve(Task& task) {
+        if (--task.unresolved == 0) system_.submit([this, &task]() { run(task); });
+    }
+
+    void run(Task& task) {
+        task.fn();
+        std::vector<Task*> dependents;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            task.done = true;
+            dependents.swap(task.dependents);
+        }
+        for (size_t i = 0; i < dependents.size(); ++i) resolve(*dependents[i]);
+        pending_--; // 最后一步: 之后 wait() 可能返回, 组随即被销毁
+    }
+
+    JobSystem& system_;
+    std::mutex mutex_;
+    std::deque<Task> tasks_; // deque: 追加时已有元素的地址不变
+    std::atomic<size_t> pending_{0};
+};
+
+// 对 [begin, end) 调用 fn(rangeBegin, rangeEnd), fn 需要可以并发执行。
+// grain 为每个任务的最大区间长度, 0 表示按线程数自动选择 (每个线程约 4 块)。
+template <typename Fn>
+inline void parallelFor(size_t begin, size_t end, size_t grain, const Fn& fn, JobSystem& system = jobSystem()) {
+    if (begin >= end) return;
+    if (grain == 0) grain = std::max<size_t>(1, (end - begin) / ((size_t)system.threadCount() * 4));
+    if (end - begin <= grain || system.threadCount() == 1) {
+        fn(begin, end);
+        return;
+    }
+
+    // 对半拆分: 后一半作为任务放进队列, 当前线程继续拆前一半。
+    // 空闲线程窃取到的总是最早放入的 (最大的) 一半, 再由它自己继续拆分
+    JobGroup group(system);
+    std::function<void(size_t, size_t)> split = [&](size_t first, size_t last) {
+        while (last - first > grain) {
+            size_t mid = first + (last - first) / 2;
+            group.add([&split, mid, last]() { split(mid, last); });
+            last = mid;
+        }
+        fn(first, last);
+    };
+    split(begin, end);
+    group.wait();
+}
+
+#endif
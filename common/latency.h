@@ -0,0 +1,291 @@
+#ifndef COMMON_LATENCY_H
+#define COMMON_LATENCY_H
+
+// 输入到显示 (input-to-photon) 延迟测量与低延迟模式
+//
+// 每帧记录四个时间点 (CPU steady_clock, 微秒):
+//   输入到达  本帧之前最早一个尚未被消费的输入事件 (键盘/鼠标回调触发的时刻)
+//   输入采样  本帧开始读取输入、推进模拟的时刻
+//   交换      glfwSwapBuffers 返回的时刻
+//   GPU 完成  本帧命令执行完毕的时刻: 交换后插入 fence 与 GL_TIMESTAMP 查询,
+//             fence 用于判断完成和限制在途帧数, 时间戳换算到 CPU 时钟得到精确时刻
+// 注意 GLFW 回调在 glfwPollEvents 内触发, 事件在操作系统队列中等待的时间无法观测;
+// 扫描输出到屏幕的时间也不包括在内, 所以 "GPU 完成" 是可测得的最晚时间点。
+//
+// 低延迟模式:
+//   - 开始新一帧前等待上一帧的 fence (在途帧数限制为 1), 不使用 glFinish
+//   - 根据近期的帧间隔和渲染耗时预测下一次交换, 睡眠到 "交换时刻 - 渲染耗时" 再采样输入,
+//     使输入采样和模拟尽量贴近渲染
+//
+// 交替模式 (alternateModes): 同一次运行中每 N 帧在默认模式和低延迟模式之间切换, 两种模式的
+// 样本分开统计, 退出时并排打印 p50/p99。场景、窗口和 GPU 负载相同, 比分两次运行对比更可靠;
+// 任务循环需要每帧通过 lowLatency() 读取当前模式。配合 --replay-input 时两种模式收到相同的输入
+
+#include "glad/glad.h"
+#include <GLFW/glfw3.h>
+
+#include <algorithm>
+#include <chrono>
+#include <deque>
+#include <iomanip>
+#include <ostream>
+#include <thread>
+#include <vector>
+
+class LatencyTracker {
+public:
+    explicit LatencyTracker(bool lowLatency) : lowLatency_(lowLatency) {}
+
+    ~LatencyTracker() {
+        // 需要在对应的 GL 上下文仍然有效时销毁
+        for (size_t i = 0; i < pending_.size(); ++i) {
+            glDeleteSync(pending_[i].fence);
+            glDeleteQueries(1, &pending_[i].query);
+        }
+    }
+
+    LatencyTracker(const LatencyTracker&) = delete;
+    LatencyTracker& operator=(const LatencyTracker&) = delete;
+
+    // 当前帧使用的模式; 交替模式下在 afterSwap() 中切换
+    bool lowLatency() const { return lowLatency_; }
+
+    // 从默认模式开始, 每 framesPerMode 帧切换一次模式
+    void alternateModes(int framesPerMode) {
+        alternateFrames_ = std::max(1, framesPerMode);
+        lowLatency_ = false;
+    }
+
+    static long long nowMicros() {
+        return (long long)std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+
+    // 安装键盘/鼠标回调记录输入时间, 并转发给之前已安装的回调 (需在任务自己的回调之后调用)
+    void attach(GLFWwindow* window) {
+        glfwSetWindowUserPointer(window, this);
+        prevKey_ = glfwSetKeyCallback(window, keyCallback);
+        prevMouseButton_ = glfwSetMouseButtonCallback(window, mouseButtonCallback);
+        prevCursorPos_ = glfwSetCursorPosCallback(window, cursorPosCallback);
+        prevScroll_ = glfwSetScrollCallback(window, scrollCallback);
+    }
+
+    // 记录一次输入事件, 只保留本帧之前最早的一个
+    void onInput() {
+        if (pendingInput_ == 0) pendingInput_ = nowMicros();
+    }
+
+    // 低延迟模式的帧开始: 等待上一帧完成并睡眠到预测的采样时刻, 之后再调用 glfwPollEvents
+    // 默认模式下什么也不做; 调用时对应的 GL 上下文必须为当前上下文
+    void beginFrame() {
+        if (!lowLatency_) return;
+        waitForPreviousFrame();
+        paceFrame();
+    }
+
+    // 在途帧数限制为 1: 阻塞等待上一帧的 fence
+    void waitForPreviousFrame() {
+        if (pending_.empty()) return;
+        glClientWaitSync(pending_.back().fence, GL_SYNC_FLUSH_COMMANDS_BIT, 100000000ull); // 最多 100 ms
+        collect(false);
+    }
+
+    // 睡眠到 "预测的下一次交换 - 预测的渲染耗时 - 余量"
+    void paceFrame() {
+        if (frameIntervalUs_ <= 0.0 || lastSwap_ == 0) return;
+        const double marginUs = 1000.0;
+        long long target = lastSwap_ + (long long)(frameIntervalUs_ - renderTimeUs_ - marginUs);
+        long long now = nowMicros();
+        if (target > now) {
+            std::this_thread::sleep_for(std::chrono::microseconds(std::min(target - now, (long long)frameIntervalUs_)));
+        }
+    }
+
+    // 输入已经读取, 本帧的模拟与渲染从此开始
+    void inputSampled() {
+        current_ = Frame();
+        current_.lowLatency = lowLatency_;
+        current_.input = pendingInput_;
+        current_.sample = nowMicros();
+        pendingInput_ = 0;
+    }
+
+    // glfwSwapBuffers 返回后调用: 记录交换时间并插入 fence 与时间戳查询
+    void afterSwap() {
+        collect(false);
+        long long now = nowMicros();
+        // 按需重绘模式下的空闲间隔不计入帧间隔
+        if (lastSwap_ != 0 && now - lastSwap_ < 100000) {
+            double interval = (double)(now - lastSwap_);
+            frameIntervalUs_ = frameIntervalUs_ <= 0.0 ? interval : frameIntervalUs_ * 0.9 + interval * 0.1;
+        }
+        lastSwap_ = now;
+        current_.swap = now;
+        glGenQueries(1, &current_.query);
+        glQueryCounter(current_.query, GL_TIMESTAMP);
+        current_.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+        if (frames_++ % 120 == 0) calibrate();
+        pending_.push_back(current_);
+        // 正常模式下保持队列有界, 避免 GPU 长时间落后时无限增长
+        while (pending_.size() > 8) collect(true);
+        if (alternateFrames_ > 0 && frames_ % alternateFrames_ == 0) lowLatency_ = !lowLatency_;
+    }
+
+    // 打印延迟分布 (毫秒)
+    // 交替模式下分别打印两种模式, 再并排对比 p50/p99
+    void report(std::ostream& os, const char* name) {
+        collect(false);
+        if (alternateFrames_ == 0) {
+            reportMode(os, name, samples_[lowLatency_ ? 1 : 0], lowLatency_ ? "低延迟模式" : "默认模式");
+            return;
+        }
+        reportMode(os, name, samples_[0], "交替运行, 默认模式");
+        reportMode(os, name, samples_[1], "交替运行, 低延迟模式");
+        os << "[延迟] " << name << " 默认 -> 低延迟 (每 " << alternateFrames_ << " 帧切换)" << std::endl;
+        compare(os, "  输入 -> GPU完成", samples_[0].inputToGpu, samples_[1].inputToGpu);
+        compare(os, "  采样 -> GPU完成", samples_[0].render, samples_[1].render);
+    }
+
+private:
+    struct Frame {
+        long long input = 0;
+        long long sample = 0;
+        long long swap = 0;
+        GLuint query = 0;
+        GLsync fence = 0;
+        bool lowLatency = false;
+    };
+
+    // 一种模式下收集的样本 (毫秒)
+    struct Samples {
+        std::vector<double> inputToSample, inputToSwap, inputToGpu, render;
+    };
+
+    static void reportMode(std::ostream& os, const char* name, const Samples& s, const char* mode) {
+        os << "[延迟] " << name << " (" << mode << "), 帧数 " << s.render.size()
+           << ", 带输入的帧 " << s.inputToGpu.size() << std::endl;
+        printDistribution(os, "  输入 -> 采样   ", s.inputToSample);
+        printDistribution(os, "  输入 -> 交换   ", s.inputToSwap);
+        printDistribution(os, "  输入 -> GPU完成", s.inputToGpu);
+        printDistribution(os, "  采样 -> GPU完成", s.render);
+    }
+
+    static void compare(std::ostream& os, const char* label, std::vector<double> normal, std::vector<double> low) {
+        os << label << ": ";
+        if (normal.empty() || low.empty()) {
+            os << "无样本" << std::endl;
+            return;
+        }
+        std::sort(normal.begin(), normal.end());
+        std::sort(low.begin(), low.end());
+        os << std::fixed << std::setprecision(2)
+           << "p50 " << percentile(normal, 0.50) << " -> " << percentile(low, 0.50)
+           << "  p99 " << percentile(normal, 0.99) << " -> " << percentile(low, 0.99) << " ms" << std::endl;
+        os.unsetf(std::ios::floatfield);
+    }
+
+    // GPU 时间戳与 CPU 时钟的偏移, 定期重新校准以抵消漂移
+    void calibrate() {
+        GLint64 gpuNs = 0;
+        glGetInteger64v(GL_TIMESTAMP, &gpuNs);
+        gpuOffsetUs_ = nowMicros() - gpuNs / 1000;
+    }
+
+    // 收集已完成帧的结果; force 为 true 时阻塞等待最早的一帧
+    void collect(bool force) {
+        while (!pending_.empty()) {
+            Frame& f = pending_.front();
+            GLenum status = glClientWaitSync(f.fence, force ? GL_SYNC_FLUSH_COMMANDS_BIT : 0, force ? 100000000ull : 0);
+            if (status != GL_ALREADY_SIGNALED && status != GL_CONDITION_SATISFIED) return;
+            GLuint64 gpuNs = 0;
+            glGetQueryObjectui64v(f.query, GL_QUERY_RESULT, &gpuNs);
+            long long gpuDone = (long long)(gpuNs / 1000) + gpuOffsetUs_;
+            gpuDone = std::max(gpuDone, f.swap);
+
+            double render = (double)(gpuDone - f.sample);
+            // 只有低延迟模式用它来安排采样时刻; 默认模式的帧在队列里排得更久, 交替运行时不计入
+            if (f.lowLatency) renderTimeUs_ = renderTimeUs_ <= 0.0 ? render : renderTimeUs_ * 0.9 + render * 0.1;
+            Samples& s = samples_[f.lowLatency ? 1 : 0];
+            s.render.push_back(render / 1000.0);
+            if (f.input != 0) {
+                s.inputToSample.push_back((f.sample - f.input) / 1000.0);
+                s.inputToSwap.push_back((f.swap - f.input) / 1000.0);
+                s.inputToGpu.push_back((gpuDone - f.input) / 1000.0);
+            }
+            glDeleteSync(f.fence);
+            glDeleteQueries(1, &f.query);
+            pending_.pop_front();
+            force = false;
+        }
+    }
+
+    static void printDistribution(std::ostream& os, const char* label, std::vector<double> values) {
+        os << label << ": ";
+        if (values.empty()) {
+            os << "无样本" << std::endl;
+            return;
+        }
+        std::sort(values.begin(), values.end());
+        double sum = 0.0;
+        for (size_t i = 0; i < values.size(); ++i) sum += values[i];
+        os << std::fixed << std::setprecision(2)
+           << "平均 " << sum / values.size()
+           << "  p50 " << percentile(values, 0.50)
+           << "  p90 " << percentile(values, 0.90)
+           << "  p99 " << percentile(values, 0.99)
+           << "  最大 " << values.back() << " ms" << std::endl;
+        os.unsetf(std::ios::floatfield);
+    }
+
+    static double percentile(const std::vector<double>& sorted, double p) {
+        size_t index = (size_t)(p * (sorted.size() - 1) + 0.5);
+        return sorted[std::min(index, sorted.size() - 1)];
+    }
+
+    static LatencyTracker* fromWindow(GLFWwindow* window) {
+        return static_cast<LatencyTracker*>(glfwGetWindowUserPointer(window));
+    }
+
+    static void keyCallback(GLFWwindow* window, int key, int scancode, int action, int mods) {
+        LatencyTracker* t = fromWindow(window);
+        t->onInput();
+        if (t->prevKey_) t->prevKey_(window, key, scancode, action, mods);
+    }
+
+    static void mouseButtonCallback(GLFWwindow* window, int button, int action, int mods) {
+        LatencyTracker* t = fromWindow(window);
+        t->onInput();
+        if (t->prevMouseButton_) t->prevMouseButton_(window, button, action, mods);
+    }
+
+    static void cursorPosCallback(GLFWwindow* window, double x, double y) {
+        LatencyTracker* t = fromWindow(window);
+        t->onInput();
+        if (t->prevCursorPos_) t->prevCursorPos_(window, x, y);
+    }
+
+    static void scrollCallback(GLFWwindow* window, double dx, double dy) {
+        LatencyTracker* t = fromWindow(window);
+        t->onInput();
+        if (t->prevScroll_) t->prevScroll_(window, dx, dy);
+    }
+
+    bool lowLatency_;
+    long long pendingInput_ = 0;
+    long long lastSwap_ = 0;
+    long long gpuOffsetUs_ = 0;
+    long long frames_ = 0;
+    int alternateFrames_ = 0;      // 交替模式的切换间隔, 0 表示不交替
+    double frameIntervalUs_ = 0.0; // 交换间隔的指数滑动平均
+    double renderTimeUs_ = 0.0;    // 低延迟模式下采样到 GPU 完成的指数滑动平均
+    Frame current_;
+    std::deque<Frame> pending_;
+    Samples samples_[2];           // 默认模式, 低延迟模式
+
+    GLFWkeyfun prevKey_ = nullptr;
+    GLFWmousebuttonfun prevMouseButton_ = nullptr;
+    GLFWcursorposfun prevCursorPos_ = nullptr;
+    GLFWscrollfun prevScroll_ = nullptr;
+};
+
+#endif
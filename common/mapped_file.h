@@ -0,0 +1,93 @@
+#ifndef COMMON_MAPPED_FILE_H
+#define COMMON_MAPPED_FILE_H
+
+// 只读内存映射文件 (POSIX mmap / Windows MapViewOfFile)
+
+#include <cstddef>
+#include <string>
+
+#ifdef _WIN32
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+class MappedFile {
+public:
+    MappedFile() {}
+    ~MappedFile() { close(); }
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    // 映射整个文件, 文件不存在或为空时返回 false
+    bool open(const std::string& path) {
+        close();
+#ifdef _WIN32
+        HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+        if (file == INVALID_HANDLE_VALUE) return false;
+        LARGE_INTEGER fileSize;
+        if (!GetFileSizeEx(file, &fileSize) || fileSize.QuadPart == 0) {
+            CloseHandle(file);
+            return false;
+        }
+        HANDLE mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+        CloseHandle(file);
+        if (mapping == NULL) return false;
+        void* view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+        CloseHandle(mapping);
+        if (view == NULL) return false;
+        data_ = static_cast<const unsigned char*>(view);
+        size_ = (size_t)fileSize.QuadPart;
+#else
+        int fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0) return false;
+        struct stat st;
+        if (fstat(fd, &st) != 0 || st.st_size == 0) {
+            ::close(fd);
+            return false;
+        }
+        void* view = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        ::close(fd); // 映射建立后即可关闭文件描述符
+        if (view == MAP_FAILED) return false;
+        data_ = static_cast<const unsigned char*>(view);
+        size_ = (size_t)st.st_size;
+#endif
+        return true;
+    }
+
+    void close() {
+        if (!data_) return;
+#ifdef _WIN32
+        UnmapViewOfFile(data_);
+#else
+        munmap(const_cast<unsigned char*>(data_), size_);
+#endif
+        data_ = nullptr;
+        size_ = 0;
+    }
+
+    // 逐页读一遍, 缺页 (以及磁盘读取) 发生在调用线程上, 而不是之后第一次访问数据的线程
+    void prefault() const {
+        volatile unsigned char sink = 0;
+        for (size_t offset = 0; offset < size_; offset += 4096) sink = data_[offset];
+        (void)sink;
+    }
+
+    const unsigned char* data() const { return data_; }
+    size_t size() const { return size_; }
+
+private:
+    const unsigned char* data_ = nullptr;
+    size_t size_ = 0;
+};
+
+#endif
@@ -0,0 +1,323 @@
+#ifndef COMMON_METRICS_EXPORTER_H
+#define COMMON_METRICS_EXPORTER_H
+
+// 以 Prometheus 文本格式导出实时帧统计
+//
+// 渲染线程只写 FrameMetrics: countDraw() 累加到普通成员 (只有渲染线程访问)。endFrame() 每帧调用一次,
+// 用 relaxed 原子操作发布本帧的绘制数、帧间隔直方图, 以及显存登记 (common/gpu_memory.h) 的数值。
+// MetricsExporter 在自己的线程上应答 HTTP 请求, 只读这些原子变量生成响应, 不加锁,
+// 也不碰渲染线程的其它状态, 抓取不会让渲染循环等待。MetricsExporter 仅 POSIX; FrameMetrics 各平台都可用。
+//
+// 端点: 纯数字为本机 TCP 端口 (只绑定 127.0.0.1), 其它视为 Unix 域套接字路径
+//   curl http://127.0.0.1:9464/metrics
+//   curl --unix-socket /tmp/task4.sock http://localhost/metrics
+
+#include "common/gpu_memory.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+
+#ifndef _WIN32
+#include "common/render_protocol.h"
+
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <thread>
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+
+class FrameMetrics {
+public:
+    typedef std::chrono::steady_clock Clock;
+
+    // 帧间隔直方图的上界 (秒): 240/120/60/30/20/10/4/1 fps, 最后还有一个 +Inf 桶
+    static const int kBucketCount = 9;
+
+    FrameMetrics() {
+        for (int b = 0; b < kBucketCount; ++b) buckets_[b].store(0);
+        for (int c = 0; c < (int)GpuCategory::Count; ++c) gpuCategoryBytes_[c].store(0);
+    }
+
+    FrameMetrics(const FrameMetrics&) = delete;
+    FrameMetrics& operator=(const FrameMetrics&) = delete;
+
+    // 渲染线程: 记录一次绘制调用, triangles 为其中的三角形数 (点、线为 0)
+    void countDraw(uint64_t triangles = 0) {
+        frameDrawCalls_++;
+        frameTriangles_ += triangles;
+    }
+
+    // 渲染线程: 交换缓冲后调用。帧时间取与上一次 endFrame 的间隔 (包括等待垂直同步和空闲等待)
+    void endFrame() {
+        Clock::time_point now = Clock::now();
+        if (frames_.load(std::memory_order_relaxed) > 0) {
+            double seconds = std::chrono::duration<double>(now - lastFrame_).count();
+            int b = 0;
+            while (b < kBucketCount - 1 && seconds > bucketBound(b)) ++b;
+            buckets_[b].fetch_add(1, std::memory_order_relaxed);
+            frameTimeSumMicros_.fetch_add((uint64_t)(seconds * 1e6), std::memory_order_relaxed);
+        }
+        lastFrame_ = now;
+        frames_.fetch_add(1, std::memory_order_relaxed);
+
+        drawCalls_.fetch_add(frameDrawCalls_, std::memory_order_relaxed);
+        triangles_.fetch_add(frameTriangles_, std::memory_order_relaxed);
+        lastFrameDrawCalls_.store(frameDrawCalls_, std::memory_order_relaxed);
+        lastFrameTriangles_.store(frameTriangles_, std::memory_order_relaxed);
+        frameDrawCalls_ = 0;
+        frameTriangles_ = 0;
+
+        // 显存登记只能在 GL 线程上读, 在这里复制一份
+        const GpuMemoryRegistry& memory = gpuMemory();
+        for (int c = 0; c < (int)GpuCategory::Count; ++c)
+            gpuCategoryBytes_[c].store(memory.categoryBytes((GpuCategory)c), std::memory_order_relaxed);
+        gpuPeakBytes_.store(memory.peakBytes(), std::memory_order_relaxed);
+        gpuBudgetBytes_.store(memory.budget(), std::memory_order_relaxed);
+        gpuObjects_.store(memory.objectCount(), std::memory_order_relaxed);
+        gpuAllocations_.store(memory.allocations(), std::memory_order_relaxed);
+        gpuFrees_.store(memory.frees(), std::memory_order_relaxed);
+        gpuEvictions_.store((uint64_t)memory.evictions(), std::memory_order_relaxed);
+    }
+
+    // 任意线程: 生成 Prometheus 文本格式 (version 0.0.4), 每个样本带 task 标签
+    std::string render(const std::string& task) const {
+        std::string out;
+        std::string label = "task=\"" + task + "\"";
+        char line[256];
+
+        out += "# HELP opengl_task_frames_total Frames presented.\n# TYPE opengl_task_frames_total counter\n";
+        sample(out, "opengl_task_frames_total", label, frames_.load(std::memory_order_relaxed));
+
+        // 累计桶由各桶依次相加, +Inf 桶与 _count 总是一致
+        out += "# HELP opengl_task_frame_time_seconds Interval between consecutive frames.\n"
+               "# TYPE opengl_task_frame_time_seconds histogram\n";
+        uint64_t cumulative = 0;
+        for (int b = 0; b < kBucketCount; ++b) {
+            cumulative += buckets_[b].load(std::memory_order_relaxed);
+            if (b < kBucketCount - 1)
+                std::snprintf(line, sizeof(line), "opengl_task_frame_time_seconds_bucket{%s,le=\"%g\"} %llu\n",
+                              label.c_str(), bucketBound(b), (unsigned long long)cumulative);
+            else
+                std::snprintf(line, sizeof(line), "opengl_task_frame_time_seconds_bucket{%s,le=\"+Inf\"} %llu\n",
+                              label.c_str(), (unsigned long long)cumulative);
+            out += line;
+        }
+        std::snprintf(line, sizeof(line), "opengl_task_frame_time_seconds_sum{%s} %.6f\n", label.c_str(),
+                      frameTimeSumMicros_.load(std::memory_order_relaxed) / 1e6);
+        out += line;
+        sample(out, "opengl_task_frame_time_seconds_count", label, cumulative);
+
+        out += "# HELP opengl_task_draw_calls_total Draw calls issued.\n# TYPE opengl_task_draw_calls_total counter\n";
+        sample(out, "opengl_task_draw_calls_total", label, drawCalls_.load(std::memory_order_relaxed));
+        out += "# HELP opengl_task_draw_calls Draw calls in the last frame.\n# TYPE opengl_task_draw_calls gauge\n";
+        sample(out, "opengl_task_draw_calls", label, lastFrameDrawCalls_.load(std::memory_order_relaxed));
+        out += "# HELP opengl_task_triangles_total Triangles submitted.\n# TYPE opengl_task_triangles_total counter\n";
+        sample(out, "opengl_task_triangles_total", label, triangles_.load(std::memory_order_relaxed));
+        out += "# HELP opengl_task_triangles Triangles in the last frame.\n# TYPE opengl_task_triangles gauge\n";
+        sample(out, "opengl_task_triangles", label, lastFrameTriangles_.load(std::memory_order_relaxed));
+
+        out += "# HELP opengl_task_gpu_memory_bytes Estimated GPU memory by category.\n"
+               "# TYPE opengl_task_gpu_memory_bytes gauge\n";
+        for (int c = 0; c < (int)GpuCategory::Count; ++c) {
+            std::string categoryLabel = label + ",category=\"" + gpuCategoryName((GpuCategory)c) + "\"";
+            sample(out, "opengl_task_gpu_memory_bytes", categoryLabel, gpuCategoryBytes_[c].load(std::memory_order_relaxed));
+        }
+        out += "# HELP opengl_task_gpu_memory_peak_bytes Peak estimated GPU memory.\n"
+               "# TYPE opengl_task_gpu_memory_peak_bytes gauge\n";
+        sample(out, "opengl_task_gpu_memory_peak_bytes", label, gpuPeakBytes_.load(std::memory_order_relaxed));
+        out += "# HELP opengl_task_gpu_memory_budget_bytes GPU memory budget, 0 when unlimited.\n"
+               "# TYPE opengl_task_gpu_memory_budget_bytes gauge\n";
+        sample(out, "opengl_task_gpu_memory_budget_bytes", label, gpuBudgetBytes_.load(std::memory_order_relaxed));
+        out += "# HELP opengl_task_gpu_objects Buffers, textures and renderbuffers currently allocated.\n"
+               "# TYPE opengl_task_gpu_objects gauge\n";
+        sample(out, "opengl_task_gpu_objects", label, gpuObjects_.load(std::memory_order_relaxed));
+        out += "# HELP opengl_task_gpu_allocations_total GPU storage allocations, including reallocations.\n"
+               "# TYPE opengl_task_gpu_allocations_total counter\n";
+        sample(out, "opengl_task_gpu_allocations_total", label, gpuAllocations_.load(std::memory_order_relaxed));
+        out += "# HELP opengl_task_gpu_frees_total GPU objects released.\n# TYPE opengl_task_gpu_frees_total counter\n";
+        sample(out, "opengl_task_gpu_frees_total", label, gpuFrees_.load(std::memory_order_relaxed));
+        out += "# HELP opengl_task_gpu_evictions_total Streamed resources evicted to stay within the budget.\n"
+               "# TYPE opengl_task_gpu_evictions_total counter\n";
+        sample(out, "opengl_task_gpu_evictions_total", label, gpuEvictions_.load(std::memory_order_relaxed));
+        return out;
+    }
+
+    static double bucketBound(int b) {
+        static const double bounds[kBucketCount - 1] = { 1.0 / 240, 1.0 / 120, 1.0 / 60, 1.0 / 30, 0.05, 0.1, 0.25, 1.0 };
+        return bounds[b];
+    }
+
+private:
+    static void sample(std::string& out, const char* name, const std::string& labels, uint64_t value) {
+        char line[256];
+        std::snprintf(line, sizeof(line), "%s{%s} %llu\n", name, labels.c_str(), (unsigned long long)value);
+        out += line;
+    }
+
+    // 只由渲染线程访问
+    uint64_t frameDrawCalls_ = 0;
+    uint64_t frameTriangles_ = 0;
+    Clock::time_point lastFrame_;
+
+    std::atomic<uint64_t> frames_{0};
+    std::atomic<uint64_t> buckets_[kBucketCount];
+    std::atomic<uint64_t> frameTimeSumMicros_{0};
+    std::atomic<uint64_t> drawCalls_{0};
+    std::atomic<uint64_t> triangles_{0};
+    std::atomic<uint64_t> lastFrameDrawCalls_{0};
+    std::atomic<uint64_t> lastFrameTriangles_{0};
+    std::atomic<uint64_t> gpuCategoryBytes_[(int)GpuCategory::Count];
+    std::atomic<uint64_t> gpuPeakBytes_{0};
+    std::atomic<uint64_t> gpuBudgetBytes_{0};
+    std::atomic<uint64_t> gpuObjects_{0};
+    std::atomic<uint64_t> gpuAllocations_{0};
+    std::atomic<uint64_t> gpuFrees_{0};
+    std::atomic<uint64_t> gpuEvictions_{0};
+};
+
+inline FrameMetrics& frameMetrics() {
+    static FrameMetrics metrics;
+    return metrics;
+}
+
+#ifndef _WIN32
+// 应答 GET /metrics (以及 GET /) 的最小 HTTP 服务, 一次处理一个连接, 响应后关闭
+class MetricsExporter {
+public:
+    explicit MetricsExporter(const std::string& task, const FrameMetrics& metrics = frameMetrics())
+        : task_(task), metrics_(metrics) {}
+    ~MetricsExporter() { stop(); }
+
+    MetricsExporter(const MetricsExporter&) = delete;
+    MetricsExporter& operator=(const MetricsExporter&) = delete;
+
+    // 开始监听并启动服务线程, 失败时打印原因并返回 false
+    bool start(const std::string& endpoint) {
+        bool tcp = !endpoint.empty() && endpoint.find_first_not_of("0123456789") == std::string::npos;
+        if (tcp) {
+            int port = std::atoi(endpoint.c_str());
+            if (port <= 0 || port > 65535) {
+                std::fprintf(stderr, "指标端口无效: %s\n", endpoint.c_str());
+                return false;
+            }
+            listenFd_ = ::socket(AF_INET, SOCK_STREAM, 0);
+            if (listenFd_ < 0) return false;
+            int reuse = 1;
+            setsockopt(listenFd_, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+            sockaddr_in addr;
+            std::memset(&addr, 0, sizeof(addr));
+            addr.sin_family = AF_INET;
+            addr.sin_port = htons((uint16_t)port);
+            addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK); // 只接受本机的抓取
+            if (::bind(listenFd_, (sockaddr*)&addr, sizeof(addr)) != 0) return fail("指标端口绑定失败");
+        } else {
+            sockaddr_un addr;
+            std::memset(&addr, 0, sizeof(addr));
+            addr.sun_family = AF_UNIX;
+            if (endpoint.empty() || endpoint.size() >= sizeof(addr.sun_path)) {
+                std::fprintf(stderr, "套接字路径无效: %s\n", endpoint.c_str());
+                return false;
+            }
+            std::strcpy(addr.sun_path, endpoint.c_str());
+            if (!removeStaleSocket(endpoint)) return false;
+            listenFd_ = ::socket(AF_UNIX, SOCK_STREAM, 0);
+            if (listenFd_ < 0) return false;
+            if (::bind(listenFd_, (sockaddr*)&addr, sizeof(addr)) != 0) return fail("指标套接字绑定失败");
+            path_ = endpoint;
+        }
+        if (::listen(listenFd_, 16) != 0) return fail("指标服务监听失败");
+        if (::pipe(wakeFds_) != 0) return fail("指标服务创建管道失败");
+        thread_ = std::thread(&MetricsExporter::serve, this);
+        return true;
+    }
+
+    void stop() {
+        if (thread_.joinable()) {
+            char c = 0;
+            while (::write(wakeFds_[1], &c, 1) < 0 && errno == EINTR) {}
+            thread_.join();
+        }
+        for (int i = 0; i < 2; ++i) {
+            if (wakeFds_[i] >= 0) ::close(wakeFds_[i]);
+            wakeFds_[i] = -1;
+        }
+        if (listenFd_ >= 0) ::close(listenFd_);
+        listenFd_ = -1;
+        if (!path_.empty()) ::unlink(path_.c_str());
+        path_.clear();
+    }
+
+    uint64_t scrapes() const { return scrapes_.load(std::memory_order_relaxed); }
+
+private:
+    bool fail(const char* what) {
+        std::perror(what);
+        ::close(listenFd_);
+        listenFd_ = -1;
+        return false;
+    }
+
+    void serve() {
+        for (;;) {
+            pollfd fds[2] = { { listenFd_, POLLIN, 0 }, { wakeFds_[0], POLLIN, 0 } };
+            int ready = ::poll(fds, 2, -1);
+            if (ready < 0 && errno == EINTR) continue;
+            if (ready < 0 || (fds[1].revents & POLLIN)) return;
+            if (!(fds[0].revents & POLLIN)) continue;
+            int client = ::accept(listenFd_, NULL, NULL);
+            if (client < 0) continue;
+            respond(client);
+            ::close(client);
+        }
+    }
+
+    // 读到请求头结束 (最多 4 KiB, 1 秒超时), 只看请求行
+    void respond(int fd) {
+        std::string request;
+        char buffer[1024];
+        while (request.find("\r\n\r\n") == std::string::npos && request.size() < 4096) {
+            pollfd pfd = { fd, POLLIN, 0 };
+            if (::poll(&pfd, 1, 1000) <= 0) return;
+            ssize_t n = ::read(fd, buffer, sizeof(buffer));
+            if (n < 0 && errno == EINTR) continue;
+            if (n <= 0) return;
+            request.append(buffer, (size_t)n);
+        }
+
+        std::string status = "200 OK", body;
+        if (request.compare(0, 13, "GET /metrics ") == 0 || request.compare(0, 6, "GET / ") == 0) {
+            body = metrics_.render(task_);
+            scrapes_.fetch_add(1, std::memory_order_relaxed);
+        } else if (request.compare(0, 4, "GET ") == 0) {
+            status = "404 Not Found";
+            body = "not found\n";
+        } else {
+            status = "405 Method Not Allowed";
+            body = "only GET is supported\n";
+        }
+        std::string header = "HTTP/1.1 " + status + "\r\nContent-Type: text/plain; version=0.0.4; charset=utf-8\r\n"
+                             "Content-Length: " + std::to_string(body.size()) + "\r\nConnection: close\r\n\r\n";
+        socketWriteAll(fd, header.data(), header.size()) && socketWriteAll(fd, body.data(), body.size());
+    }
+
+    std::string task_;
+    const FrameMetrics& metrics_;
+    int listenFd_ = -1;
+    int wakeFds_[2] = { -1, -1 };
+    std::string path_;
+    std::thread thread_;
+    std::atomic<uint64_t> scrapes_{0};
+};
+#endif
+
+#endif
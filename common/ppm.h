@@ -0,0 +1,28 @@
+#ifndef COMMON_PPM_H
+#define COMMON_PPM_H
+
+// 把 glReadPixels 读回的 RGBA8 图像 (自底向上) 编码为二进制 PPM (P6, RGB, 自顶向下)
+
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+inline void encodePpm(const unsigned char* rgba, int width, int height, std::vector<unsigned char>& out) {
+    char header[32];
+    int headerLength = std::snprintf(header, sizeof(header), "P6\n%d %d\n255\n", width, height);
+    out.resize((size_t)headerLength + (size_t)width * height * 3);
+    std::memcpy(out.data(), header, (size_t)headerLength);
+    unsigned char* dst = out.data() + headerLength;
+    for (int y = height - 1; y >= 0; --y) {
+        const unsigned char* src = rgba + (size_t)y * width * 4;
+        for (int x = 0; x < width; ++x) {
+            dst[0] = src[0];
+            dst[1] = src[1];
+            dst[2] = src[2];
+            dst += 3;
+            src += 4;
+        }
+    }
+}
+
+#endif
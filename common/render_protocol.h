@@ -0,0 +1,157 @@
+#ifndef COMMON_RENDER_PROTOCOL_H
+#define COMMON_RENDER_PROTOCOL_H
+
+// 渲染服务的请求协议 (Unix 域套接字, 仅 POSIX), 服务端和负载生成客户端共用
+//
+// 请求为一行文本, 字段可任意省略, 省略时使用服务端的默认值:
+//   RENDER width=640 height=480 eye=0,0.5,4 target=0,0,0 fov=60 time=0 stars=1
+//   SHUTDOWN
+// 响应按同一连接上的请求顺序返回:
+//   OK <字节数>\n 后跟一幅二进制 PPM (P6) 图像
+//   ERR <原因>\n
+
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+struct RenderRequest {
+    int width = 640;
+    int height = 480;
+    float eye[3] = { 0.0f, 0.0f, 4.0f };
+    float target[3] = { 0.0f, 0.0f, 0.0f };
+    float fov = 60.0f;   // 竖直视场角 (度)
+    float time = 0.0f;   // 场景时间 (秒), 决定动画状态
+    bool stars = true;   // task4: 是否绘制星空
+};
+
+// 单张图像的边长上限, 超出的请求直接拒绝
+const int kRenderMaxDimension = 8192;
+
+inline bool parseFloats(const char* text, float* out, int count) {
+    for (int i = 0; i < count; ++i) {
+        char* end = nullptr;
+        out[i] = std::strtof(text, &end);
+        if (end == text) return false;
+        text = end;
+        if (i + 1 < count) {
+            if (*text != ',') return false;
+            ++text;
+        }
+    }
+    return true;
+}
+
+// 解析 RENDER 行的字段部分 (不含 "RENDER"), 未出现的字段保留 request 中原有的值
+inline bool parseRenderRequest(const std::string& fields, RenderRequest& request, std::string& error) {
+    size_t pos = 0;
+    while (pos < fields.size()) {
+        while (pos < fields.size() && fields[pos] == ' ') ++pos;
+        size_t end = fields.find(' ', pos);
+        if (end == std::string::npos) end = fields.size();
+        if (end == pos) break;
+        std::string token = fields.substr(pos, end - pos);
+        pos = end;
+
+        size_t eq = token.find('=');
+        if (eq == std::string::npos) {
+            error = "字段缺少 '=': " + token;
+            return false;
+        }
+        std::string key = token.substr(0, eq);
+        const char* value = token.c_str() + eq + 1;
+        bool ok = true;
+        if (key == "width") request.width = std::atoi(value);
+        else if (key == "height") request.height = std::atoi(value);
+        else if (key == "eye") ok = parseFloats(value, request.eye, 3);
+        else if (key == "target") ok = parseFloats(value, request.target, 3);
+        else if (key == "fov") ok = parseFloats(value, &request.fov, 1);
+        else if (key == "time") ok = parseFloats(value, &request.time, 1);
+        else if (key == "stars") request.stars = std::atoi(value) != 0;
+        else {
+            error = "未知字段: " + key;
+            return false;
+        }
+        if (!ok) {
+            error = "字段格式错误: " + token;
+            return false;
+        }
+    }
+    if (request.width <= 0 || request.height <= 0
+        || request.width > kRenderMaxDimension || request.height > kRenderMaxDimension) {
+        error = "分辨率超出范围";
+        return false;
+    }
+    return true;
+}
+
+// bind 之前清理上次异常退出留下的套接字文件; 路径上已有的不是套接字时 (例如把参数写错成
+// 某个普通文件) 不删除, 打印原因并返回 false
+inline bool removeStaleSocket(const std::string& path) {
+    struct stat st;
+    if (::lstat(path.c_str(), &st) != 0) {
+        if (errno == ENOENT) return true;
+        std::perror(path.c_str());
+        return false;
+    }
+    if (!S_ISSOCK(st.st_mode)) {
+        std::fprintf(stderr, "%s 已存在且不是套接字, 不会覆盖\n", path.c_str());
+        return false;
+    }
+    if (::unlink(path.c_str()) != 0 && errno != ENOENT) {
+        std::perror(path.c_str());
+        return false;
+    }
+    return true;
+}
+
+// 写出全部数据; 对端已关闭时返回 false 而不是触发 SIGPIPE
+inline bool socketWriteAll(int fd, const void* data, size_t size) {
+    const char* p = static_cast<const char*>(data);
+#ifdef MSG_NOSIGNAL
+    const int flags = MSG_NOSIGNAL;
+#else
+    const int flags = 0;
+#endif
+    while (size > 0) {
+        ssize_t n = ::send(fd, p, size, flags);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return false;
+        p += n;
+        size -= (size_t)n;
+    }
+    return true;
+}
+
+// 读满 size 字节
+inline bool socketReadAll(int fd, void* data, size_t size) {
+    char* p = static_cast<char*>(data);
+    while (size > 0) {
+        ssize_t n = ::read(fd, p, size);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return false;
+        p += n;
+        size -= (size_t)n;
+    }
+    return true;
+}
+
+// 逐字节读取一行 (不含换行符), 只用于短小的响应头
+inline bool socketReadLine(int fd, std::string& line) {
+    line.clear();
+    char c;
+    while (true) {
+        ssize_t n = ::read(fd, &c, 1);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return false;
+        if (c == '\n') return true;
+        line += c;
+    }
+}
+
+#endif
@@ -0,0 +1,366 @@
+#ifndef COMMON_RENDER_SERVER_H
+#define COMMON_RENDER_SERVER_H
+
+// 常驻渲染服务 (仅 POSIX): 进程保持 GL 上下文、已编译的着色器和已上传的资源,
+// 通过 Unix 域套接字接收渲染请求, 离屏渲染后以 PPM 图像返回。
+//
+// 每轮先收取所有连接上已到达的请求, 再把分辨率相同的请求合成一批:
+// 同一批共用一个帧缓冲, 依次渲染并用 PBO 异步回读, 全部提交后才映射读取结果,
+// 这样 GPU 渲染后面的请求时 CPU 可以同时编码和发送前面的结果, 避免每个请求都同步等待。
+// 同一连接上的响应顺序与请求顺序一致。
+//
+// 渲染回调只需绘制场景: 调用前服务端已绑定目标帧缓冲并设置好视口。
+
+#include "glad/glad.h"
+
+#include "ppm.h"
+#include "render_protocol.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <functional>
+#include <ostream>
+#include <set>
+#include <string>
+#include <vector>
+
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+class RenderServer {
+public:
+    typedef std::function<void(const RenderRequest&)> RenderFunc;
+
+    // defaults: 请求中省略的字段所用的值 (各任务的默认视角)
+    explicit RenderServer(const RenderRequest& defaults, int maxBatch = 16)
+        : defaults_(defaults), maxBatch_(maxBatch) {}
+
+    // 需要在 GL 上下文仍然有效时销毁
+    ~RenderServer() {
+        for (size_t i = 0; i < clients_.size(); ++i) ::close(clients_[i].fd);
+        if (listenFd_ >= 0) {
+            ::close(listenFd_);
+            ::unlink(path_.c_str());
+        }
+        for (size_t i = 0; i < targets_.size(); ++i) deleteTarget(targets_[i]);
+        if (!pbos_.empty()) glDeleteBuffers((GLsizei)pbos_.size(), pbos_.data());
+    }
+
+    RenderServer(const RenderServer&) = delete;
+    RenderServer& operator=(const RenderServer&) = delete;
+
+    bool listen(const std::string& path) {
+        sockaddr_un addr;
+        std::memset(&addr, 0, sizeof(addr));
+        addr.sun_family = AF_UNIX;
+        if (path.size() >= sizeof(addr.sun_path)) {
+            std::fprintf(stderr, "套接字路径过长: %s\n", path.c_str());
+            return false;
+        }
+        std::strcpy(addr.sun_path, path.c_str());
+
+        if (!removeStaleSocket(path)) return false;
+        listenFd_ = ::socket(AF_UNIX, SOCK_STREAM, 0);
+        if (listenFd_ < 0) return false;
+        if (::bind(listenFd_, (sockaddr*)&addr, sizeof(addr)) != 0 || ::listen(listenFd_, 64) != 0) {
+            std::perror("渲染服务监听失败");
+            ::close(listenFd_);
+            listenFd_ = -1;
+            return false;
+        }
+        path_ = path;
+        return true;
+    }
+
+    // 服务循环, 收到 SHUTDOWN 请求并处理完已收到的请求后返回
+    void run(const RenderFunc& render) {
+        while (!stopping_ || !pending_.empty()) {
+            // 没有待处理的请求时阻塞等待, 否则只收取已经到达的数据
+            pollSockets(pending_.empty() ? -1 : 0);
+            if (!pending_.empty()) processBatch(render);
+        }
+    }
+
+    void printStats(std::ostream& os) const {
+        os << "[渲染服务] 请求 " << requests_ << ", 批次 " << batches_
+           << ", 平均批大小 " << (batches_ > 0 ? (double)requests_ / batches_ : 0.0) << std::endl;
+        if (requests_ == 0) return;
+        os << "  每请求平均 (ms): 提交 " << submitMs_ / requests_
+           << ", 等待 GPU 与回读 " << readbackMs_ / requests_
+           << ", 编码 " << encodeMs_ / requests_
+           << ", 发送 " << sendMs_ / requests_ << std::endl;
+    }
+
+private:
+    struct Client {
+        int fd;
+        std::string inbox; // 尚未组成完整一行的数据
+    };
+
+    struct Pending {
+        int fd;
+        RenderRequest request;
+        std::string error; // 非空时直接返回 ERR
+    };
+
+    // 按分辨率缓存的离屏帧缓冲
+    struct Target {
+        int width = 0;
+        int height = 0;
+        GLuint fbo = 0;
+        GLuint color = 0;
+        GLuint depth = 0;
+        long long lastUsed = 0;
+    };
+
+    static double elapsedMs(std::chrono::steady_clock::time_point since) {
+        return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - since).count();
+    }
+
+    void pollSockets(int timeoutMs) {
+        std::vector<pollfd> fds(1 + clients_.size());
+        fds[0].fd = listenFd_;
+        fds[0].events = POLLIN;
+        for (size_t i = 0; i < clients_.size(); ++i) {
+            fds[i + 1].fd = clients_[i].fd;
+            fds[i + 1].events = POLLIN;
+        }
+        if (::poll(fds.data(), fds.size(), timeoutMs) <= 0) return;
+
+        std::vector<int> closed;
+        for (size_t i = 0; i < clients_.size(); ++i) {
+            if (!(fds[i + 1].revents & (POLLIN | POLLHUP | POLLERR))) continue;
+            char buffer[4096];
+            ssize_t n = ::read(clients_[i].fd, buffer, sizeof(buffer));
+            if (n <= 0) {
+                closed.push_back(clients_[i].fd);
+                continue;
+            }
+            clients_[i].inbox.append(buffer, (size_t)n);
+            splitLines(clients_[i]);
+        }
+        for (size_t i = 0; i < closed.size(); ++i) closeClient(closed[i]);
+
+        if (fds[0].revents & POLLIN) {
+            int fd = ::accept(listenFd_, nullptr, nullptr);
+            if (fd >= 0) {
+                Client client;
+                client.fd = fd;
+                clients_.push_back(client);
+            }
+        }
+    }
+
+    void splitLines(Client& client) {
+        size_t newline;
+        while ((newline = client.inbox.find('\n')) != std::string::npos) {
+            std::string line = client.inbox.substr(0, newline);
+            client.inbox.erase(0, newline + 1);
+            if (!line.empty() && line[line.size() - 1] == '\r') line.erase(line.size() - 1);
+            if (line.empty()) continue;
+
+            if (line == "SHUTDOWN") {
+                stopping_ = true;
+                continue;
+            }
+            Pending p;
+            p.fd = client.fd;
+            p.request = defaults_;
+            if (line.compare(0, 6, "RENDER") == 0) {
+                parseRenderRequest(line.substr(6), p.request, p.error);
+            } else {
+                p.error = "未知命令";
+            }
+            pending_.push_back(p);
+        }
+    }
+
+    void closeClient(int fd) {
+        ::close(fd);
+        for (size_t i = 0; i < clients_.size(); ++i) {
+            if (clients_[i].fd == fd) {
+                clients_.erase(clients_.begin() + i);
+                break;
+            }
+        }
+        // 丢弃该连接尚未处理的请求
+        std::vector<Pending> kept;
+        for (size_t i = 0; i < pending_.size(); ++i) {
+            if (pending_[i].fd != fd) kept.push_back(pending_[i]);
+        }
+        pending_.swap(kept);
+    }
+
+    Target& targetFor(int width, int height) {
+        ++useCounter_;
+        for (size_t i = 0; i < targets_.size(); ++i) {
+            if (targets_[i].width == width && targets_[i].height == height) {
+                targets_[i].lastUsed = useCounter_;
+                return targets_[i];
+            }
+        }
+        // 最多缓存 4 种分辨率, 超出时淘汰最久未用的
+        if (targets_.size() >= 4) {
+            size_t oldest = 0;
+            for (size_t i = 1; i < targets_.size(); ++i) {
+                if (targets_[i].lastUsed < targets_[oldest].lastUsed) oldest = i;
+            }
+            deleteTarget(targets_[oldest]);
+            targets_.erase(targets_.begin() + oldest);
+        }
+        Target t;
+        t.width = width;
+        t.height = height;
+        t.lastUsed = useCounter_;
+        glGenFramebuffers(1, &t.fbo);
+        glGenRenderbuffers(1, &t.color);
+        glGenRenderbuffers(1, &t.depth);
+        glBindRenderbuffer(GL_RENDERBUFFER, t.color);
+        glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, width, height);
+        glBindRenderbuffer(GL_RENDERBUFFER, t.depth);
+        glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH24_STENCIL8, width, height);
+        glBindRenderbuffer(GL_RENDERBUFFER, 0);
+        glBindFramebuffer(GL_FRAMEBUFFER, t.fbo);
+        glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, t.color);
+        glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER, t.depth);
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+        targets_.push_back(t);
+        return targets_.back();
+    }
+
+    static void deleteTarget(Target& t) {
+        glDeleteFramebuffers(1, &t.fbo);
+        glDeleteRenderbuffers(1, &t.color);
+        glDeleteRenderbuffers(1, &t.depth);
+    }
+
+    // 取出一批: 按到达顺序, 与第一个渲染请求分辨率相同的请求 (以及出错的请求) 加入本批;
+    // 某个连接一旦有请求被跳过, 它后面的请求也不再加入, 保证每个连接的响应顺序
+    void processBatch(const RenderFunc& render) {
+        int width = 0, height = 0;
+        std::set<int> blocked;
+        std::vector<Pending> batch, rest;
+        int renders = 0;
+        for (size_t i = 0; i < pending_.size(); ++i) {
+            const Pending& p = pending_[i];
+            bool take = false;
+            if (!blocked.count(p.fd)) {
+                if (!p.error.empty()) {
+                    take = true;
+                } else if (renders < maxBatch_ && (renders == 0 || (p.request.width == width && p.request.height == height))) {
+                    width = p.request.width;
+                    height = p.request.height;
+                    take = true;
+                    renders++;
+                }
+            }
+            if (take) {
+                batch.push_back(p);
+            } else {
+                blocked.insert(p.fd);
+                rest.push_back(p);
+            }
+        }
+        pending_.swap(rest);
+
+        size_t imageBytes = (size_t)width * height * 4;
+        if (renders > 0) {
+            while ((int)pbos_.size() < renders) {
+                GLuint pbo;
+                glGenBuffers(1, &pbo);
+                pbos_.push_back(pbo);
+                pboBytes_.push_back(0);
+            }
+
+            // 依次渲染并发起异步回读, 此时不等待 GPU
+            std::chrono::steady_clock::time_point submitStart = std::chrono::steady_clock::now();
+            Target& target = targetFor(width, height);
+            glBindFramebuffer(GL_FRAMEBUFFER, target.fbo);
+            int slot = 0;
+            for (size_t i = 0; i < batch.size(); ++i) {
+                if (!batch[i].error.empty()) continue;
+                glViewport(0, 0, width, height);
+                render(batch[i].request);
+                glBindBuffer(GL_PIXEL_PACK_BUFFER, pbos_[slot]);
+                if (pboBytes_[slot] < imageBytes) {
+                    glBufferData(GL_PIXEL_PACK_BUFFER, (GLsizeiptr)imageBytes, nullptr, GL_STREAM_READ);
+                    pboBytes_[slot] = imageBytes;
+                }
+                glReadPixels(0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, (void*)0);
+                slot++;
+            }
+            glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+            glBindFramebuffer(GL_FRAMEBUFFER, 0);
+            glFlush();
+            submitMs_ += elapsedMs(submitStart);
+        }
+
+        std::vector<unsigned char> ppm;
+        int slot = 0;
+        for (size_t i = 0; i < batch.size(); ++i) {
+            const Pending& p = batch[i];
+            if (!isOpen(p.fd)) {
+                if (p.error.empty()) slot++;
+                continue;
+            }
+            if (!p.error.empty()) {
+                std::string line = "ERR " + p.error + "\n";
+                if (!socketWriteAll(p.fd, line.data(), line.size())) closeClient(p.fd);
+                continue;
+            }
+
+            std::chrono::steady_clock::time_point mapStart = std::chrono::steady_clock::now();
+            glBindBuffer(GL_PIXEL_PACK_BUFFER, pbos_[slot++]);
+            const unsigned char* pixels = (const unsigned char*)glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, (GLsizeiptr)imageBytes, GL_MAP_READ_BIT);
+            readbackMs_ += elapsedMs(mapStart);
+
+            std::chrono::steady_clock::time_point encodeStart = std::chrono::steady_clock::now();
+            if (pixels) encodePpm(pixels, width, height, ppm);
+            glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+            glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+            encodeMs_ += elapsedMs(encodeStart);
+
+            std::chrono::steady_clock::time_point sendStart = std::chrono::steady_clock::now();
+            bool ok;
+            if (pixels) {
+                char header[32];
+                int headerLength = std::snprintf(header, sizeof(header), "OK %zu\n", ppm.size());
+                ok = socketWriteAll(p.fd, header, (size_t)headerLength) && socketWriteAll(p.fd, ppm.data(), ppm.size());
+            } else {
+                ok = socketWriteAll(p.fd, "ERR 回读失败\n", std::strlen("ERR 回读失败\n"));
+            }
+            sendMs_ += elapsedMs(sendStart);
+            if (!ok) closeClient(p.fd);
+            requests_++;
+        }
+        if (renders > 0) batches_++;
+    }
+
+    bool isOpen(int fd) const {
+        for (size_t i = 0; i < clients_.size(); ++i) {
+            if (clients_[i].fd == fd) return true;
+        }
+        return false;
+    }
+
+    RenderRequest defaults_;
+    int maxBatch_;
+    int listenFd_ = -1;
+    std::string path_;
+    bool stopping_ = false;
+    std::vector<Client> clients_;
+    std::vector<Pending> pending_;
+    std::vector<Target> targets_;
+    long long useCounter_ = 0;
+    std::vector<GLuint> pbos_;
+    std::vector<size_t> pboBytes_;
+
+    long long requests_ = 0;
+    long long batches_ = 0;
+    double submitMs_ = 0.0, readbackMs_ = 0.0, encodeMs_ = 0.0, sendMs_ = 0.0;
+};
+
+#endif
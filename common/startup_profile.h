@@ -0,0 +1,186 @@
+#ifndef COMMON_STARTUP_PROFILE_H
+#define COMMON_STARTUP_PROFILE_H
+
+// 启动阶段耗时分解
+//
+// main 开头先调用一次 startupProfile(), 时间从这里开始计算。主线程上的启动步骤依次用 mark(name) 记录,
+// 每个阶段从上一次 mark 开始, 到本次调用结束。着色器编译、纹理解码这类细分步骤用 StartupScope
+// 记录自己的起止时间。它们可以在任意线程上执行, 也可以与其它阶段重叠 (协程加载时解码与 GL 阶段并行)。
+// 第一次交换缓冲后调用 finish()。之后的 mark 和 StartupScope 都不再记录, 运行中重新编译着色器之类不算启动。
+// report() 打印各阶段的起点和耗时。给出 JSON 路径时另写一份 JSON ("-" 表示标准输出), 用于对比启动耗时的回归。
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+class StartupProfile {
+public:
+    typedef std::chrono::steady_clock Clock;
+
+    struct Phase {
+        std::string name;
+        double startMs;   // 相对 startupProfile() 第一次调用
+        double ms;
+        bool detail;      // StartupScope 记录的细分步骤
+        bool mainThread;
+    };
+
+    StartupProfile() : begin_(Clock::now()), last_(begin_), mainThread_(std::this_thread::get_id()) {}
+
+    StartupProfile(const StartupProfile&) = delete;
+    StartupProfile& operator=(const StartupProfile&) = delete;
+
+    // 主线程: 记录从上一次 mark 到现在的阶段
+    void mark(const std::string& name) {
+        Clock::time_point now = Clock::now();
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (finished_) return;
+        push(name, last_, now, false);
+        last_ = now;
+    }
+
+    // 记录一个细分步骤, 可以在任意线程上调用
+    void add(const std::string& name, Clock::time_point start, Clock::time_point end) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (finished_) return;
+        push(name, start, end, true);
+    }
+
+    // 第一次交换缓冲后调用: 记录最后一个阶段并停止记录
+    void finish(const std::string& name = "first frame") {
+        mark(name);
+        std::lock_guard<std::mutex> lock(mutex_);
+        finished_ = true;
+    }
+
+    bool finished() const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return finished_;
+    }
+
+    // 到最后一次 mark 为止的总耗时
+    double totalMs() const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return toMs(last_);
+    }
+
+    void print(std::ostream& os, const char* task) const {
+        std::vector<Phase> phases = sortedPhases();
+        char line[160];
+        std::snprintf(line, sizeof(line), "[启动] %s 到首帧共 %.2f ms (缩进的细分步骤与所在阶段重叠)", task, totalMs());
+        os << line << std::endl;
+        std::snprintf(line, sizeof(line), "    %-34s %10s %10s %7s\n", "phase", "start ms", "ms", "thread");
+        os << line;
+        for (size_t i = 0; i < phases.size(); ++i) {
+            const Phase& p = phases[i];
+            std::string name = (p.detail ? "  " : "") + p.name;
+            std::snprintf(line, sizeof(line), "    %-34s %10.2f %10.2f %7s\n", name.c_str(), p.startMs, p.ms,
+                          p.mainThread ? "main" : "worker");
+            os << line;
+        }
+    }
+
+    // {"task": ..., "total_ms": ..., "phases": [{"name", "start_ms", "ms", "detail", "thread"}, ...]}
+    void writeJson(std::ostream& os, const char* task) const {
+        std::vector<Phase> phases = sortedPhases();
+        char number[32];
+        os << "{\"task\": \"" << escape(task) << "\", \"total_ms\": ";
+        std::snprintf(number, sizeof(number), "%.3f", totalMs());
+        os << number << ", \"phases\": [";
+        for (size_t i = 0; i < phases.size(); ++i) {
+            const Phase& p = phases[i];
+            os << (i ? ", " : "") << "{\"name\": \"" << escape(p.name) << "\", \"start_ms\": ";
+            std::snprintf(number, sizeof(number), "%.3f", p.startMs);
+            os << number << ", \"ms\": ";
+            std::snprintf(number, sizeof(number), "%.3f", p.ms);
+            os << number << ", \"detail\": " << (p.detail ? "true" : "false")
+               << ", \"thread\": \"" << (p.mainThread ? "main" : "worker") << "\"}";
+        }
+        os << "]}" << std::endl;
+    }
+
+    // 打印分解, jsonPath 非空时另写 JSON ("-" 写到标准输出)
+    void report(std::ostream& os, const char* task, const char* jsonPath) const {
+        print(os, task);
+        if (!jsonPath) return;
+        if (std::string(jsonPath) == "-") {
+            writeJson(std::cout, task);
+            return;
+        }
+        std::ofstream file(jsonPath);
+        if (file) writeJson(file, task);
+        if (!file) std::cerr << "无法写入启动耗时: " << jsonPath << std::endl;
+    }
+
+private:
+    double toMs(Clock::time_point t) const { return std::chrono::duration<double, std::milli>(t - begin_).count(); }
+
+    void push(const std::string& name, Clock::time_point start, Clock::time_point end, bool detail) {
+        Phase p;
+        p.name = name;
+        p.startMs = toMs(start);
+        p.ms = std::chrono::duration<double, std::milli>(end - start).count();
+        p.detail = detail;
+        p.mainThread = std::this_thread::get_id() == mainThread_;
+        phases_.push_back(p);
+    }
+
+    // 按开始时间排序; 阶段排在同时开始的细分步骤之前
+    std::vector<Phase> sortedPhases() const {
+        std::vector<Phase> phases;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            phases = phases_;
+        }
+        std::stable_sort(phases.begin(), phases.end(), [](const Phase& a, const Phase& b) {
+            if (a.startMs != b.startMs) return a.startMs < b.startMs;
+            return !a.detail && b.detail;
+        });
+        return phases;
+    }
+
+    static std::string escape(const std::string& s) {
+        std::string out;
+        for (size_t i = 0; i < s.size(); ++i) {
+            if (s[i] == '"' || s[i] == '\\') out += '\\';
+            out += s[i];
+        }
+        return out;
+    }
+
+    Clock::time_point begin_;
+    Clock::time_point last_;
+    std::thread::id mainThread_;
+    mutable std::mutex mutex_;
+    std::vector<Phase> phases_;
+    bool finished_ = false;
+};
+
+inline StartupProfile& startupProfile() {
+    static StartupProfile profile;
+    return profile;
+}
+
+// 作用域内的细分步骤, 析构时记录
+class StartupScope {
+public:
+    explicit StartupScope(std::string name) : name_(std::move(name)), start_(StartupProfile::Clock::now()) {}
+    ~StartupScope() { startupProfile().add(name_, start_, StartupProfile::Clock::now()); }
+
+    StartupScope(const StartupScope&) = delete;
+    StartupScope& operator=(const StartupScope&) = delete;
+
+private:
+    std::string name_;
+    StartupProfile::Clock::time_point start_;
+};
+
+#endif
@@ -4,11 +4,21 @@
 #include <glm/gtc/matrix_transform.hpp>
 #include <glm/gtc/type_ptr.hpp>
 
+#include <algorithm>
 #include <iostream>
 #include <vector>
 #include <string>
 #include <cmath>
 #include <map>
+#include <memory>
+#include <cstring>
+
+#include "common/gl_handle.h"
+#include "common/input_trace.h"
+#include "common/job_system.h"
+#include "common/latency.h"
+#include "common/metrics_exporter.h"
+#include "common/startup_profile.h"
 
 #ifndef M_PI
 #define M_PI 3.14159265358979323846
@@ -163,23 +173,52 @@ glm::vec3 sphereColors[] = {
 struct WindowData {
     GLFWwindow* window = nullptr;
     unsigned int shaderProgram = 0;
-    unsigned int VAO = 0;
-    unsigned int VBO = 0;
-    unsigned int EBO = 0;
+    // 三个窗口的上下文不共享对象, 每个窗口一个删除队列, 切换上下文时 makeCurrent()
+    std::unique_ptr<GlDeletionQueue> deletionQueue;
+    GlVertexArray VAO;
+    GlBuffer VBO;
+    GlBuffer EBO;
     size_t indexCount = 0;
     glm::vec3 objectColor;
     std::string title;
     bool shouldClose = false;
+    std::unique_ptr<LatencyTracker> latency; // 每个窗口有自己的上下文, fence 不能跨上下文使用
 };
 
 // -- main 函数 --
-int main()
+int main(int argc, char** argv)
 {
+    startupProfile(); // 启动各阶段从这里开始计时
+
+    // 命令行参数: --low-latency 每个窗口渲染前才采样输入, 在途帧数限制为 1
+    //           --startup-json PATH 另把启动耗时分解写成 JSON ("-" 为标准输出)
+    //           --metrics ENDPOINT 以 Prometheus 格式导出帧统计, ENDPOINT 为本机端口或 Unix 套接字路径
+    //           --record-input PATH 把输入和帧时间录制到 PATH, --replay-input PATH 按录制的输入和时间回放
+    bool lowLatency = false;
+    const char* startupJson = nullptr;
+    const char* metricsEndpoint = nullptr;
+    const char* recordInput = nullptr;
+    const char* replayInput = nullptr;
+    for (int i = 1; i < argc; ++i) {
+        if (std::strcmp(argv[i], "--low-latency") == 0) lowLatency = true;
+        else if (std::strcmp(argv[i], "--startup-json") == 0 && i + 1 < argc) startupJson = argv[++i];
+        else if (std::strcmp(argv[i], "--metrics") == 0 && i + 1 < argc) metricsEndpoint = argv[++i];
+        else if (std::strcmp(argv[i], "--record-input") == 0 && i + 1 < argc) recordInput = argv[++i];
+        else if (std::strcmp(argv[i], "--replay-input") == 0 && i + 1 < argc) replayInput = argv[++i];
+    }
+    if (replayInput && !inputTrace().replay(replayInput, "task1")) return -1;
+    if (recordInput && !replayInput) inputTrace().record(recordInput, "task1");
+#ifndef _WIN32
+    MetricsExporter metricsExporter("task1");
+    if (metricsEndpoint && !metricsExporter.start(metricsEndpoint)) return -1;
+#endif
+
     // 1. 初始化 GLFW
     if (!glfwInit()) {
         std::cerr << "Failed to initialize GLFW" << std::endl;
         return -1;
     }
+    startupProfile().mark("glfwInit");
     glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
     glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
     glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
@@ -203,6 +242,7 @@ int main()
         }
         glfwMakeContextCurrent(glfwWindow); // 重要：在加载GLAD前设置当前上下文
         glfwSetFramebufferSizeCallback(glfwWindow, framebuffer_size_callback);
+        startupProfile().mark("window/context " + std::to_string(i));
 
         // 3. 初始化 GLAD (需要在创建第一个窗口并设置上下文后)
         if (i == 0) { // 只需要加载一次
@@ -211,12 +251,18 @@ int main()
                 glfwTerminate();
                 return -1;
              }
+             startupProfile().mark("gladLoadGLLoader");
         }
 
         WindowData data;
         data.window = glfwWindow;
         data.title = titles[i];
         data.objectColor = sphereColors[i];
+        data.deletionQueue.reset(new GlDeletionQueue());
+        data.deletionQueue->makeCurrent();
+        data.latency.reset(new LatencyTracker(lowLatency));
+        data.latency->attach(glfwWindow);
+        inputTrace().attach(glfwWindow, i);
 
         // 4. 构建和编译着色器程序 (使用源码字符串)
         data.shaderProgram = createShaderProgram(vertexShaders[i], fragmentShaders[i]);
@@ -224,23 +270,25 @@ int main()
              glfwTerminate();
              return -1; // Shader creation failed
         }
+        startupProfile().mark("shaders " + std::to_string(i));
 
         // 5. 设置顶点数据和缓冲区
         std::vector<float> vertices;
         std::vector<unsigned int> indices;
         generateSphere(vertices, indices, 1.0f, 36, 18); // 半径1.0, 36x18段
+        startupProfile().mark("sphere mesh generate " + std::to_string(i));
         data.indexCount = indices.size();
 
-        glGenVertexArrays(1, &data.VAO);
-        glGenBuffers(1, &data.VBO);
-        glGenBuffers(1, &data.EBO);
+        data.VAO = GlVertexArray::create();
+        data.VBO = GlBuffer::create();
+        data.EBO = GlBuffer::create();
 
-        glBindVertexArray(data.VAO);
+        glBindVertexArray(data.VAO.get());
 
-        glBindBuffer(GL_ARRAY_BUFFER, data.VBO);
+        glBindBuffer(GL_ARRAY_BUFFER, data.VBO.get());
         glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(float), vertices.data(), GL_STATIC_DRAW);
 
-        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, data.EBO);
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, data.EBO.get());
         glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(unsigned int), indices.data(), GL_STATIC_DRAW);
 
         // 位置属性 (每个顶点6个float: pos.x, pos.y, pos.z, norm.x, norm.y, norm.z)
@@ -255,14 +303,17 @@ int main()
 
         // 开启深度测试
         glEnable(GL_DEPTH_TEST);
+        startupProfile().mark("sphere mesh upload " + std::to_string(i));
 
-        windows[glfwWindow] = data; // 存储窗口数据
+        windows[glfwWindow] = std::move(data); // 存储窗口数据
     }
 
     // 6. 渲染循环
     while (!windows.empty()) // 当还有窗口存在时继续
     {
-        glfwPollEvents(); // 检查事件
+        if (!lowLatency)
+            glfwPollEvents(); // 检查事件
+        double frameTime = inputTrace().beginFrame(glfwGetTime()); // 回放时取录制的时间
 
         auto it = windows.begin();
         while (it != windows.end()) {
@@ -277,6 +328,14 @@ int main()
 
             // 使当前窗口的上下文成为当前
             glfwMakeContextCurrent(currentWindow);
+            data.deletionQueue->makeCurrent();
+
+            // 低延迟模式: 等待该窗口上一帧完成, 睡到下一次交换前再检查事件
+            if (lowLatency) {
+                data.latency->beginFrame();
+                glfwPollEvents();
+            }
+            data.latency->inputSampled();
 
             // 处理输入 (特定于当前窗口)
             processInput(currentWindow);
@@ -297,7 +356,7 @@ int main()
             // 创建变换矩阵
             glm::mat4 model = glm::mat4(1.0f);
             // 让球体旋转以更好地观察光照效果
-            model = glm::rotate(model, (float)glfwGetTime() * glm::radians(50.0f), glm::vec3(0.5f, 1.0f, 0.0f));
+            model = glm::rotate(model, (float)frameTime * glm::radians(50.0f), glm::vec3(0.5f, 1.0f, 0.0f));
 
             glm::mat4 view = glm::mat4(1.0f);
             // 将摄像机向后移动一点
@@ -319,27 +378,46 @@ int main()
             glUniformMatrix4fv(glGetUniformLocation(data.shaderProgram, "projection"), 1, GL_FALSE, glm::value_ptr(projection));
 
             // 绘制球体
-            glBindVertexArray(data.VAO);
+            glBindVertexArray(data.VAO.get());
             glDrawElements(GL_TRIANGLES, data.indexCount, GL_UNSIGNED_INT, 0);
+            frameMetrics().countDraw(data.indexCount / 3);
             glBindVertexArray(0); // 解绑
 
             // 交换缓冲区
             glfwSwapBuffers(currentWindow);
+            data.latency->afterSwap();
+            data.deletionQueue->endFrame();
 
             it++; // 处理下一个窗口
         }
 
+        frameMetrics().endFrame(); // 一帧指三个窗口各绘制一次
+        inputTrace().endFrame();
+
+        // 三个窗口都交换过一次缓冲后启动结束
+        if (!startupProfile().finished()) {
+            startupProfile().finish("first frame");
+            startupProfile().report(std::cout, "task1", startupJson);
+        }
+
         // 清理需要关闭的窗口
          it = windows.begin();
         while (it != windows.end()) {
              if (it->second.shouldClose) {
-                 // 清理OpenGL资源 (Make context current first might be safer, though often not strictly required for deletion)
-                 // glfwMakeContextCurrent(it->first); // 可选，但有时有助于避免跨上下文问题
-                 glDeleteVertexArrays(1, &it->second.VAO);
-                 glDeleteBuffers(1, &it->second.VBO);
-                 glDeleteBuffers(1, &it->second.EBO);
+                 // 清理OpenGL资源
+                 // 延迟统计的 fence 和查询对象属于该窗口的上下文, 所以这里必须先切换上下文
+                 glfwMakeContextCurrent(it->first);
+                 it->second.deletionQueue->makeCurrent();
+                 it->second.VAO.reset();
+                 it->second.VBO.reset();
+                 it->second.EBO.reset();
                  glDeleteProgram(it->second.shaderProgram);
+                 it->second.deletionQueue->finish(); // 销毁窗口 (和它的上下文) 之前删除剩余的对象
+                 it->second.deletionQueue->printStats(std::cout, it->second.title.c_str());
+                 it->second.latency->report(std::cout, it->second.title.c_str());
+                 it->second.latency.reset();
                  // 销毁窗口
+                 inputTrace().detach(it->first);
                  glfwDestroyWindow(it->first);
                  // 从map中移除
                  it = windows.erase(it); // erase返回下一个有效迭代器
@@ -350,6 +428,8 @@ int main()
     }
 
 
+    inputTrace().finish(std::cout);
+
     // 7. 清理 GLFW 资源 (当所有窗口关闭后)
     glfwTerminate();
     return 0;
@@ -360,7 +440,7 @@ int main()
 // 处理输入: 按下ESC键关闭当前窗口
 void processInput(GLFWwindow *window)
 {
-    if (glfwGetKey(window, GLFW_KEY_ESCAPE) == GLFW_PRESS)
+    if (inputTrace().keyDown(window, GLFW_KEY_ESCAPE))
         glfwSetWindowShouldClose(window, true);
 }
 
@@ -374,6 +454,7 @@ void framebuffer_size_callback(GLFWwindow* window, int width, int height)
 
 // 编译着色器 (从源码字符串)
 unsigned int compileShader(const char* source, GLenum type) {
+    StartupScope scope(type == GL_VERTEX_SHADER ? "compile vertex shader" : "compile fragment shader");
     unsigned int shader = glCreateShader(type);
     glShaderSource(shader, 1, &source, NULL);
     glCompileShader(shader);
@@ -404,6 +485,7 @@ unsigned int createShaderProgram(const char* vertexSource, const char* fragmentS
     }
 
     // 创建着色器程序
+    StartupScope scope("link program");
     unsigned int shaderProgram = glCreateProgram();
     glAttachShader(shaderProgram, vertexShader);
     glAttachShader(shaderProgram, fragmentShader);
@@ -429,74 +511,69 @@ unsigned int createShaderProgram(const char* vertexSource, const char* fragmentS
 
 
 // 生成球体顶点数据 (位置和法线交错) 和索引
+// 每一行 (stack) 的顶点和索引写到预先算好的位置, 各行互不依赖, 交给任务系统按行并行生成;
+// 行数不超过 kSphereRowGrain 时 (默认的 36x18 球体) 直接在调用线程上生成
 void generateSphere(std::vector<float>& vertices, std::vector<unsigned int>& indices, float radius, int sectorCount, int stackCount) {
-    vertices.clear();
-    indices.clear();
-
-    float x, y, z, xy;                              // vertex position
-    float nx, ny, nz, lengthInv = 1.0f / radius;    // vertex normal
-
+    const size_t kSphereRowGrain = 32;
+    float lengthInv = 1.0f / radius;                // vertex normal
     float sectorStep = 2.0f * M_PI / sectorCount;
     float stackStep = M_PI / stackCount;
-    float sectorAngle, stackAngle;
-
-    // 预留空间以提高效率 (可选)
-    vertices.reserve((stackCount + 1) * (sectorCount + 1) * 6);
-    indices.reserve(stackCount * sectorCount * 6);
-
-
-    for(int i = 0; i <= stackCount; ++i) {
-        stackAngle = M_PI / 2.0f - i * stackStep;      // starting from pi/2 to -pi/2
-        xy = radius * cosf(stackAngle);             // r * cos(u)
-        z = radius * sinf(stackAngle);              // r * sin(u)
-
-        // add (sectorCount+1) vertices per stack
-        // the first and last vertices have same position and normal, but may have different tex coords in other scenarios
-        for(int j = 0; j <= sectorCount; ++j) {
-            sectorAngle = j * sectorStep;           // starting from 0 to 2pi
-
-            // vertex position (x, y, z)
-            x = xy * cosf(sectorAngle);             // r * cos(u) * cos(v)
-            y = xy * sinf(sectorAngle);             // r * cos(u) * sin(v)
-            vertices.push_back(x);
-            vertices.push_back(y);
-            vertices.push_back(z);
-
-            // normalized vertex normal (nx, ny, nz)
-            nx = x * lengthInv;
-            ny = y * lengthInv;
-            nz = z * lengthInv;
-            vertices.push_back(nx);
-            vertices.push_back(ny);
-            vertices.push_back(nz);
-        }
-    }
 
-    // generate index list for triangles
-    // k1--k1+1
-    // |  / |
-    // k2--k2+1
-    unsigned int k1, k2;
-    for(int i = 0; i < stackCount; ++i) {
-        k1 = i * (sectorCount + 1);     // beginning of current stack
-        k2 = k1 + sectorCount + 1;      // beginning of next stack
-
-        for(int j = 0; j < sectorCount; ++j, ++k1, ++k2) {
-            // 2 triangles per sector, formed correctly for GL_TRIANGLES
-
-            // first triangle of sector: (k1, k2, k1+1)
-            if (i != 0) { // Aovid creating triangles at the top pole degenerating into lines
-                indices.push_back(k1);
-                indices.push_back(k2);
-                indices.push_back(k1 + 1);
+    // 首行和末行只有一半三角形 (极点处退化的那一半不生成)
+    vertices.assign((size_t)(stackCount + 1) * (sectorCount + 1) * 6, 0.0f);
+    indices.assign(stackCount > 1 ? (size_t)(2 * stackCount - 2) * sectorCount * 3 : 0, 0u);
+
+    parallelFor(0, stackCount + 1, kSphereRowGrain, [&](size_t first, size_t last) {
+        for (int i = (int)first; i < (int)last; ++i) {
+            float stackAngle = M_PI / 2.0f - i * stackStep; // starting from pi/2 to -pi/2
+            float xy = radius * cosf(stackAngle);           // r * cos(u)
+            float z = radius * sinf(stackAngle);            // r * sin(u)
+
+            // add (sectorCount+1) vertices per stack
+            // the first and last vertices have same position and normal, but may have different tex coords in other scenarios
+            float* v = &vertices[(size_t)i * (sectorCount + 1) * 6];
+            for (int j = 0; j <= sectorCount; ++j, v += 6) {
+                float sectorAngle = j * sectorStep;         // starting from 0 to 2pi
+
+                // vertex position (x, y, z)
+                float x = xy * cosf(sectorAngle);           // r * cos(u) * cos(v)
+                float y = xy * sinf(sectorAngle);           // r * cos(u) * sin(v)
+                v[0] = x;
+                v[1] = y;
+                v[2] = z;
+
+                // normalized vertex normal (nx, ny, nz)
+                v[3] = x * lengthInv;
+                v[4] = y * lengthInv;
+                v[5] = z * lengthInv;
             }
 
-             // second triangle of sector: (k1+1, k2, k2+1)
-            if (i != (stackCount - 1)) { // Avoid creating triangles at the bottom pole degenerating into lines
-                indices.push_back(k1 + 1);
-                indices.push_back(k2);
-                indices.push_back(k2 + 1);
+            // generate index list for triangles between stack i and i+1
+            // k1--k1+1
+            // |  / |
+            // k2--k2+1
+            if (i == stackCount || indices.empty()) continue;
+            unsigned int k1 = i * (sectorCount + 1);     // beginning of current stack
+            unsigned int k2 = k1 + sectorCount + 1;      // beginning of next stack
+            // 前面各行的索引数: 第 0 行 3 * sectorCount, 之后每行 6 * sectorCount
+            unsigned int* out = &indices[(size_t)(2 * i - std::min(i, 1)) * sectorCount * 3];
+            for (int j = 0; j < sectorCount; ++j, ++k1, ++k2) {
+                // 2 triangles per sector, formed correctly for GL_TRIANGLES
+
+                // first triangle of sector: (k1, k2, k1+1)
+                if (i != 0) { // Aovid creating triangles at the top pole degenerating into lines
+                    *out++ = k1;
+                    *out++ = k2;
+                    *out++ = k1 + 1;
+                }
+
+                // second triangle of sector: (k1+1, k2, k2+1)
+                if (i != (stackCount - 1)) { // Avoid creating triangles at the bottom pole degenerating into lines
+                    *out++ = k1 + 1;
+                    *out++ = k2;
+                    *out++ = k2 + 1;
+                }
             }
         }
-    }
+    });
 }
\ No newline at end of file
@@ -270,6 +270,10 @@ RECENT REVISION HISTORY:
 // (at least this is true for iOS and Android). Therefore, the NEON support is
 // toggled by a build flag: define STBI_NEON to get NEON loops.
 //
+// PNG scanline unfiltering has SSE2 versions of Up, Sub, Average and Paeth for
+// 8-bit 3- and 4-channel images. Compiling with -mssse3 adds a faster Sub for
+// 3-channel images and -mavx2 a 32-byte Up; both are chosen at compile time.
+//
 // If for some reason you do not want to use any of SIMD code, or if
 // you have issues compiling it, you can disable it entirely by
 // defining STBI_NO_SIMD.
@@ -429,6 +433,41 @@ STBIDEF stbi_uc *stbi_load_from_file  (FILE *f, int *x, int *y, int *channels_in
 // for stbi_load_from_file, file pointer is left pointing immediately after image
 #endif
 
+// Decode into caller-provided memory (e.g. a mapped pixel buffer) instead of a malloc'd
+// image. Row r of the result starts at out + r*out_stride and holds x*desired_channels
+// bytes; out_size is the usable size of out and must be at least
+// (y-1)*out_stride + x*desired_channels (get x,y first with stbi_info*). desired_channels
+// must be 1..4. Vertical flip is honored. Non-interlaced 8-bit PNGs without palette or
+// tRNS, and all baseline/progressive JPEGs, are written in place with no full-image
+// allocation; other images are decoded as usual and then copied. Returns 1 on success.
+STBIDEF int stbi_load_from_memory_into(stbi_uc const *buffer, int len, stbi_uc *out, size_t out_stride, size_t out_size, int *x, int *y, int *channels_in_file, int desired_channels);
+#ifndef STBI_NO_STDIO
+STBIDEF int stbi_load_into            (char const *filename, stbi_uc *out, size_t out_stride, size_t out_size, int *x, int *y, int *channels_in_file, int desired_channels);
+STBIDEF int stbi_load_from_file_into  (FILE *f, stbi_uc *out, size_t out_stride, size_t out_size, int *x, int *y, int *channels_in_file, int desired_channels);
+#endif
+
+// Incremental decoding of progressive JPEGs. Each stbi_progressive_scan call decodes
+// one more scan; stbi_progressive_image can be called after any of them to get the
+// image as refined so far (a malloc'd x*y*desired_channels image, free it with
+// stbi_image_free; vertical flip is honored). The first scan of a typical file holds
+// only DC coefficients, which is exactly a 1/8 size image: ask for scale_denom 8
+// (see stbi_set_jpeg_scale_denom; 1, 2, 4 or 8) to get it for a fraction of the cost
+// of a full-size conversion. stbi_progressive_scan returns 0 once the last scan has
+// been decoded (or on error, see stbi_progressive_failed), after which
+// stbi_progressive_image returns the final image. The open functions fail for
+// anything but a progressive JPEG (use stbi_load for those). The buffer passed to
+// stbi_progressive_open_memory must stay valid until stbi_progressive_close.
+typedef struct stbi_progressive stbi_progressive;
+STBIDEF stbi_progressive *stbi_progressive_open_memory(stbi_uc const *buffer, int len, int desired_channels);
+#ifndef STBI_NO_STDIO
+STBIDEF stbi_progressive *stbi_progressive_open(char const *filename, int desired_channels);
+#endif
+STBIDEF int      stbi_progressive_scan  (stbi_progressive *p);
+STBIDEF int      stbi_progressive_failed(stbi_progressive *p);
+STBIDEF int      stbi_progressive_scans (stbi_progressive *p); // scans decoded so far
+STBIDEF stbi_uc *stbi_progressive_image (stbi_progressive *p, int scale_denom, int *x, int *y, int *channels_in_file);
+STBIDEF void     stbi_progressive_close (stbi_progressive *p);
+
 #ifndef STBI_NO_GIF
 STBIDEF stbi_uc *stbi_load_gif_from_memory(stbi_uc const *buffer, int len, int **delays, int *x, int *y, int *z, int *comp, int req_comp);
 #endif
@@ -467,6 +506,14 @@ STBIDEF stbi_us *stbi_load_from_file_16(FILE *f, int *x, int *y, int *channels_i
 #ifndef STBI_NO_HDR
    STBIDEF void   stbi_hdr_to_ldr_gamma(float gamma);
    STBIDEF void   stbi_hdr_to_ldr_scale(float scale);
+
+   // Radiance .hdr pixels as the raw RGBE bytes, 4 per pixel, without the float
+   // expansion: a channel's value is m * 2^(e-136), or 0 when e == 0. For callers
+   // that convert to a GPU format themselves. Free with stbi_image_free.
+   STBIDEF stbi_uc *stbi_load_hdr_rgbe_from_memory(stbi_uc const *buffer, int len, int *x, int *y);
+   #ifndef STBI_NO_STDIO
+   STBIDEF stbi_uc *stbi_load_hdr_rgbe          (char const *filename, int *x, int *y);
+   #endif
 #endif // STBI_NO_HDR
 
 #ifndef STBI_NO_LINEAR
@@ -517,12 +564,18 @@ STBIDEF void stbi_convert_iphone_png_to_rgb(int flag_true_if_should_convert);
 // flip the image vertically, so the first pixel in the output array is the bottom left
 STBIDEF void stbi_set_flip_vertically_on_load(int flag_true_if_should_flip);
 
+// decode JPEGs at 1/denom of their size (denom = 1, 2, 4 or 8; default 1) using a
+// reduced IDCT, DC-only at 1/8. stbi_info reports the reduced size too, so the
+// *_into functions can be sized from it. Other formats are unaffected.
+STBIDEF void stbi_set_jpeg_scale_denom(int denom);
+
 // as above, but only applies to images loaded on the thread that calls the function
 // this function is only available if your compiler supports thread-local variables;
 // calling it will fail to link if your compiler doesn't
 STBIDEF void stbi_set_unpremultiply_on_load_thread(int flag_true_if_should_unpremultiply);
 STBIDEF void stbi_convert_iphone_png_to_rgb_thread(int flag_true_if_should_convert);
 STBIDEF void stbi_set_flip_vertically_on_load_thread(int flag_true_if_should_flip);
+STBIDEF void stbi_set_jpeg_scale_denom_thread(int denom);
 
 // ZLIB client - used by PNG, available for other purposes
 
@@ -724,6 +777,16 @@ typedef unsigned char validate_uint32[sizeof(stbi__uint32)==4 ? 1 : -1];
 #if !defined(STBI_NO_SIMD) && (defined(STBI__X86_TARGET) || defined(STBI__X64_TARGET))
 #define STBI_SSE2
 #include <emmintrin.h>
+// Wider extensions follow the same compile-time rule as SSE2 above: they are used
+// only when the compiler is already allowed to emit them (-mssse3, -mavx2, /arch:AVX2).
+#ifdef __SSSE3__
+#define STBI_SSSE3
+#include <tmmintrin.h>
+#endif
+#ifdef __AVX2__
+#define STBI_AVX2
+#include <immintrin.h>
+#endif
 
 #ifdef _MSC_VER
 
@@ -817,6 +880,12 @@ typedef struct
 
    stbi_uc *img_buffer, *img_buffer_end;
    stbi_uc *img_buffer_original, *img_buffer_original_end;
+
+   // caller-provided 8-bit output (stbi_load_*_into); a loader that decodes
+   // straight into it sets direct_used and returns direct_out
+   stbi_uc *direct_out;
+   size_t direct_stride, direct_size;
+   int direct_used;
 } stbi__context;
 
 
@@ -830,6 +899,8 @@ static void stbi__start_mem(stbi__context *s, stbi_uc const *buffer, int len)
    s->callback_already_read = 0;
    s->img_buffer = s->img_buffer_original = (stbi_uc *) buffer;
    s->img_buffer_end = s->img_buffer_original_end = (stbi_uc *) buffer+len;
+   s->direct_out = NULL;
+   s->direct_used = 0;
 }
 
 // initialize a callback-based context
@@ -843,6 +914,8 @@ static void stbi__start_callbacks(stbi__context *s, stbi_io_callbacks *c, void *
    s->img_buffer = s->img_buffer_original = s->buffer_start;
    stbi__refill_buffer(s);
    s->img_buffer_original_end = s->img_buffer_end;
+   s->direct_out = NULL;
+   s->direct_used = 0;
 }
 
 #ifndef STBI_NO_STDIO
@@ -1310,6 +1383,55 @@ static stbi__uint16 *stbi__load_and_postprocess_16bit(stbi__context *s, int *x,
    return (stbi__uint16 *) result;
 }
 
+static int stbi__direct_fits(stbi__context *s, stbi__uint32 w, stbi__uint32 h, int comp)
+{
+   size_t row_bytes = (size_t) w * comp;
+   return row_bytes <= s->direct_stride && row_bytes <= s->direct_size && h > 0
+       && (size_t) (h-1) * s->direct_stride <= s->direct_size - row_bytes;
+}
+
+// start of output row j of an h-row image in the caller's buffer, flipped if requested
+static stbi_uc *stbi__direct_row(stbi__context *s, stbi__uint32 j, stbi__uint32 h)
+{
+   stbi__uint32 row = stbi__vertically_flip_on_load ? h - 1 - j : j;
+   return s->direct_out + (size_t) row * s->direct_stride;
+}
+
+static int stbi__load_into(stbi__context *s, stbi_uc *out, size_t out_stride, size_t out_size, int *x, int *y, int *comp, int req_comp)
+{
+   stbi__result_info ri;
+   stbi_uc *result;
+   int j;
+
+   if (req_comp < 1 || req_comp > 4) return stbi__err("bad req_comp", "Internal error");
+   if (out == NULL) return stbi__err("no output", "Output buffer is NULL");
+   s->direct_out = out;
+   s->direct_stride = out_stride;
+   s->direct_size = out_size;
+   s->direct_used = 0;
+
+   result = (stbi_uc *) stbi__load_main(s, x, y, comp, req_comp, &ri, 8);
+   if (result == NULL)
+      return 0;
+   if (s->direct_used)
+      return 1;
+
+   // this loader allocated its own image; convert and copy rows into place
+   STBI_ASSERT(ri.bits_per_channel == 8 || ri.bits_per_channel == 16);
+   if (ri.bits_per_channel != 8) {
+      result = stbi__convert_16_to_8((stbi__uint16 *) result, *x, *y, req_comp);
+      if (result == NULL) return 0;
+   }
+   if (!stbi__direct_fits(s, *x, *y, req_comp)) {
+      STBI_FREE(result);
+      return stbi__err("too large", "Output buffer too small");
+   }
+   for (j=0; j < *y; ++j)
+      memcpy(stbi__direct_row(s, j, *y), result + (size_t) j * *x * req_comp, (size_t) *x * req_comp);
+   STBI_FREE(result);
+   return 1;
+}
+
 #if !defined(STBI_NO_HDR) && !defined(STBI_NO_LINEAR)
 static void stbi__float_postprocess(float *result, int *x, int *y, int *comp, int req_comp)
 {
@@ -1386,6 +1508,29 @@ STBIDEF stbi_uc *stbi_load_from_file(FILE *f, int *x, int *y, int *comp, int req
    return result;
 }
 
+STBIDEF int stbi_load_into(char const *filename, stbi_uc *out, size_t out_stride, size_t out_size, int *x, int *y, int *comp, int req_comp)
+{
+   FILE *f = stbi__fopen(filename, "rb");
+   int result;
+   if (!f) return stbi__err("can't fopen", "Unable to open file");
+   result = stbi_load_from_file_into(f,out,out_stride,out_size,x,y,comp,req_comp);
+   fclose(f);
+   return result;
+}
+
+STBIDEF int stbi_load_from_file_into(FILE *f, stbi_uc *out, size_t out_stride, size_t out_size, int *x, int *y, int *comp, int req_comp)
+{
+   int result;
+   stbi__context s;
+   stbi__start_file(&s,f);
+   result = stbi__load_into(&s,out,out_stride,out_size,x,y,comp,req_comp);
+   if (result) {
+      // need to 'unget' all the characters in the IO buffer
+      fseek(f, - (int) (s.img_buffer_end - s.img_buffer), SEEK_CUR);
+   }
+   return result;
+}
+
 STBIDEF stbi__uint16 *stbi_load_from_file_16(FILE *f, int *x, int *y, int *comp, int req_comp)
 {
    stbi__uint16 *result;
@@ -1433,6 +1578,13 @@ STBIDEF stbi_uc *stbi_load_from_memory(stbi_uc const *buffer, int len, int *x, i
    return stbi__load_and_postprocess_8bit(&s,x,y,comp,req_comp);
 }
 
+STBIDEF int stbi_load_from_memory_into(stbi_uc const *buffer, int len, stbi_uc *out, size_t out_stride, size_t out_size, int *x, int *y, int *comp, int req_comp)
+{
+   stbi__context s;
+   stbi__start_mem(&s,buffer,len);
+   return stbi__load_into(&s,out,out_stride,out_size,x,y,comp,req_comp);
+}
+
 STBIDEF stbi_uc *stbi_load_from_callbacks(stbi_io_callbacks const *clbk, void *user, int *x, int *y, int *comp, int req_comp)
 {
    stbi__context s;
@@ -1569,6 +1721,43 @@ STBIDEF int      stbi_is_hdr_from_callbacks(stbi_io_callbacks const *clbk, void
    #endif
 }
 
+#ifndef STBI_NO_HDR
+// internal req_comp for stbi__hdr_load: keep the raw RGBE bytes
+#define STBI__HDR_RGBE 5
+
+static stbi_uc *stbi__load_hdr_rgbe(stbi__context *s, int *x, int *y)
+{
+   stbi__result_info ri;
+   stbi_uc *result;
+   if (!stbi__hdr_test(s)) return stbi__errpuc("not HDR", "Not a Radiance HDR image");
+   result = (stbi_uc *) stbi__hdr_load(s, x, y, NULL, STBI__HDR_RGBE, &ri);
+   if (result && stbi__vertically_flip_on_load)
+      stbi__vertical_flip(result, *x, *y, 4);
+   return result;
+}
+
+STBIDEF stbi_uc *stbi_load_hdr_rgbe_from_memory(stbi_uc const *buffer, int len, int *x, int *y)
+{
+   stbi__context s;
+   stbi__start_mem(&s,buffer,len);
+   return stbi__load_hdr_rgbe(&s,x,y);
+}
+
+#ifndef STBI_NO_STDIO
+STBIDEF stbi_uc *stbi_load_hdr_rgbe(char const *filename, int *x, int *y)
+{
+   FILE *f = stbi__fopen(filename, "rb");
+   stbi_uc *result;
+   stbi__context s;
+   if (!f) return stbi__errpuc("can't fopen", "Unable to open file");
+   stbi__start_file(&s,f);
+   result = stbi__load_hdr_rgbe(&s,x,y);
+   fclose(f);
+   return result;
+}
+#endif // !STBI_NO_STDIO
+#endif // !STBI_NO_HDR
+
 #ifndef STBI_NO_LINEAR
 static float stbi__l2h_gamma=2.2f, stbi__l2h_scale=1.0f;
 
@@ -1993,6 +2182,7 @@ typedef struct
 
    int scan_n, order[4];
    int restart_interval, todo;
+   int scale_shift;            // pixel planes hold (8 >> scale_shift)^2 samples per block
 
 // kernels
    void (*idct_block_kernel)(stbi_uc *out, int out_stride, short data[64]);
@@ -2927,6 +3117,97 @@ static stbi_uc stbi__get_marker(stbi__jpeg *j)
    return x;
 }
 
+// reduced-size decoding: an NxN block (N = 4, 2) is the N-point IDCT of the
+// top-left NxN coefficients, which approximates a full IDCT followed by averaging
+// (8/N)x(8/N) pixels; at N = 1 that is just the DC term. Constants are
+// C(u) * cos((2x+1) u pi / 2N) scaled by 2048: 1448 = cos(pi/4), 1892 = cos(pi/8), 784 = sin(pi/8)
+#define STBI__IDCT_4(s0,s1,s2,s3)                   \
+   e0 = ((s0) + (s2)) * 1448;                       \
+   e1 = ((s0) - (s2)) * 1448;                       \
+   o0 = (s1) * 1892 + (s3) * 784;                   \
+   o1 = (s1) * 784 - (s3) * 1892;
+
+static void stbi__idct_4x4(stbi_uc *out, int out_stride, short data[64])
+{
+   int i, tmp[16], e0,e1,o0,o1;
+   // rows (horizontal frequencies), keeping the result at coefficient scale
+   for (i=0; i < 4; ++i) {
+      short *d = data + i*8;
+      STBI__IDCT_4(d[0],d[1],d[2],d[3])
+      tmp[i*4+0] = (e0 + o0 + 1024) >> 11;
+      tmp[i*4+1] = (e1 + o1 + 1024) >> 11;
+      tmp[i*4+2] = (e1 - o1 + 1024) >> 11;
+      tmp[i*4+3] = (e0 - o0 + 1024) >> 11;
+   }
+   // columns; the 1/4 of the 2D IDCT and the constant scale come out in one shift
+   for (i=0; i < 4; ++i) {
+      STBI__IDCT_4(tmp[i],tmp[4+i],tmp[8+i],tmp[12+i])
+      out[i]              = stbi__clamp(((e0 + o0 + 4096) >> 13) + 128);
+      out[out_stride+i]   = stbi__clamp(((e1 + o1 + 4096) >> 13) + 128);
+      out[out_stride*2+i] = stbi__clamp(((e1 - o1 + 4096) >> 13) + 128);
+      out[out_stride*3+i] = stbi__clamp(((e0 - o0 + 4096) >> 13) + 128);
+   }
+}
+
+static void stbi__idct_2x2(stbi_uc *out, int out_stride, short data[64])
+{
+   int t0 = ((data[0] + data[1]) * 1448 + 1024) >> 11;
+   int t1 = ((data[0] - data[1]) * 1448 + 1024) >> 11;
+   int t2 = ((data[8] + data[9]) * 1448 + 1024) >> 11;
+   int t3 = ((data[8] - data[9]) * 1448 + 1024) >> 11;
+   out[0]            = stbi__clamp((((t0 + t2) * 1448 + 4096) >> 13) + 128);
+   out[1]            = stbi__clamp((((t1 + t3) * 1448 + 4096) >> 13) + 128);
+   out[out_stride]   = stbi__clamp((((t0 - t2) * 1448 + 4096) >> 13) + 128);
+   out[out_stride+1] = stbi__clamp((((t1 - t3) * 1448 + 4096) >> 13) + 128);
+}
+
+// idct block (bx,by) of component n into its pixel plane
+static void stbi__jpeg_idct(stbi__jpeg *z, int n, int bx, int by, short data[64])
+{
+   int size = 8 >> z->scale_shift;
+   int stride = z->img_comp[n].w2;
+   stbi_uc *out = z->img_comp[n].data + stride*by*size + bx*size;
+   if (size == 8)
+      z->idct_block_kernel(out, stride, data);
+   else if (size == 1)
+      *out = stbi__clamp(((data[0] + 4) >> 3) + 128);
+   else if (size == 4)
+      stbi__idct_4x4(out, stride, data);
+   else
+      stbi__idct_2x2(out, stride, data);
+}
+
+static int stbi__jpeg_scale_shift_global = 0;
+
+static int stbi__jpeg_denom_to_shift(int denom)
+{
+   return denom >= 8 ? 3 : denom >= 4 ? 2 : denom >= 2 ? 1 : 0;
+}
+
+STBIDEF void stbi_set_jpeg_scale_denom(int denom)
+{
+   stbi__jpeg_scale_shift_global = stbi__jpeg_denom_to_shift(denom);
+}
+
+#ifndef STBI_THREAD_LOCAL
+#define stbi__jpeg_scale_shift  stbi__jpeg_scale_shift_global
+#else
+static STBI_THREAD_LOCAL int stbi__jpeg_scale_shift_local, stbi__jpeg_scale_shift_set;
+
+STBIDEF void stbi_set_jpeg_scale_denom_thread(int denom)
+{
+   stbi__jpeg_scale_shift_local = stbi__jpeg_denom_to_shift(denom);
+   stbi__jpeg_scale_shift_set = 1;
+}
+
+#define stbi__jpeg_scale_shift  (stbi__jpeg_scale_shift_set         \
+                                  ? stbi__jpeg_scale_shift_local    \
+                                  : stbi__jpeg_scale_shift_global)
+#endif // STBI_THREAD_LOCAL
+
+// size of a dimension after reduced-size decoding, rounded up like the MCU padding
+#define stbi__jpeg_scaled(v, shift)  (((v) + (1u << (shift)) - 1) >> (shift))
+
 // in each scan, we'll have scan_n components, and the order
 // of the components is specified by order[]
 #define STBI__RESTART(x)     ((x) >= 0xd0 && (x) <= 0xd7)
@@ -2964,7 +3245,7 @@ static int stbi__parse_entropy_coded_data(stbi__jpeg *z)
             for (i=0; i < w; ++i) {
                int ha = z->img_comp[n].ha;
                if (!stbi__jpeg_decode_block(z, data, z->huff_dc+z->img_comp[n].hd, z->huff_ac+ha, z->fast_ac[ha], n, z->dequant[z->img_comp[n].tq])) return 0;
-               z->idct_block_kernel(z->img_comp[n].data+z->img_comp[n].w2*j*8+i*8, z->img_comp[n].w2, data);
+               stbi__jpeg_idct(z, n, i, j, data);
                // every data block is an MCU, so countdown the restart interval
                if (--z->todo <= 0) {
                   if (z->code_bits < 24) stbi__grow_buffer_unsafe(z);
@@ -2988,11 +3269,11 @@ static int stbi__parse_entropy_coded_data(stbi__jpeg *z)
                   // by the basic H and V specified for the component
                   for (y=0; y < z->img_comp[n].v; ++y) {
                      for (x=0; x < z->img_comp[n].h; ++x) {
-                        int x2 = (i*z->img_comp[n].h + x)*8;
-                        int y2 = (j*z->img_comp[n].v + y)*8;
+                        int x2 = (i*z->img_comp[n].h + x);
+                        int y2 = (j*z->img_comp[n].v + y);
                         int ha = z->img_comp[n].ha;
                         if (!stbi__jpeg_decode_block(z, data, z->huff_dc+z->img_comp[n].hd, z->huff_ac+ha, z->fast_ac[ha], n, z->dequant[z->img_comp[n].tq])) return 0;
-                        z->idct_block_kernel(z->img_comp[n].data+z->img_comp[n].w2*y2+x2, z->img_comp[n].w2, data);
+                        stbi__jpeg_idct(z, n, x2, y2, data);
                      }
                   }
                }
@@ -3089,7 +3370,7 @@ static void stbi__jpeg_finish(stbi__jpeg *z)
             for (i=0; i < w; ++i) {
                short *data = z->img_comp[n].coeff + 64 * (i + j * z->img_comp[n].coeff_w);
                stbi__jpeg_dequantize(data, z->dequant[z->img_comp[n].tq]);
-               z->idct_block_kernel(z->img_comp[n].data+z->img_comp[n].w2*j*8+i*8, z->img_comp[n].w2, data);
+               stbi__jpeg_idct(z, n, i, j, data);
             }
          }
       }
@@ -3334,7 +3615,7 @@ static int stbi__process_frame_header(stbi__jpeg *z, int scan)
       z->img_comp[i].coeff = 0;
       z->img_comp[i].raw_coeff = 0;
       z->img_comp[i].linebuf = NULL;
-      z->img_comp[i].raw_data = stbi__malloc_mad2(z->img_comp[i].w2, z->img_comp[i].h2, 15);
+      z->img_comp[i].raw_data = stbi__malloc_mad2(z->img_comp[i].w2 >> z->scale_shift, z->img_comp[i].h2 >> z->scale_shift, 15);
       if (z->img_comp[i].raw_data == NULL)
          return stbi__free_jpeg_components(z, i+1, stbi__err("outofmem", "Out of memory"));
       // align blocks for idct using mmx/sse
@@ -3348,6 +3629,9 @@ static int stbi__process_frame_header(stbi__jpeg *z, int scan)
             return stbi__free_jpeg_components(z, i+1, stbi__err("outofmem", "Out of memory"));
          z->img_comp[i].coeff = (short*) (((size_t) z->img_comp[i].raw_coeff + 15) & ~15);
       }
+      // coefficients are kept per full 8x8 block; the pixel plane is reduced
+      z->img_comp[i].w2 >>= z->scale_shift;
+      z->img_comp[i].h2 >>= z->scale_shift;
    }
 
    return 1;
@@ -3862,16 +4146,11 @@ static stbi_uc stbi__blinn_8x8(stbi_uc x, stbi_uc y)
    return (stbi_uc) ((t + (t >>8)) >> 8);
 }
 
-static stbi_uc *load_jpeg_image(stbi__jpeg *z, int *out_x, int *out_y, int *comp, int req_comp)
+// resample and color-convert the decoded planes into a new image (or the caller's rows,
+// see direct_out). The planes are left as they are; the caller cleans up z
+static stbi_uc *stbi__jpeg_output(stbi__jpeg *z, int *out_x, int *out_y, int *comp, int req_comp)
 {
    int n, decode_n, is_rgb;
-   z->s->img_n = 0; // make stbi__cleanup_jpeg safe
-
-   // validate req_comp
-   if (req_comp < 0 || req_comp > 4) return stbi__errpuc("bad req_comp", "Internal error");
-
-   // load a jpeg image from whichever source, but leave in YCbCr format
-   if (!stbi__decode_jpeg_image(z)) { stbi__cleanup_jpeg(z); return NULL; }
 
    // determine actual number of components to generate
    n = req_comp ? req_comp : z->s->img_n >= 3 ? 3 : 1;
@@ -3885,13 +4164,13 @@ static stbi_uc *load_jpeg_image(stbi__jpeg *z, int *out_x, int *out_y, int *comp
 
    // nothing to do if no components requested; check this now to avoid
    // accessing uninitialized coutput[0] later
-   if (decode_n <= 0) { stbi__cleanup_jpeg(z); return NULL; }
+   if (decode_n <= 0) return NULL;
 
    // resample and color-convert
    {
       int k;
       unsigned int i,j;
-      stbi_uc *output;
+      stbi_uc *output, *tail = NULL;
       stbi_uc *coutput[4] = { NULL, NULL, NULL, NULL };
 
       stbi__resample res_comp[4];
@@ -3902,7 +4181,7 @@ static stbi_uc *load_jpeg_image(stbi__jpeg *z, int *out_x, int *out_y, int *comp
          // allocate line buffer big enough for upsampling off the edges
          // with upsample factor of 4
          z->img_comp[k].linebuf = (stbi_uc *) stbi__malloc(z->s->img_x + 3);
-         if (!z->img_comp[k].linebuf) { stbi__cleanup_jpeg(z); return stbi__errpuc("outofmem", "Out of memory"); }
+         if (!z->img_comp[k].linebuf) return stbi__errpuc("outofmem", "Out of memory");
 
          r->hs      = z->img_h_max / z->img_comp[k].h;
          r->vs      = z->img_v_max / z->img_comp[k].v;
@@ -3918,13 +4197,35 @@ static stbi_uc *load_jpeg_image(stbi__jpeg *z, int *out_x, int *out_y, int *comp
          else                               r->resample = stbi__resample_row_generic;
       }
 
-      // can't error after this so, this is safe
-      output = (stbi_uc *) stbi__malloc_mad3(n, z->s->img_x, z->s->img_y, 1);
-      if (!output) { stbi__cleanup_jpeg(z); return stbi__errpuc("outofmem", "Out of memory"); }
+      if (z->s->direct_out) {
+         // decode straight into the caller's rows. The 3-channel writers store a 4th byte
+         // past the last pixel, which lands in the row padding or, with a tight stride, on
+         // the next row in memory (already written when flipping, out of bounds for the
+         // last one), so every 3-channel row is written to 'tail' and copied into place
+         if (!stbi__direct_fits(z->s, z->s->img_x, z->s->img_y, n)) return stbi__errpuc("too large", "Output buffer too small");
+         if (n == 3) {
+            tail = (stbi_uc *) stbi__malloc_mad2(n, z->s->img_x, 1);
+            if (!tail) return stbi__errpuc("outofmem", "Out of memory");
+         }
+         z->s->direct_used = 1;
+         output = z->s->direct_out;
+      } else {
+         // can't error after this so, this is safe
+         output = (stbi_uc *) stbi__malloc_mad3(n, z->s->img_x, z->s->img_y, 1);
+         if (!output) return stbi__errpuc("outofmem", "Out of memory");
+      }
 
       // now go ahead and resample
       for (j=0; j < z->s->img_y; ++j) {
          stbi_uc *out = output + n * z->s->img_x * j;
+         stbi_uc *direct_row = NULL;
+         if (z->s->direct_used) {
+            out = stbi__direct_row(z->s, j, z->s->img_y);
+            if (tail) {
+               direct_row = out;
+               out = tail;
+            }
+         }
          for (k=0; k < decode_n; ++k) {
             stbi__resample *r = &res_comp[k];
             int y_bot = r->ystep >= (r->vs >> 1);
@@ -4016,8 +4317,14 @@ static stbi_uc *load_jpeg_image(stbi__jpeg *z, int *out_x, int *out_y, int *comp
                   for (i=0; i < z->s->img_x; ++i) { *out++ = y[i]; *out++ = 255; }
             }
          }
+         if (direct_row)
+            memcpy(direct_row, tail, n * z->s->img_x);
+      }
+      STBI_FREE(tail);
+      for (k=0; k < decode_n; ++k) {
+         STBI_FREE(z->img_comp[k].linebuf);
+         z->img_comp[k].linebuf = NULL;
       }
-      stbi__cleanup_jpeg(z);
       *out_x = z->s->img_x;
       *out_y = z->s->img_y;
       if (comp) *comp = z->s->img_n >= 3 ? 3 : 1; // report original components, not output
@@ -4025,6 +4332,33 @@ static stbi_uc *load_jpeg_image(stbi__jpeg *z, int *out_x, int *out_y, int *comp
    }
 }
 
+static stbi_uc *load_jpeg_image(stbi__jpeg *z, int *out_x, int *out_y, int *comp, int req_comp)
+{
+   stbi_uc *result;
+   z->s->img_n = 0; // make stbi__cleanup_jpeg safe
+
+   // validate req_comp
+   if (req_comp < 0 || req_comp > 4) return stbi__errpuc("bad req_comp", "Internal error");
+
+   // load a jpeg image from whichever source, but leave in YCbCr format
+   if (!stbi__decode_jpeg_image(z)) { stbi__cleanup_jpeg(z); return NULL; }
+
+   // from here on the image is its reduced size; x/y only counted blocks while decoding
+   if (z->scale_shift) {
+      int k;
+      z->s->img_x = stbi__jpeg_scaled(z->s->img_x, z->scale_shift);
+      z->s->img_y = stbi__jpeg_scaled(z->s->img_y, z->scale_shift);
+      for (k=0; k < z->s->img_n; ++k) {
+         z->img_comp[k].x = stbi__jpeg_scaled(z->img_comp[k].x, z->scale_shift);
+         z->img_comp[k].y = stbi__jpeg_scaled(z->img_comp[k].y, z->scale_shift);
+      }
+   }
+
+   result = stbi__jpeg_output(z, out_x, out_y, comp, req_comp);
+   stbi__cleanup_jpeg(z);
+   return result;
+}
+
 static void *stbi__jpeg_load(stbi__context *s, int *x, int *y, int *comp, int req_comp, stbi__result_info *ri)
 {
    unsigned char* result;
@@ -4033,6 +4367,7 @@ static void *stbi__jpeg_load(stbi__context *s, int *x, int *y, int *comp, int re
    memset(j, 0, sizeof(stbi__jpeg));
    STBI_NOTUSED(ri);
    j->s = s;
+   j->scale_shift = stbi__jpeg_scale_shift;
    stbi__setup_jpeg(j);
    result = load_jpeg_image(j, x,y,comp,req_comp);
    STBI_FREE(j);
@@ -4059,8 +4394,8 @@ static int stbi__jpeg_info_raw(stbi__jpeg *j, int *x, int *y, int *comp)
       stbi__rewind( j->s );
       return 0;
    }
-   if (x) *x = j->s->img_x;
-   if (y) *y = j->s->img_y;
+   if (x) *x = stbi__jpeg_scaled(j->s->img_x, stbi__jpeg_scale_shift);
+   if (y) *y = stbi__jpeg_scaled(j->s->img_y, stbi__jpeg_scale_shift);
    if (comp) *comp = j->s->img_n >= 3 ? 3 : 1;
    return 1;
 }
@@ -4076,6 +4411,173 @@ static int stbi__jpeg_info(stbi__context *s, int *x, int *y, int *comp)
    STBI_FREE(j);
    return result;
 }
+
+// incremental progressive decoding: the same marker loop as stbi__decode_jpeg_image,
+// but returning after every scan
+struct stbi_progressive
+{
+   stbi__context s;
+   stbi__jpeg j;
+   stbi_uc *file_data;  // owned copy of the file (stbi_progressive_open)
+   int req_comp;
+   int marker;          // next marker, read after the previous scan
+   int scans;
+   int done, failed;
+};
+
+STBIDEF stbi_progressive *stbi_progressive_open_memory(stbi_uc const *buffer, int len, int desired_channels)
+{
+   int m;
+   stbi_progressive *p;
+   if (desired_channels < 0 || desired_channels > 4) return (stbi_progressive *) stbi__errpuc("bad req_comp", "Internal error");
+   p = (stbi_progressive *) stbi__malloc(sizeof(*p));
+   if (!p) return (stbi_progressive *) stbi__errpuc("outofmem", "Out of memory");
+   memset(p, 0, sizeof(*p));
+   stbi__start_mem(&p->s, buffer, len);
+   p->j.s = &p->s;
+   p->req_comp = desired_channels;
+   stbi__setup_jpeg(&p->j);
+   for (m = 0; m < 4; m++) {
+      p->j.img_comp[m].raw_data = NULL;
+      p->j.img_comp[m].raw_coeff = NULL;
+   }
+   if (!stbi__jpeg_test(&p->s)) {
+      STBI_FREE(p);
+      return (stbi_progressive *) stbi__errpuc("not JPEG", "Image is not a JPEG");
+   }
+   if (!stbi__decode_jpeg_header(&p->j, STBI__SCAN_load) || !p->j.progressive) {
+      if (!p->j.progressive) stbi__err("not progressive", "JPEG is not progressive");
+      stbi_progressive_close(p);
+      return NULL;
+   }
+   p->marker = stbi__get_marker(&p->j);
+   return p;
+}
+
+#ifndef STBI_NO_STDIO
+STBIDEF stbi_progressive *stbi_progressive_open(char const *filename, int desired_channels)
+{
+   long size;
+   stbi_uc *data;
+   stbi_progressive *p;
+   FILE *f = stbi__fopen(filename, "rb");
+   if (!f) return (stbi_progressive *) stbi__errpuc("can't fopen", "Unable to open file");
+   fseek(f, 0, SEEK_END);
+   size = ftell(f);
+   fseek(f, 0, SEEK_SET);
+   data = size > 0 && size < (1L << 30) ? (stbi_uc *) stbi__malloc(size) : NULL;
+   if (!data || fread(data, 1, size, f) != (size_t) size) {
+      fclose(f);
+      STBI_FREE(data);
+      return (stbi_progressive *) stbi__errpuc("can't read", "Unable to read file");
+   }
+   fclose(f);
+   p = stbi_progressive_open_memory(data, (int) size, desired_channels);
+   if (!p) { STBI_FREE(data); return NULL; }
+   p->file_data = data;
+   return p;
+}
+#endif
+
+STBIDEF int stbi_progressive_scan(stbi_progressive *p)
+{
+   stbi__jpeg *j = &p->j;
+   int m = p->marker;
+   if (p->done) return 0;
+   while (!stbi__EOI(m)) {
+      if (stbi__SOS(m)) {
+         if (!stbi__process_scan_header(j) || !stbi__parse_entropy_coded_data(j)) {
+            p->done = p->failed = 1;
+            return 0;
+         }
+         if (j->marker == STBI__MARKER_none)
+            j->marker = stbi__skip_jpeg_junk_at_end(j);
+         m = stbi__get_marker(j);
+         if (STBI__RESTART(m))
+            m = stbi__get_marker(j);
+         p->marker = m;
+         ++p->scans;
+         return 1;
+      } else if (stbi__DNL(m)) {
+         int Ld = stbi__get16be(j->s);
+         stbi__uint32 NL = stbi__get16be(j->s);
+         if (Ld != 4 || NL != j->s->img_y) {
+            stbi__err("bad DNL", "Corrupt JPEG");
+            p->done = p->failed = 1;
+            return 0;
+         }
+         m = stbi__get_marker(j);
+      } else {
+         if (!stbi__process_marker(j, m)) break;
+         m = stbi__get_marker(j);
+      }
+   }
+   p->done = 1;
+   return 0;
+}
+
+STBIDEF int stbi_progressive_failed(stbi_progressive *p)
+{
+   return p->failed;
+}
+
+STBIDEF int stbi_progressive_scans(stbi_progressive *p)
+{
+   return p->scans;
+}
+
+STBIDEF stbi_uc *stbi_progressive_image(stbi_progressive *p, int scale_denom, int *x, int *y, int *comp)
+{
+   stbi__jpeg *z = &p->j;
+   stbi__uint32 img_x = z->s->img_x, img_y = z->s->img_y;
+   int comp_x[4], comp_y[4];
+   stbi_uc *result;
+   int i,j,n;
+   STBI_SIMD_ALIGN(short, data[64]);
+   if (p->scans == 0) return stbi__errpuc("no scan", "No scan decoded yet");
+
+   // like stbi__jpeg_finish, but on a copy so later scans still refine the coefficients.
+   // A reduced image only uses the top-left of each plane, with the full-size stride
+   z->scale_shift = stbi__jpeg_denom_to_shift(scale_denom);
+   for (n=0; n < z->s->img_n; ++n) {
+      int w = (z->img_comp[n].x+7) >> 3;
+      int h = (z->img_comp[n].y+7) >> 3;
+      for (j=0; j < h; ++j) {
+         for (i=0; i < w; ++i) {
+            memcpy(data, z->img_comp[n].coeff + 64 * (i + j * z->img_comp[n].coeff_w), sizeof(data));
+            stbi__jpeg_dequantize(data, z->dequant[z->img_comp[n].tq]);
+            stbi__jpeg_idct(z, n, i, j, data);
+         }
+      }
+      comp_x[n] = z->img_comp[n].x;
+      comp_y[n] = z->img_comp[n].y;
+      z->img_comp[n].x = stbi__jpeg_scaled(comp_x[n], z->scale_shift);
+      z->img_comp[n].y = stbi__jpeg_scaled(comp_y[n], z->scale_shift);
+   }
+   z->s->img_x = stbi__jpeg_scaled(img_x, z->scale_shift);
+   z->s->img_y = stbi__jpeg_scaled(img_y, z->scale_shift);
+   result = stbi__jpeg_output(z, x, y, comp, p->req_comp);
+
+   // later scans count blocks with the full-size dimensions
+   z->s->img_x = img_x;
+   z->s->img_y = img_y;
+   for (n=0; n < z->s->img_n; ++n) {
+      z->img_comp[n].x = comp_x[n];
+      z->img_comp[n].y = comp_y[n];
+   }
+   z->scale_shift = 0;
+   if (result && stbi__vertically_flip_on_load)
+      stbi__vertical_flip(result, *x, *y, p->req_comp ? p->req_comp : (z->s->img_n >= 3 ? 3 : 1));
+   return result;
+}
+
+STBIDEF void stbi_progressive_close(stbi_progressive *p)
+{
+   if (!p) return;
+   stbi__cleanup_jpeg(&p->j);
+   STBI_FREE(p->file_data);
+   STBI_FREE(p);
+}
 #endif
 
 // public domain zlib decode    v0.2  Sean Barrett 2006-11-18
@@ -4692,6 +5194,143 @@ static void stbi__create_png_alpha_expand8(stbi_uc *dest, stbi_uc *src, stbi__ui
    }
 }
 
+#ifdef STBI_SSE2
+// SIMD unfiltering of one scanline for 8-bit images with 3 or 4 bytes per pixel
+// (Up works for any layout). Sub, Avg and Paeth depend on the previous pixel, so they
+// go one pixel per step with all channels in one register; Up has no such dependency
+// and runs 16 (or 32 with AVX2) bytes per step. Returns 0 if the scalar loop should run.
+static __m128i stbi__png_load_pixel(const stbi_uc *p, int bpp)
+{
+   stbi__uint32 v;
+   if (bpp == 4)
+      memcpy(&v, p, 4);
+   else // 3-byte pixels must not read past the end of the row
+      v = p[0] | (p[1] << 8) | ((stbi__uint32) p[2] << 16);
+   return _mm_cvtsi32_si128((int) v);
+}
+
+static void stbi__png_store_pixel(stbi_uc *p, __m128i v, int bpp)
+{
+   stbi__uint32 x = (stbi__uint32) _mm_cvtsi128_si32(v);
+   if (bpp == 4) {
+      memcpy(p, &x, 4);
+   } else {
+      p[0] = STBI__BYTECAST(x);
+      p[1] = STBI__BYTECAST(x >> 8);
+      p[2] = STBI__BYTECAST(x >> 16);
+   }
+}
+
+static __m128i stbi__png_select(__m128i mask, __m128i a, __m128i b)
+{
+   return _mm_or_si128(_mm_and_si128(mask, a), _mm_andnot_si128(mask, b));
+}
+
+// Sub, Avg and Paeth; called with a literal bpp so the pixel loads and stores specialize
+static int stbi__png_unfilter_pixels(int filter, stbi_uc *cur, const stbi_uc *prior, const stbi_uc *raw, int nk, int bpp)
+{
+   __m128i zero = _mm_setzero_si128();
+   __m128i a, b, c, x;
+   int k;
+
+   switch (filter) {
+   case STBI__F_sub:
+      // a block of whole pixels at a time: prefix sum inside the register by shifting one,
+      // two and four pixels, then add the last pixel of the previous block to every pixel
+      a = zero;
+      k = 0;
+      if (bpp == 4) {
+         for (; k + 16 <= nk; k += 16) {
+            x = _mm_loadu_si128((const __m128i *) (raw + k));
+            x = _mm_add_epi8(x, _mm_slli_si128(x, 4));
+            x = _mm_add_epi8(x, _mm_slli_si128(x, 8));
+            x = _mm_add_epi8(x, _mm_shuffle_epi32(a, 0xff));
+            _mm_storeu_si128((__m128i *) (cur + k), x);
+            a = x;
+         }
+         a = _mm_srli_si128(a, 12);
+      }
+      #ifdef STBI_SSSE3
+      else {
+         // 5 pixels per block; byte 15 is scratch and gets overwritten by the next block
+         const __m128i last3 = _mm_setr_epi8(12,13,14, 12,13,14, 12,13,14, 12,13,14, 12,13,14, -1);
+         for (; k + 16 <= nk; k += 15) {
+            x = _mm_loadu_si128((const __m128i *) (raw + k));
+            x = _mm_add_epi8(x, _mm_slli_si128(x, 3));
+            x = _mm_add_epi8(x, _mm_slli_si128(x, 6));
+            x = _mm_add_epi8(x, _mm_slli_si128(x, 12));
+            x = _mm_add_epi8(x, _mm_shuffle_epi8(a, last3));
+            _mm_storeu_si128((__m128i *) (cur + k), x);
+            a = x;
+         }
+         a = _mm_srli_si128(a, 12);
+      }
+      #endif
+      for (; k < nk; k += bpp) {
+         a = _mm_add_epi8(a, stbi__png_load_pixel(raw + k, bpp));
+         stbi__png_store_pixel(cur + k, a, bpp);
+      }
+      return 1;
+   case STBI__F_avg:
+      // floor((a+b)/2): _mm_avg_epu8 rounds up, so subtract the carried-out low bit
+      a = zero;
+      for (k = 0; k < nk; k += bpp) {
+         b = stbi__png_load_pixel(prior + k, bpp);
+         x = _mm_sub_epi8(_mm_avg_epu8(a, b), _mm_and_si128(_mm_xor_si128(a, b), _mm_set1_epi8(1)));
+         a = _mm_add_epi8(x, stbi__png_load_pixel(raw + k, bpp));
+         stbi__png_store_pixel(cur + k, a, bpp);
+      }
+      return 1;
+   case STBI__F_paeth:
+      // same branch-free formulation as stbi__paeth, in 16-bit lanes so 3c-(a+b) can't
+      // overflow; it keeps the dependency on the previous pixel short
+      a = c = zero;
+      for (k = 0; k < nk; k += bpp) {
+         __m128i thresh, lo, hi, t0;
+         b = _mm_unpacklo_epi8(stbi__png_load_pixel(prior + k, bpp), zero);
+         x = _mm_unpacklo_epi8(stbi__png_load_pixel(raw + k, bpp), zero);
+         thresh = _mm_sub_epi16(_mm_add_epi16(c, _mm_add_epi16(c, c)), _mm_add_epi16(a, b));
+         lo = _mm_min_epi16(a, b);
+         hi = _mm_max_epi16(a, b);
+         t0 = stbi__png_select(_mm_cmpgt_epi16(hi, thresh), c, lo);
+         t0 = stbi__png_select(_mm_cmpgt_epi16(thresh, lo), t0, hi);
+         // byte add wraps mod 256 and leaves the zero high bytes alone
+         a = _mm_add_epi8(x, t0);
+         stbi__png_store_pixel(cur + k, _mm_packus_epi16(a, a), bpp);
+         c = b;
+      }
+      return 1;
+   default:
+      return 0;
+   }
+}
+
+static int stbi__png_unfilter_simd(int filter, stbi_uc *cur, const stbi_uc *prior, const stbi_uc *raw, int nk, int bpp)
+{
+   int k = 0;
+   if (filter == STBI__F_up) {
+      #ifdef STBI_AVX2
+      for (; k + 32 <= nk; k += 32) {
+         __m256i r = _mm256_loadu_si256((const __m256i *) (raw + k));
+         __m256i p = _mm256_loadu_si256((const __m256i *) (prior + k));
+         _mm256_storeu_si256((__m256i *) (cur + k), _mm256_add_epi8(r, p));
+      }
+      #endif
+      for (; k + 16 <= nk; k += 16) {
+         __m128i r = _mm_loadu_si128((const __m128i *) (raw + k));
+         __m128i p = _mm_loadu_si128((const __m128i *) (prior + k));
+         _mm_storeu_si128((__m128i *) (cur + k), _mm_add_epi8(r, p));
+      }
+      for (; k < nk; ++k)
+         cur[k] = STBI__BYTECAST(raw[k] + prior[k]);
+      return 1;
+   }
+   if (bpp == 4) return stbi__png_unfilter_pixels(filter, cur, prior, raw, nk, 4);
+   if (bpp == 3) return stbi__png_unfilter_pixels(filter, cur, prior, raw, nk, 3);
+   return 0;
+}
+#endif // STBI_SSE2
+
 // create the png data from post-deflated data
 static int stbi__create_png_image_raw(stbi__png *a, stbi_uc *raw, stbi__uint32 raw_len, int out_n, stbi__uint32 x, stbi__uint32 y, int depth, int color)
 {
@@ -4709,7 +5348,10 @@ static int stbi__create_png_image_raw(stbi__png *a, stbi_uc *raw, stbi__uint32 r
    int width = x;
 
    STBI_ASSERT(out_n == s->img_n || out_n == s->img_n+1);
-   a->out = (stbi_uc *) stbi__malloc_mad3(x, y, output_bytes, 0); // extra bytes to write off the end into
+   if (s->direct_used)
+      a->out = s->direct_out; // rows are addressed through stbi__direct_row
+   else
+      a->out = (stbi_uc *) stbi__malloc_mad3(x, y, output_bytes, 0); // extra bytes to write off the end into
    if (!a->out) return stbi__err("outofmem", "Out of memory");
 
    // note: error exits here don't need to clean up a->out individually,
@@ -4738,7 +5380,7 @@ static int stbi__create_png_image_raw(stbi__png *a, stbi_uc *raw, stbi__uint32 r
       // cur/prior filter buffers alternate
       stbi_uc *cur = filter_buf + (j & 1)*img_width_bytes;
       stbi_uc *prior = filter_buf + (~j & 1)*img_width_bytes;
-      stbi_uc *dest = a->out + stride*j;
+      stbi_uc *dest = s->direct_used ? stbi__direct_row(s, j, y) : a->out + stride*j;
       int nk = width * filter_bytes;
       int filter = *raw++;
 
@@ -4752,6 +5394,10 @@ static int stbi__create_png_image_raw(stbi__png *a, stbi_uc *raw, stbi__uint32 r
       if (j == 0) filter = first_row_filter[filter];
 
       // perform actual filtering
+      #ifdef STBI_SSE2
+      if ((depth == 8 || filter == STBI__F_up) && stbi__png_unfilter_simd(filter, cur, prior, raw, nk, filter_bytes))
+         filter = -1; // done
+      #endif
       switch (filter) {
       case STBI__F_none:
          memcpy(cur, raw, nk);
@@ -5211,6 +5857,13 @@ static int stbi__parse_png_file(stbi__png *z, int scan, int req_comp)
                s->img_out_n = s->img_n+1;
             else
                s->img_out_n = s->img_n;
+            // stbi_load_*_into: the common case needs no post-pass over the image and can
+            // unfilter straight into the caller's rows
+            if (s->direct_out && !interlace && z->depth <= 8 && !pal_img_n && !has_trans && !is_iphone
+                && s->img_out_n == req_comp) {
+               if (!stbi__direct_fits(s, s->img_x, s->img_y, req_comp)) return stbi__err("too large", "Output buffer too small");
+               s->direct_used = 1;
+            }
             if (!stbi__create_png_image(z, z->expanded, raw_len, s->img_out_n, z->depth, color, interlace)) return 0;
             if (has_trans) {
                if (z->depth == 16) {
@@ -5285,6 +5938,7 @@ static void *stbi__do_png(stbi__png *p, int *x, int *y, int *n, int req_comp, st
       *y = p->s->img_y;
       if (n) *n = p->s->img_n;
    }
+   if (p->s->direct_used && p->out == p->s->direct_out) p->out = NULL; // caller's memory, not ours
    STBI_FREE(p->out);      p->out      = NULL;
    STBI_FREE(p->expanded); p->expanded = NULL;
    STBI_FREE(p->idata);    p->idata    = NULL;
@@ -7155,6 +7809,14 @@ static void stbi__hdr_convert(float *output, stbi_uc *input, int req_comp)
    }
 }
 
+static void stbi__hdr_store(void *output, int pixel, stbi_uc *rgbe, int req_comp)
+{
+   if (req_comp == STBI__HDR_RGBE)
+      memcpy((stbi_uc *) output + (size_t) pixel * 4, rgbe, 4);
+   else
+      stbi__hdr_convert((float *) output + (size_t) pixel * req_comp, rgbe, req_comp);
+}
+
 static float *stbi__hdr_load(stbi__context *s, int *x, int *y, int *comp, int req_comp, stbi__result_info *ri)
 {
    char buffer[STBI__HDR_BUFLEN];
@@ -7162,7 +7824,7 @@ static float *stbi__hdr_load(stbi__context *s, int *x, int *y, int *comp, int re
    int valid = 0;
    int width, height;
    stbi_uc *scanline;
-   float *hdr_data;
+   void *hdr_data;
    int len;
    unsigned char count, value;
    int i, j, k, c1,c2, z;
@@ -7203,11 +7865,17 @@ static float *stbi__hdr_load(stbi__context *s, int *x, int *y, int *comp, int re
    if (comp) *comp = 3;
    if (req_comp == 0) req_comp = 3;
 
-   if (!stbi__mad4sizes_valid(width, height, req_comp, sizeof(float), 0))
-      return stbi__errpf("too large", "HDR image is too large");
+   if (req_comp == STBI__HDR_RGBE) {
+      if (!stbi__mad3sizes_valid(width, height, 4, 0))
+         return stbi__errpf("too large", "HDR image is too large");
+      hdr_data = stbi__malloc_mad3(width, height, 4, 0);
+   } else {
+      if (!stbi__mad4sizes_valid(width, height, req_comp, sizeof(float), 0))
+         return stbi__errpf("too large", "HDR image is too large");
+      hdr_data = stbi__malloc_mad4(width, height, req_comp, sizeof(float), 0);
+   }
 
    // Read data
-   hdr_data = (float *) stbi__malloc_mad4(width, height, req_comp, sizeof(float), 0);
    if (!hdr_data)
       return stbi__errpf("outofmem", "Out of memory");
 
@@ -7220,7 +7888,7 @@ static float *stbi__hdr_load(stbi__context *s, int *x, int *y, int *comp, int re
             stbi_uc rgbe[4];
            main_decode_loop:
             stbi__getn(s, rgbe, 4);
-            stbi__hdr_convert(hdr_data + j * width * req_comp + i * req_comp, rgbe, req_comp);
+            stbi__hdr_store(hdr_data, j * width + i, rgbe, req_comp);
          }
       }
    } else {
@@ -7239,7 +7907,7 @@ static float *stbi__hdr_load(stbi__context *s, int *x, int *y, int *comp, int re
             rgbe[1] = (stbi_uc) c2;
             rgbe[2] = (stbi_uc) len;
             rgbe[3] = (stbi_uc) stbi__get8(s);
-            stbi__hdr_convert(hdr_data, rgbe, req_comp);
+            stbi__hdr_store(hdr_data, 0, rgbe, req_comp);
             i = 1;
             j = 0;
             STBI_FREE(scanline);
@@ -7276,14 +7944,17 @@ static float *stbi__hdr_load(stbi__context *s, int *x, int *y, int *comp, int re
                }
             }
          }
-         for (i=0; i < width; ++i)
-            stbi__hdr_convert(hdr_data+(j*width + i)*req_comp, scanline + i*4, req_comp);
+         if (req_comp == STBI__HDR_RGBE)
+            memcpy((stbi_uc *) hdr_data + (size_t) j * width * 4, scanline, (size_t) width * 4);
+         else
+            for (i=0; i < width; ++i)
+               stbi__hdr_convert((float *) hdr_data + (size_t) (j*width + i)*req_comp, scanline + i*4, req_comp);
       }
       if (scanline)
          STBI_FREE(scanline);
    }
 
-   return hdr_data;
+   return (float *) hdr_data;
 }
 
 static int stbi__hdr_info(stbi__context *s, int *x, int *y, int *comp)
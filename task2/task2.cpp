@@ -8,22 +8,78 @@
 #define STB_IMAGE_IMPLEMENTATION
 #include "stb_image.h"
 
+#include "common/async_load.h"
+#include "common/gl_handle.h"
+#include "common/gpu_memory.h"
+#include "common/half_float.h"
+#include "common/image_resample.h"
+#include "common/input_trace.h"
+#include "common/job_system.h"
+#include "common/latency.h"
+#include "common/metrics_exporter.h"
+#include "common/startup_profile.h"
+
 #include <iostream>
 #include <string>
 #include <fstream>
 #include <sstream>
 #include <vector>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <chrono>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <functional>
+
+// --- Progressive Texture Loading ---
+// A progressive JPEG is decoded scan by scan on a worker thread. The image after the first
+// scan (DC only, taken at 1/8 size) is uploaded as soon as it exists and is then replaced by
+// sharper full-size images as more scans are decoded, so the first frame shows a texture
+// long before the whole file has been decoded.
+struct ProgressiveTexture {
+    unsigned int texture = 0;
+    GLenum format = GL_RGB;
+    std::thread worker;
+    std::atomic<bool> cancel{false};
+    std::mutex mutex;                  // Guards everything below
+    std::vector<unsigned char> pixels; // Newest image not yet uploaded
+    int width = 0, height = 0;
+    int scans = 0;                     // Scans decoded when 'pixels' was produced
+    bool pending = false;              // 'pixels' is waiting to be uploaded
+    bool finished = false;             // The worker has published its last image (or failed)
+};
 
 // --- Function Prototypes ---
 void framebuffer_size_callback(GLFWwindow* window, int width, int height);
+void window_refresh_callback(GLFWwindow* window);
+void key_callback(GLFWwindow* window, int key, int scancode, int action, int mods);
 void processInput(GLFWwindow *window);
-unsigned int loadTexture(const char *path);
+LoadTask<unsigned int> loadTexture(GlThreadQueue &gl, std::string path);
+LoadTask<unsigned int> loadHdrTexture(GlThreadQueue &gl, std::string path, std::vector<unsigned char> file);
+bool loadDownscaled(const char *path, const stbi_uc *file, int fileBytes, stbi_uc *out, size_t stride, int width, int height, int channels);
+unsigned int startProgressiveTexture(ProgressiveTexture &progressive, const char *path);
+bool updateProgressiveTexture(ProgressiveTexture &progressive, double loadStart);
+void stopProgressiveTexture(ProgressiveTexture &progressive);
 GLuint compileShader(GLenum type, const char* source);
 GLuint linkProgram(GLuint vertexShader, GLuint fragmentShader);
+LoadTask<GLuint> loadShaderProgram(GlThreadQueue &gl, const char *vertexSource, const char *fragmentSource);
 
 // --- Settings ---
 const unsigned int SCR_WIDTH = 800;
 const unsigned int SCR_HEIGHT = 600;
+// Images larger than this are shrunk at load time (--max-texture-size, --texture-budget-mb); 0 = unlimited
+TextureBudget textureBudget;
+// --jpeg-scale N: decode JPEGs at 1/N size (2, 4 or 8); a texture budget may pick a smaller scale
+int jpegScaleDenom = 1;
+
+// --- Redraw State ---
+// In on-demand mode (--on-demand) a frame is only rendered when something changed
+// (window resized/exposed, input) or while the pyramid is animating; otherwise the
+// loop sleeps in glfwWaitEvents so an idle kiosk uses essentially no CPU/GPU.
+bool sceneDirty = true;        // Set by callbacks whenever the image must be redrawn
+bool animating = true;         // SPACE pauses/resumes the rotation
 
 // --- Shader Source Code (GLSL) ---
 
@@ -65,13 +121,78 @@ void main()
 )glsl";
 
 
-int main() {
+int main(int argc, char** argv) {
+    startupProfile(); // Startup phases are timed from here
+
+    // Command line: --on-demand      only redraw when the scene, camera or window changed
+    //               --max-fps N      cap the animation frame rate (on-demand mode)
+    //               --low-latency    sample input just before rendering, one frame in flight
+    //               --latency-ab N   alternate default and low-latency mode every N frames and
+    //                                compare their latency at exit
+    //               --max-texture-size N     shrink textures whose longer side exceeds N pixels
+    //               --texture-budget-mb N    shrink textures whose base level exceeds N MiB
+    //               --jpeg-scale N           decode JPEG textures at 1/N size (2, 4, 8)
+    //               --startup-json PATH      also write the startup breakdown as JSON ("-" for stdout)
+    //               --metrics ENDPOINT       serve Prometheus metrics on a localhost port or a Unix socket path
+    //               --record-input PATH      record input and frame times to PATH
+    //               --replay-input PATH      replay a recording: same input, same animation clock
+    const char* startupJson = nullptr;
+    const char* metricsEndpoint = nullptr;
+    const char* recordInput = nullptr;
+    const char* replayInput = nullptr;
+    bool onDemand = false;
+    bool lowLatency = false;
+    int latencyAb = 0;
+    double maxFps = 0.0;
+    for (int i = 1; i < argc; ++i) {
+        if (std::strcmp(argv[i], "--on-demand") == 0) {
+            onDemand = true;
+        } else if (std::strcmp(argv[i], "--max-fps") == 0 && i + 1 < argc) {
+            maxFps = std::atof(argv[++i]);
+        } else if (std::strcmp(argv[i], "--low-latency") == 0) {
+            lowLatency = true;
+        } else if (std::strcmp(argv[i], "--latency-ab") == 0 && i + 1 < argc) {
+            latencyAb = std::atoi(argv[++i]);
+        } else if (std::strcmp(argv[i], "--max-texture-size") == 0 && i + 1 < argc) {
+            textureBudget.maxDimension = std::atoi(argv[++i]);
+        } else if (std::strcmp(argv[i], "--texture-budget-mb") == 0 && i + 1 < argc) {
+            textureBudget.maxBytes = (size_t)(std::atof(argv[++i]) * 1024.0 * 1024.0);
+        } else if (std::strcmp(argv[i], "--jpeg-scale") == 0 && i + 1 < argc) {
+            jpegScaleDenom = std::atoi(argv[++i]);
+            // The decoder only scales by powers of two; anything else would silently decode at another scale
+            if (jpegScaleDenom != 1 && jpegScaleDenom != 2 && jpegScaleDenom != 4 && jpegScaleDenom != 8) {
+                std::cerr << "--jpeg-scale must be 1, 2, 4 or 8 (got " << argv[i] << ")" << std::endl;
+                return -1;
+            }
+        } else if (std::strcmp(argv[i], "--startup-json") == 0 && i + 1 < argc) {
+            startupJson = argv[++i];
+        } else if (std::strcmp(argv[i], "--metrics") == 0 && i + 1 < argc) {
+            metricsEndpoint = argv[++i];
+        } else if (std::strcmp(argv[i], "--record-input") == 0 && i + 1 < argc) {
+            recordInput = argv[++i];
+        } else if (std::strcmp(argv[i], "--replay-input") == 0 && i + 1 < argc) {
+            replayInput = argv[++i];
+        }
+    }
+    if (replayInput) {
+        if (!inputTrace().replay(replayInput, "task2"))
+            return -1;
+        onDemand = false; // Only the frames that were drawn are recorded; replay them back to back
+    } else if (recordInput) {
+        inputTrace().record(recordInput, "task2");
+    }
+#ifndef _WIN32
+    MetricsExporter metricsExporter("task2");
+    if (metricsEndpoint && !metricsExporter.start(metricsEndpoint)) return -1;
+#endif
+
     // 1. Initialize GLFW
     // -------------------
     if (!glfwInit()) {
         std::cerr << "Failed to initialize GLFW" << std::endl;
         return -1;
     }
+    startupProfile().mark("glfwInit");
     glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
     glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
     glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
@@ -89,6 +210,9 @@ int main() {
     }
     glfwMakeContextCurrent(window);
     glfwSetFramebufferSizeCallback(window, framebuffer_size_callback);
+    glfwSetWindowRefreshCallback(window, window_refresh_callback);
+    glfwSetKeyCallback(window, key_callback);
+    startupProfile().mark("window/context");
 
     // 3. Initialize GLAD
     // ------------------
@@ -97,19 +221,41 @@ int main() {
         glfwTerminate();
         return -1;
     }
+    startupProfile().mark("gladLoadGLLoader");
 
     // 4. Configure Global OpenGL State
     // --------------------------------
     glEnable(GL_DEPTH_TEST); // Enable depth testing for 3D
 
-    // 5. Build and Compile Shaders
-    // ----------------------------
-    GLuint vertexShader = compileShader(GL_VERTEX_SHADER, vertexShaderSource);
-    GLuint fragmentShader = compileShader(GL_FRAGMENT_SHADER, fragmentShaderSource);
-    GLuint shaderProgram = linkProgram(vertexShader, fragmentShader);
-    // Delete shaders after linking as they are no longer needed
-    glDeleteShader(vertexShader);
-    glDeleteShader(fragmentShader);
+    // Input-to-photon latency tracking (always on, reported at exit). It chains in front
+    // of key_callback, so it has to be attached after the task's own callbacks.
+    // Held in a unique_ptr because it owns GL sync objects that must go before glfwTerminate.
+    std::unique_ptr<LatencyTracker> latency(new LatencyTracker(lowLatency));
+    if (latencyAb > 0)
+        latency->alternateModes(latencyAb); // The loop reads the mode from the tracker every frame
+    latency->attach(window);
+    inputTrace().attach(window); // Outermost: replay drops live key events before anything sees them
+
+    // 5. Start Loading Texture and Shaders
+    // ------------------------------------
+    // Each load is a coroutine (common/async_load.h): reading and decoding run on the job system,
+    // the GL stages run on this thread, and all loads are awaited together in step 7, so startup
+    // waits for the slowest load instead of the sum of them.
+    // !! Replace "pyramid_texture.jpg" with the actual path to your texture file !!
+    const char* texturePath = "pyramid_texture.jpg"; // Or .png, etc.
+    GlThreadQueue glQueue;
+    // Progressive JPEGs are refined while rendering; everything else (and anything that has to
+    // be shrunk for the texture budget) is loaded up front
+    ProgressiveTexture progressive;
+    double textureLoadStart = glfwGetTime();
+    unsigned int progressiveTexture = 0;
+    if (textureBudget.maxDimension == 0 && textureBudget.maxBytes == 0 && jpegScaleDenom <= 1)
+        progressiveTexture = startProgressiveTexture(progressive, texturePath);
+    LoadTask<unsigned int> textureLoad = progressiveTexture != 0 ? loadReady(progressiveTexture)
+                                                                 : loadTexture(glQueue, texturePath);
+    // Compiled right here while the texture file is read on a worker
+    LoadTask<GLuint> programLoad = loadShaderProgram(glQueue, vertexShaderSource, fragmentShaderSource);
+    startupProfile().mark("start loads");
 
     // 6. Set up Vertex Data and Buffers
     // ---------------------------------
@@ -148,16 +294,16 @@ int main() {
     };
 
     // Create Vertex Array Object (VAO), Vertex Buffer Object (VBO)
-    unsigned int VBO, VAO;
-    glGenVertexArrays(1, &VAO);
-    glGenBuffers(1, &VBO);
+    // (RAII handles: deletion goes through the fenced queue in common/gl_handle.h)
+    GlVertexArray VAO = GlVertexArray::create();
+    GlBuffer VBO = GlBuffer::create();
 
     // Bind VAO
-    glBindVertexArray(VAO);
+    glBindVertexArray(VAO.get());
 
     // Bind VBO and copy vertex data
-    glBindBuffer(GL_ARRAY_BUFFER, VBO);
-    glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), vertices, GL_STATIC_DRAW);
+    glBindBuffer(GL_ARRAY_BUFFER, VBO.get());
+    gpuBufferData(GL_ARRAY_BUFFER, VBO.get(), sizeof(vertices), vertices, GL_STATIC_DRAW, GpuCategory::VertexBuffer);
 
     // Configure Vertex Attributes
     // Position attribute (location = 0)
@@ -171,18 +317,26 @@ int main() {
     glBindBuffer(GL_ARRAY_BUFFER, 0);
     // Unbind VAO
     glBindVertexArray(0);
-
-    // 7. Load Texture
-    // ---------------
-    // !! Replace "pyramid_texture.jpg" with the actual path to your texture file !!
-    const char* texturePath = "pyramid_texture.jpg"; // Or .png, etc.
-    unsigned int texture1 = loadTexture(texturePath);
+    startupProfile().mark("mesh upload");
+
+    // 7. Wait for the Loads
+    // ---------------------
+    // Runs the loads' GL stages queued on this thread and helps the job system in the meantime
+    waitAll(glQueue, textureLoad, programLoad);
+    startupProfile().mark("wait for loads");
+    GLuint shaderProgram = programLoad.get();
+    unsigned int texture1 = textureLoad.get();
+    double loadMs = (glfwGetTime() - textureLoadStart) * 1000.0;
+    if (texture1 != 0 && progressiveTexture == 0)
+        std::cout << "Texture ready after " << textureLoad.elapsedMs() << " ms" << std::endl;
+    printLoadTimes(std::cout, loadMs, { { "texture", textureLoad.elapsedMs() }, { "shaders", programLoad.elapsedMs() } });
     if (texture1 == 0) {
         std::cerr << "Failed to load texture: " << texturePath << std::endl;
         // Continue without texture? Or terminate? Let's terminate for now.
-        glDeleteVertexArrays(1, &VAO);
-        glDeleteBuffers(1, &VBO);
+        VAO.reset();
+        VBO.reset();
         glDeleteProgram(shaderProgram);
+        glDeletionQueue().finish();
         glfwTerminate();
         return -1;
     }
@@ -193,7 +347,57 @@ int main() {
 
     // 8. Rendering Loop
     // -----------------
+    // The rotation angle advances only while animating, so pausing and resuming
+    // continues from the same pose.
+    double animationTime = 0.0;
+    double lastTime = inputTrace().clock(glfwGetTime());
+    double nextFrameTime = lastTime;
+    long long framesRendered = 0;
     while (!glfwWindowShouldClose(window)) {
+        // --- Texture Refinement ---
+        if (updateProgressiveTexture(progressive, textureLoadStart))
+            sceneDirty = true;
+
+        // --- Events ---
+        if (onDemand) {
+            if (animating && maxFps > 0.0) {
+                // Sleep until the next animation frame is due (or an event arrives)
+                double wait = nextFrameTime - glfwGetTime();
+                if (wait > 0.0)
+                    glfwWaitEventsTimeout(wait);
+                else
+                    glfwPollEvents();
+                if (glfwGetTime() >= nextFrameTime)
+                    sceneDirty = true;
+            } else if (animating) {
+                glfwPollEvents();
+                sceneDirty = true;
+            } else {
+                // Nothing is moving: block until the OS delivers an event
+                if (!sceneDirty)
+                    glfwWaitEvents();
+            }
+            if (!sceneDirty)
+                continue;
+            if (maxFps > 0.0)
+                nextFrameTime = glfwGetTime() + 1.0 / maxFps;
+            // Pacing would only delay a frame that an event just asked for, so on-demand
+            // low-latency mode only limits the frames in flight
+            if (latency->lowLatency())
+                latency->waitForPreviousFrame();
+        } else if (latency->lowLatency()) {
+            // Wait for the previous frame and sleep until just before the next swap is due,
+            // then sample input so it is as fresh as possible when the frame is drawn
+            latency->beginFrame();
+            glfwPollEvents();
+        }
+        latency->inputSampled();
+
+        double now = inputTrace().beginFrame(glfwGetTime()); // Recorded time (and key events) when replaying
+        if (animating)
+            animationTime += now - lastTime;
+        lastTime = now;
+
         // --- Input ---
         processInput(window);
 
@@ -215,14 +419,17 @@ int main() {
         glm::mat4 projection = glm::mat4(1.0f);
 
         // Model: Rotate the pyramid over time for creativity
-        float angle = (float)glfwGetTime() * glm::radians(40.0f); // Rotate 40 degrees per second
+        float angle = (float)animationTime * glm::radians(40.0f); // Rotate 40 degrees per second
         model = glm::rotate(model, angle, glm::vec3(0.2f, 1.0f, 0.3f)); // Rotate around a tilted axis
 
         // View: Move the camera slightly back
         view = glm::translate(view, glm::vec3(0.0f, 0.0f, -3.0f));
 
-        // Projection: Perspective projection
-        projection = glm::perspective(glm::radians(45.0f), (float)SCR_WIDTH / (float)SCR_HEIGHT, 0.1f, 100.0f);
+        // Projection: Perspective projection (use the current framebuffer so resizes keep the aspect ratio)
+        int fbWidth, fbHeight;
+        glfwGetFramebufferSize(window, &fbWidth, &fbHeight);
+        float aspect = (fbWidth > 0 && fbHeight > 0) ? (float)fbWidth / (float)fbHeight : (float)SCR_WIDTH / (float)SCR_HEIGHT;
+        projection = glm::perspective(glm::radians(45.0f), aspect, 0.1f, 100.0f);
 
         // Get matrix uniform locations and set them
         unsigned int modelLoc = glGetUniformLocation(shaderProgram, "model");
@@ -233,25 +440,47 @@ int main() {
         glUniformMatrix4fv(projLoc, 1, GL_FALSE, glm::value_ptr(projection));
 
         // Bind VAO (contains vertex data configuration)
-        glBindVertexArray(VAO);
+        glBindVertexArray(VAO.get());
 
         // Draw the pyramid (18 vertices define 6 triangles)
         glDrawArrays(GL_TRIANGLES, 0, 18);
+        frameMetrics().countDraw(6);
 
         // Unbind VAO
         glBindVertexArray(0);
 
         // --- Swap Buffers and Poll Events ---
         glfwSwapBuffers(window);
-        glfwPollEvents();
+        latency->afterSwap();
+        glDeletionQueue().endFrame(); // Fence this frame; delete objects released by frames the GPU has finished
+        frameMetrics().endFrame();
+        inputTrace().endFrame();
+        if (!startupProfile().finished()) {
+            startupProfile().finish("first frame");
+            startupProfile().report(std::cout, "task2", startupJson);
+        }
+        sceneDirty = false;
+        framesRendered++;
+        if (!onDemand && !latency->lowLatency())
+            glfwPollEvents();
     }
 
+    std::cout << "Rendered " << framesRendered << " frames in " << glfwGetTime() << " s"
+              << (onDemand ? " (on-demand)" : "") << std::endl;
+    latency->report(std::cout, "task2");
+    inputTrace().finish(std::cout);
+    latency.reset();
+    gpuMemory().printBreakdown(std::cout);
+
     // 9. Cleanup Resources
     // --------------------
-    glDeleteVertexArrays(1, &VAO);
-    glDeleteBuffers(1, &VBO);
+    stopProgressiveTexture(progressive);
+    VAO.reset();
+    VBO.reset();
     glDeleteProgram(shaderProgram);
-    glDeleteTextures(1, &texture1);
+    GlTexture(texture1).reset();
+    glDeletionQueue().finish(); // Wait for the last frames and delete what is left while the context exists
+    glDeletionQueue().printStats(std::cout);
 
     glfwDestroyWindow(window);
     glfwTerminate();
@@ -263,63 +492,358 @@ int main() {
 // GLFW: Adjust viewport on window resize
 void framebuffer_size_callback(GLFWwindow* window, int width, int height) {
     glViewport(0, 0, width, height);
+    sceneDirty = true;
+}
+
+// GLFW: Window contents were damaged (exposed, restored, moved between monitors)
+void window_refresh_callback(GLFWwindow* window) {
+    sceneDirty = true;
+}
+
+// GLFW: Discrete key presses (SPACE toggles the animation). ESC is handled here as well
+// because processInput only runs when a frame is rendered.
+void key_callback(GLFWwindow* window, int key, int scancode, int action, int mods) {
+    if (key == GLFW_KEY_ESCAPE && action == GLFW_PRESS)
+        glfwSetWindowShouldClose(window, true);
+    if (key == GLFW_KEY_SPACE && action == GLFW_PRESS) {
+        animating = !animating;
+        sceneDirty = true;
+    }
 }
 
 // GLFW: Process input (e.g., close window on ESC)
 void processInput(GLFWwindow *window) {
-    if (glfwGetKey(window, GLFW_KEY_ESCAPE) == GLFW_PRESS)
+    if (inputTrace().keyDown(window, GLFW_KEY_ESCAPE))
         glfwSetWindowShouldClose(window, true);
 }
 
-// Utility function for loading a 2D texture from file
-unsigned int loadTexture(char const * path) {
+// Utility coroutine for loading a 2D texture from file
+// The file is read and decoded on the job system; the GL thread only creates the pixel unpack
+// buffer, and later copies it into the texture. The image is decoded straight into the mapped
+// buffer, so there is no intermediate malloc'd copy between stb_image and the driver. Images
+// over textureBudget are decoded to memory first and resampled into the buffer at the reduced size.
+// JPEGs are decoded at 1/2, 1/4 or 1/8 size straight away when that is enough.
+LoadTask<unsigned int> loadTexture(GlThreadQueue &gl, std::string path) {
+    // --- Worker: read the file and work out the size ---
+    std::vector<unsigned char> file;
+    {
+        StartupScope scope("texture read");
+        file = co_await readFileAsync(path);
+    }
+    if (file.empty()) {
+        std::cerr << "Texture failed to load at path: " << path << " (cannot read file)" << std::endl;
+        co_return 0; // Indicate failure
+    }
+    const stbi_uc *data = file.data();
+    int fileBytes = (int)file.size();
+    if (stbi_is_hdr_from_memory(data, fileBytes))
+        co_return co_await loadHdrTexture(gl, path, std::move(file));
+
+    // The decoder settings are per thread: workers are shared with other loads
+    int width, height, nrComponents;
+    stbi_set_jpeg_scale_denom_thread(1);
+    if (!stbi_info_from_memory(data, fileBytes, &width, &height, &nrComponents)) {
+        std::cerr << "Texture failed to load at path: " << path << " (" << stbi_failure_reason() << ")" << std::endl;
+        co_return 0; // Indicate failure
+    }
+
+    GLenum format;
+    if (nrComponents == 1)
+        format = GL_RED;
+    else if (nrComponents == 3)
+        format = GL_RGB;
+    else if (nrComponents == 4)
+        format = GL_RGBA;
+    else {
+        std::cerr << "Texture format not supported (nrComponents=" << nrComponents << ") for " << path << std::endl;
+        co_return 0; // Indicate failure
+    }
+
+    int fullWidth = width, fullHeight = height;
+    fitTextureBudget(textureBudget, fullWidth, fullHeight, nrComponents, width, height);
+
+    // Reduced JPEG decoding: --jpeg-scale, or the smallest scale that still covers the budgeted size.
+    // stbi_info reports the size the decoder will produce, which stays the full size for other formats
+    int denom = std::max(1, jpegScaleDenom);
+    while (denom < 8 && (fullWidth + denom * 2 - 1) / (denom * 2) >= width && (fullHeight + denom * 2 - 1) / (denom * 2) >= height)
+        denom *= 2;
+    int decodedWidth = fullWidth, decodedHeight = fullHeight;
+    if (denom > 1) {
+        stbi_set_jpeg_scale_denom_thread(denom);
+        stbi_info_from_memory(data, fileBytes, &decodedWidth, &decodedHeight, NULL);
+        stbi_set_jpeg_scale_denom_thread(1);
+        if (decodedWidth != fullWidth)
+            std::cout << "Texture " << path << " decoded at 1/" << denom << " scale: " << decodedWidth << "x" << decodedHeight << std::endl;
+    }
+    if (decodedWidth < width || decodedHeight < height) { // --jpeg-scale asked for less than the budget allows
+        width = decodedWidth;
+        height = decodedHeight;
+    }
+    bool downscale = decodedWidth != width || decodedHeight != height;
+
+    // Rows padded to GL_UNPACK_ALIGNMENT's default of 4 bytes
+    size_t stride = ((size_t)width * nrComponents + 3) & ~(size_t)3;
+    size_t imageBytes = stride * (height - 1) + (size_t)width * nrComponents;
+
+    // --- GL thread: map a pixel unpack buffer ---
+    co_await resumeOnGlThread(gl);
+    // The PBO is released when this coroutine returns; the deletion queue keeps it alive
+    // until the frame that sourced the copy has completed
+    GlBuffer pbo = GlBuffer::create();
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, pbo.get());
+    gpuBufferData(GL_PIXEL_UNPACK_BUFFER, pbo.get(), (GLsizeiptr)imageBytes, NULL, GL_STREAM_DRAW, GpuCategory::PixelBuffer);
+    stbi_uc *pixels = (stbi_uc *)glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, (GLsizeiptr)imageBytes,
+                                                  GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+
+    // --- Worker: decode into the mapped buffer ---
+    bool decoded = false;
+    std::string failure = "buffer mapping failed";
+    if (pixels) {
+        co_await resumeOnWorker();
+        StartupScope scope("texture decode");
+        // Tell stb_image.h to flip loaded texture's on the y-axis (OpenGL expects 0.0 on y-axis to be at the bottom)
+        stbi_set_flip_vertically_on_load_thread(1);
+        stbi_set_jpeg_scale_denom_thread(denom);
+        if (downscale)
+            decoded = loadDownscaled(path.c_str(), data, fileBytes, pixels, stride, width, height, nrComponents);
+        else
+            decoded = stbi_load_from_memory_into(data, fileBytes, pixels, stride, imageBytes, &width, &height, NULL, nrComponents) != 0;
+        stbi_set_jpeg_scale_denom_thread(1);
+        if (!decoded)
+            failure = stbi_failure_reason(); // Only valid on the decoding thread
+    }
+
+    // --- GL thread: upload ---
+    co_await resumeOnGlThread(gl);
+    StartupScope scope("texture upload");
+    // Other loads may have bound their own buffers in the meantime
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, pbo.get());
+    bool unmapped = pixels && glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER) == GL_TRUE; // false if the driver lost the mapping
+    if (!decoded || !unmapped) {
+        std::cerr << "Texture failed to load at path: " << path << " (" << (decoded ? "buffer mapping lost" : failure) << ")" << std::endl;
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+        co_return 0; // Indicate failure
+    }
+
     unsigned int textureID;
     glGenTextures(1, &textureID);
+    glBindTexture(GL_TEXTURE_2D, textureID);
+    glTexImage2D(GL_TEXTURE_2D, 0, format, width, height, 0, format, GL_UNSIGNED_BYTE, (const void *)0); // Source is the bound PBO
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+    glGenerateMipmap(GL_TEXTURE_2D);
+    gpuTrackTexture(textureID, format, width, height, 0, GpuCategory::Texture); // Full mip chain
+
+    // Set texture wrapping parameters
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT); // Repeat texture horizontally
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT); // Repeat texture vertically
+    // Set texture filtering parameters
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR); // Linear filtering for minification (with mipmaps)
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);                // Linear filtering for magnification
+
+    co_return textureID;
+}
 
-    int width, height, nrComponents;
-    // Tell stb_image.h to flip loaded texture's on the y-axis (OpenGL expects 0.0 on y-axis to be at the bottom)
-    stbi_set_flip_vertically_on_load(true);
-    unsigned char *data = stbi_load(path, &width, &height, &nrComponents, 0);
-    if (data) {
-        GLenum format;
-        if (nrComponents == 1)
-            format = GL_RED;
-        else if (nrComponents == 3)
-            format = GL_RGB;
-        else if (nrComponents == 4)
-            format = GL_RGBA;
-        else {
-             std::cerr << "Texture format not supported (nrComponents=" << nrComponents << ") for " << path << std::endl;
-             stbi_image_free(data);
-             glDeleteTextures(1, &textureID); // Clean up generated texture ID
-             return 0; // Indicate failure
+// Worker thread: decodes one scan at a time and publishes images for the render thread.
+// Intermediate images are only produced when the previous one has already been uploaded,
+// so a slow render thread skips refinements instead of the worker queueing them up.
+void decodeProgressive(ProgressiveTexture *progressive, stbi_progressive *decoder, int channels) {
+    stbi_set_flip_vertically_on_load_thread(1);
+    bool first = true;
+    while (!progressive->cancel) {
+        bool more = stbi_progressive_scan(decoder) != 0;
+        if (more && !first) {
+            std::lock_guard<std::mutex> lock(progressive->mutex);
+            if (progressive->pending)
+                continue;
         }
 
+        int width = 0, height = 0;
+        stbi_uc *image = (more || stbi_progressive_scans(decoder) > 0)
+            ? stbi_progressive_image(decoder, first ? 8 : 1, &width, &height, NULL) : NULL;
+        {
+            std::lock_guard<std::mutex> lock(progressive->mutex);
+            if (image) {
+                progressive->pixels.assign(image, image + (size_t)width * height * channels);
+                progressive->width = width;
+                progressive->height = height;
+                progressive->scans = stbi_progressive_scans(decoder);
+                progressive->pending = true;
+            }
+            progressive->finished = !more || !image;
+        }
+        stbi_image_free(image);
+        glfwPostEmptyEvent(); // Wake the render loop if it is waiting for events (on-demand mode)
+        first = false;
+        if (!more || !image)
+            break;
+    }
+    if (stbi_progressive_failed(decoder))
+        std::cerr << "Progressive texture decode stopped early (" << stbi_failure_reason() << ")" << std::endl;
+    stbi_progressive_close(decoder);
+}
 
-        glBindTexture(GL_TEXTURE_2D, textureID);
-        glTexImage2D(GL_TEXTURE_2D, 0, format, width, height, 0, format, GL_UNSIGNED_BYTE, data);
-        glGenerateMipmap(GL_TEXTURE_2D);
+// Creates the texture object and starts decoding; returns 0 if path is not a progressive JPEG
+unsigned int startProgressiveTexture(ProgressiveTexture &progressive, char const * path) {
+    int width, height, nrComponents;
+    stbi_set_jpeg_scale_denom(1);
+    if (!stbi_info(path, &width, &height, &nrComponents) || (nrComponents != 1 && nrComponents != 3))
+        return 0;
+    stbi_progressive *decoder = stbi_progressive_open(path, nrComponents);
+    if (!decoder)
+        return 0;
 
-        // Set texture wrapping parameters
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT); // Repeat texture horizontally
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT); // Repeat texture vertically
-        // Set texture filtering parameters
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR); // Linear filtering for minification (with mipmaps)
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);                // Linear filtering for magnification
+    progressive.format = nrComponents == 1 ? GL_RED : GL_RGB;
+    glGenTextures(1, &progressive.texture);
+    glBindTexture(GL_TEXTURE_2D, progressive.texture);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    progressive.worker = std::thread(decodeProgressive, &progressive, decoder, nrComponents);
+    return progressive.texture;
+}
 
-        stbi_image_free(data); // Free image memory after uploading to GPU
-    } else {
-        std::cerr << "Texture failed to load at path: " << path << std::endl;
-        stbi_image_free(data);
-        return 0; // Indicate failure
+// Render thread: uploads the newest published image, if any. Returns true if the texture changed
+bool updateProgressiveTexture(ProgressiveTexture &progressive, double loadStart) {
+    if (progressive.texture == 0)
+        return false;
+    std::vector<unsigned char> pixels;
+    int width, height, scans;
+    bool finished;
+    {
+        std::lock_guard<std::mutex> lock(progressive.mutex);
+        if (!progressive.pending)
+            return false;
+        pixels.swap(progressive.pixels);
+        width = progressive.width;
+        height = progressive.height;
+        scans = progressive.scans;
+        finished = progressive.finished;
+        progressive.pending = false;
     }
 
-    return textureID;
+    // Re-specifying level 0 may change the size (the first image is 1/8 of the final one)
+    glBindTexture(GL_TEXTURE_2D, progressive.texture);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1); // Rows are tightly packed
+    glTexImage2D(GL_TEXTURE_2D, 0, progressive.format, width, height, 0, progressive.format, GL_UNSIGNED_BYTE, pixels.data());
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    glGenerateMipmap(GL_TEXTURE_2D);
+    gpuTrackTexture(progressive.texture, progressive.format, width, height, 0, GpuCategory::Texture);
+
+    double ms = (glfwGetTime() - loadStart) * 1000.0;
+    if (finished)
+        std::cout << "Progressive texture final after " << ms << " ms (" << width << "x" << height << ", " << scans << " scans)" << std::endl;
+    else
+        std::cout << "Progressive texture refined after " << ms << " ms (" << width << "x" << height << ", scan " << scans << ")" << std::endl;
+    return true;
+}
+
+void stopProgressiveTexture(ProgressiveTexture &progressive) {
+    progressive.cancel = true;
+    if (progressive.worker.joinable())
+        progressive.worker.join();
 }
 
 
+// Decodes the image in file (at the current thread's JPEG scale) and resamples it into out
+// (width x height, the budgeted size) on the shared job system: box filter for integer factors, Lanczos-3 otherwise
+bool loadDownscaled(char const * path, const stbi_uc *file, int fileBytes, stbi_uc *out, size_t stride, int width, int height, int channels) {
+    int fullWidth, fullHeight;
+    stbi_uc *full = stbi_load_from_memory(file, fileBytes, &fullWidth, &fullHeight, NULL, channels);
+    if (!full)
+        return false;
+    int threads = jobSystem().threadCount();
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    // 16 output rows per job: small enough to balance across cores, large enough that the
+    // vertical taps (the bulk of the work) dwarf the scheduling cost
+    ResampleFilter filter = resampleImageWith(full, fullWidth, fullHeight, (size_t)fullWidth * channels,
+                                              out, width, height, stride, channels,
+                                              [](int begin, int end, const std::function<void(int, int)> &rows) {
+        parallelFor(begin, end, 16, [&rows](size_t first, size_t last) { rows((int)first, (int)last); });
+    });
+    double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    stbi_image_free(full);
+
+    double savedMiB = ((double)fullWidth * fullHeight - (double)width * height) * channels / (1024.0 * 1024.0);
+    std::cout << "Texture " << path << " downscaled " << fullWidth << "x" << fullHeight << " -> " << width << "x" << height
+              << " (" << (filter == ResampleFilter::Box ? "box" : "lanczos3") << ", " << threads << " threads): saved "
+              << savedMiB << " MiB, " << ms << " ms, " << (double)fullWidth * fullHeight / 1e3 / std::max(ms, 1e-3)
+              << " Mpixel/s" << std::endl;
+    return true;
+}
+
+
+// Loads a Radiance .hdr image as a GL_RGB16F texture (called by loadTexture on the worker that read the file)
+// stb_image only decodes the RLE scanlines to raw RGBE; the SIMD converter then writes
+// half floats straight into a mapped pixel unpack buffer. That is half the memory of
+// stbi_loadf's float RGB, and the driver gets the texture's own format with nothing left to convert.
+LoadTask<unsigned int> loadHdrTexture(GlThreadQueue &gl, std::string path, std::vector<unsigned char> file) {
+    // --- Worker: decode to RGBE ---
+    std::chrono::steady_clock::time_point decodeStart = std::chrono::steady_clock::now();
+    int width, height;
+    stbi_set_flip_vertically_on_load_thread(1);
+    stbi_uc *rgbe = stbi_load_hdr_rgbe_from_memory(file.data(), (int)file.size(), &width, &height);
+    if (!rgbe) {
+        std::cerr << "HDR texture failed to load at path: " << path << " (" << stbi_failure_reason() << ")" << std::endl;
+        co_return 0; // Indicate failure
+    }
+    file = std::vector<unsigned char>();
+    startupProfile().add("hdr decode", decodeStart, std::chrono::steady_clock::now());
+
+    // --- GL thread: map a pixel unpack buffer ---
+    co_await resumeOnGlThread(gl);
+    size_t pixels = (size_t)width * height;
+    GLsizeiptr imageBytes = (GLsizeiptr)(pixels * 3 * sizeof(uint16_t));
+    GlBuffer pbo = GlBuffer::create();
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, pbo.get());
+    gpuBufferData(GL_PIXEL_UNPACK_BUFFER, pbo.get(), imageBytes, NULL, GL_STREAM_DRAW, GpuCategory::PixelBuffer);
+    uint16_t *halves = (uint16_t *)glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, imageBytes,
+                                                    GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+
+    // --- Worker: convert into the mapped buffer ---
+    if (halves) {
+        co_await resumeOnWorker();
+        StartupScope scope("hdr convert");
+        // Independent per pixel; split into 256K-pixel jobs (1 MiB of RGBE each)
+        parallelFor(0, pixels, (size_t)1 << 18, [rgbe, halves](size_t begin, size_t end) {
+            rgbeToHalfRgb(rgbe + begin * 4, halves + begin * 3, end - begin);
+        });
+    }
+    stbi_image_free(rgbe);
+
+    // --- GL thread: upload ---
+    co_await resumeOnGlThread(gl);
+    StartupScope scope("hdr upload");
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, pbo.get());
+    if (!halves || glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER) != GL_TRUE) {
+        std::cerr << "HDR texture upload failed for " << path << " (buffer mapping failed)" << std::endl;
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+        co_return 0;
+    }
+
+    unsigned int textureID;
+    glGenTextures(1, &textureID);
+    glBindTexture(GL_TEXTURE_2D, textureID);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 2); // Rows are width * 6 bytes, not always a multiple of 4
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB16F, width, height, 0, GL_RGB, GL_HALF_FLOAT, (const void *)0);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+    glGenerateMipmap(GL_TEXTURE_2D);
+    gpuTrackTexture(textureID, GL_RGB16F, width, height, 0, GpuCategory::Texture);
+
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+
+    co_return textureID;
+}
+
 // Utility function to compile a shader
 GLuint compileShader(GLenum type, const char* source) {
+    StartupScope scope(type == GL_VERTEX_SHADER ? "compile vertex shader" : "compile fragment shader");
     GLuint shader = glCreateShader(type);
     glShaderSource(shader, 1, &source, NULL);
     glCompileShader(shader);
@@ -339,6 +863,7 @@ GLuint compileShader(GLenum type, const char* source) {
 
 // Utility function to link shader program
 GLuint linkProgram(GLuint vertexShader, GLuint fragmentShader) {
+    StartupScope scope("link program");
     GLuint program = glCreateProgram();
     glAttachShader(program, vertexShader);
     glAttachShader(program, fragmentShader);
@@ -355,4 +880,17 @@ GLuint linkProgram(GLuint vertexShader, GLuint fragmentShader) {
         return 0;
     }
     return program;
+}
+
+// Utility coroutine to build the shader program on the GL thread
+// (when started there it runs to completion immediately)
+LoadTask<GLuint> loadShaderProgram(GlThreadQueue &gl, const char *vertexSource, const char *fragmentSource) {
+    co_await resumeOnGlThread(gl);
+    GLuint vertexShader = compileShader(GL_VERTEX_SHADER, vertexSource);
+    GLuint fragmentShader = compileShader(GL_FRAGMENT_SHADER, fragmentSource);
+    GLuint program = linkProgram(vertexShader, fragmentShader);
+    // Delete shaders after linking as they are no longer needed
+    glDeleteShader(vertexShader);
+    glDeleteShader(fragmentShader);
+    co_return program;
 }
\ No newline at end of file
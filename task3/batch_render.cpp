@@ -0,0 +1,346 @@
+#include "batch_render.h"
+
+#include "glad/glad.h"
+#include "common/gpu_memory.h"
+
+#include "common/ppm.h"
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <cstring>
+#include <deque>
+#include <fstream>
+#include <iostream>
+#include <mutex>
+#include <sstream>
+#include <thread>
+
+#ifdef _WIN32
+#include <direct.h>
+#else
+#include <sys/stat.h>
+#endif
+
+bool loadCameraPath(const std::string& path, std::vector<CameraKeyframe>& keys) {
+    std::ifstream in(path.c_str());
+    if (!in) {
+        std::cerr << "Failed to open camera path: " << path << std::endl;
+        return false;
+    }
+    keys.clear();
+    std::string line;
+    int lineNumber = 0;
+    while (std::getline(in, line)) {
+        lineNumber++;
+        size_t comment = line.find('#');
+        if (comment != std::string::npos) line.erase(comment);
+        std::istringstream fields(line);
+        CameraKeyframe k;
+        if (!(fields >> k.time)) continue; // blank line
+        if (!(fields >> k.eye.x >> k.eye.y >> k.eye.z >> k.target.x >> k.target.y >> k.target.z >> k.fov)) {
+            std::cerr << path << ":" << lineNumber << ": expected 8 numbers" << std::endl;
+            return false;
+        }
+        if (!keys.empty() && k.time <= keys.back().time) {
+            std::cerr << path << ":" << lineNumber << ": keyframe times must increase" << std::endl;
+            return false;
+        }
+        keys.push_back(k);
+    }
+    if (keys.empty()) {
+        std::cerr << "Camera path has no keyframes: " << path << std::endl;
+        return false;
+    }
+    return true;
+}
+
+static glm::vec3 catmullRom(const glm::vec3& p0, const glm::vec3& p1, const glm::vec3& p2, const glm::vec3& p3, float u) {
+    float u2 = u * u, u3 = u2 * u;
+    return 0.5f * (2.0f * p1 + (p2 - p0) * u + (2.0f * p0 - 5.0f * p1 + 4.0f * p2 - p3) * u2 + (3.0f * p1 - p0 - 3.0f * p2 + p3) * u3);
+}
+
+CameraKeyframe sampleCameraPath(const std::vector<CameraKeyframe>& keys, float time) {
+    CameraKeyframe result = keys.front();
+    if (keys.size() == 1 || time <= keys.front().time) {
+        result.time = time;
+        return result;
+    }
+    if (time >= keys.back().time) {
+        result = keys.back();
+        result.time = time;
+        return result;
+    }
+    size_t i = 0;
+    while (keys[i + 1].time <= time) i++;
+    const CameraKeyframe& k0 = keys[i > 0 ? i - 1 : i];
+    const CameraKeyframe& k1 = keys[i];
+    const CameraKeyframe& k2 = keys[i + 1];
+    const CameraKeyframe& k3 = keys[i + 2 < keys.size() ? i + 2 : i + 1];
+    float u = (time - k1.time) / (k2.time - k1.time);
+    result.time = time;
+    result.eye = catmullRom(k0.eye, k1.eye, k2.eye, k3.eye, u);
+    result.target = catmullRom(k0.target, k1.target, k2.target, k3.target, u);
+    result.fov = k1.fov + (k2.fov - k1.fov) * u;
+    return result;
+}
+
+namespace {
+
+typedef std::chrono::steady_clock Clock;
+
+double msSince(Clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+}
+
+// One PBO ring slot: the readback of a frame that may still be executing on the GPU
+struct ReadbackSlot {
+    GLuint pbo = 0;
+    GLuint timeQuery = 0;
+    GLsync fence = 0;
+    int frame = -1;
+};
+
+struct WriterJob {
+    int frame;
+    std::vector<unsigned char> pixels;
+};
+
+// Encodes and writes frames on its own thread; the pixel buffers are recycled through a
+// fixed-size pool so a slow disk throttles the render loop instead of growing memory.
+class FrameWriter {
+public:
+    FrameWriter(const BatchRenderOptions& options) : options_(options) {
+        for (int i = 0; i < options.writerQueue; ++i) {
+            free_.push_back(std::vector<unsigned char>((size_t)options.width * options.height * 4));
+        }
+        thread_ = std::thread(&FrameWriter::run, this);
+    }
+
+    ~FrameWriter() { finish(); }
+
+    // Blocks while every buffer is queued for writing; returns the time spent waiting
+    double acquire(std::vector<unsigned char>& buffer) {
+        Clock::time_point start = Clock::now();
+        std::unique_lock<std::mutex> lock(mutex_);
+        cv_.wait(lock, [this] { return !free_.empty(); });
+        buffer.swap(free_.back());
+        free_.pop_back();
+        return msSince(start);
+    }
+
+    // Returns an acquired buffer that will not be submitted to the pool
+    void release(std::vector<unsigned char>& buffer) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        free_.push_back(std::vector<unsigned char>());
+        free_.back().swap(buffer);
+        cv_.notify_all();
+    }
+
+    void submit(int frame, std::vector<unsigned char>& buffer) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        WriterJob job;
+        job.frame = frame;
+        job.pixels.swap(buffer);
+        jobs_.push_back(std::move(job));
+        cv_.notify_all();
+    }
+
+    void finish() {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (stopping_) return;
+            stopping_ = true;
+            cv_.notify_all();
+        }
+        thread_.join();
+    }
+
+    double encodeMs() const { return encodeMs_; }
+    double writeMs() const { return writeMs_; }
+    int failures() const { return failures_; }
+
+private:
+    void run() {
+        std::vector<unsigned char> ppm;
+        char name[64];
+        while (true) {
+            WriterJob job;
+            {
+                std::unique_lock<std::mutex> lock(mutex_);
+                cv_.wait(lock, [this] { return stopping_ || !jobs_.empty(); });
+                if (jobs_.empty()) return;
+                job = std::move(jobs_.front());
+                jobs_.pop_front();
+            }
+
+            Clock::time_point encodeStart = Clock::now();
+            encodePpm(job.pixels.data(), options_.width, options_.height, ppm);
+            encodeMs_ += msSince(encodeStart);
+
+            Clock::time_point writeStart = Clock::now();
+            std::snprintf(name, sizeof(name), "/frame_%05d.ppm", job.frame);
+            FILE* f = std::fopen((options_.outputDir + name).c_str(), "wb");
+            bool ok = f && std::fwrite(ppm.data(), 1, ppm.size(), f) == ppm.size();
+            if (f) ok = (std::fclose(f) == 0) && ok;
+            if (!ok) failures_++;
+            writeMs_ += msSince(writeStart);
+
+            std::lock_guard<std::mutex> lock(mutex_);
+            free_.push_back(std::vector<unsigned char>());
+            free_.back().swap(job.pixels);
+            cv_.notify_all();
+        }
+    }
+
+    const BatchRenderOptions& options_;
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    std::deque<WriterJob> jobs_;
+    std::vector<std::vector<unsigned char> > free_;
+    bool stopping_ = false;
+    std::thread thread_;
+    // Only touched by the writer thread until finish() joins it
+    double encodeMs_ = 0.0;
+    double writeMs_ = 0.0;
+    int failures_ = 0;
+};
+
+} // namespace
+
+bool renderCameraPath(const std::vector<CameraKeyframe>& keys, const BatchRenderOptions& options, const BatchDrawFunc& draw) {
+    if (keys.empty()) return false;
+    int lastFrame = options.lastFrame >= 0 ? options.lastFrame : (int)(keys.back().time * options.fps);
+    if (options.fps <= 0.0f || options.firstFrame > lastFrame || options.width <= 0 || options.height <= 0) {
+        std::cerr << "Nothing to render: check --frames, --fps and --size" << std::endl;
+        return false;
+    }
+#ifdef _WIN32
+    _mkdir(options.outputDir.c_str());
+#else
+    mkdir(options.outputDir.c_str(), 0755);
+#endif
+
+    const int width = options.width, height = options.height;
+    const size_t frameBytes = (size_t)width * height * 4;
+
+    GLuint fbo, colorBuffer;
+    glGenFramebuffers(1, &fbo);
+    glGenRenderbuffers(1, &colorBuffer);
+    glBindRenderbuffer(GL_RENDERBUFFER, colorBuffer);
+    gpuRenderbufferStorage(colorBuffer, GL_RGBA8, width, height);
+    glBindRenderbuffer(GL_RENDERBUFFER, 0);
+    glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, colorBuffer);
+
+    std::vector<ReadbackSlot> slots(options.framesInFlight > 0 ? options.framesInFlight : 1);
+    for (size_t i = 0; i < slots.size(); ++i) {
+        glGenBuffers(1, &slots[i].pbo);
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, slots[i].pbo);
+        gpuBufferData(GL_PIXEL_PACK_BUFFER, slots[i].pbo, (GLsizeiptr)frameBytes, nullptr, GL_STREAM_READ, GpuCategory::PixelBuffer);
+        glGenQueries(1, &slots[i].timeQuery);
+    }
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+    FrameWriter writer(options);
+    double traceMs = 0.0, readbackMs = 0.0, writerStallMs = 0.0;
+    int readbackFailures = 0;
+    std::vector<unsigned char> buffer;
+
+    // Wait for the slot's frame, copy it out of the PBO and queue it for the writer. A frame
+    // whose fence or mapping fails is reported and not written: the PBO (and the recycled
+    // writer buffer) would still hold an earlier frame
+    auto retire = [&](ReadbackSlot& slot) {
+        Clock::time_point start = Clock::now();
+        int frame = slot.frame;
+        slot.frame = -1;
+        GLenum waited = glClientWaitSync(slot.fence, GL_SYNC_FLUSH_COMMANDS_BIT, 10000000000ull);
+        glDeleteSync(slot.fence);
+        slot.fence = 0;
+        if (waited != GL_ALREADY_SIGNALED && waited != GL_CONDITION_SATISFIED) {
+            std::cerr << "Frame " << frame << ": "
+                      << (waited == GL_TIMEOUT_EXPIRED ? "GPU did not finish within 10 s" : "glClientWaitSync failed")
+                      << std::endl;
+            readbackFailures++;
+            return;
+        }
+        GLuint64 elapsedNs = 0;
+        glGetQueryObjectui64v(slot.timeQuery, GL_QUERY_RESULT, &elapsedNs);
+        traceMs += elapsedNs / 1.0e6;
+
+        double stall = writer.acquire(buffer);
+        writerStallMs += stall;
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.pbo);
+        const void* pixels = glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, (GLsizeiptr)frameBytes, GL_MAP_READ_BIT);
+        if (pixels) {
+            std::memcpy(buffer.data(), pixels, frameBytes);
+            glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+        }
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+        readbackMs += msSince(start) - stall;
+        if (!pixels) {
+            std::cerr << "Frame " << frame << ": mapping the readback buffer failed (GL error 0x"
+                      << std::hex << glGetError() << std::dec << ")" << std::endl;
+            writer.release(buffer);
+            readbackFailures++;
+            return;
+        }
+        writer.submit(frame, buffer);
+    };
+
+    Clock::time_point batchStart = Clock::now();
+    int frameCount = 0;
+    for (int frame = options.firstFrame; frame <= lastFrame; ++frame, ++frameCount) {
+        ReadbackSlot& slot = slots[frameCount % slots.size()];
+        if (slot.frame >= 0) retire(slot);
+        if (readbackFailures > 0)
+            break; // stop the batch; the frames still in flight are drained below
+
+        glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+        glViewport(0, 0, width, height);
+        glBeginQuery(GL_TIME_ELAPSED, slot.timeQuery);
+        draw(width, height, sampleCameraPath(keys, frame / options.fps));
+        glEndQuery(GL_TIME_ELAPSED);
+
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.pbo);
+        glReadPixels(0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, (void*)0);
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+        slot.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+        slot.frame = frame;
+    }
+    // Drain the ring in submission order
+    for (int i = 0; i < (int)slots.size(); ++i) {
+        ReadbackSlot& slot = slots[(frameCount + i) % slots.size()];
+        if (slot.frame >= 0) retire(slot);
+    }
+    double renderLoopMs = msSince(batchStart);
+    writer.finish();
+    double totalMs = msSince(batchStart);
+
+    for (size_t i = 0; i < slots.size(); ++i) {
+        gpuDeleteBuffers(1, &slots[i].pbo);
+        glDeleteQueries(1, &slots[i].timeQuery);
+    }
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    glDeleteFramebuffers(1, &fbo);
+    gpuDeleteRenderbuffers(1, &colorBuffer);
+
+    std::cout << "Rendered " << frameCount << " frames (" << width << "x" << height << ", " << slots.size()
+              << " in flight) to " << options.outputDir << " in " << totalMs / 1000.0 << " s: "
+              << frameCount / (totalMs / 1000.0) << " frames/s" << std::endl;
+    std::cout << "  per frame (ms): trace " << traceMs / frameCount
+              << ", readback " << readbackMs / frameCount
+              << ", encode " << writer.encodeMs() / frameCount
+              << ", write " << writer.writeMs() / frameCount << std::endl;
+    std::cout << "  render loop " << renderLoopMs / 1000.0 << " s, waited on writer " << writerStallMs / 1000.0 << " s" << std::endl;
+    gpuMemory().printBreakdown(std::cout);
+    if (readbackFailures > 0) {
+        std::cerr << "Batch stopped: " << readbackFailures << " frames could not be read back" << std::endl;
+        return false;
+    }
+    if (writer.failures() > 0) {
+        std::cerr << writer.failures() << " frames could not be written" << std::endl;
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,46 @@
+#ifndef TASK3_BATCH_RENDER_H
+#define TASK3_BATCH_RENDER_H
+
+#include <glm/glm.hpp>
+
+#include <functional>
+#include <string>
+#include <vector>
+
+// Offline rendering of a camera flythrough: every frame of the path is traced into an
+// offscreen framebuffer, read back through a ring of PBOs (several frames in flight) and
+// handed to a writer thread that encodes and saves it, so tracing, readback and encoding overlap.
+
+struct CameraKeyframe {
+    float time;        // seconds
+    glm::vec3 eye;
+    glm::vec3 target;
+    float fov;         // vertical, degrees
+};
+
+// Path file: one keyframe per line, "time eye.x eye.y eye.z target.x target.y target.z fov",
+// '#' starts a comment. Keyframes must be in increasing time order.
+bool loadCameraPath(const std::string& path, std::vector<CameraKeyframe>& keys);
+
+// Catmull-Rom through eye and target positions, linear fov; clamps outside the path
+CameraKeyframe sampleCameraPath(const std::vector<CameraKeyframe>& keys, float time);
+
+struct BatchRenderOptions {
+    int width = 1280;
+    int height = 720;
+    float fps = 30.0f;
+    int firstFrame = 0;
+    int lastFrame = -1;        // inclusive, -1 = end of the path
+    int framesInFlight = 3;    // PBO ring size
+    int writerQueue = 8;       // frames buffered for the writer before the render loop waits
+    std::string outputDir = "frames";
+};
+
+// Draws one frame into the bound framebuffer (viewport already set)
+typedef std::function<void(int width, int height, const CameraKeyframe& camera)> BatchDrawFunc;
+
+// Renders the frame range, writes outputDir/frame_NNNNN.ppm and prints throughput and the
+// trace / readback / encode time split. Needs a current GL context.
+bool renderCameraPath(const std::vector<CameraKeyframe>& keys, const BatchRenderOptions& options, const BatchDrawFunc& draw);
+
+#endif
@@ -0,0 +1,191 @@
+#include "sphere_grid.h"
+
+#include "glad/glad.h"
+#include "common/gpu_memory.h"
+#include "common/job_system.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <iostream>
+#include <random>
+
+namespace {
+
+typedef std::chrono::steady_clock Clock;
+
+double msSince(Clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+}
+
+// Splits [0, count) into the same contiguous chunks on every call and runs one job per chunk
+// on the shared job system. fn gets the chunk index, not a thread, so per-chunk state lines up
+// between calls whichever thread picks the job up
+template <typename Fn>
+void parallelChunks(int chunks, size_t count, const Fn& fn) {
+    if (chunks == 1) {
+        fn(0, 0, count);
+        return;
+    }
+    size_t chunk = (count + chunks - 1) / chunks;
+    JobGroup group;
+    for (int c = 0; c < chunks; ++c) {
+        size_t begin = std::min(count, c * chunk);
+        size_t end = std::min(count, begin + chunk);
+        group.add([&fn, c, begin, end]() { fn(c, begin, end); });
+    }
+    group.wait();
+}
+
+} // namespace
+
+SphereGrid::SphereGrid(int count, unsigned seed, int chunks)
+    : boundsMin_(-3.0f, -1.5f, -1.9f), boundsMax_(3.0f, 1.5f, 1.5f) {
+    count = std::max(count, 1);
+    glm::vec3 extent = boundsMax_ - boundsMin_;
+
+    // About one sphere per cell; spheres are a bit smaller than a cell so most overlap few cells
+    float cellEdge = std::cbrt(extent.x * extent.y * extent.z / count);
+    resolution_ = glm::clamp(glm::ivec3(glm::ceil(extent / cellEdge)), glm::ivec3(1), glm::ivec3(256));
+    cellSize_ = extent / glm::vec3(resolution_);
+
+    // Scheduling is not worth it below a few thousand spheres per chunk
+    chunks_ = chunks > 0 ? chunks : jobSystem().threadCount();
+    chunks_ = std::max(1, std::min(chunks_, count / 2048));
+
+    std::mt19937 rng(seed);
+    std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+    spheres_.resize(count);
+    velocities_.resize(count);
+    for (int i = 0; i < count; ++i) {
+        float radius = cellEdge * (0.25f + 0.15f * unit(rng));
+        glm::vec3 p(unit(rng), unit(rng), unit(rng));
+        glm::vec3 center = boundsMin_ + glm::vec3(radius) + p * (extent - glm::vec3(2.0f * radius));
+        spheres_[i] = glm::vec4(center, radius);
+        glm::vec3 dir(unit(rng) - 0.5f, unit(rng) - 0.5f, unit(rng) - 0.5f);
+        velocities_[i] = glm::normalize(dir + glm::vec3(1e-4f)) * (0.3f + 0.9f * unit(rng));
+    }
+    cellOffsets_.assign((size_t)resolution_.x * resolution_.y * resolution_.z + 1, 0);
+
+    GLint maxTexels = 0;
+    glGetIntegerv(GL_MAX_TEXTURE_BUFFER_SIZE, &maxTexels);
+    if ((size_t)maxTexels < cellOffsets_.size() || (size_t)maxTexels < (size_t)count * 8)
+        std::cerr << "SphereGrid: " << count << " spheres may exceed GL_MAX_TEXTURE_BUFFER_SIZE (" << maxTexels << ")" << std::endl;
+
+    const GLenum formats[3] = { GL_R32UI, GL_R32UI, GL_RGBA32F };
+    glGenBuffers(3, buffers_);
+    glGenTextures(3, textures_);
+    for (int i = 0; i < 3; ++i) {
+        glBindBuffer(GL_TEXTURE_BUFFER, buffers_[i]);
+        gpuBufferData(GL_TEXTURE_BUFFER, buffers_[i], 16, NULL, GL_STREAM_DRAW, GpuCategory::StorageBuffer);
+        glBindTexture(GL_TEXTURE_BUFFER, textures_[i]);
+        glTexBuffer(GL_TEXTURE_BUFFER, formats[i], buffers_[i]);
+    }
+    glBindTexture(GL_TEXTURE_BUFFER, 0);
+    glBindBuffer(GL_TEXTURE_BUFFER, 0);
+}
+
+SphereGrid::~SphereGrid() {
+    glDeleteTextures(3, textures_);
+    gpuDeleteBuffers(3, buffers_);
+}
+
+glm::ivec3 SphereGrid::cellOf(const glm::vec3& p) const {
+    glm::ivec3 cell(glm::floor((p - boundsMin_) / cellSize_));
+    return glm::clamp(cell, glm::ivec3(0), resolution_ - 1);
+}
+
+void SphereGrid::update(float dt) {
+    const size_t cells = cellCount();
+    const size_t count = spheres_.size();
+    const int rowStride = resolution_.x;
+    const int sliceStride = resolution_.x * resolution_.y;
+
+    // Phase 1: move, then count cell overlaps into this chunk's own row
+    Clock::time_point start = Clock::now();
+    chunkCells_.assign((size_t)chunks_ * cells, 0);
+    parallelChunks(chunks_, count, [&](int chunk, size_t begin, size_t end) {
+        uint32_t* counts = &chunkCells_[chunk * cells];
+        for (size_t i = begin; i < end; ++i) {
+            glm::vec4& s = spheres_[i];
+            glm::vec3& v = velocities_[i];
+            glm::vec3 c = glm::vec3(s) + v * dt;
+            for (int a = 0; a < 3; ++a) {
+                if (c[a] < boundsMin_[a] + s.w) { c[a] = boundsMin_[a] + s.w; v[a] = std::fabs(v[a]); }
+                if (c[a] > boundsMax_[a] - s.w) { c[a] = boundsMax_[a] - s.w; v[a] = -std::fabs(v[a]); }
+            }
+            s = glm::vec4(c, s.w);
+
+            glm::ivec3 lo = cellOf(c - glm::vec3(s.w)), hi = cellOf(c + glm::vec3(s.w));
+            for (int z = lo.z; z <= hi.z; ++z)
+                for (int y = lo.y; y <= hi.y; ++y)
+                    for (int x = lo.x; x <= hi.x; ++x)
+                        counts[z * sliceStride + y * rowStride + x]++;
+        }
+    });
+    stats_.moveCountMs = msSince(start);
+
+    // Phase 2: cell offsets, and per chunk a cursor inside each cell's range
+    start = Clock::now();
+    uint32_t running = 0;
+    for (size_t c = 0; c < cells; ++c) {
+        cellOffsets_[c] = running;
+        for (int k = 0; k < chunks_; ++k) {
+            uint32_t& slot = chunkCells_[k * cells + c];
+            uint32_t n = slot;
+            slot = running;
+            running += n;
+        }
+    }
+    cellOffsets_[cells] = running;
+    sphereIndices_.resize(running);
+    stats_.prefixMs = msSince(start);
+
+    // Phase 3: same chunks as phase 1, so every cursor receives exactly the spheres it counted
+    start = Clock::now();
+    parallelChunks(chunks_, count, [&](int chunk, size_t begin, size_t end) {
+        uint32_t* cursors = &chunkCells_[chunk * cells];
+        for (size_t i = begin; i < end; ++i) {
+            glm::vec3 c(spheres_[i]);
+            float r = spheres_[i].w;
+            glm::ivec3 lo = cellOf(c - glm::vec3(r)), hi = cellOf(c + glm::vec3(r));
+            for (int z = lo.z; z <= hi.z; ++z)
+                for (int y = lo.y; y <= hi.y; ++y)
+                    for (int x = lo.x; x <= hi.x; ++x)
+                        sphereIndices_[cursors[z * sliceStride + y * rowStride + x]++] = (uint32_t)i;
+        }
+    });
+    stats_.scatterMs = msSince(start);
+}
+
+void SphereGrid::upload() {
+    Clock::time_point start = Clock::now();
+    const void* data[3] = { cellOffsets_.data(), sphereIndices_.data(), spheres_.data() };
+    const size_t sizes[3] = { cellOffsets_.size() * sizeof(uint32_t), sphereIndices_.size() * sizeof(uint32_t),
+                              spheres_.size() * sizeof(glm::vec4) };
+    for (int i = 0; i < 3; ++i) {
+        // Orphan so the driver does not wait for last frame's trace to finish reading
+        glBindBuffer(GL_TEXTURE_BUFFER, buffers_[i]);
+        gpuBufferData(GL_TEXTURE_BUFFER, buffers_[i], sizes[i], NULL, GL_STREAM_DRAW, GpuCategory::StorageBuffer);
+        glBufferSubData(GL_TEXTURE_BUFFER, 0, sizes[i], data[i]);
+    }
+    glBindBuffer(GL_TEXTURE_BUFFER, 0);
+    stats_.uploadMs = msSince(start);
+}
+
+void SphereGrid::bind() const {
+    const int units[3] = { kGridOffsetsUnit, kGridIndicesUnit, kGridSpheresUnit };
+    for (int i = 0; i < 3; ++i) {
+        glActiveTexture(GL_TEXTURE0 + units[i]);
+        glBindTexture(GL_TEXTURE_BUFFER, textures_[i]);
+    }
+    glActiveTexture(GL_TEXTURE0);
+}
+
+void SphereGrid::setUniforms(unsigned int program) const {
+    glUniform3f(glGetUniformLocation(program, "gridMin"), boundsMin_.x, boundsMin_.y, boundsMin_.z);
+    glUniform3f(glGetUniformLocation(program, "gridMax"), boundsMax_.x, boundsMax_.y, boundsMax_.z);
+    glUniform3f(glGetUniformLocation(program, "gridCellSize"), cellSize_.x, cellSize_.y, cellSize_.z);
+    glUniform3i(glGetUniformLocation(program, "gridRes"), resolution_.x, resolution_.y, resolution_.z);
+    glUniform1i(glGetUniformLocation(program, "gridSphereCount"), (int)spheres_.size());
+}
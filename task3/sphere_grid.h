@@ -0,0 +1,72 @@
+#ifndef TASK3_SPHERE_GRID_H
+#define TASK3_SPHERE_GRID_H
+
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <vector>
+
+// Fully dynamic scene of small spheres bouncing inside a box. Every frame the spheres move
+// and a uniform grid over the box is rebuilt from scratch with a parallel counting sort:
+//   1. a job per chunk of spheres moves them and counts, per cell, the spheres overlapping it
+//   2. a prefix sum over cells (and over chunks within a cell) gives every chunk its own
+//      write cursor per cell
+//   3. a job per chunk, over the same chunks, scatters its sphere indices to those cursors
+// O(n + cells), no atomics, and the output order does not depend on thread timing. The grid
+// goes to the GPU as three texture buffers (cell offsets, sphere indices, sphere data) that
+// the tracer walks with a 3D-DDA.
+
+// Texture units the grid buffers are bound to; the scene shader's samplers point at these
+const int kGridOffsetsUnit = 1;
+const int kGridIndicesUnit = 2;
+const int kGridSpheresUnit = 3;
+
+class SphereGrid {
+public:
+    struct Stats {
+        double moveCountMs = 0.0;  // phase 1
+        double prefixMs = 0.0;     // phase 2
+        double scatterMs = 0.0;    // phase 3
+        double uploadMs = 0.0;
+        double buildMs() const { return moveCountMs + prefixMs + scatterMs; }
+    };
+
+    // The rebuild runs as one job per chunk on jobSystem(); chunks = 0 uses one per job system thread
+    SphereGrid(int count, unsigned seed = 1, int chunks = 0);
+    ~SphereGrid();
+
+    // Moves the spheres by dt seconds and rebuilds the grid (CPU only)
+    void update(float dt);
+    // Copies the grid into the texture buffers; needs a current GL context
+    void upload();
+    // Binds the texture buffers to kGrid*Unit
+    void bind() const;
+    // Grid uniforms for the scene shader (program already in use)
+    void setUniforms(unsigned int program) const;
+
+    const Stats& stats() const { return stats_; }
+    size_t sphereCount() const { return spheres_.size(); }
+    size_t cellCount() const { return cellOffsets_.size() - 1; }
+    size_t referenceCount() const { return cellOffsets_.back(); }
+
+private:
+    glm::ivec3 cellOf(const glm::vec3& p) const;
+
+    glm::vec3 boundsMin_;
+    glm::vec3 boundsMax_;
+    glm::vec3 cellSize_;
+    glm::ivec3 resolution_;
+    int chunks_;
+
+    std::vector<glm::vec4> spheres_;      // xyz center, w radius
+    std::vector<glm::vec3> velocities_;
+    std::vector<uint32_t> chunkCells_;    // chunks_ x cells: counts, then write cursors
+    std::vector<uint32_t> cellOffsets_;   // cells + 1
+    std::vector<uint32_t> sphereIndices_;
+
+    unsigned int buffers_[3];             // offsets, indices, spheres
+    unsigned int textures_[3];
+    Stats stats_;
+};
+
+#endif
@@ -4,8 +4,29 @@
 #include <glm/gtc/matrix_transform.hpp>
 #include <glm/gtc/type_ptr.hpp>
 
+#include "batch_render.h"
+#include "sphere_grid.h"
+#include "wavefront.h"
+#include "common/gl43.h"
+#include "common/gl_handle.h"
+#include "common/gpu_memory.h"
+#include "common/input_trace.h"
+#include "common/latency.h"
+#include "common/metrics_exporter.h"
+#include "common/startup_profile.h"
+#ifndef _WIN32
+#include "common/render_server.h"
+#endif
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
 #include <iostream>
+#include <memory>
 #include <string>
+#include <thread>
 #include <vector>
 
 #ifndef M_PI
@@ -16,6 +37,18 @@
 const unsigned int SCR_WIDTH = 800;
 const unsigned int SCR_HEIGHT = 600;
 
+// The scene is static, so with --on-demand a frame is traced only when the window
+// or the camera changed; otherwise the loop blocks in glfwWaitEvents.
+bool sceneDirty = true;
+
+// Orbit camera around the origin (arrow keys), starts at (0, 0.5, 4)
+float cameraYaw = 0.0f;
+float cameraPitch = atanf(0.5f / 4.0f);
+float cameraDistance = sqrtf(0.5f * 0.5f + 4.0f * 4.0f);
+
+// Moving spheres added with --spheres N (owned by main), nullptr for the static scene
+SphereGrid* dynamicSpheres = nullptr;
+
 
 const char *vertexShaderSource = R"(
     #version 330 core
@@ -31,11 +64,9 @@ const char *vertexShaderSource = R"(
     }
 )";
 
-const char *fragmentShaderSource = R"(
-    #version 330 core
-    out vec4 FragColor;
-    in vec2 TexCoords; 
-
+// Scene description shared by the fragment tracer and the wavefront compute stages
+// (no #version, each user prepends its own)
+const char *sceneShaderSource = R"(
     uniform vec2 iResolution;
 
     
@@ -61,8 +92,8 @@ const char *fragmentShaderSource = R"(
     uniform vec3 checkerColor2;
     uniform float checkerScale;
 
-    const int MAX_BOUNCES = 3; 
     const float EPSILON = 0.001; 
+    const vec3 BACKGROUND = vec3(0.1, 0.1, 0.15);
 
     
     
@@ -131,98 +162,303 @@ const char *fragmentShaderSource = R"(
         return -1.0;
     }
 
-    void main()
-    {
-        
-        
-        vec2 uv_centered = (2.0 * gl_FragCoord.xy - iResolution.xy) / iResolution.y; 
+    // Dynamic spheres in a uniform grid (see sphere_grid.h). Cell c holds the sphere indices
+    // gridIndices[gridOffsets[c] .. gridOffsets[c + 1]); gridSpheres is xyz center, w radius.
+    uniform usamplerBuffer gridOffsets;
+    uniform usamplerBuffer gridIndices;
+    uniform samplerBuffer gridSpheres;
+    uniform vec3 gridMin;
+    uniform vec3 gridMax;
+    uniform vec3 gridCellSize;
+    uniform ivec3 gridRes;
+    uniform int gridSphereCount; 
+    uniform vec3 gridSphereColor;
+
+    // 3D-DDA: visit the cells along the ray in order and stop at the first cell whose range
+    // contains the nearest hit found so far (a sphere spans several cells, so a hit beyond the
+    // current cell may still be beaten by one in a later cell)
+    float traverseGrid(vec3 ro, vec3 rd, float tMax, out vec3 outHitNormal) {
+        vec3 dir = rd + vec3(equal(rd, vec3(0.0))) * 1e-8;
+        vec3 invDir = 1.0 / dir;
+        vec3 t0 = (gridMin - ro) * invDir;
+        vec3 t1 = (gridMax - ro) * invDir;
+        vec3 tmin3 = min(t0, t1);
+        vec3 tmax3 = max(t0, t1);
+        float tEnter = max(max(tmin3.x, tmin3.y), max(tmin3.z, 0.0));
+        float tExit = min(min(tmax3.x, tmax3.y), min(tmax3.z, tMax));
+        if (tEnter > tExit) return -1.0;
+
+        vec3 entry = ro + rd * tEnter;
+        ivec3 cell = clamp(ivec3(floor((entry - gridMin) / gridCellSize)), ivec3(0), gridRes - 1);
+        ivec3 cellStep = ivec3(sign(dir));
+        vec3 tNext = (gridMin + (vec3(cell) + step(0.0, dir)) * gridCellSize - ro) * invDir;
+        vec3 tDelta = abs(gridCellSize * invDir);
+
+        float tBest = tMax;
+        vec3 bestCenter = vec3(0.0);
+        int maxSteps = gridRes.x + gridRes.y + gridRes.z;
+        for (int i = 0; i < maxSteps; ++i) {
+            int cellIndex = (cell.z * gridRes.y + cell.y) * gridRes.x + cell.x;
+            int first = int(texelFetch(gridOffsets, cellIndex).r);
+            int last = int(texelFetch(gridOffsets, cellIndex + 1).r);
+            for (int k = first; k < last; ++k) {
+                vec4 sphere = texelFetch(gridSpheres, int(texelFetch(gridIndices, k).r));
+                float t = intersectSphere(ro, rd, sphere.xyz, sphere.w);
+                if (t > EPSILON && t < tBest) {
+                    tBest = t;
+                    bestCenter = sphere.xyz;
+                }
+            }
+
+            float cellExit = min(min(tNext.x, tNext.y), tNext.z);
+            if (tBest <= cellExit || cellExit >= tExit) break;
+            if (tNext.x < tNext.y && tNext.x < tNext.z) {
+                cell.x += cellStep.x;
+                tNext.x += tDelta.x;
+            } else if (tNext.y < tNext.z) {
+                cell.y += cellStep.y;
+                tNext.y += tDelta.y;
+            } else {
+                cell.z += cellStep.z;
+                tNext.z += tDelta.z;
+            }
+            if (any(lessThan(cell, ivec3(0))) || any(greaterThanEqual(cell, gridRes))) break;
+        }
+        if (tBest >= tMax) return -1.0;
+        outHitNormal = normalize(ro + rd * tBest - bestCenter);
+        return tBest;
+    }
+
+    // Camera ray through a pixel position in window coordinates (pixel centers at .5)
+    vec3 primaryRayDir(vec2 pixel) {
+        vec2 uv_centered = (2.0 * pixel - iResolution.xy) / iResolution.y; 
 
-        
         vec3 camForward = normalize(cameraTarget - cameraPos);
         vec3 camRight = normalize(cross(camForward, cameraUp));
         vec3 camActualUp = normalize(cross(camRight, camForward)); 
         
         float focalLength = 1.0 / tan(radians(cameraFov) * 0.5);
-        vec3 rayDir = normalize(uv_centered.x * camRight + uv_centered.y * camActualUp + focalLength * camForward);
-        vec3 rayOrigin = cameraPos;
+        return normalize(uv_centered.x * camRight + uv_centered.y * camActualUp + focalLength * camForward);
+    }
 
-        
-        vec3 finalColor = vec3(0.0);
-        float transmission = 1.0; 
+    // Nearest hit: 1 sphere, 2 cube, 3 checker plane, 4 grid sphere, 0 nothing.
+    // The plane is only tested when no object is hit.
+    int intersectScene(vec3 ro, vec3 rd, out float t_hit, out vec3 hitNormal) {
+        t_hit = 1e20; 
+        hitNormal = vec3(0.0);
+        int hitType = 0; 
 
-        vec3 currentRayOrigin = rayOrigin;
-        vec3 currentRayDir = rayDir;
+        float t_sphere = intersectSphere(ro, rd, sphereCenter, sphereRadius);
+        if (t_sphere > EPSILON && t_sphere < t_hit) {
+            t_hit = t_sphere;
+            hitNormal = normalize((ro + rd * t_sphere) - sphereCenter);
+            hitType = 1;
+        }
 
-        for (int i = 0; i < MAX_BOUNCES; ++i) {
-            if (transmission < 0.01) break; 
+        vec3 cubeHitNormal;
+        float t_cube = intersectAABB(ro, rd, cubeMin, cubeMax, cubeHitNormal);
+        if (t_cube > EPSILON && t_cube < t_hit) {
+            t_hit = t_cube;
+            hitNormal = cubeHitNormal;
+            hitType = 2;
+        }
 
-            float t_hit = 1e20; 
-            vec4 hitObjectColorAlpha = vec4(0.0); 
-            vec3 hitNormal = vec3(0.0);
-            int hitType = 0; 
+        if (gridSphereCount > 0) {
+            vec3 gridHitNormal;
+            float t_grid = traverseGrid(ro, rd, t_hit, gridHitNormal);
+            if (t_grid > 0.0) {
+                t_hit = t_grid;
+                hitNormal = gridHitNormal;
+                hitType = 4;
+            }
+        }
 
-            
-            float t_sphere = intersectSphere(currentRayOrigin, currentRayDir, sphereCenter, sphereRadius);
-            if (t_sphere > EPSILON && t_sphere < t_hit) {
-                t_hit = t_sphere;
-                hitObjectColorAlpha = sphereColorAlpha;
-                hitNormal = normalize((currentRayOrigin + currentRayDir * t_sphere) - sphereCenter);
-                hitType = 1;
+        if (hitType == 0) {
+            float t_plane = intersectPlane(ro, rd, planeNormal, planeD);
+            if (t_plane > EPSILON) {
+                t_hit = t_plane;
+                hitNormal = planeNormal;
+                hitType = 3;
             }
+        }
+        return hitType;
+    }
 
-            
-            vec3 cubeHitNormal;
-            float t_cube = intersectAABB(currentRayOrigin, currentRayDir, cubeMin, cubeMax, cubeHitNormal);
-            if (t_cube > EPSILON && t_cube < t_hit) {
-                t_hit = t_cube;
-                hitObjectColorAlpha = cubeColorAlpha;
-                hitNormal = cubeHitNormal;
-                hitType = 2;
+    vec3 checkerColorAt(vec3 planeHitPoint) {
+        vec2 boardCoords;
+        
+        if (abs(planeNormal.z) > 0.99) { 
+            boardCoords = planeHitPoint.xy;
+        } else if (abs(planeNormal.y) > 0.99) { 
+            boardCoords = planeHitPoint.xz;
+        } else { 
+            boardCoords = planeHitPoint.yz;
+        }
+
+        float pattern = mod(floor(boardCoords.x * checkerScale) + floor(boardCoords.y * checkerScale), 2.0);
+        return (pattern < 0.5) ? checkerColor1 : checkerColor2;
+    }
+
+    // Legacy look (pathTrace == 0): objects are alpha-blended layers, the ray passes straight
+    // through. Path tracing (pathTrace == 1): the sphere is tinted glass, cube and checker wall
+    // are diffuse, light comes from the sky.
+    uniform int pathTrace;
+    uniform int russianRoulette;
+    uniform uint frameIndex;
+
+    const float GLASS_IOR = 1.5;
+    const int ROULETTE_MIN_DEPTH = 2;
+
+    uint pcgHash(uint v) {
+        uint state = v * 747796405u + 2891336453u;
+        uint word = ((state >> ((state >> 28u) + 4u)) ^ state) * 277803737u;
+        return (word >> 22u) ^ word;
+    }
+
+    uint seedRng(uint pixel) {
+        return pcgHash(pixel ^ pcgHash(frameIndex));
+    }
+
+    float nextRandom(inout uint rng) {
+        rng = pcgHash(rng);
+        return float(rng >> 8) * (1.0 / 16777216.0);
+    }
+
+    vec3 skyColor(vec3 dir) {
+        return mix(vec3(1.0), vec3(0.5, 0.7, 1.0), 0.5 * (dir.y + 1.0));
+    }
+
+    vec3 cosineSampleHemisphere(vec3 n, inout uint rng) {
+        float u1 = nextRandom(rng);
+        float u2 = nextRandom(rng);
+        float r = sqrt(u1);
+        float phi = 6.28318530718 * u2;
+        vec3 tangent = normalize(abs(n.x) > 0.5 ? cross(n, vec3(0.0, 1.0, 0.0)) : cross(n, vec3(1.0, 0.0, 0.0)));
+        vec3 bitangent = cross(n, tangent);
+        return normalize(r * cos(phi) * tangent + r * sin(phi) * bitangent + sqrt(max(0.0, 1.0 - u1)) * n);
+    }
+
+    float fresnelSchlick(float cosTheta, float etaI, float etaT) {
+        float r0 = (etaI - etaT) / (etaI + etaT);
+        r0 *= r0;
+        return r0 + (1.0 - r0) * pow(1.0 - cosTheta, 5.0);
+    }
+
+    // One path vertex: adds light reaching the eye to color, updates throughput and moves the ray
+    // to the continuation. Returns false when the path ends. depth counts segments traced before this one.
+    bool scatter(int hitType, vec3 hitPoint, vec3 hitNormal, inout vec3 rayOrigin, inout vec3 rayDir,
+                 inout vec3 throughput, inout vec3 color, int depth, inout uint rng) {
+        if (pathTrace == 0) {
+            if (hitType == 4) {
+                // Opaque; shaded by facing ratio so the small spheres read as round
+                color += throughput * gridSphereColor * (0.3 + 0.7 * abs(dot(hitNormal, rayDir)));
+                return false;
+            }
+            if (hitType == 1 || hitType == 2) { 
+                vec4 hitObjectColorAlpha = (hitType == 1) ? sphereColorAlpha : cubeColorAlpha;
+                color += throughput * hitObjectColorAlpha.rgb * hitObjectColorAlpha.a;
+                throughput *= (1.0 - hitObjectColorAlpha.a);
+                rayOrigin = hitPoint + rayDir * (EPSILON * 2.0); 
+                return throughput.x >= 0.01;
             }
+            color += throughput * ((hitType == 3) ? checkerColorAt(hitPoint) : BACKGROUND);
+            return false;
+        }
 
-            if (hitType > 0) { 
-                
-                
-                
-                
-                vec3 litColor = hitObjectColorAlpha.rgb; 
-
-                finalColor += transmission * litColor * hitObjectColorAlpha.a;
-                transmission *= (1.0 - hitObjectColorAlpha.a);
-                currentRayOrigin = currentRayOrigin + currentRayDir * (t_hit + EPSILON * 2.0); 
-            } else { 
-                float t_plane = intersectPlane(currentRayOrigin, currentRayDir, planeNormal, planeD);
-                if (t_plane > EPSILON) {
-                    vec3 planeHitPoint = currentRayOrigin + currentRayDir * t_plane;
-                    vec2 boardCoords;
-                    
-                    if (abs(planeNormal.z) > 0.99) { 
-                        boardCoords = planeHitPoint.xy;
-                    } else if (abs(planeNormal.y) > 0.99) { 
-                        boardCoords = planeHitPoint.xz;
-                    } else { 
-                        boardCoords = planeHitPoint.yz;
-                    }
-
-                    float pattern = mod(floor(boardCoords.x * checkerScale) + floor(boardCoords.y * checkerScale), 2.0);
-                    vec3 checkerCol = (pattern < 0.5) ? checkerColor1 : checkerColor2;
-                    finalColor += transmission * checkerCol;
-                } else {
-                    
-                    finalColor += transmission * vec3(0.1, 0.1, 0.15); 
-                }
-                break; 
+        if (hitType == 0) {
+            color += throughput * skyColor(rayDir);
+            return false;
+        }
+
+        bool entering = dot(rayDir, hitNormal) < 0.0;
+        vec3 n = entering ? hitNormal : -hitNormal;
+        if (hitType == 1) {
+            // Dielectric: reflect with the Fresnel probability, otherwise refract (or total internal reflection)
+            float etaI = entering ? 1.0 : GLASS_IOR;
+            float etaT = entering ? GLASS_IOR : 1.0;
+            float cosTheta = min(dot(-rayDir, n), 1.0);
+            vec3 refracted = refract(rayDir, n, etaI / etaT);
+            bool totalReflection = dot(refracted, refracted) == 0.0;
+            if (totalReflection || nextRandom(rng) < fresnelSchlick(cosTheta, etaI, etaT)) {
+                rayDir = reflect(rayDir, n);
+                rayOrigin = hitPoint + n * (EPSILON * 2.0);
+            } else {
+                rayDir = normalize(refracted);
+                rayOrigin = hitPoint - n * (EPSILON * 2.0);
+                throughput *= sphereColorAlpha.rgb;
             }
+        } else {
+            vec3 albedo = (hitType == 2) ? cubeColorAlpha.rgb
+                        : (hitType == 4) ? gridSphereColor : checkerColorAt(hitPoint);
+            rayDir = cosineSampleHemisphere(n, rng);
+            rayOrigin = hitPoint + n * (EPSILON * 2.0);
+            throughput *= albedo;
+        }
+
+        // Russian roulette: keep the path with probability tied to its throughput and
+        // reweight survivors, so the estimate stays unbiased while dim paths end early
+        if (russianRoulette != 0 && depth >= ROULETTE_MIN_DEPTH) {
+            float survive = clamp(max(throughput.r, max(throughput.g, throughput.b)), 0.05, 1.0);
+            if (nextRandom(rng) >= survive) return false;
+            throughput /= survive;
         }
-        FragColor = vec4(finalColor, 1.0); 
+        return true;
+    }
+)";
+
+const char *fragmentShaderSource = R"(
+    out vec4 FragColor;
+    in vec2 TexCoords; 
+
+    uniform int maxBounces; 
+
+    void main()
+    {
+        vec3 finalColor = vec3(0.0);
+        vec3 throughput = vec3(1.0); 
+        uint rng = seedRng(uint(gl_FragCoord.y) * uint(iResolution.x) + uint(gl_FragCoord.x));
+
+        vec3 currentRayOrigin = cameraPos;
+        vec3 currentRayDir = primaryRayDir(gl_FragCoord.xy);
+
+        int segments = 0;
+        for (int i = 0; i < maxBounces; ++i) {
+            float t_hit;
+            vec3 hitNormal;
+            int hitType = intersectScene(currentRayOrigin, currentRayDir, t_hit, hitNormal);
+            ++segments;
+            if (!scatter(hitType, currentRayOrigin + currentRayDir * t_hit, hitNormal,
+                         currentRayOrigin, currentRayDir, throughput, finalColor, i, rng))
+                break;
+        }
+        // In path-trace mode alpha carries the path length, summed by the accumulation blend
+        FragColor = vec4(finalColor, pathTrace != 0 ? float(segments) : 1.0); 
+    }
+)";
+
+const char *resolveFragmentShaderSource = R"(
+    #version 330 core
+    out vec4 FragColor;
+    in vec2 TexCoords;
+
+    uniform sampler2D accumulation;
+    uniform float sampleCount;
+
+    void main()
+    {
+        FragColor = vec4(texture(accumulation, TexCoords).rgb / sampleCount, 1.0);
     }
 )";
 
 void framebuffer_size_callback(GLFWwindow* window, int width, int height);
-void processInput(GLFWwindow *window);
+void window_refresh_callback(GLFWwindow* window);
+void key_callback(GLFWwindow* window, int key, int scancode, int action, int mods);
+bool cameraKeysHeld(GLFWwindow *window);
+bool processInput(GLFWwindow *window, float deltaTime);
 
 
 unsigned int compileShader(GLenum type, const char* source) {
+    StartupScope scope(type == GL_VERTEX_SHADER ? "compile vertex shader" : "compile fragment shader");
     unsigned int shader = glCreateShader(type);
     glShaderSource(shader, 1, &source, NULL);
     glCompileShader(shader);
@@ -238,6 +474,7 @@ unsigned int compileShader(GLenum type, const char* source) {
 
 
 unsigned int createShaderProgram(unsigned int vertexShader, unsigned int fragmentShader) {
+    StartupScope scope("link program");
     unsigned int program = glCreateProgram();
     glAttachShader(program, vertexShader);
     glAttachShader(program, fragmentShader);
@@ -253,40 +490,494 @@ unsigned int createShaderProgram(unsigned int vertexShader, unsigned int fragmen
 }
 
 
-int main() {
+// Per-frame tracing parameters, shared by the fragment tracer and the wavefront stages
+struct TraceSettings {
+    int maxBounces;
+    bool pathTrace;          // physically based materials instead of the alpha-blended look
+    bool russianRoulette;    // path tracing only
+    unsigned int frameIndex; // seeds the per-pixel random numbers
+    TraceSettings() : maxBounces(3), pathTrace(false), russianRoulette(true), frameIndex(0) {}
+};
+
+void setTraceUniforms(unsigned int shaderProgram, const TraceSettings& trace) {
+    glUniform1i(glGetUniformLocation(shaderProgram, "maxBounces"), trace.maxBounces);
+    glUniform1i(glGetUniformLocation(shaderProgram, "pathTrace"), trace.pathTrace ? 1 : 0);
+    glUniform1i(glGetUniformLocation(shaderProgram, "russianRoulette"), trace.russianRoulette ? 1 : 0);
+    glUniform1ui(glGetUniformLocation(shaderProgram, "frameIndex"), trace.frameIndex);
+}
+
+
+// Camera and scene uniforms, shared by the fragment tracer and the wavefront stages
+void setSceneUniforms(unsigned int shaderProgram, int width, int height,
+                      const glm::vec3& camPos, const glm::vec3& camTarget, float fov) {
+    glUniform2f(glGetUniformLocation(shaderProgram, "iResolution"), (float)width, (float)height);
+    
+    
+    glm::vec3 camUp = glm::vec3(0.0f, 1.0f, 0.0f);
+    glUniform3fv(glGetUniformLocation(shaderProgram, "cameraPos"), 1, glm::value_ptr(camPos));
+    glUniform3fv(glGetUniformLocation(shaderProgram, "cameraTarget"), 1, glm::value_ptr(camTarget));
+    glUniform3fv(glGetUniformLocation(shaderProgram, "cameraUp"), 1, glm::value_ptr(camUp));
+    glUniform1f(glGetUniformLocation(shaderProgram, "cameraFov"), fov); 
+
+    
+    glm::vec3 sCenter(-0.8f, 0.0f, 0.0f); 
+    float sRadius = 0.7f;
+    glm::vec4 sColorAlpha(1.0f, 0.3f, 0.3f, 0.5f); 
+    glUniform3fv(glGetUniformLocation(shaderProgram, "sphereCenter"), 1, glm::value_ptr(sCenter));
+    glUniform1f(glGetUniformLocation(shaderProgram, "sphereRadius"), sRadius);
+    glUniform4fv(glGetUniformLocation(shaderProgram, "sphereColorAlpha"), 1, glm::value_ptr(sColorAlpha));
+
+    
+    glm::vec3 cMin(0.4f, -0.6f, -0.4f); 
+    glm::vec3 cMax(1.4f, 0.6f, 0.6f);   
+    glm::vec4 cColorAlpha(0.3f, 0.3f, 1.0f, 0.65f); 
+    glUniform3fv(glGetUniformLocation(shaderProgram, "cubeMin"), 1, glm::value_ptr(cMin));
+    glUniform3fv(glGetUniformLocation(shaderProgram, "cubeMax"), 1, glm::value_ptr(cMax));
+    glUniform4fv(glGetUniformLocation(shaderProgram, "cubeColorAlpha"), 1, glm::value_ptr(cColorAlpha));
     
+    
+    glm::vec3 pNormal(0.0f, 0.0f, 1.0f); 
+    float pD = -2.0f; 
+    glm::vec3 chkCol1(0.8f, 0.8f, 0.8f); 
+    glm::vec3 chkCol2(0.3f, 0.3f, 0.3f); 
+    float chkScale = 1.5f;
+    glUniform3fv(glGetUniformLocation(shaderProgram, "planeNormal"), 1, glm::value_ptr(pNormal));
+    glUniform1f(glGetUniformLocation(shaderProgram, "planeD"), pD);
+    glUniform3fv(glGetUniformLocation(shaderProgram, "checkerColor1"), 1, glm::value_ptr(chkCol1));
+    glUniform3fv(glGetUniformLocation(shaderProgram, "checkerColor2"), 1, glm::value_ptr(chkCol2));
+    glUniform1f(glGetUniformLocation(shaderProgram, "checkerScale"), chkScale);
+
+    // The buffer samplers must never share unit 0 with a sampler of another type, even unused
+    glm::vec3 gridColor(0.9f, 0.75f, 0.3f);
+    glUniform1i(glGetUniformLocation(shaderProgram, "gridOffsets"), kGridOffsetsUnit);
+    glUniform1i(glGetUniformLocation(shaderProgram, "gridIndices"), kGridIndicesUnit);
+    glUniform1i(glGetUniformLocation(shaderProgram, "gridSpheres"), kGridSpheresUnit);
+    glUniform3fv(glGetUniformLocation(shaderProgram, "gridSphereColor"), 1, glm::value_ptr(gridColor));
+    if (dynamicSpheres)
+        dynamicSpheres->setUniforms(shaderProgram);
+    else
+        glUniform1i(glGetUniformLocation(shaderProgram, "gridSphereCount"), 0);
+}
+
+
+// Traces one frame into the bound framebuffer; the viewport must already cover width x height.
+// The quad covers every pixel, so there is no clear (path tracing blends into an accumulation target).
+void drawScene(unsigned int shaderProgram, unsigned int quadVAO, int width, int height,
+               const glm::vec3& camPos, const glm::vec3& camTarget, float fov, const TraceSettings& trace) {
+    glUseProgram(shaderProgram);
+    setSceneUniforms(shaderProgram, width, height, camPos, camTarget, fov);
+    setTraceUniforms(shaderProgram, trace);
+
+    glBindVertexArray(quadVAO);
+    glDrawArrays(GL_TRIANGLES, 0, 6);
+    frameMetrics().countDraw(2);
+    glBindVertexArray(0);
+}
+
+
+// Traces the default view at 1..8 bounces with both tracers into an offscreen target and
+// prints the GPU time per frame and the ray throughput. Both follow the same paths, so the
+// segment count read back from the wavefront queues holds for the fragment tracer too.
+void runTraceBenchmark(unsigned int shaderProgram, unsigned int quadVAO, WavefrontTracer& wavefront,
+                       int width, int height) {
+    unsigned int fbo, colorTexture;
+    glGenFramebuffers(1, &fbo);
+    glGenTextures(1, &colorTexture);
+    glBindTexture(GL_TEXTURE_2D, colorTexture);
+    gpuTexImage2D(GL_TEXTURE_2D, colorTexture, GL_RGBA8, width, height, GL_RGBA, GL_UNSIGNED_BYTE, NULL, GpuCategory::RenderTarget);
+    glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, colorTexture, 0);
+    glViewport(0, 0, width, height);
+
+    glm::vec3 camPos(0.0f, 0.5f, 4.0f), camTarget(0.0f);
+    const float fov = 60.0f;
+    const int warmup = 3, frames = 20;
+    unsigned int query;
+    glGenQueries(1, &query);
+
+    std::cout << "Trace benchmark " << width << "x" << height << ", " << frames << " frames per run" << std::endl;
+    std::printf("%8s %12s %12s %12s %12s %12s\n", "bounces", "rays/frame", "frag ms", "frag Mray/s", "wave ms", "wave Mray/s");
+    for (int bounces = 1; bounces <= 8; ++bounces) {
+        TraceSettings trace;
+        trace.maxBounces = bounces;
+        double ms[2];
+        for (int path = 0; path < 2; ++path) {
+            GLuint64 elapsed = 0;
+            for (int i = 0; i < warmup + frames; ++i) {
+                if (i == warmup) glBeginQuery(GL_TIME_ELAPSED, query);
+                if (path == 0) {
+                    drawScene(shaderProgram, quadVAO, width, height, camPos, camTarget, fov, trace);
+                } else {
+                    wavefront.trace(width, height, bounces, [&](unsigned int program) {
+                        setSceneUniforms(program, width, height, camPos, camTarget, fov);
+                        setTraceUniforms(program, trace);
+                    });
+                }
+            }
+            glEndQuery(GL_TIME_ELAPSED);
+            glGetQueryObjectui64v(query, GL_QUERY_RESULT, &elapsed);
+            ms[path] = elapsed / 1e6 / frames;
+        }
+        double rays = (double)wavefront.raysTraced();
+        std::printf("%8d %12.0f %12.3f %12.1f %12.3f %12.1f\n", bounces, rays,
+                    ms[0], rays / (ms[0] * 1e3), ms[1], rays / (ms[1] * 1e3));
+    }
+
+    gpuMemory().printBreakdown(std::cout);
+    glDeleteQueries(1, &query);
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    glDeleteFramebuffers(1, &fbo);
+    gpuDeleteTextures(1, &colorTexture);
+}
+
+
+// Progressive accumulation for path tracing: each frame is added into a float target with
+// additive blending (alpha sums the path lengths) and the resolve pass divides by the sample count
+struct Accumulator {
+    unsigned int fbo;
+    unsigned int texture;
+    int width;
+    int height;
+    int samples;
+    Accumulator() : fbo(0), texture(0), width(0), height(0), samples(0) {}
+};
+
+void clearAccumulator(Accumulator& acc) {
+    glBindFramebuffer(GL_FRAMEBUFFER, acc.fbo);
+    glClearColor(0.0f, 0.0f, 0.0f, 0.0f);
+    glClear(GL_COLOR_BUFFER_BIT);
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    acc.samples = 0;
+}
+
+void resizeAccumulator(Accumulator& acc, int width, int height) {
+    if (!acc.fbo) glGenFramebuffers(1, &acc.fbo);
+    if (!acc.texture) glGenTextures(1, &acc.texture);
+    glBindTexture(GL_TEXTURE_2D, acc.texture);
+    gpuTexImage2D(GL_TEXTURE_2D, acc.texture, GL_RGBA32F, width, height, GL_RGBA, GL_FLOAT, NULL, GpuCategory::RenderTarget);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glBindTexture(GL_TEXTURE_2D, 0);
+    glBindFramebuffer(GL_FRAMEBUFFER, acc.fbo);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, acc.texture, 0);
+    acc.width = width;
+    acc.height = height;
+    clearAccumulator(acc);
+}
+
+void releaseAccumulator(Accumulator& acc) {
+    glDeleteFramebuffers(1, &acc.fbo);
+    gpuDeleteTextures(1, &acc.texture);
+    acc = Accumulator();
+}
+
+void beginAccumulate(const Accumulator& acc) {
+    glBindFramebuffer(GL_FRAMEBUFFER, acc.fbo);
+    glEnable(GL_BLEND);
+    glBlendFunc(GL_ONE, GL_ONE);
+}
+
+void endAccumulate(Accumulator& acc) {
+    glDisable(GL_BLEND);
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    acc.samples++;
+}
+
+void resolveAccumulator(const Accumulator& acc, unsigned int resolveProgram, unsigned int quadVAO) {
+    glUseProgram(resolveProgram);
+    glUniform1i(glGetUniformLocation(resolveProgram, "accumulation"), 0);
+    glUniform1f(glGetUniformLocation(resolveProgram, "sampleCount"), (float)std::max(acc.samples, 1));
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D, acc.texture);
+    glBindVertexArray(quadVAO);
+    glDrawArrays(GL_TRIANGLES, 0, 6);
+    frameMetrics().countDraw(2);
+    glBindVertexArray(0);
+    glBindTexture(GL_TEXTURE_2D, 0);
+}
+
+
+// Path-traced default view at bounce limits 4, 8 and 16, with a fixed limit (every path runs
+// until it escapes or hits the limit) and with Russian roulette. Prints GPU ms per sample,
+// the average path length and the mean pixel value; the latter should agree between the two
+// modes since roulette only changes the variance. With a wavefront tracer the same runs are
+// repeated on the compute path.
+void runPathBenchmark(unsigned int shaderProgram, unsigned int quadVAO, WavefrontTracer* wavefront,
+                      int width, int height) {
+    Accumulator acc;
+    resizeAccumulator(acc, width, height);
+    glViewport(0, 0, width, height);
+
+    glm::vec3 camPos(0.0f, 0.5f, 4.0f), camTarget(0.0f);
+    const float fov = 60.0f;
+    const int warmup = 3, frames = 32;
+    const double pixels = (double)width * height;
+    unsigned int query;
+    glGenQueries(1, &query);
+    std::vector<float> readback((size_t)width * height * 4);
+
+    std::cout << "Path benchmark " << width << "x" << height << ", " << frames << " samples per run" << std::endl;
+    std::printf("%6s %9s %10s %10s %12s %10s", "limit", "roulette", "frag ms", "avg length", "Msegment/s", "mean");
+    if (wavefront) std::printf(" %10s %10s", "wave ms", "avg length");
+    std::printf("\n");
+
+    const int limits[] = { 4, 8, 16 };
+    for (int l = 0; l < 3; ++l) {
+        for (int roulette = 0; roulette < 2; ++roulette) {
+            TraceSettings trace;
+            trace.maxBounces = limits[l];
+            trace.pathTrace = true;
+            trace.russianRoulette = roulette != 0;
+
+            GLuint64 elapsed = 0;
+            for (int i = 0; i < warmup + frames; ++i) {
+                if (i == warmup) {
+                    clearAccumulator(acc);
+                    glBeginQuery(GL_TIME_ELAPSED, query);
+                }
+                trace.frameIndex = (unsigned int)i;
+                beginAccumulate(acc);
+                drawScene(shaderProgram, quadVAO, width, height, camPos, camTarget, fov, trace);
+                endAccumulate(acc);
+            }
+            glEndQuery(GL_TIME_ELAPSED);
+            glGetQueryObjectui64v(query, GL_QUERY_RESULT, &elapsed);
+            double ms = elapsed / 1e6 / frames;
+
+            glBindFramebuffer(GL_FRAMEBUFFER, acc.fbo);
+            glReadPixels(0, 0, width, height, GL_RGBA, GL_FLOAT, readback.data());
+            glBindFramebuffer(GL_FRAMEBUFFER, 0);
+            double radiance = 0.0, segments = 0.0;
+            for (size_t p = 0; p < readback.size(); p += 4) {
+                radiance += (readback[p] + readback[p + 1] + readback[p + 2]) / 3.0;
+                segments += readback[p + 3];
+            }
+            double avgLength = segments / (pixels * frames);
+            std::printf("%6d %9s %10.3f %10.2f %12.1f %10.4f", limits[l], roulette ? "on" : "off", ms, avgLength,
+                        pixels * avgLength / (ms * 1e3), radiance / (pixels * frames));
+
+            if (wavefront) {
+                for (int i = 0; i < warmup + frames; ++i) {
+                    if (i == warmup) glBeginQuery(GL_TIME_ELAPSED, query);
+                    trace.frameIndex = (unsigned int)i;
+                    wavefront->trace(width, height, trace.maxBounces, [&](unsigned int program) {
+                        setSceneUniforms(program, width, height, camPos, camTarget, fov);
+                        setTraceUniforms(program, trace);
+                    });
+                }
+                glEndQuery(GL_TIME_ELAPSED);
+                glGetQueryObjectui64v(query, GL_QUERY_RESULT, &elapsed);
+                std::printf(" %10.3f %10.2f", elapsed / 1e6 / frames, wavefront->raysTraced() / pixels);
+            }
+            std::printf("\n");
+        }
+    }
+
+    gpuMemory().printBreakdown(std::cout);
+    glDeleteQueries(1, &query);
+    releaseAccumulator(acc);
+}
+
+
+// Moving-sphere scenes from 1k to 100k spheres: CPU grid rebuild time per phase, upload time
+// and GPU trace time of the default view with the grid in the scene (legacy shading)
+void runGridBenchmark(unsigned int shaderProgram, unsigned int quadVAO, int width, int height, const TraceSettings& trace) {
+    unsigned int fbo, colorTexture;
+    glGenFramebuffers(1, &fbo);
+    glGenTextures(1, &colorTexture);
+    glBindTexture(GL_TEXTURE_2D, colorTexture);
+    gpuTexImage2D(GL_TEXTURE_2D, colorTexture, GL_RGBA8, width, height, GL_RGBA, GL_UNSIGNED_BYTE, NULL, GpuCategory::RenderTarget);
+    glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, colorTexture, 0);
+    glViewport(0, 0, width, height);
+
+    glm::vec3 camPos(0.0f, 0.5f, 4.0f), camTarget(0.0f);
+    const int warmup = 5, frames = 30;
+    unsigned int query;
+    glGenQueries(1, &query);
+    TraceSettings legacy = trace;
+    legacy.pathTrace = false;
+
+    std::cout << "Grid benchmark " << width << "x" << height << ", " << frames << " frames per scene, "
+              << std::thread::hardware_concurrency() << " hardware threads" << std::endl;
+    std::printf("%8s %8s %9s %10s %9s %10s %9s %9s %9s %11s\n", "spheres", "cells", "refs/sph", "move+cnt", "prefix",
+                "scatter", "build ms", "upload", "trace ms", "Mpixel/s");
+    const int counts[] = { 1000, 4000, 16000, 64000, 100000 };
+    for (int c = 0; c < 5; ++c) {
+        SphereGrid grid(counts[c]);
+        dynamicSpheres = &grid;
+        SphereGrid::Stats total;
+        double traceMs = 0.0;
+        for (int i = 0; i < warmup + frames; ++i) {
+            grid.update(1.0f / 60.0f);
+            grid.upload();
+            grid.bind();
+            glBeginQuery(GL_TIME_ELAPSED, query);
+            drawScene(shaderProgram, quadVAO, width, height, camPos, camTarget, 60.0f, legacy);
+            glEndQuery(GL_TIME_ELAPSED);
+            GLuint64 elapsed = 0;
+            glGetQueryObjectui64v(query, GL_QUERY_RESULT, &elapsed);
+            if (i < warmup) continue;
+            const SphereGrid::Stats& s = grid.stats();
+            total.moveCountMs += s.moveCountMs;
+            total.prefixMs += s.prefixMs;
+            total.scatterMs += s.scatterMs;
+            total.uploadMs += s.uploadMs;
+            traceMs += elapsed / 1e6;
+        }
+        dynamicSpheres = nullptr;
+        std::printf("%8d %8zu %9.2f %10.3f %9.3f %10.3f %9.3f %9.3f %9.3f %11.1f\n", counts[c], grid.cellCount(),
+                    (double)grid.referenceCount() / grid.sphereCount(), total.moveCountMs / frames,
+                    total.prefixMs / frames, total.scatterMs / frames, total.buildMs() / frames,
+                    total.uploadMs / frames, traceMs / frames, (double)width * height / (traceMs / frames * 1e3));
+    }
+
+    gpuMemory().printBreakdown(std::cout);
+    glDeleteQueries(1, &query);
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    glDeleteFramebuffers(1, &fbo);
+    gpuDeleteTextures(1, &colorTexture);
+}
+
+
+int main(int argc, char** argv) {
+    startupProfile(); // startup phases are timed from here
+    bool onDemand = false;
+    bool lowLatency = false;
+    int latencyAb = 0; // --latency-ab N alternates default and low-latency mode every N frames, compared at exit
+    const char* servePath = nullptr; // --serve PATH: headless render server on a Unix socket
+    // --render-path FILE renders a camera flythrough to image files and exits, together with
+    // --frames A:B, --fps N, --size WxH, --out DIR, --in-flight N
+    const char* cameraPathFile = nullptr;
+    BatchRenderOptions batchOptions;
+    // --wavefront traces with the GL 4.3 compute path instead of the fragment shader,
+    // --trace-bench compares both at 1..8 bounces (at --size) and exits
+    bool wavefrontMode = false;
+    bool traceBench = false;
+    // --path-trace switches to glass / diffuse materials with progressive accumulation,
+    // --no-roulette disables Russian roulette, --path-bench compares both and exits
+    bool pathBench = false;
+    TraceSettings trace;
+    // --spheres N adds N moving spheres in a per-frame rebuilt uniform grid,
+    // --grid-bench times build and trace for 1k..100k spheres and exits
+    int sphereCount = 0;
+    bool gridBench = false;
+    // --startup-json PATH also writes the startup breakdown as JSON ("-" for stdout)
+    const char* startupJson = nullptr;
+    // --metrics ENDPOINT serves Prometheus metrics on a localhost port or a Unix socket path
+    const char* metricsEndpoint = nullptr;
+    // --record-input PATH records input and frame times, --replay-input PATH replays them
+    // (interactive mode only)
+    const char* recordInput = nullptr;
+    const char* replayInput = nullptr;
+    for (int i = 1; i < argc; ++i) {
+        if (std::strcmp(argv[i], "--on-demand") == 0) onDemand = true;
+        else if (std::strcmp(argv[i], "--low-latency") == 0) lowLatency = true;
+        else if (std::strcmp(argv[i], "--latency-ab") == 0 && i + 1 < argc) latencyAb = std::atoi(argv[++i]);
+        else if (std::strcmp(argv[i], "--serve") == 0 && i + 1 < argc) servePath = argv[++i];
+        else if (std::strcmp(argv[i], "--render-path") == 0 && i + 1 < argc) cameraPathFile = argv[++i];
+        else if (std::strcmp(argv[i], "--frames") == 0 && i + 1 < argc)
+            std::sscanf(argv[++i], "%d:%d", &batchOptions.firstFrame, &batchOptions.lastFrame);
+        else if (std::strcmp(argv[i], "--fps") == 0 && i + 1 < argc) batchOptions.fps = (float)std::atof(argv[++i]);
+        else if (std::strcmp(argv[i], "--size") == 0 && i + 1 < argc)
+            std::sscanf(argv[++i], "%dx%d", &batchOptions.width, &batchOptions.height);
+        else if (std::strcmp(argv[i], "--out") == 0 && i + 1 < argc) batchOptions.outputDir = argv[++i];
+        else if (std::strcmp(argv[i], "--in-flight") == 0 && i + 1 < argc) batchOptions.framesInFlight = std::atoi(argv[++i]);
+        else if (std::strcmp(argv[i], "--wavefront") == 0) wavefrontMode = true;
+        else if (std::strcmp(argv[i], "--trace-bench") == 0) traceBench = true;
+        else if (std::strcmp(argv[i], "--bounces") == 0 && i + 1 < argc) trace.maxBounces = std::max(1, std::atoi(argv[++i]));
+        else if (std::strcmp(argv[i], "--path-trace") == 0) trace.pathTrace = true;
+        else if (std::strcmp(argv[i], "--no-roulette") == 0) trace.russianRoulette = false;
+        else if (std::strcmp(argv[i], "--path-bench") == 0) pathBench = true;
+        else if (std::strcmp(argv[i], "--spheres") == 0 && i + 1 < argc) sphereCount = std::atoi(argv[++i]);
+        else if (std::strcmp(argv[i], "--grid-bench") == 0) gridBench = true;
+        else if (std::strcmp(argv[i], "--startup-json") == 0 && i + 1 < argc) startupJson = argv[++i];
+        else if (std::strcmp(argv[i], "--metrics") == 0 && i + 1 < argc) metricsEndpoint = argv[++i];
+        else if (std::strcmp(argv[i], "--record-input") == 0 && i + 1 < argc) recordInput = argv[++i];
+        else if (std::strcmp(argv[i], "--replay-input") == 0 && i + 1 < argc) replayInput = argv[++i];
+    }
+#ifndef _WIN32
+    MetricsExporter metricsExporter("task3");
+    if (metricsEndpoint && !metricsExporter.start(metricsEndpoint)) return -1;
+#endif
+    bool headless = servePath || cameraPathFile || traceBench || pathBench || gridBench;
+    if (!headless && replayInput) {
+        if (!inputTrace().replay(replayInput, "task3"))
+            return -1;
+        onDemand = false; // only drawn frames are recorded; replay them back to back
+    } else if (!headless && recordInput) {
+        inputTrace().record(recordInput, "task3");
+    }
+    bool needCompute = wavefrontMode || traceBench;
+
     glfwInit();
-    glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+    startupProfile().mark("glfwInit");
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, needCompute ? 4 : 3);
     glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
     glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
 
 #ifdef __APPLE__
     glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE);
 #endif
+    if (headless)
+        glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE); // only needed for the GL context
 
     
     GLFWwindow* window = glfwCreateWindow(SCR_WIDTH, SCR_HEIGHT, "Task 3: Ray Tracing", NULL, NULL);
     if (window == NULL) {
-        std::cerr << "Failed to create GLFW window" << std::endl;
+        std::cerr << "Failed to create GLFW window" << (needCompute ? " (compute tracing needs OpenGL 4.3)" : "") << std::endl;
         glfwTerminate();
         return -1;
     }
     glfwMakeContextCurrent(window);
     glfwSetFramebufferSizeCallback(window, framebuffer_size_callback);
+    glfwSetWindowRefreshCallback(window, window_refresh_callback);
+    glfwSetKeyCallback(window, key_callback);
+    startupProfile().mark("window/context");
 
     
     if (!gladLoadGLLoader((GLADloadproc)glfwGetProcAddress)) {
         std::cerr << "Failed to initialize GLAD" << std::endl;
         return -1;
     }
+    startupProfile().mark("gladLoadGLLoader");
+
+    // Compute stages and their queues; reset before glfwTerminate
+    std::unique_ptr<WavefrontTracer> wavefront;
+    if (needCompute) {
+        wavefront.reset(new WavefrontTracer());
+        if (!loadGl43((GLADloadproc)glfwGetProcAddress) || !wavefront->init(sceneShaderSource)) {
+            std::cerr << "Failed to set up the wavefront tracer" << std::endl;
+            wavefront.reset();
+            glDeletionQueue().finish();
+            glfwTerminate();
+            return -1;
+        }
+        startupProfile().mark("wavefront tracer setup");
+    }
 
     
+    std::string fragmentSource = std::string("#version 330 core\n") + sceneShaderSource + fragmentShaderSource;
     unsigned int vertexShader = compileShader(GL_VERTEX_SHADER, vertexShaderSource);
-    unsigned int fragmentShader = compileShader(GL_FRAGMENT_SHADER, fragmentShaderSource);
+    unsigned int fragmentShader = compileShader(GL_FRAGMENT_SHADER, fragmentSource.c_str());
     unsigned int shaderProgram = createShaderProgram(vertexShader, fragmentShader);
     glDeleteShader(vertexShader); 
     glDeleteShader(fragmentShader);
 
+    vertexShader = compileShader(GL_VERTEX_SHADER, vertexShaderSource);
+    fragmentShader = compileShader(GL_FRAGMENT_SHADER, resolveFragmentShaderSource);
+    unsigned int resolveProgram = createShaderProgram(vertexShader, fragmentShader);
+    glDeleteShader(vertexShader);
+    glDeleteShader(fragmentShader);
+    startupProfile().mark("shaders");
+
+    // Latency tracker chains in front of key_callback; reset before glfwTerminate (owns fences)
+    std::unique_ptr<LatencyTracker> latency(new LatencyTracker(lowLatency));
+    if (latencyAb > 0)
+        latency->alternateModes(latencyAb); // the loop reads the mode from the tracker every frame
+    latency->attach(window);
+    inputTrace().attach(window);
+
     
     float quadVertices[] = { 
         
@@ -299,12 +990,12 @@ int main() {
          1.0f,  1.0f,  1.0f, 1.0f
     };
 
-    unsigned int quadVAO, quadVBO;
-    glGenVertexArrays(1, &quadVAO);
-    glGenBuffers(1, &quadVBO);
+    GlVertexArray quadVertexArray = GlVertexArray::create();
+    GlBuffer quadVBO = GlBuffer::create();
+    unsigned int quadVAO = quadVertexArray.get();
     glBindVertexArray(quadVAO);
-    glBindBuffer(GL_ARRAY_BUFFER, quadVBO);
-    glBufferData(GL_ARRAY_BUFFER, sizeof(quadVertices), quadVertices, GL_STATIC_DRAW);
+    glBindBuffer(GL_ARRAY_BUFFER, quadVBO.get());
+    gpuBufferData(GL_ARRAY_BUFFER, quadVBO.get(), sizeof(quadVertices), quadVertices, GL_STATIC_DRAW, GpuCategory::VertexBuffer);
     
     glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 4 * sizeof(float), (void*)0);
     glEnableVertexAttribArray(0);
@@ -312,77 +1003,217 @@ int main() {
     glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, 4 * sizeof(float), (void*)(2 * sizeof(float)));
     glEnableVertexAttribArray(1);
     glBindVertexArray(0); 
+    startupProfile().mark("quad upload");
 
-    
-    while (!glfwWindowShouldClose(window)) {
-        processInput(window);
+    if (gridBench)
+        runGridBenchmark(shaderProgram, quadVAO, batchOptions.width, batchOptions.height, trace);
 
-        glClearColor(0.1f, 0.1f, 0.1f, 1.0f);
-        glClear(GL_COLOR_BUFFER_BIT);
+    // Owns GL buffers; reset before glfwTerminate
+    std::unique_ptr<SphereGrid> grid;
+    if (sphereCount > 0) {
+        grid.reset(new SphereGrid(sphereCount));
+        grid->update(0.0f);
+        grid->upload();
+        grid->bind();
+        dynamicSpheres = grid.get();
+        startupProfile().mark("sphere grid build/upload");
+    }
 
-        glUseProgram(shaderProgram);
+    // Offline outputs are single-sample, so they keep the noise-free legacy shading
+    TraceSettings offlineTrace = trace;
+    offlineTrace.pathTrace = false;
 
-        
-        glUniform2f(glGetUniformLocation(shaderProgram, "iResolution"), (float)SCR_WIDTH, (float)SCR_HEIGHT);
-        
-        
-        glm::vec3 camPos = glm::vec3(0.0f, 0.5f, 4.0f); 
-        glm::vec3 camTarget = glm::vec3(0.0f, 0.0f, 0.0f);
-        glm::vec3 camUp = glm::vec3(0.0f, 1.0f, 0.0f);
-        glUniform3fv(glGetUniformLocation(shaderProgram, "cameraPos"), 1, glm::value_ptr(camPos));
-        glUniform3fv(glGetUniformLocation(shaderProgram, "cameraTarget"), 1, glm::value_ptr(camTarget));
-        glUniform3fv(glGetUniformLocation(shaderProgram, "cameraUp"), 1, glm::value_ptr(camUp));
-        glUniform1f(glGetUniformLocation(shaderProgram, "cameraFov"), 60.0f); 
+    int exitCode = 0;
+    if (cameraPathFile) {
+        std::vector<CameraKeyframe> keys;
+        bool ok = loadCameraPath(cameraPathFile, keys) && renderCameraPath(keys, batchOptions,
+            [&](int width, int height, const CameraKeyframe& camera) {
+                drawScene(shaderProgram, quadVAO, width, height, camera.eye, camera.target, camera.fov, offlineTrace);
+            });
+        if (!ok) exitCode = 1;
+    }
 
-        
-        glm::vec3 sCenter(-0.8f, 0.0f, 0.0f); 
-        float sRadius = 0.7f;
-        glm::vec4 sColorAlpha(1.0f, 0.3f, 0.3f, 0.5f); 
-        glUniform3fv(glGetUniformLocation(shaderProgram, "sphereCenter"), 1, glm::value_ptr(sCenter));
-        glUniform1f(glGetUniformLocation(shaderProgram, "sphereRadius"), sRadius);
-        glUniform4fv(glGetUniformLocation(shaderProgram, "sphereColorAlpha"), 1, glm::value_ptr(sColorAlpha));
+#ifndef _WIN32
+    if (servePath) {
+        // Program and quad stay resident; each request only sets uniforms and traces
+        RenderRequest defaults;
+        defaults.eye[0] = 0.0f; defaults.eye[1] = 0.5f; defaults.eye[2] = 4.0f;
+        defaults.fov = 60.0f;
+        RenderServer server(defaults);
+        if (server.listen(servePath)) {
+            std::cout << "Serving on " << servePath << std::endl;
+            server.run([&](const RenderRequest& r) {
+                drawScene(shaderProgram, quadVAO, r.width, r.height, glm::vec3(r.eye[0], r.eye[1], r.eye[2]),
+                          glm::vec3(r.target[0], r.target[1], r.target[2]), r.fov, offlineTrace);
+                frameMetrics().endFrame(); // one frame per request
+            });
+            server.printStats(std::cout);
+        }
+    }
+#endif
 
-        
-        glm::vec3 cMin(0.4f, -0.6f, -0.4f); 
-        glm::vec3 cMax(1.4f, 0.6f, 0.6f);   
-        glm::vec4 cColorAlpha(0.3f, 0.3f, 1.0f, 0.65f); 
-        glUniform3fv(glGetUniformLocation(shaderProgram, "cubeMin"), 1, glm::value_ptr(cMin));
-        glUniform3fv(glGetUniformLocation(shaderProgram, "cubeMax"), 1, glm::value_ptr(cMax));
-        glUniform4fv(glGetUniformLocation(shaderProgram, "cubeColorAlpha"), 1, glm::value_ptr(cColorAlpha));
-        
-        
-        glm::vec3 pNormal(0.0f, 0.0f, 1.0f); 
-        float pD = -2.0f; 
-        glm::vec3 chkCol1(0.8f, 0.8f, 0.8f); 
-        glm::vec3 chkCol2(0.3f, 0.3f, 0.3f); 
-        float chkScale = 1.5f;
-        glUniform3fv(glGetUniformLocation(shaderProgram, "planeNormal"), 1, glm::value_ptr(pNormal));
-        glUniform1f(glGetUniformLocation(shaderProgram, "planeD"), pD);
-        glUniform3fv(glGetUniformLocation(shaderProgram, "checkerColor1"), 1, glm::value_ptr(chkCol1));
-        glUniform3fv(glGetUniformLocation(shaderProgram, "checkerColor2"), 1, glm::value_ptr(chkCol2));
-        glUniform1f(glGetUniformLocation(shaderProgram, "checkerScale"), chkScale);
-
-        glBindVertexArray(quadVAO);
-        glDrawArrays(GL_TRIANGLES, 0, 6);
-        glBindVertexArray(0);
+    if (traceBench)
+        runTraceBenchmark(shaderProgram, quadVAO, *wavefront, batchOptions.width, batchOptions.height);
+    if (pathBench)
+        runPathBenchmark(shaderProgram, quadVAO, wavefront.get(), batchOptions.width, batchOptions.height);
+
+    // Path tracing keeps adding samples until kMaxPathSamples, then only re-displays the result
+    const int kMaxPathSamples = 4096;
+    Accumulator accumulator;
+    double gridBuildMs = 0.0, gridUploadMs = 0.0;
+
+    double lastTime = inputTrace().clock(glfwGetTime());
+    long long framesRendered = 0;
+    while (!headless && !glfwWindowShouldClose(window)) {
+        // Moving spheres and unconverged path tracing keep the on-demand loop running
+        bool keepTracing = grid || (trace.pathTrace && accumulator.samples < kMaxPathSamples);
+        if (onDemand) {
+            // Keep polling while the camera is being driven, otherwise sleep until an event
+            if (!sceneDirty && !keepTracing && !cameraKeysHeld(window))
+                glfwWaitEvents();
+            else
+                glfwPollEvents();
+            if (latency->lowLatency())
+                latency->waitForPreviousFrame();
+        } else if (latency->lowLatency()) {
+            // Sample input right before tracing instead of after the previous swap
+            latency->beginFrame();
+            glfwPollEvents();
+        }
+        latency->inputSampled();
+
+        // Clamp the step so the first frame after a long idle wait does not jump
+        double now = inputTrace().beginFrame(glfwGetTime());
+        float deltaTime = (float)std::min(now - lastTime, 0.1);
+        bool cameraMoved = processInput(window, deltaTime);
+        if (cameraMoved)
+            sceneDirty = true;
+
+        // A skipped iteration is not recorded, so the step keeps running from the last drawn
+        // frame, the same frame times a replay of the recording sees
+        if (onDemand && !sceneDirty && !keepTracing)
+            continue;
+        lastTime = now;
+
+        if (grid) {
+            grid->update(deltaTime);
+            grid->upload();
+            grid->bind();
+            gridBuildMs += grid->stats().buildMs();
+            gridUploadMs += grid->stats().uploadMs;
+        }
+
+        int fbWidth, fbHeight;
+        glfwGetFramebufferSize(window, &fbWidth, &fbHeight);
+
+        glm::vec3 camPos = cameraDistance * glm::vec3(cosf(cameraPitch) * sinf(cameraYaw), sinf(cameraPitch), cosf(cameraPitch) * cosf(cameraYaw));
+        glm::vec3 camTarget = glm::vec3(0.0f, 0.0f, 0.0f);
+        trace.frameIndex = (unsigned int)framesRendered;
+        auto traceFrame = [&]() {
+            if (wavefront) {
+                wavefront->trace(fbWidth, fbHeight, trace.maxBounces, [&](unsigned int program) {
+                    setSceneUniforms(program, fbWidth, fbHeight, camPos, camTarget, 60.0f);
+                    setTraceUniforms(program, trace);
+                });
+                wavefront->present();
+            } else {
+                drawScene(shaderProgram, quadVAO, fbWidth, fbHeight, camPos, camTarget, 60.0f, trace);
+            }
+        };
+        if (trace.pathTrace) {
+            if (accumulator.width != fbWidth || accumulator.height != fbHeight)
+                resizeAccumulator(accumulator, fbWidth, fbHeight);
+            else if (cameraMoved || grid)
+                clearAccumulator(accumulator); // moving spheres invalidate earlier samples
+            if (accumulator.samples < kMaxPathSamples) {
+                beginAccumulate(accumulator);
+                traceFrame();
+                endAccumulate(accumulator);
+            }
+            resolveAccumulator(accumulator, resolveProgram, quadVAO);
+        } else {
+            traceFrame();
+        }
 
         glfwSwapBuffers(window);
-        glfwPollEvents();
+        latency->afterSwap();
+        glDeletionQueue().endFrame(); // Queue buffers dropped by a resize are deleted once this frame is done
+        frameMetrics().endFrame();
+        inputTrace().endFrame();
+        if (!startupProfile().finished()) {
+            startupProfile().finish("first frame");
+            startupProfile().report(std::cout, "task3", startupJson);
+        }
+        sceneDirty = false;
+        framesRendered++;
+        if (!onDemand && !latency->lowLatency())
+            glfwPollEvents();
     }
 
-    glDeleteVertexArrays(1, &quadVAO);
-    glDeleteBuffers(1, &quadVBO);
+    if (!headless) {
+        std::cout << "Rendered " << framesRendered << " frames in " << glfwGetTime() << " s"
+                  << (onDemand ? " (on-demand)" : "") << (wavefront ? " (wavefront)" : "") << std::endl;
+        if (trace.pathTrace)
+            std::cout << "Path traced, " << accumulator.samples << " samples in the final image" << std::endl;
+        if (grid && framesRendered > 0)
+            std::cout << grid->sphereCount() << " moving spheres, " << grid->cellCount() << " grid cells: build "
+                      << gridBuildMs / framesRendered << " ms, upload " << gridUploadMs / framesRendered
+                      << " ms per frame" << std::endl;
+        latency->report(std::cout, "task3");
+        inputTrace().finish(std::cout);
+        gpuMemory().printBreakdown(std::cout);
+    }
+    latency.reset();
+    wavefront.reset();
+    releaseAccumulator(accumulator);
+    dynamicSpheres = nullptr;
+    grid.reset();
+
+    quadVertexArray.reset();
+    quadVBO.reset();
     glDeleteProgram(shaderProgram);
+    glDeleteProgram(resolveProgram);
+    glDeletionQueue().finish();
+    if (!headless)
+        glDeletionQueue().printStats(std::cout);
 
     glfwTerminate();
-    return 0;
+    return exitCode;
 }
 
-void processInput(GLFWwindow *window) {
-    if (glfwGetKey(window, GLFW_KEY_ESCAPE) == GLFW_PRESS)
+bool cameraKeysHeld(GLFWwindow *window) {
+    InputTrace& input = inputTrace();
+    return input.keyDown(window, GLFW_KEY_LEFT) || input.keyDown(window, GLFW_KEY_RIGHT)
+        || input.keyDown(window, GLFW_KEY_UP) || input.keyDown(window, GLFW_KEY_DOWN);
+}
+
+// Returns true when the camera moved this frame
+bool processInput(GLFWwindow *window, float deltaTime) {
+    InputTrace& input = inputTrace(); // recorded key state when replaying
+    if (input.keyDown(window, GLFW_KEY_ESCAPE))
         glfwSetWindowShouldClose(window, true);
+
+    const float speed = 1.5f; // radians per second
+    bool moved = false;
+    if (input.keyDown(window, GLFW_KEY_LEFT)) { cameraYaw -= speed * deltaTime; moved = true; }
+    if (input.keyDown(window, GLFW_KEY_RIGHT)) { cameraYaw += speed * deltaTime; moved = true; }
+    if (input.keyDown(window, GLFW_KEY_UP)) { cameraPitch += speed * deltaTime; moved = true; }
+    if (input.keyDown(window, GLFW_KEY_DOWN)) { cameraPitch -= speed * deltaTime; moved = true; }
+    cameraPitch = glm::clamp(cameraPitch, -1.5f, 1.5f);
+    return moved;
 }
 
 void framebuffer_size_callback(GLFWwindow* window, int width, int height) {
     glViewport(0, 0, width, height);
+    sceneDirty = true;
+}
+
+void window_refresh_callback(GLFWwindow* window) {
+    sceneDirty = true;
+}
+
+// Any key press wakes the on-demand loop and redraws once
+void key_callback(GLFWwindow* window, int key, int scancode, int action, int mods) {
+    if (action == GLFW_PRESS)
+        sceneDirty = true;
 }
\ No newline at end of file
@@ -0,0 +1,322 @@
+#include "wavefront.h"
+
+#include "common/gl43.h"
+#include "common/gpu_memory.h"
+#include "common/metrics_exporter.h"
+
+#include <iostream>
+#include <string>
+
+namespace {
+
+const int kGroupSize = 64;  // local_size_x of the extend / shade kernels
+const int kTileSize = 8;    // generate runs in 8x8 tiles
+
+const int kRayBytes = 48;
+const int kHitBytes = 32;
+
+// Queue layout shared by all compute stages (sizes above are the std430 strides)
+const char *queueDeclarations = R"(
+    struct Ray {
+        vec3 origin;
+        uint pixel;          // y * width + x
+        vec3 direction;
+        uint rng;
+        vec3 throughput;
+        int depth;           // segments traced before this one
+    };
+    struct Hit {
+        vec4 normalT;        // xyz normal, w distance
+        int type;            // see intersectScene
+    };
+
+    layout(std430, binding = 0) buffer QueueState {
+        uint dispatchX;      // indirect args for the extend / shade dispatches
+        uint dispatchY;
+        uint dispatchZ;
+        uint rayCount[2];
+        uint totalRays;
+    };
+    layout(std430, binding = 1) buffer InQueue { Ray inRays[]; };
+    layout(std430, binding = 2) buffer OutQueue { Ray outRays[]; };
+    layout(std430, binding = 3) buffer Hits { Hit hits[]; };
+
+    uniform int queueIn;     // which rayCount belongs to InQueue
+)";
+
+const char *generateSource = R"(
+    layout(local_size_x = 8, local_size_y = 8) in;
+    layout(rgba32f, binding = 0) uniform writeonly image2D outputImage;
+
+    void main()
+    {
+        ivec2 pixel = ivec2(gl_GlobalInvocationID.xy);
+        ivec2 size = ivec2(iResolution);
+        if (pixel.x >= size.x || pixel.y >= size.y) return;
+
+        uint index = uint(pixel.y * size.x + pixel.x);
+        outRays[index] = Ray(cameraPos, index, primaryRayDir(vec2(pixel) + 0.5), seedRng(index), vec3(1.0), 0);
+        imageStore(outputImage, pixel, vec4(0.0, 0.0, 0.0, 1.0));
+    }
+)";
+
+const char *extendSource = R"(
+    layout(local_size_x = 64) in;
+
+    void main()
+    {
+        uint i = gl_GlobalInvocationID.x;
+        if (i >= rayCount[queueIn]) return;
+
+        float t;
+        vec3 normal;
+        int type = intersectScene(inRays[i].origin, inRays[i].direction, t, normal);
+        hits[i].normalT = vec4(normal, t);
+        hits[i].type = type;
+    }
+)";
+
+const char *shadeSource = R"(
+    layout(local_size_x = 64) in;
+    layout(rgba32f, binding = 0) uniform image2D outputImage;
+
+    void main()
+    {
+        uint i = gl_GlobalInvocationID.x;
+        if (i >= rayCount[queueIn]) return;
+
+        Ray ray = inRays[i];
+        Hit hit = hits[i];
+        int width = int(iResolution.x);
+        ivec2 pixel = ivec2(int(ray.pixel) % width, int(ray.pixel) / width);
+
+        // Each pixel has at most one live ray, so the read-modify-write does not race
+        vec3 color = imageLoad(outputImage, pixel).rgb;
+        vec3 hitPoint = ray.origin + ray.direction * hit.normalT.w;
+        bool alive = scatter(hit.type, hitPoint, hit.normalT.xyz, ray.origin, ray.direction,
+                             ray.throughput, color, ray.depth, ray.rng);
+        imageStore(outputImage, pixel, vec4(color, 1.0));
+
+        if (alive) {
+            uint slot = atomicAdd(rayCount[1 - queueIn], 1u);
+            ray.depth += 1;
+            outRays[slot] = ray;
+        }
+    }
+)";
+
+// Single invocation between bounces: sizes the next dispatch from the compacted count
+const char *advanceSource = R"(
+    layout(local_size_x = 1) in;
+
+    void main()
+    {
+        totalRays += rayCount[queueIn];
+        dispatchX = (rayCount[1 - queueIn] + 63u) / 64u;
+        rayCount[queueIn] = 0u;
+    }
+)";
+
+const char *presentVertexSource = R"(
+    #version 330 core
+    void main()
+    {
+        vec2 p = vec2((gl_VertexID << 1) & 2, gl_VertexID & 2);
+        gl_Position = vec4(p * 2.0 - 1.0, 0.0, 1.0);
+    }
+)";
+
+const char *presentFragmentSource = R"(
+    #version 330 core
+    out vec4 FragColor;
+    uniform sampler2D outputImage;
+
+    void main()
+    {
+        FragColor = vec4(texelFetch(outputImage, ivec2(gl_FragCoord.xy), 0).rgb, 1.0);
+    }
+)";
+
+unsigned int compileStage(GLenum type, const std::string& source, const char* name) {
+    unsigned int shader = glCreateShader(type);
+    const char* text = source.c_str();
+    glShaderSource(shader, 1, &text, NULL);
+    glCompileShader(shader);
+    int success;
+    glGetShaderiv(shader, GL_COMPILE_STATUS, &success);
+    if (!success) {
+        char infoLog[1024];
+        glGetShaderInfoLog(shader, sizeof(infoLog), NULL, infoLog);
+        std::cerr << "ERROR::SHADER::COMPILATION_FAILED (" << name << ")\n" << infoLog << std::endl;
+        glDeleteShader(shader);
+        return 0;
+    }
+    return shader;
+}
+
+unsigned int linkProgram(unsigned int a, unsigned int b, const char* name) {
+    unsigned int program = glCreateProgram();
+    glAttachShader(program, a);
+    if (b) glAttachShader(program, b);
+    glLinkProgram(program);
+    glDeleteShader(a);
+    if (b) glDeleteShader(b);
+    int success;
+    glGetProgramiv(program, GL_LINK_STATUS, &success);
+    if (!success) {
+        char infoLog[1024];
+        glGetProgramInfoLog(program, sizeof(infoLog), NULL, infoLog);
+        std::cerr << "ERROR::PROGRAM::LINKING_FAILED (" << name << ")\n" << infoLog << std::endl;
+        glDeleteProgram(program);
+        return 0;
+    }
+    return program;
+}
+
+unsigned int computeProgram(const char* sceneSource, const char* stageSource, const char* name) {
+    std::string source = std::string("#version 430 core\n") + sceneSource + queueDeclarations + stageSource;
+    unsigned int shader = compileStage(GL_COMPUTE_SHADER, source, name);
+    return shader ? linkProgram(shader, 0, name) : 0;
+}
+
+} // namespace
+
+WavefrontTracer::WavefrontTracer()
+    : generateProgram_(0), extendProgram_(0), shadeProgram_(0), advanceProgram_(0), presentProgram_(0),
+      width_(0), height_(0) {}
+
+WavefrontTracer::~WavefrontTracer() {
+    release();
+    glDeleteProgram(generateProgram_);
+    glDeleteProgram(extendProgram_);
+    glDeleteProgram(shadeProgram_);
+    glDeleteProgram(advanceProgram_);
+    glDeleteProgram(presentProgram_);
+}
+
+bool WavefrontTracer::init(const char* sceneSource) {
+    generateProgram_ = computeProgram(sceneSource, generateSource, "generate");
+    extendProgram_ = computeProgram(sceneSource, extendSource, "extend");
+    shadeProgram_ = computeProgram(sceneSource, shadeSource, "shade");
+    advanceProgram_ = computeProgram("", advanceSource, "advance");
+    unsigned int vs = compileStage(GL_VERTEX_SHADER, presentVertexSource, "present");
+    unsigned int fs = compileStage(GL_FRAGMENT_SHADER, presentFragmentSource, "present");
+    if (vs && fs) presentProgram_ = linkProgram(vs, fs, "present");
+    if (!generateProgram_ || !extendProgram_ || !shadeProgram_ || !advanceProgram_ || !presentProgram_)
+        return false;
+
+    emptyVAO_ = GlVertexArray::create();
+    stateBuffer_ = GlBuffer::create();
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, stateBuffer_.get());
+    gpuBufferData(GL_SHADER_STORAGE_BUFFER, stateBuffer_.get(), 6 * sizeof(GLuint), NULL, GL_DYNAMIC_COPY, GpuCategory::StorageBuffer);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+    return true;
+}
+
+void WavefrontTracer::release() {
+    queueBuffers_[0].reset();
+    queueBuffers_[1].reset();
+    hitBuffer_.reset();
+    outputTexture_.reset();
+    width_ = height_ = 0;
+}
+
+void WavefrontTracer::resize(int width, int height) {
+    release();
+    width_ = width;
+    height_ = height;
+
+    // Worst case every pixel keeps its ray, so each queue holds one ray per pixel
+    GLsizeiptr pixels = (GLsizeiptr)width * height;
+    hitBuffer_ = GlBuffer::create();
+    for (int i = 0; i < 2; ++i) {
+        queueBuffers_[i] = GlBuffer::create();
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, queueBuffers_[i].get());
+        gpuBufferData(GL_SHADER_STORAGE_BUFFER, queueBuffers_[i].get(), pixels * kRayBytes, NULL, GL_DYNAMIC_COPY, GpuCategory::StorageBuffer);
+    }
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, hitBuffer_.get());
+    gpuBufferData(GL_SHADER_STORAGE_BUFFER, hitBuffer_.get(), pixels * kHitBytes, NULL, GL_DYNAMIC_COPY, GpuCategory::StorageBuffer);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+
+    outputTexture_ = GlTexture::create();
+    glBindTexture(GL_TEXTURE_2D, outputTexture_.get());
+    glTexStorage2D(GL_TEXTURE_2D, 1, GL_RGBA32F, width, height);
+    gpuTrackTexture(outputTexture_.get(), GL_RGBA32F, width, height, 1, GpuCategory::RenderTarget);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glBindTexture(GL_TEXTURE_2D, 0);
+}
+
+void WavefrontTracer::trace(int width, int height, int maxBounces, const SceneUniformFunc& setUniforms) {
+    if (width <= 0 || height <= 0) return;
+    if (width != width_ || height != height_) resize(width, height);
+
+    // Queue 0 starts full (one primary ray per pixel), queue 1 empty
+    GLuint pixels = (GLuint)(width * height);
+    GLuint state[6] = { (pixels + kGroupSize - 1) / kGroupSize, 1, 1, pixels, 0, 0 };
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, stateBuffer_.get());
+    glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, sizeof(state), state);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, stateBuffer_.get());
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 2, queueBuffers_[0].get());
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 3, hitBuffer_.get());
+    glBindImageTexture(0, outputTexture_.get(), 0, GL_FALSE, 0, GL_READ_WRITE, GL_RGBA32F);
+    glBindBuffer(GL_DISPATCH_INDIRECT_BUFFER, stateBuffer_.get());
+
+    glUseProgram(generateProgram_);
+    setUniforms(generateProgram_);
+    glDispatchCompute((width + kTileSize - 1) / kTileSize, (height + kTileSize - 1) / kTileSize, 1);
+    glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT | GL_SHADER_IMAGE_ACCESS_BARRIER_BIT);
+
+    // Uniforms stick to the program, so set them once per frame and only flip queueIn per bounce
+    glUseProgram(extendProgram_);
+    setUniforms(extendProgram_);
+    glUseProgram(shadeProgram_);
+    setUniforms(shadeProgram_);
+
+    for (int bounce = 0; bounce < maxBounces; ++bounce) {
+        int in = bounce & 1;
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, queueBuffers_[in].get());
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 2, queueBuffers_[1 - in].get());
+
+        glUseProgram(extendProgram_);
+        glUniform1i(glGetUniformLocation(extendProgram_, "queueIn"), in);
+        glDispatchComputeIndirect(0);
+        glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+
+        glUseProgram(shadeProgram_);
+        glUniform1i(glGetUniformLocation(shadeProgram_, "queueIn"), in);
+        glDispatchComputeIndirect(0);
+        glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT | GL_SHADER_IMAGE_ACCESS_BARRIER_BIT);
+
+        glUseProgram(advanceProgram_);
+        glUniform1i(glGetUniformLocation(advanceProgram_, "queueIn"), in);
+        glDispatchCompute(1, 1, 1);
+        glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT | GL_COMMAND_BARRIER_BIT);
+    }
+
+    glBindBuffer(GL_DISPATCH_INDIRECT_BUFFER, 0);
+    glUseProgram(0);
+    glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT | GL_BUFFER_UPDATE_BARRIER_BIT);
+}
+
+void WavefrontTracer::present() {
+    glUseProgram(presentProgram_);
+    glUniform1i(glGetUniformLocation(presentProgram_, "outputImage"), 0);
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D, outputTexture_.get());
+    glBindVertexArray(emptyVAO_.get());
+    glDrawArrays(GL_TRIANGLES, 0, 3);
+    frameMetrics().countDraw(1);
+    glBindVertexArray(0);
+    glBindTexture(GL_TEXTURE_2D, 0);
+}
+
+unsigned long long WavefrontTracer::raysTraced() {
+    GLuint total = 0;
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, stateBuffer_.get());
+    glGetBufferSubData(GL_SHADER_STORAGE_BUFFER, 5 * sizeof(GLuint), sizeof(GLuint), &total);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+    return total;
+}
@@ -0,0 +1,59 @@
+#ifndef TASK3_WAVEFRONT_H
+#define TASK3_WAVEFRONT_H
+
+#include "common/gl_handle.h"
+
+#include <functional>
+
+// Wavefront path tracer on GL 4.3 compute shaders. Instead of one fragment invocation
+// walking a whole path, each bounce runs as separate kernels over a ray queue in SSBOs:
+//   generate  camera rays for every pixel into queue 0
+//   extend    nearest hit for each queued ray
+//   shade     scatter off the material, add light to the output image and append
+//             surviving rays to the other queue
+// Shade compacts with an atomic counter, so later bounces only launch threads for live
+// rays; a one-thread kernel turns the count into the next indirect dispatch size.
+
+// Sets the camera and scene uniforms on the given program (already bound)
+typedef std::function<void(unsigned int program)> SceneUniformFunc;
+
+class WavefrontTracer {
+public:
+    WavefrontTracer();
+    ~WavefrontTracer();
+
+    // sceneSource: the GLSL scene description shared with the fragment tracer (no #version).
+    // Needs a 4.3 context with loadGl43() done.
+    bool init(const char* sceneSource);
+
+    // Traces one frame into the output image, reallocating the queues on resize
+    void trace(int width, int height, int maxBounces, const SceneUniformFunc& setUniforms);
+
+    // Draws the output image into the bound framebuffer (viewport already set)
+    void present();
+
+    // Ray segments extended during the last trace(); reads back and stalls the pipeline
+    unsigned long long raysTraced();
+
+private:
+    void resize(int width, int height);
+    void release();
+
+    unsigned int generateProgram_;
+    unsigned int extendProgram_;
+    unsigned int shadeProgram_;
+    unsigned int advanceProgram_;
+    unsigned int presentProgram_;
+    GlVertexArray emptyVAO_;
+
+    GlBuffer stateBuffer_;    // indirect dispatch args, queue counters, ray total
+    // Released on resize while the last frame may still be tracing into them, so they go
+    // through the deletion queue instead of being deleted on the spot
+    GlBuffer queueBuffers_[2];
+    GlBuffer hitBuffer_;
+    GlTexture outputTexture_;
+    int width_;
+    int height_;
+};
+
+#endif
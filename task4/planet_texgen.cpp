@@ -0,0 +1,373 @@
+#include "planet_texgen.h"
+
+#include "common/mapped_file.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <thread>
+
+#if !defined(PLANET_TEXGEN_NO_SIMD) && (defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2))
+#define PLANET_TEXGEN_SSE2
+#include <emmintrin.h>
+#endif
+
+#ifdef _WIN32
+#include <direct.h>
+#else
+#include <sys/stat.h>
+#endif
+
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+
+// 修改噪声或着色算法时递增, 使旧缓存失效
+static const uint32_t kGeneratorVersion = 1;
+static const uint32_t kCacheMagic = 0x58455450; // "PTEX"
+
+struct CacheHeader {
+    uint32_t magic;
+    uint32_t version;
+    uint64_t key;
+    int32_t width;
+    int32_t height;
+};
+
+static std::atomic<int> g_cacheHits(0);
+static std::atomic<int> g_generated(0);
+static std::atomic<long long> g_generatedTexels(0);
+static std::atomic<long long> g_generateCoreMicros(0); // 生成耗时 x 线程数
+static std::atomic<long long> g_cacheLoadMicros(0);
+
+// -- 三维梯度噪声 --
+// 晶格点的梯度取 8 个对角方向之一, 由整数哈希的低 3 位选择各分量符号,
+// 这样标量与 SIMD 版本都只需要整数乘法/异或, 两者结果一致
+
+static inline uint32_t hashLattice(int32_t x, int32_t y, int32_t z, uint32_t seed) {
+    uint32_t h = seed ^ ((uint32_t)x * 0x8da6b343u) ^ ((uint32_t)y * 0xd8163841u) ^ ((uint32_t)z * 0xcb1ab31fu);
+    h ^= h >> 13;
+    h *= 0x5bd1e995u;
+    h ^= h >> 15;
+    return h;
+}
+
+static inline float gradient(uint32_t h, float x, float y, float z) {
+    return ((h & 1) ? -x : x) + ((h & 2) ? -y : y) + ((h & 4) ? -z : z);
+}
+
+static inline float fade(float t) {
+    return t * t * t * (t * (t * 6.0f - 15.0f) + 10.0f);
+}
+
+static inline float lerp(float a, float b, float t) {
+    return a + (b - a) * t;
+}
+
+static float gradientNoise(float x, float y, float z, uint32_t seed) {
+    float fx = std::floor(x), fy = std::floor(y), fz = std::floor(z);
+    int32_t ix = (int32_t)fx, iy = (int32_t)fy, iz = (int32_t)fz;
+    x -= fx; y -= fy; z -= fz;
+    float u = fade(x), v = fade(y), w = fade(z);
+
+    float n000 = gradient(hashLattice(ix,     iy,     iz,     seed), x,        y,        z);
+    float n100 = gradient(hashLattice(ix + 1, iy,     iz,     seed), x - 1.0f, y,        z);
+    float n010 = gradient(hashLattice(ix,     iy + 1, iz,     seed), x,        y - 1.0f, z);
+    float n110 = gradient(hashLattice(ix + 1, iy + 1, iz,     seed), x - 1.0f, y - 1.0f, z);
+    float n001 = gradient(hashLattice(ix,     iy,     iz + 1, seed), x,        y,        z - 1.0f);
+    float n101 = gradient(hashLattice(ix + 1, iy,     iz + 1, seed), x - 1.0f, y,        z - 1.0f);
+    float n011 = gradient(hashLattice(ix,     iy + 1, iz + 1, seed), x,        y - 1.0f, z - 1.0f);
+    float n111 = gradient(hashLattice(ix + 1, iy + 1, iz + 1, seed), x - 1.0f, y - 1.0f, z - 1.0f);
+
+    return lerp(lerp(lerp(n000, n100, u), lerp(n010, n110, u), v),
+                lerp(lerp(n001, n101, u), lerp(n011, n111, u), v), w);
+}
+
+static float fbm(float x, float y, float z, const PlanetTextureParams& p) {
+    float sum = 0.0f, amplitude = 0.5f, frequency = p.frequency;
+    for (int o = 0; o < p.octaves; ++o) {
+        sum += amplitude * gradientNoise(x * frequency, y * frequency, z * frequency, p.seed + o);
+        frequency *= p.lacunarity;
+        amplitude *= p.gain;
+    }
+    return sum;
+}
+
+#ifdef PLANET_TEXGEN_SSE2
+// SSE2 没有 32 位整数乘法低位指令, 用两次 _mm_mul_epu32 拼出来
+static inline __m128i mullo32(__m128i a, __m128i b) {
+    __m128i even = _mm_mul_epu32(a, b);
+    __m128i odd = _mm_mul_epu32(_mm_srli_epi64(a, 32), _mm_srli_epi64(b, 32));
+    return _mm_unpacklo_epi32(_mm_shuffle_epi32(even, _MM_SHUFFLE(0, 0, 2, 0)),
+                              _mm_shuffle_epi32(odd, _MM_SHUFFLE(0, 0, 2, 0)));
+}
+
+static inline __m128i hashLattice4(__m128i x, __m128i y, __m128i z, __m128i seed) {
+    __m128i h = _mm_xor_si128(seed, mullo32(x, _mm_set1_epi32((int)0x8da6b343u)));
+    h = _mm_xor_si128(h, mullo32(y, _mm_set1_epi32((int)0xd8163841u)));
+    h = _mm_xor_si128(h, mullo32(z, _mm_set1_epi32((int)0xcb1ab31fu)));
+    h = _mm_xor_si128(h, _mm_srli_epi32(h, 13));
+    h = mullo32(h, _mm_set1_epi32(0x5bd1e995));
+    h = _mm_xor_si128(h, _mm_srli_epi32(h, 15));
+    return h;
+}
+
+// 哈希第 0/1/2 位移到符号位后与坐标异或, 等价于标量版本的条件取负
+static inline __m128 gradient4(__m128i h, __m128 x, __m128 y, __m128 z) {
+    __m128 sx = _mm_castsi128_ps(_mm_slli_epi32(h, 31));
+    __m128 sy = _mm_castsi128_ps(_mm_slli_epi32(_mm_srli_epi32(h, 1), 31));
+    __m128 sz = _mm_castsi128_ps(_mm_slli_epi32(_mm_srli_epi32(h, 2), 31));
+    return _mm_add_ps(_mm_add_ps(_mm_xor_ps(x, sx), _mm_xor_ps(y, sy)), _mm_xor_ps(z, sz));
+}
+
+static inline __m128 floor4(__m128 x) {
+    __m128 t = _mm_cvtepi32_ps(_mm_cvttps_epi32(x));
+    return _mm_sub_ps(t, _mm_and_ps(_mm_cmpgt_ps(t, x), _mm_set1_ps(1.0f)));
+}
+
+static inline __m128 fade4(__m128 t) {
+    __m128 inner = _mm_add_ps(_mm_mul_ps(t, _mm_sub_ps(_mm_mul_ps(t, _mm_set1_ps(6.0f)), _mm_set1_ps(15.0f))), _mm_set1_ps(10.0f));
+    return _mm_mul_ps(_mm_mul_ps(_mm_mul_ps(t, t), t), inner);
+}
+
+static inline __m128 lerp4(__m128 a, __m128 b, __m128 t) {
+    return _mm_add_ps(a, _mm_mul_ps(_mm_sub_ps(b, a), t));
+}
+
+static __m128 gradientNoise4(__m128 x, __m128 y, __m128 z, uint32_t seed) {
+    __m128 fx = floor4(x), fy = floor4(y), fz = floor4(z);
+    __m128i ix = _mm_cvttps_epi32(fx), iy = _mm_cvttps_epi32(fy), iz = _mm_cvttps_epi32(fz);
+    x = _mm_sub_ps(x, fx); y = _mm_sub_ps(y, fy); z = _mm_sub_ps(z, fz);
+    __m128 u = fade4(x), v = fade4(y), w = fade4(z);
+
+    const __m128i one = _mm_set1_epi32(1);
+    const __m128 onef = _mm_set1_ps(1.0f);
+    __m128i ix1 = _mm_add_epi32(ix, one), iy1 = _mm_add_epi32(iy, one), iz1 = _mm_add_epi32(iz, one);
+    __m128 x1 = _mm_sub_ps(x, onef), y1 = _mm_sub_ps(y, onef), z1 = _mm_sub_ps(z, onef);
+    __m128i s = _mm_set1_epi32((int)seed);
+
+    __m128 n000 = gradient4(hashLattice4(ix,  iy,  iz,  s), x,  y,  z);
+    __m128 n100 = gradient4(hashLattice4(ix1, iy,  iz,  s), x1, y,  z);
+    __m128 n010 = gradient4(hashLattice4(ix,  iy1, iz,  s), x,  y1, z);
+    __m128 n110 = gradient4(hashLattice4(ix1, iy1, iz,  s), x1, y1, z);
+    __m128 n001 = gradient4(hashLattice4(ix,  iy,  iz1, s), x,  y,  z1);
+    __m128 n101 = gradient4(hashLattice4(ix1, iy,  iz1, s), x1, y,  z1);
+    __m128 n011 = gradient4(hashLattice4(ix,  iy1, iz1, s), x,  y1, z1);
+    __m128 n111 = gradient4(hashLattice4(ix1, iy1, iz1, s), x1, y1, z1);
+
+    return lerp4(lerp4(lerp4(n000, n100, u), lerp4(n010, n110, u), v),
+                 lerp4(lerp4(n001, n101, u), lerp4(n011, n111, u), v), w);
+}
+
+static __m128 fbm4(__m128 x, __m128 y, __m128 z, const PlanetTextureParams& p) {
+    __m128 sum = _mm_setzero_ps();
+    float amplitude = 0.5f, frequency = p.frequency;
+    for (int o = 0; o < p.octaves; ++o) {
+        __m128 f = _mm_set1_ps(frequency);
+        __m128 n = gradientNoise4(_mm_mul_ps(x, f), _mm_mul_ps(y, f), _mm_mul_ps(z, f), p.seed + o);
+        sum = _mm_add_ps(sum, _mm_mul_ps(_mm_set1_ps(amplitude), n));
+        frequency *= p.lacunarity;
+        amplitude *= p.gain;
+    }
+    return sum;
+}
+#endif
+
+static inline float smoothstep(float e0, float e1, float x) {
+    float t = std::min(std::max((x - e0) / (e1 - e0), 0.0f), 1.0f);
+    return t * t * (3.0f - 2.0f * t);
+}
+
+// 把噪声值 (和纬度) 映射为颜色
+static inline void shade(const PlanetTextureParams& p, float n, float sinLat, unsigned char* out) {
+    glm::vec3 c;
+    if (p.gasGiant) {
+        float band = 0.5f + 0.5f * sinf((sinLat + p.turbulence * n) * p.bandFrequency);
+        c = glm::mix(p.colors[2], p.colors[3], band);
+        c = glm::mix(c, p.colors[1], smoothstep(0.25f, 0.6f, n) * 0.5f); // 风暴斑块
+    } else {
+        float h = 0.5f + n; // fBm 大致落在 [-0.5, 0.5]
+        if (h < p.seaLevel) {
+            c = glm::mix(p.colors[0], p.colors[1], smoothstep(0.0f, p.seaLevel, h));
+        } else {
+            c = glm::mix(p.colors[2], p.colors[3], smoothstep(p.seaLevel, 1.0f, h));
+        }
+    }
+    out[0] = (unsigned char)(std::min(std::max(c.x, 0.0f), 1.0f) * 255.0f + 0.5f);
+    out[1] = (unsigned char)(std::min(std::max(c.y, 0.0f), 1.0f) * 255.0f + 0.5f);
+    out[2] = (unsigned char)(std::min(std::max(c.z, 0.0f), 1.0f) * 255.0f + 0.5f);
+    out[3] = 255;
+}
+
+// 生成 [rowBegin, rowEnd) 行; 经度的 sin/cos 按列预先计算
+static void generateRows(const PlanetTextureParams& p, const float* cosLon, const float* sinLon,
+                         unsigned char* rgba, int rowBegin, int rowEnd) {
+    for (int y = rowBegin; y < rowEnd; ++y) {
+        // 第 0 行对应南极, 与 stb_image 翻转加载后的纹理约定一致
+        float lat = ((y + 0.5f) / p.height - 0.5f) * (float)M_PI;
+        float cosLat = cosf(lat), sinLat = sinf(lat);
+        unsigned char* row = rgba + (size_t)y * p.width * 4;
+        int x = 0;
+#ifdef PLANET_TEXGEN_SSE2
+        __m128 cl = _mm_set1_ps(cosLat), sl = _mm_set1_ps(sinLat);
+        for (; x + 4 <= p.width; x += 4) {
+            __m128 px = _mm_mul_ps(cl, _mm_loadu_ps(cosLon + x));
+            __m128 pz = _mm_mul_ps(cl, _mm_loadu_ps(sinLon + x));
+            float n[4];
+            _mm_storeu_ps(n, fbm4(px, sl, pz, p));
+            for (int i = 0; i < 4; ++i) {
+                shade(p, n[i], sinLat, row + (x + i) * 4);
+            }
+        }
+#endif
+        for (; x < p.width; ++x) {
+            float n = fbm(cosLat * cosLon[x], sinLat, cosLat * sinLon[x], p);
+            shade(p, n, sinLat, row + x * 4);
+        }
+    }
+}
+
+void generatePlanetTexture(const PlanetTextureParams& params, unsigned char* rgba, int threadCount) {
+    std::vector<float> cosLon(params.width), sinLon(params.width);
+    for (int x = 0; x < params.width; ++x) {
+        float lon = (x + 0.5f) / params.width * 2.0f * (float)M_PI;
+        cosLon[x] = cosf(lon);
+        sinLon[x] = sinf(lon);
+    }
+
+    // 不放进 jobSystem(): 主线程每帧在 JobGroup::wait() 里会顺带执行队列中的任务, 抢到一段生成任务
+    // 就会卡住这一帧。生成只在加载纹理时发生, 每张纹理创建一次线程的开销相对生成本身可以忽略
+    threadCount = std::max(1, std::min(threadCount, params.height));
+    std::vector<std::thread> threads;
+    int rowsPerThread = (params.height + threadCount - 1) / threadCount;
+    for (int t = 1; t < threadCount; ++t) {
+        int begin = t * rowsPerThread;
+        int end = std::min(params.height, begin + rowsPerThread);
+        if (begin >= end) break;
+        threads.push_back(std::thread(generateRows, std::cref(params), cosLon.data(), sinLon.data(), rgba, begin, end));
+    }
+    generateRows(params, cosLon.data(), sinLon.data(), rgba, 0, std::min(params.height, rowsPerThread));
+    for (size_t i = 0; i < threads.size(); ++i) {
+        threads[i].join();
+    }
+}
+
+// FNV-1a, 按字段逐个哈希以避开结构体填充字节
+static void hashBytes(uint64_t& h, const void* data, size_t size) {
+    const unsigned char* bytes = static_cast<const unsigned char*>(data);
+    for (size_t i = 0; i < size; ++i) {
+        h ^= bytes[i];
+        h *= 1099511628211ull;
+    }
+}
+
+uint64_t planetTextureKey(const PlanetTextureParams& p) {
+    uint64_t h = 14695981039346656037ull;
+    hashBytes(h, &kGeneratorVersion, sizeof(kGeneratorVersion));
+    hashBytes(h, &p.seed, sizeof(p.seed));
+    hashBytes(h, &p.width, sizeof(p.width));
+    hashBytes(h, &p.height, sizeof(p.height));
+    hashBytes(h, &p.octaves, sizeof(p.octaves));
+    hashBytes(h, &p.frequency, sizeof(p.frequency));
+    hashBytes(h, &p.lacunarity, sizeof(p.lacunarity));
+    hashBytes(h, &p.gain, sizeof(p.gain));
+    unsigned char gasGiant = p.gasGiant ? 1 : 0;
+    hashBytes(h, &gasGiant, sizeof(gasGiant));
+    hashBytes(h, &p.bandFrequency, sizeof(p.bandFrequency));
+    hashBytes(h, &p.turbulence, sizeof(p.turbulence));
+    hashBytes(h, &p.seaLevel, sizeof(p.seaLevel));
+    for (int i = 0; i < 4; ++i) {
+        hashBytes(h, &p.colors[i].x, sizeof(float));
+        hashBytes(h, &p.colors[i].y, sizeof(float));
+        hashBytes(h, &p.colors[i].z, sizeof(float));
+    }
+    return h;
+}
+
+static void makeDirectory(const std::string& dir) {
+#ifdef _WIN32
+    _mkdir(dir.c_str());
+#else
+    mkdir(dir.c_str(), 0755);
+#endif
+}
+
+static long long microsSince(std::chrono::steady_clock::time_point start) {
+    return (long long)std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count();
+}
+
+bool loadOrGeneratePlanetTexture(const PlanetTextureParams& params, const std::string& cacheDir, int threadCount,
+                                 int& width, int& height, std::vector<unsigned char>& rgba) {
+    char keyHex[17];
+    std::snprintf(keyHex, sizeof(keyHex), "%016llx", (unsigned long long)planetTextureKey(params));
+    std::string path = cacheDir + "/planet_" + keyHex + ".ptex";
+    size_t imageBytes = (size_t)params.width * params.height * 4;
+
+    // 热启动: 缓存文件直接 mmap, 校验头部后拷出像素
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    MappedFile cached;
+    if (cached.open(path) && cached.size() == sizeof(CacheHeader) + imageBytes) {
+        CacheHeader header;
+        std::memcpy(&header, cached.data(), sizeof(header));
+        if (header.magic == kCacheMagic && header.version == kGeneratorVersion && header.key == planetTextureKey(params)
+            && header.width == params.width && header.height == params.height) {
+            width = params.width;
+            height = params.height;
+            rgba.assign(cached.data() + sizeof(CacheHeader), cached.data() + cached.size());
+            g_cacheHits++;
+            g_cacheLoadMicros += microsSince(start);
+            return true;
+        }
+    }
+    cached.close();
+
+    // 冷启动: 生成后写入临时文件再重命名, 避免其他进程读到写了一半的缓存
+    width = params.width;
+    height = params.height;
+    rgba.resize(imageBytes);
+    start = std::chrono::steady_clock::now();
+    generatePlanetTexture(params, rgba.data(), threadCount);
+    long long micros = microsSince(start);
+    g_generated++;
+    g_generatedTexels += (long long)params.width * params.height;
+    g_generateCoreMicros += micros * std::max(1, std::min(threadCount, params.height));
+
+    makeDirectory(cacheDir);
+    std::string tmpPath = path + ".tmp";
+    FILE* f = std::fopen(tmpPath.c_str(), "wb");
+    if (f) {
+        CacheHeader header = { kCacheMagic, kGeneratorVersion, planetTextureKey(params), params.width, params.height };
+        bool ok = std::fwrite(&header, sizeof(header), 1, f) == 1 && std::fwrite(rgba.data(), 1, imageBytes, f) == imageBytes;
+        ok = (std::fclose(f) == 0) && ok;
+        if (!ok || std::rename(tmpPath.c_str(), path.c_str()) != 0) {
+            std::remove(tmpPath.c_str());
+        }
+    }
+    return true;
+}
+
+void printPlanetTexgenStats(std::ostream& os) {
+    os << "[程序纹理] 生成 " << g_generated.load() << " 张, 缓存命中 " << g_cacheHits.load() << " 张";
+    if (g_generateCoreMicros.load() > 0) {
+        double mtexelsPerCoreSecond = (double)g_generatedTexels.load() / (double)g_generateCoreMicros.load();
+        os << ", 生成吞吐 " << mtexelsPerCoreSecond << " Mtexel/s/核";
+#ifdef PLANET_TEXGEN_SSE2
+        os << " (SSE2)";
+#else
+        os << " (标量)";
+#endif
+    }
+    if (g_cacheHits.load() > 0) {
+        os << ", 缓存读取共 " << g_cacheLoadMicros.load() / 1000.0 << " ms";
+    }
+    os << std::endl;
+}
+
+void planetTexgenCounts(int& cacheHits, int& generated) {
+    cacheHits = g_cacheHits.load();
+    generated = g_generated.load();
+}
@@ -0,0 +1,44 @@
+#ifndef TASK4_PLANET_TEXGEN_H
+#define TASK4_PLANET_TEXGEN_H
+
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <iosfwd>
+#include <string>
+#include <vector>
+
+// 程序化行星表面纹理: 在球面上对三维梯度噪声做 fBm, 按等距柱状投影展开成 RGBA8 图像
+// 类地行星按高度映射到 海洋/陆地 调色板, 气态巨行星用受噪声扰动的纬向条带
+struct PlanetTextureParams {
+    unsigned int seed = 1;
+    int width = 1024;
+    int height = 512;
+    int octaves = 6;
+    float frequency = 2.0f;     // 单位球面上的基础噪声频率
+    float lacunarity = 2.0f;    // 每个八度的频率倍数
+    float gain = 0.5f;          // 每个八度的振幅倍数
+    bool gasGiant = false;
+    float bandFrequency = 12.0f; // 气态巨行星的纬向条带频率
+    float turbulence = 0.4f;     // 条带受噪声扰动的强度
+    float seaLevel = 0.0f;       // 低于该值映射为海洋, 0 表示没有海洋
+    glm::vec3 colors[4];         // 深海, 浅海, 低地, 高地
+};
+
+// 由所有生成参数计算的缓存键, 参数或生成算法版本变化都会得到新键
+uint64_t planetTextureKey(const PlanetTextureParams& params);
+
+// 用 threadCount 个线程按行分块生成纹理, rgba 至少容纳 width * height * 4 字节
+void generatePlanetTexture(const PlanetTextureParams& params, unsigned char* rgba, int threadCount);
+
+// 优先从 cacheDir 下按参数键命名的缓存文件 mmap 读取, 未命中时生成并写入缓存
+bool loadOrGeneratePlanetTexture(const PlanetTextureParams& params, const std::string& cacheDir, int threadCount,
+                                 int& width, int& height, std::vector<unsigned char>& rgba);
+
+// 打印累计的生成吞吐 (Mtexel/s/核) 与缓存命中情况
+void printPlanetTexgenStats(std::ostream& os);
+
+// 缓存命中次数与生成次数, 用于区分冷/热启动
+void planetTexgenCounts(int& cacheHits, int& generated);
+
+#endif
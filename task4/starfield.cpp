@@ -0,0 +1,149 @@
+#include "starfield.h"
+
+#include <glad/glad.h>
+#include <glm/gtc/type_ptr.hpp>
+
+#include "common/gpu_memory.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <random>
+#include <vector>
+
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+
+static const uint32_t kStarCatalogMagic = 0x52415453; // "STAR"
+static const uint32_t kStarCatalogVersion = 1;
+
+bool writeSyntheticStarCatalog(const std::string& path, uint32_t count, uint32_t seed) {
+    std::mt19937 rng(seed);
+    std::uniform_real_distribution<float> uniform(0.0f, 1.0f);
+    std::normal_distribution<float> galacticLatitude(0.0f, 0.12f);
+
+    // 银道面相对黄道倾斜约 60 度
+    const float tilt = glm::radians(60.0f);
+    const float cosTilt = cosf(tilt), sinTilt = sinf(tilt);
+
+    // 从蓝白到橙红的恒星颜色
+    const glm::vec3 palette[4] = {
+        glm::vec3(0.70f, 0.80f, 1.00f),
+        glm::vec3(1.00f, 1.00f, 1.00f),
+        glm::vec3(1.00f, 0.93f, 0.78f),
+        glm::vec3(1.00f, 0.70f, 0.50f)
+    };
+
+    std::vector<StarRecord> stars(count);
+    for (uint32_t i = 0; i < count; ++i) {
+        float lon = uniform(rng) * 2.0f * (float)M_PI;
+        float lat;
+        if (uniform(rng) < 0.4f) {
+            lat = galacticLatitude(rng);
+        } else {
+            lat = asinf(2.0f * uniform(rng) - 1.0f); // 球面均匀分布
+        }
+        glm::vec3 d(cosf(lat) * cosf(lon), sinf(lat), cosf(lat) * sinf(lon));
+        glm::vec3 dir(d.x, d.y * cosTilt - d.z * sinTilt, d.y * sinTilt + d.z * cosTilt);
+
+        // 累计分布 N(<m) ∝ 10^(0.5m) 的逆变换采样, 极限星等 8
+        float magnitude = 8.0f + 2.0f * log10f(std::max(uniform(rng), 1e-6f));
+        magnitude = std::max(magnitude, -1.5f);
+
+        float t = std::min(std::max(uniform(rng) * 0.8f + uniform(rng) * 0.4f, 0.0f), 0.999f) * 3.0f;
+        int k = (int)t;
+        glm::vec3 color = glm::mix(palette[k], palette[k + 1], t - k);
+
+        StarRecord& s = stars[i];
+        s.direction[0] = dir.x;
+        s.direction[1] = dir.y;
+        s.direction[2] = dir.z;
+        s.magnitudeTenths = (int8_t)lroundf(magnitude * 10.0f);
+        s.color[0] = (uint8_t)(color.x * 255.0f + 0.5f);
+        s.color[1] = (uint8_t)(color.y * 255.0f + 0.5f);
+        s.color[2] = (uint8_t)(color.z * 255.0f + 0.5f);
+    }
+
+    FILE* f = std::fopen(path.c_str(), "wb");
+    if (!f) return false;
+    StarCatalogHeader header = { kStarCatalogMagic, kStarCatalogVersion, count, 0 };
+    bool ok = std::fwrite(&header, sizeof(header), 1, f) == 1
+           && std::fwrite(stars.data(), sizeof(StarRecord), count, f) == count;
+    ok = (std::fclose(f) == 0) && ok;
+    return ok;
+}
+
+bool Starfield::map(const std::string& path) {
+    MappedFile& file = catalog_;
+    if (!file.open(path) || file.size() < sizeof(StarCatalogHeader)) {
+        std::cerr << "无法打开星表: " << path << std::endl;
+        file.close();
+        return false;
+    }
+    StarCatalogHeader header;
+    std::memcpy(&header, file.data(), sizeof(header));
+    if (header.magic != kStarCatalogMagic || header.version != kStarCatalogVersion
+        || file.size() != sizeof(StarCatalogHeader) + (size_t)header.count * sizeof(StarRecord)) {
+        std::cerr << "星表格式无效: " << path << std::endl;
+        file.close();
+        return false;
+    }
+    file.prefault(); // 上传时 GL 线程不再等待读盘
+    return true;
+}
+
+void Starfield::upload() {
+    const MappedFile& file = catalog_;
+    StarCatalogHeader header;
+    std::memcpy(&header, file.data(), sizeof(header));
+
+    // 记录布局就是顶点布局, 映射的文件内容直接上传, 无需解析
+    vao_ = GlVertexArray::create();
+    vbo_ = GlBuffer::create();
+    glBindVertexArray(vao_.get());
+    glBindBuffer(GL_ARRAY_BUFFER, vbo_.get());
+    gpuBufferData(GL_ARRAY_BUFFER, vbo_.get(), (GLsizeiptr)header.count * sizeof(StarRecord), file.data() + sizeof(StarCatalogHeader),
+                  GL_STATIC_DRAW, GpuCategory::VertexBuffer);
+    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(StarRecord), (void*)0);
+    glEnableVertexAttribArray(0);
+    glVertexAttribPointer(1, 1, GL_BYTE, GL_FALSE, sizeof(StarRecord), (void*)offsetof(StarRecord, magnitudeTenths));
+    glEnableVertexAttribArray(1);
+    glVertexAttribPointer(2, 3, GL_UNSIGNED_BYTE, GL_TRUE, sizeof(StarRecord), (void*)offsetof(StarRecord, color));
+    glEnableVertexAttribArray(2);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    glBindVertexArray(0);
+
+    count_ = header.count;
+    catalog_.close();
+}
+
+void Starfield::draw(unsigned int shaderProgram, const glm::mat4& view, const glm::mat4& projection, float sizeScale) const {
+    if (count_ == 0) return;
+
+    // 恒星在无穷远处, 只使用视图矩阵的旋转部分
+    glm::mat4 rotationOnly = glm::mat4(glm::mat3(view));
+    glUseProgram(shaderProgram);
+    glUniformMatrix4fv(glGetUniformLocation(shaderProgram, "view"), 1, GL_FALSE, glm::value_ptr(rotationOnly));
+    glUniformMatrix4fv(glGetUniformLocation(shaderProgram, "projection"), 1, GL_FALSE, glm::value_ptr(projection));
+    glUniform1f(glGetUniformLocation(shaderProgram, "sizeScale"), sizeScale);
+
+    // 背景最先绘制: 不做深度测试也不写深度, 加法混合叠加亮度
+    glDisable(GL_DEPTH_TEST);
+    glDepthMask(GL_FALSE);
+    glEnable(GL_BLEND);
+    glBlendFunc(GL_ONE, GL_ONE);
+    glEnable(GL_PROGRAM_POINT_SIZE);
+
+    glBindVertexArray(vao_.get());
+    glDrawArrays(GL_POINTS, 0, (GLsizei)count_);
+    glBindVertexArray(0);
+
+    glDisable(GL_PROGRAM_POINT_SIZE);
+    glDisable(GL_BLEND);
+    glDepthMask(GL_TRUE);
+    glEnable(GL_DEPTH_TEST);
+}
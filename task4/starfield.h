@@ -0,0 +1,59 @@
+#ifndef TASK4_STARFIELD_H
+#define TASK4_STARFIELD_H
+
+#include <glm/glm.hpp>
+
+#include "common/gl_handle.h"
+#include "common/mapped_file.h"
+
+#include <cstdint>
+#include <string>
+
+// 星表文件格式: 文件头 + 紧密排列的 StarRecord, 整个文件 mmap 后直接作为顶点数据上传
+struct StarCatalogHeader {
+    uint32_t magic;   // "STAR"
+    uint32_t version;
+    uint32_t count;
+    uint32_t reserved;
+};
+
+struct StarRecord {
+    float direction[3];      // 天球上的单位方向
+    int8_t magnitudeTenths;  // 视星等 x10
+    uint8_t color[3];        // sRGB 颜色
+};
+
+static_assert(sizeof(StarCatalogHeader) == 16, "星表文件头必须为 16 字节");
+static_assert(sizeof(StarRecord) == 16, "星表记录必须为 16 字节");
+
+// 生成一份合成星表: 星等按 N(<m) ∝ 10^(0.5m) 分布, 约四成集中在倾斜的银道面附近
+bool writeSyntheticStarCatalog(const std::string& path, uint32_t count, uint32_t seed);
+
+// 星空背景: 所有恒星放在一个静态缓冲区中, 一次 GL_POINTS 绘制
+class Starfield {
+public:
+    Starfield() {}
+    Starfield(const Starfield&) = delete;
+    Starfield& operator=(const Starfield&) = delete;
+
+    // mmap 星表并上传到静态顶点缓冲区, 失败时返回 false
+    bool load(const std::string& path) { return map(path) && (upload(), true); }
+
+    // load 的两个阶段: map 只做 mmap 和校验, 不调用 GL, 可以在工作线程上执行;
+    // upload 在 GL 线程上把映射的内容上传到顶点缓冲区, 随后解除映射
+    bool map(const std::string& path);
+    void upload();
+
+    // 使用 shaderProgram 绘制; sizeScale 放大点精灵, 用于填充率测试
+    void draw(unsigned int shaderProgram, const glm::mat4& view, const glm::mat4& projection, float sizeScale) const;
+
+    uint32_t count() const { return count_; }
+
+private:
+    GlVertexArray vao_;
+    GlBuffer vbo_;
+    MappedFile catalog_;   // map 与 upload 之间持有映射
+    uint32_t count_ = 0;
+};
+
+#endif
@@ -7,29 +7,93 @@
 #include <iostream>
 #include <vector>
 #include <cmath>
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <thread>
+
+#include "common/async_load.h"
+#include "common/gl_handle.h"
+#include "common/gpu_memory.h"
+#include "common/gpu_timer.h"
+#include "common/input_trace.h"
+#include "common/job_system.h"
+#include "common/latency.h"
+#include "common/metrics_exporter.h"
+#include "common/startup_profile.h"
+#ifndef _WIN32
+#include "common/render_server.h"
+#endif
+#include "planet_texgen.h"
+#include "starfield.h"
+#include "texture_streamer.h"
 
 #ifndef M_PI
 #define M_PI 3.14159265358979323846
 #endif
 
+// 单位球体网格, 所有球形天体共用 (实际大小通过 model 矩阵控制)
+struct SphereMesh {
+    GlVertexArray vao;
+    GlBuffer vbo;
+    GlBuffer ebo;
+    GLsizei indexCount = 0;
+};
+
 // 函数声明
 void framebuffer_size_callback(GLFWwindow* window, int width, int height);
 void processInput(GLFWwindow *window);
 unsigned int compileShader(unsigned int type, const char* source);
 unsigned int createShaderProgram(const char* vertexSource, const char* fragmentSource);
-std::vector<float> createSphere(float radius, int sectorCount, int stackCount);
+std::vector<float> createSphere(float radius, int sectorCount, int stackCount, std::vector<unsigned int>& indices);
+LoadTask<unsigned int> loadShaderProgram(GlThreadQueue& gl, const char* vertexSource, const char* fragmentSource);
+LoadTask<SphereMesh> loadSphereMesh(GlThreadQueue& gl, int sectorCount, int stackCount);
+LoadTask<bool> loadStarfield(GlThreadQueue& gl, Starfield& starfield, std::string catalogPath);
+float screenDiameter(const glm::mat4& model, float radius, const glm::vec3& cameraPos, float fovY, int viewportHeight);
+void bindBodyTexture(unsigned int shaderProgram, const TextureStreamer& streamer, int textureId);
+PlanetTextureParams planetParams(unsigned int seed, int width, bool gasGiant, float seaLevel,
+                                 const glm::vec3& c0, const glm::vec3& c1, const glm::vec3& c2, const glm::vec3& c3);
+int addBodyTexture(TextureStreamer& streamer, const std::string& name, const PlanetTextureParams& params, int texgenThreads);
 void drawOrbit(unsigned int shaderProgram, float radius, const glm::mat4& view, const glm::mat4& projection, float tiltAngle = 0.0f, const glm::vec3& tiltAxis = glm::vec3(1.0f, 0.0f, 0.0f));
 void drawRing(unsigned int shaderProgram, float innerRadius, float outerRadius, const glm::mat4& view, const glm::mat4& projection, const glm::mat4& planetModelMatrix, float tiltAngle, const glm::vec3& tiltAxis);
 
+// 绘制太阳系所需的常驻资源, 交互渲染循环和渲染服务共用
+struct SolarSystemScene {
+    unsigned int shaderProgram;
+    unsigned int starShaderProgram;
+    unsigned int sphereVAO;
+    GLsizei sphereIndexCount;
+    TextureStreamer* textureStreamer;
+    Starfield* starfield;
+    int sunTexture, mercuryTexture, venusTexture, earthTexture, moonTexture, marsTexture, jupiterTexture, saturnTexture;
+};
+void drawSolarSystem(const SolarSystemScene& scene, const glm::vec3& cameraPos, const glm::vec3& cameraTarget,
+                     float fovY, float aspect, int viewportHeight, float timeValue,
+                     bool drawStars, float starSizeScale, GpuTimer* gpuTimer);
+
 
 // 窗口设置
 const unsigned int SCR_WIDTH = 1200; // 增加窗口宽度以便更好地显示
 const unsigned int SCR_HEIGHT = 800; // 增加窗口高度
 
+// 摄像机缩放 (W/S 拉近/拉远), 用于观察纹理随屏幕尺寸流送
+float cameraZoom = 1.0f;
+float deltaTime = 0.0f;
+float lastFrame = 0.0f;
+bool printStreamerStats = false; // 按 T 打印纹理驻留统计
+bool printGpuMemory = false;     // 按 M 打印显存分类统计
+
 // 顶点着色器源码 (GLSL)
 const char *vertexShaderSource = R"(
     #version 330 core
     layout (location = 0) in vec3 aPos; // 顶点位置输入
+    layout (location = 1) in vec2 aTexCoord; // 纹理坐标 (轨道和环没有该属性)
+
+    out vec2 TexCoord;
 
     uniform mat4 model;      // 模型矩阵 (物体局部坐标 -> 世界坐标)
     uniform mat4 view;       // 视图矩阵 (世界坐标 -> 观察空间)
@@ -39,6 +103,7 @@ const char *vertexShaderSource = R"(
     {
         // 将顶点位置通过 MVP 矩阵变换到裁剪空间
         gl_Position = projection * view * model * vec4(aPos, 1.0);
+        TexCoord = aTexCoord;
     }
 )";
 
@@ -47,39 +112,213 @@ const char *fragmentShaderSource = R"(
     #version 330 core
     out vec4 FragColor; // 输出的颜色
 
+    in vec2 TexCoord;
+
     uniform vec3 objectColor; // 从 CPU 传入的物体颜色
+    uniform sampler2D bodyTexture; // 天体表面纹理
+    uniform bool useTexture;       // 纹理尚未驻留时使用纯色
 
     void main()
     {
-        // 直接使用传入的颜色作为片段的最终颜色
-        FragColor = vec4(objectColor, 1.0f);
+        if (useTexture)
+            FragColor = vec4(texture(bodyTexture, TexCoord).rgb, 1.0f);
+        else
+            FragColor = vec4(objectColor, 1.0f); // 直接使用传入的颜色作为片段的最终颜色
     }
 )";
 
-// 创建球体顶点数据
-std::vector<float> createSphere(float radius, int sectorCount, int stackCount) {
-    std::vector<float> vertices;
-    float x, y, z, xy;
+// 星空顶点着色器: 恒星方向只经过视图旋转, 深度固定在远平面; 星等越亮点越大
+const char *starVertexShaderSource = R"(
+    #version 330 core
+    layout (location = 0) in vec3 aDirection;
+    layout (location = 1) in float aMagnitudeTenths;
+    layout (location = 2) in vec3 aColor;
+
+    uniform mat4 view;       // 只含旋转部分
+    uniform mat4 projection;
+    uniform float sizeScale; // 点精灵放大倍数 (填充率测试用)
+
+    out vec3 StarColor;
+
+    void main()
+    {
+        float magnitude = aMagnitudeTenths * 0.1;
+        // 每暗 1 等亮度约降为 0.4 倍, 极暗的星保留一点底亮度
+        float brightness = clamp(pow(2.512, 1.0 - magnitude), 0.05, 1.0);
+        StarColor = aColor * brightness;
+        gl_PointSize = sizeScale * mix(1.0, 4.0, clamp((6.0 - magnitude) / 7.5, 0.0, 1.0));
+        gl_Position = (projection * view * vec4(aDirection, 1.0)).xyww;
+    }
+)";
+
+// 星空片段着色器: 圆形点精灵, 从中心向边缘衰减
+const char *starFragmentShaderSource = R"(
+    #version 330 core
+    in vec3 StarColor;
+    out vec4 FragColor;
+
+    void main()
+    {
+        float r = length(gl_PointCoord - vec2(0.5)) * 2.0;
+        float falloff = clamp(1.0 - r * r, 0.0, 1.0);
+        FragColor = vec4(StarColor * falloff, 1.0);
+    }
+)";
+
+// 创建球体顶点数据 (位置和纹理坐标交错) 和索引
+// 极轴沿 Y 轴, 与天体自转轴一致, 纹理按等距柱状投影映射
+// 各行写到预先算好的位置, 行数超过 kSphereRowGrain 时由任务系统按行并行生成
+std::vector<float> createSphere(float radius, int sectorCount, int stackCount, std::vector<unsigned int>& indices) {
+    const size_t kSphereRowGrain = 32;
     float sectorStep = 2 * M_PI / sectorCount;
     float stackStep = M_PI / stackCount;
-    float sectorAngle, stackAngle;
-
-    for(int i = 0; i <= stackCount; ++i) {
-        stackAngle = M_PI / 2 - i * stackStep;
-        xy = radius * cosf(stackAngle);
-        z = radius * sinf(stackAngle);
-        for(int j = 0; j <= sectorCount; ++j) {
-            sectorAngle = j * sectorStep;
-            x = xy * cosf(sectorAngle);
-            y = xy * sinf(sectorAngle);
-            vertices.push_back(x);
-            vertices.push_back(y);
-            vertices.push_back(z);
+
+    // 首行和末行只有一半三角形
+    std::vector<float> vertices((size_t)(stackCount + 1) * (sectorCount + 1) * 5);
+    indices.assign(stackCount > 1 ? (size_t)(2 * stackCount - 2) * sectorCount * 3 : 0, 0u);
+
+    parallelFor(0, stackCount + 1, kSphereRowGrain, [&](size_t first, size_t last) {
+        for (int i = (int)first; i < (int)last; ++i) {
+            float stackAngle = M_PI / 2 - i * stackStep;
+            float xz = radius * cosf(stackAngle);
+            float y = radius * sinf(stackAngle);
+            float* v = &vertices[(size_t)i * (sectorCount + 1) * 5];
+            for (int j = 0; j <= sectorCount; ++j, v += 5) {
+                float sectorAngle = j * sectorStep;
+                v[0] = xz * cosf(sectorAngle);
+                v[1] = y;
+                v[2] = xz * sinf(sectorAngle);
+                v[3] = (float)j / sectorCount;        // u: 经度
+                v[4] = 1.0f - (float)i / stackCount;  // v: 纬度, 北极为 1
+            }
+
+            if (i == stackCount || indices.empty()) continue;
+            unsigned int k1 = i * (sectorCount + 1);
+            unsigned int k2 = k1 + sectorCount + 1;
+            unsigned int* out = &indices[(size_t)(2 * i - std::min(i, 1)) * sectorCount * 3];
+            for (int j = 0; j < sectorCount; ++j, ++k1, ++k2) {
+                if (i != 0) {
+                    *out++ = k1;
+                    *out++ = k2;
+                    *out++ = k1 + 1;
+                }
+                if (i != (stackCount - 1)) {
+                    *out++ = k1 + 1;
+                    *out++ = k2;
+                    *out++ = k2 + 1;
+                }
+            }
         }
-    }
+    });
     return vertices;
 }
 
+// 天体在屏幕上的投影直径 (像素), 用于选择纹理 mip 级别
+float screenDiameter(const glm::mat4& model, float radius, const glm::vec3& cameraPos, float fovY, int viewportHeight) {
+    glm::vec3 center = glm::vec3(model[3]);
+    float distance = glm::length(center - cameraPos);
+    if (distance <= radius) return (float)viewportHeight;
+    return 2.0f * radius / (distance * tanf(fovY * 0.5f)) * (viewportHeight * 0.5f);
+}
+
+// 程序化纹理参数, 高度为宽度的一半 (等距柱状投影)
+PlanetTextureParams planetParams(unsigned int seed, int width, bool gasGiant, float seaLevel,
+                                 const glm::vec3& c0, const glm::vec3& c1, const glm::vec3& c2, const glm::vec3& c3) {
+    PlanetTextureParams p;
+    p.seed = seed;
+    p.width = width;
+    p.height = width / 2;
+    p.gasGiant = gasGiant;
+    p.seaLevel = seaLevel;
+    p.colors[0] = c0;
+    p.colors[1] = c1;
+    p.colors[2] = c2;
+    p.colors[3] = c3;
+    return p;
+}
+
+// 天体纹理来源: 优先使用 textures/<name>.jpg, 不存在时在工作线程上程序化生成 (结果缓存在 cache/ 下)
+int addBodyTexture(TextureStreamer& streamer, const std::string& name, const PlanetTextureParams& params, int texgenThreads) {
+    std::string path = "textures/" + name + ".jpg";
+    FILE* f = std::fopen(path.c_str(), "rb");
+    if (f) {
+        std::fclose(f);
+        return streamer.addTexture(path);
+    }
+    return streamer.addTexture(name + " (程序化)", [params, texgenThreads](int& w, int& h, std::vector<unsigned char>& rgba) {
+        return loadOrGeneratePlanetTexture(params, "cache", texgenThreads, w, h, rgba);
+    });
+}
+
+// 着色器程序在 GL 线程上编译链接; 在 GL 线程上发起时立即完成
+LoadTask<unsigned int> loadShaderProgram(GlThreadQueue& gl, const char* vertexSource, const char* fragmentSource) {
+    co_await resumeOnGlThread(gl);
+    co_return createShaderProgram(vertexSource, fragmentSource);
+}
+
+// 工作线程上生成顶点和索引, GL 线程上创建缓冲区
+LoadTask<SphereMesh> loadSphereMesh(GlThreadQueue& gl, int sectorCount, int stackCount) {
+    co_await resumeOnWorker();
+    std::vector<unsigned int> indices;
+    std::vector<float> vertices;
+    {
+        StartupScope scope("sphere mesh generate");
+        vertices = createSphere(1.0f, sectorCount, stackCount, indices);
+    }
+
+    co_await resumeOnGlThread(gl);
+    StartupScope scope("sphere mesh upload");
+    SphereMesh mesh;
+    mesh.indexCount = (GLsizei)indices.size();
+    mesh.vao = GlVertexArray::create();
+    mesh.vbo = GlBuffer::create();
+    mesh.ebo = GlBuffer::create();
+    glBindVertexArray(mesh.vao.get());
+    glBindBuffer(GL_ARRAY_BUFFER, mesh.vbo.get());
+    gpuBufferData(GL_ARRAY_BUFFER, mesh.vbo.get(), vertices.size() * sizeof(float), vertices.data(), GL_STATIC_DRAW, GpuCategory::VertexBuffer);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, mesh.ebo.get());
+    gpuBufferData(GL_ELEMENT_ARRAY_BUFFER, mesh.ebo.get(), indices.size() * sizeof(unsigned int), indices.data(), GL_STATIC_DRAW, GpuCategory::IndexBuffer);
+    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 5 * sizeof(float), (void*)0);
+    glEnableVertexAttribArray(0);
+    glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, 5 * sizeof(float), (void*)(3 * sizeof(float)));
+    glEnableVertexAttribArray(1);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    glBindVertexArray(0);
+    co_return mesh;
+}
+
+// 星空背景: 工作线程上映射星表 (缺失时先生成一份 12 万颗星的合成星表), GL 线程上上传
+LoadTask<bool> loadStarfield(GlThreadQueue& gl, Starfield& starfield, std::string catalogPath) {
+    co_await resumeOnWorker();
+    FILE* catalogFile = std::fopen(catalogPath.c_str(), "rb");
+    if (catalogFile) {
+        std::fclose(catalogFile);
+    } else {
+        StartupScope scope("star catalog generate");
+        if (!writeSyntheticStarCatalog(catalogPath, 120000, 2024))
+            std::cerr << "无法写入星表: " << catalogPath << std::endl;
+    }
+    {
+        StartupScope scope("star catalog map");
+        if (!starfield.map(catalogPath)) co_return false;
+    }
+
+    co_await resumeOnGlThread(gl);
+    StartupScope scope("star catalog upload");
+    starfield.upload();
+    co_return true;
+}
+
+// 绑定天体纹理; 纹理尚未驻留时退回纯色
+void bindBodyTexture(unsigned int shaderProgram, const TextureStreamer& streamer, int textureId) {
+    unsigned int tex = streamer.texture(textureId);
+    glUniform1i(glGetUniformLocation(shaderProgram, "useTexture"), tex != 0);
+    if (tex != 0) {
+        glActiveTexture(GL_TEXTURE0);
+        glBindTexture(GL_TEXTURE_2D, tex);
+    }
+}
+
 // 绘制轨道
 void drawOrbit(unsigned int shaderProgram, float radius, const glm::mat4& view, const glm::mat4& projection, float tiltAngle, const glm::vec3& tiltAxis) {
     unsigned int modelLoc = glGetUniformLocation(shaderProgram, "model");
@@ -108,21 +347,20 @@ void drawOrbit(unsigned int shaderProgram, float radius, const glm::mat4& view,
         orbitVertices.push_back(z);
     }
 
-    unsigned int orbitVAO, orbitVBO;
-    glGenVertexArrays(1, &orbitVAO);
-    glGenBuffers(1, &orbitVBO);
-    glBindVertexArray(orbitVAO);
-    glBindBuffer(GL_ARRAY_BUFFER, orbitVBO);
-    glBufferData(GL_ARRAY_BUFFER, orbitVertices.size() * sizeof(float), orbitVertices.data(), GL_STATIC_DRAW);
+    // 每次绘制都重建顶点缓冲; 句柄离开作用域时交给删除队列, 等这一帧在 GPU 上执行完才删除
+    GlVertexArray orbitVAO = GlVertexArray::create();
+    GlBuffer orbitVBO = GlBuffer::create();
+    glBindVertexArray(orbitVAO.get());
+    glBindBuffer(GL_ARRAY_BUFFER, orbitVBO.get());
+    gpuBufferData(GL_ARRAY_BUFFER, orbitVBO.get(), orbitVertices.size() * sizeof(float), orbitVertices.data(), GL_STATIC_DRAW, GpuCategory::VertexBuffer);
     glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), (void*)0);
     glEnableVertexAttribArray(0);
 
     glDrawArrays(GL_LINE_STRIP, 0, segments + 1); // Use GL_LINE_STRIP for non-closed loop if segments is not +1
+    frameMetrics().countDraw();
 
     glBindBuffer(GL_ARRAY_BUFFER, 0);
     glBindVertexArray(0);
-    glDeleteBuffers(1, &orbitVBO);
-    glDeleteVertexArrays(1, &orbitVAO);
 }
 
 // 绘制土星环
@@ -163,252 +401,157 @@ void drawRing(unsigned int shaderProgram, float innerRadius, float outerRadius,
         ringVertices.push_back(0.0f);
     }
 
-    unsigned int ringVAO, ringVBO;
-    glGenVertexArrays(1, &ringVAO);
-    glGenBuffers(1, &ringVBO);
-    glBindVertexArray(ringVAO);
-    glBindBuffer(GL_ARRAY_BUFFER, ringVBO);
-    glBufferData(GL_ARRAY_BUFFER, ringVertices.size() * sizeof(float), ringVertices.data(), GL_STATIC_DRAW);
+    GlVertexArray ringVAO = GlVertexArray::create();
+    GlBuffer ringVBO = GlBuffer::create();
+    glBindVertexArray(ringVAO.get());
+    glBindBuffer(GL_ARRAY_BUFFER, ringVBO.get());
+    gpuBufferData(GL_ARRAY_BUFFER, ringVBO.get(), ringVertices.size() * sizeof(float), ringVertices.data(), GL_STATIC_DRAW, GpuCategory::VertexBuffer);
     glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), (void*)0);
     glEnableVertexAttribArray(0);
 
     glDrawArrays(GL_TRIANGLE_STRIP, 0, (segments + 1) * 2);
+    frameMetrics().countDraw(segments * 2);
 
     glBindBuffer(GL_ARRAY_BUFFER, 0);
     glBindVertexArray(0);
-    glDeleteBuffers(1, &ringVBO);
-    glDeleteVertexArrays(1, &ringVAO);
 }
 
 
-int main()
+// 绘制一帧太阳系 (星空、轨道、天体、土星环) 到当前绑定的帧缓冲
+// viewportHeight 用于估算天体的屏幕尺寸; gpuTimer 非空时在星空绘制完后打第 1 个时间戳
+void drawSolarSystem(const SolarSystemScene& scene, const glm::vec3& cameraPos, const glm::vec3& cameraTarget,
+                     float fovY, float aspect, int viewportHeight, float timeValue,
+                     bool drawStars, float starSizeScale, GpuTimer* gpuTimer)
 {
-    // 1. 初始化 GLFW
-    if (!glfwInit()) {
-        std::cerr << "Failed to initialize GLFW" << std::endl;
-        return -1;
-    }
-    glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
-    glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
-    glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
-#ifdef __APPLE__
-    glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE);
-#endif
-
-    // 2. 创建 GLFW 窗口
-    GLFWwindow* window = glfwCreateWindow(SCR_WIDTH, SCR_HEIGHT, "太阳系模拟", NULL, NULL);
-    if (window == NULL) {
-        std::cerr << "Failed to create GLFW window" << std::endl;
-        glfwTerminate();
-        return -1;
-    }
-    glfwMakeContextCurrent(window);
-    glfwSetFramebufferSizeCallback(window, framebuffer_size_callback);
-
-    // 3. 初始化 GLAD
-    if (!gladLoadGLLoader((GLADloadproc)glfwGetProcAddress)) {
-        std::cerr << "Failed to initialize GLAD" << std::endl;
-        glfwTerminate();
-        return -1;
-    }
-
-    // 4. 构建和编译着色器程序
-    unsigned int shaderProgram = createShaderProgram(vertexShaderSource, fragmentShaderSource);
-
-    // 5. 设置顶点数据和缓冲区 (为单位球体，实际大小通过model矩阵控制)
-    std::vector<float> sphereVertices = createSphere(1.0f, 36, 18); // 单位球体
-    
-    unsigned int VBO, VAO;
-    glGenVertexArrays(1, &VAO);
-    glGenBuffers(1, &VBO);
-    glBindVertexArray(VAO);
-    glBindBuffer(GL_ARRAY_BUFFER, VBO);
-    glBufferData(GL_ARRAY_BUFFER, sphereVertices.size() * sizeof(float), sphereVertices.data(), GL_STATIC_DRAW);
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), (void*)0);
-    glEnableVertexAttribArray(0);
-    glBindBuffer(GL_ARRAY_BUFFER, 0);
-    glBindVertexArray(0);
-
-    glEnable(GL_DEPTH_TEST);
-    glEnable(GL_LINE_SMOOTH);
-    glHint(GL_LINE_SMOOTH_HINT, GL_NICEST);
-    glLineWidth(1.0f); // 设置轨道线宽
-
-    // 6. 渲染循环
-    while (!glfwWindowShouldClose(window))
-    {
-        processInput(window);
-
-        glClearColor(0.01f, 0.01f, 0.02f, 1.0f); // 更深的太空背景
-        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-
-        glUseProgram(shaderProgram);
-
-        unsigned int modelLoc = glGetUniformLocation(shaderProgram, "model");
-        unsigned int viewLoc = glGetUniformLocation(shaderProgram, "view");
-        unsigned int projLoc = glGetUniformLocation(shaderProgram, "projection");
-        unsigned int colorLoc = glGetUniformLocation(shaderProgram, "objectColor");
-
-        glm::mat4 projection = glm::perspective(glm::radians(45.0f), (float)SCR_WIDTH / (float)SCR_HEIGHT, 0.1f, 200.0f); // 增加 far plane
-        glUniformMatrix4fv(projLoc, 1, GL_FALSE, glm::value_ptr(projection));
-
-        // 调整摄像机位置以容纳更大的太阳系
-        glm::mat4 view = glm::lookAt(glm::vec3(0.0f, 30.0f, 60.0f), // 摄像机位置 (更高更远)
-                                     glm::vec3(0.0f, 0.0f, 0.0f),  // 目标位置
-                                     glm::vec3(0.0f, 1.0f, 0.0f)); // 上向量
-        glUniformMatrix4fv(viewLoc, 1, GL_FALSE, glm::value_ptr(view));
-
-        float timeValue = (float)glfwGetTime();
-
-        // 行星参数 (半径单位：任意，轨道半径单位：任意，速度：相对值)
-        // 太阳
-        float sunRadius = 2.5f;
-        float sunRotationSpeed = 0.05f;
-
-        // 水星 (Mercury)
-        float mercuryOrbitRadius = 5.0f;
-        float mercuryRadius = 0.2f;
-        float mercuryOrbitalSpeed = 1.0f * 0.7f; // 相对地球更快
-        float mercuryRotationSpeed = 0.1f;
-        glm::vec3 mercuryColor = glm::vec3(0.6f, 0.6f, 0.6f); // 灰色
-
-        // 金星 (Venus)
-        float venusOrbitRadius = 8.0f;
-        float venusRadius = 0.5f;
-        float venusOrbitalSpeed = 0.7f * 0.7f;
-        float venusRotationSpeed = -0.05f; // 缓慢逆行自转
-        float venusAxialTilt = glm::radians(177.0f); // 大倾角
-        glm::vec3 venusColor = glm::vec3(0.9f, 0.85f, 0.7f); // 黄白色
-
-        // 地球 (Earth)
-        float earthOrbitRadius = 12.0f;
-        float earthRadius = 0.6f;
-        float earthOrbitalSpeed = 0.5f * 0.7f;
-        float earthRotationSpeed = 1.0f;
-        float earthAxialTilt = glm::radians(23.5f);
-        glm::vec3 earthColor = glm::vec3(0.2f, 0.4f, 0.8f); // 蓝色
-
-        // 月球 (Moon)
-        float moonOrbitRadius = 1.2f; // 相对地球
-        float moonRadius = 0.15f;
-        float moonOrbitalSpeed = 2.5f; // 相对地球公转
-        glm::vec3 moonColor = glm::vec3(0.7f, 0.7f, 0.7f); // 浅灰色
-
-        // 火星 (Mars)
-        float marsOrbitRadius = 17.0f;
-        float marsRadius = 0.35f;
-        float marsOrbitalSpeed = 0.35f * 0.7f;
-        float marsRotationSpeed = 0.9f;
-        float marsAxialTilt = glm::radians(25.0f);
-        glm::vec3 marsColor = glm::vec3(0.8f, 0.3f, 0.1f); // 红色
-
-        // 木星 (Jupiter)
-        float jupiterOrbitRadius = 25.0f;
-        float jupiterRadius = 1.5f; // 最大行星
-        float jupiterOrbitalSpeed = 0.15f * 0.7f;
-        float jupiterRotationSpeed = 2.2f; // 快速自转
-        float jupiterAxialTilt = glm::radians(3.0f);
-        glm::vec3 jupiterColor = glm::vec3(0.8f, 0.7f, 0.5f); // 橙棕色
-
-        // 土星 (Saturn)
-        float saturnOrbitRadius = 35.0f;
-        float saturnRadius = 1.2f;
-        float saturnOrbitalSpeed = 0.1f * 0.7f;
-        float saturnRotationSpeed = 1.9f;
-        float saturnAxialTilt = glm::radians(27.0f); // 轴倾角
-        float saturnOrbitalTilt = glm::radians(2.5f); // 轨道倾角 (相对黄道面)
-        glm::vec3 saturnColor = glm::vec3(0.9f, 0.8f, 0.6f); // 淡黄色
-        float saturnRingInnerRadius = saturnRadius * 1.2f;
-        float saturnRingOuterRadius = saturnRadius * 2.2f;
-
-
-        // 绘制所有轨道 (除了太阳)
-        drawOrbit(shaderProgram, mercuryOrbitRadius, view, projection);
-        drawOrbit(shaderProgram, venusOrbitRadius, view, projection);
-        drawOrbit(shaderProgram, earthOrbitRadius, view, projection);
-        drawOrbit(shaderProgram, marsOrbitRadius, view, projection);
-        drawOrbit(shaderProgram, jupiterOrbitRadius, view, projection);
-        // 土星轨道需要考虑其轨道倾角
-        drawOrbit(shaderProgram, saturnOrbitRadius, view, projection, saturnOrbitalTilt, glm::vec3(1.0f, 0.0f, 0.0f));
-
-
-        glBindVertexArray(VAO); // 绑定一次球体VAO，用于所有球形天体
-
-        // --- 绘制太阳 ---
-        glm::mat4 model = glm::mat4(1.0f);
+    glClearColor(0.01f, 0.01f, 0.02f, 1.0f); // 更深的太空背景
+    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+    glm::mat4 projection = glm::perspective(fovY, aspect, 0.1f, 200.0f); // 增加 far plane
+    glm::mat4 view = glm::lookAt(cameraPos,
+                                 cameraTarget,                 // 目标位置
+                                 glm::vec3(0.0f, 1.0f, 0.0f)); // 上向量
+
+    // 行星参数 (半径单位：任意，轨道半径单位：任意，速度：相对值)
+    // 太阳
+    float sunRadius = 2.5f;
+    float sunRotationSpeed = 0.05f;
+
+    // 水星 (Mercury)
+    float mercuryOrbitRadius = 5.0f;
+    float mercuryRadius = 0.2f;
+    float mercuryOrbitalSpeed = 1.0f * 0.7f; // 相对地球更快
+    float mercuryRotationSpeed = 0.1f;
+    glm::vec3 mercuryColor = glm::vec3(0.6f, 0.6f, 0.6f); // 灰色
+
+    // 金星 (Venus)
+    float venusOrbitRadius = 8.0f;
+    float venusRadius = 0.5f;
+    float venusOrbitalSpeed = 0.7f * 0.7f;
+    float venusRotationSpeed = -0.05f; // 缓慢逆行自转
+    float venusAxialTilt = glm::radians(177.0f); // 大倾角
+    glm::vec3 venusColor = glm::vec3(0.9f, 0.85f, 0.7f); // 黄白色
+
+    // 地球 (Earth)
+    float earthOrbitRadius = 12.0f;
+    float earthRadius = 0.6f;
+    float earthOrbitalSpeed = 0.5f * 0.7f;
+    float earthRotationSpeed = 1.0f;
+    float earthAxialTilt = glm::radians(23.5f);
+    glm::vec3 earthColor = glm::vec3(0.2f, 0.4f, 0.8f); // 蓝色
+
+    // 月球 (Moon)
+    float moonOrbitRadius = 1.2f; // 相对地球
+    float moonRadius = 0.15f;
+    float moonOrbitalSpeed = 2.5f; // 相对地球公转
+    glm::vec3 moonColor = glm::vec3(0.7f, 0.7f, 0.7f); // 浅灰色
+
+    // 火星 (Mars)
+    float marsOrbitRadius = 17.0f;
+    float marsRadius = 0.35f;
+    float marsOrbitalSpeed = 0.35f * 0.7f;
+    float marsRotationSpeed = 0.9f;
+    float marsAxialTilt = glm::radians(25.0f);
+    glm::vec3 marsColor = glm::vec3(0.8f, 0.3f, 0.1f); // 红色
+
+    // 木星 (Jupiter)
+    float jupiterOrbitRadius = 25.0f;
+    float jupiterRadius = 1.5f; // 最大行星
+    float jupiterOrbitalSpeed = 0.15f * 0.7f;
+    float jupiterRotationSpeed = 2.2f; // 快速自转
+    float jupiterAxialTilt = glm::radians(3.0f);
+    glm::vec3 jupiterColor = glm::vec3(0.8f, 0.7f, 0.5f); // 橙棕色
+
+    // 土星 (Saturn)
+    float saturnOrbitRadius = 35.0f;
+    float saturnRadius = 1.2f;
+    float saturnOrbitalSpeed = 0.1f * 0.7f;
+    float saturnRotationSpeed = 1.9f;
+    float saturnAxialTilt = glm::radians(27.0f); // 轴倾角
+    float saturnOrbitalTilt = glm::radians(2.5f); // 轨道倾角 (相对黄道面)
+    glm::vec3 saturnColor = glm::vec3(0.9f, 0.8f, 0.6f); // 淡黄色
+    float saturnRingInnerRadius = saturnRadius * 1.2f;
+    float saturnRingOuterRadius = saturnRadius * 2.2f;
+
+
+    // 各天体的模型矩阵作为一组任务计算 (月球依赖地球的公转位置, 土星环依赖土星的轨道位置),
+    // 与下面星空和轨道的绘制同时进行; 绘制天体前 wait(), 主线程等待期间也执行这些任务
+    glm::mat4 model, mercuryModel, venusModel, earthModel, earthWorldModel, moonModel, marsModel, jupiterModel;
+    glm::mat4 saturnWorldModel, saturnPlanetPart, ringBaseModel;
+    JobGroup bodyUpdates;
+    bodyUpdates.add([&]() { // 太阳
+        model = glm::mat4(1.0f);
         model = glm::rotate(model, timeValue * sunRotationSpeed, glm::vec3(0.0f, 1.0f, 0.0f)); // 太阳自转
         model = glm::scale(model, glm::vec3(sunRadius));
-        glUniformMatrix4fv(modelLoc, 1, GL_FALSE, glm::value_ptr(model));
-        glUniform3f(colorLoc, 1.0f, 0.8f, 0.0f); // 太阳颜色
-        glDrawArrays(GL_TRIANGLES, 0, sphereVertices.size() / 3);
-
-        // --- 绘制水星 ---
-        glm::mat4 mercuryModel = glm::mat4(1.0f);
+    });
+    bodyUpdates.add([&]() { // 水星
+        mercuryModel = glm::mat4(1.0f);
         mercuryModel = glm::rotate(mercuryModel, timeValue * mercuryOrbitalSpeed, glm::vec3(0.0f, 1.0f, 0.0f)); // 公转
         mercuryModel = glm::translate(mercuryModel, glm::vec3(mercuryOrbitRadius, 0.0f, 0.0f));
         mercuryModel = glm::rotate(mercuryModel, timeValue * mercuryRotationSpeed, glm::vec3(0.0f, 1.0f, 0.0f)); // 自转
         mercuryModel = glm::scale(mercuryModel, glm::vec3(mercuryRadius));
-        glUniformMatrix4fv(modelLoc, 1, GL_FALSE, glm::value_ptr(mercuryModel));
-        glUniform3fv(colorLoc, 1, glm::value_ptr(mercuryColor));
-        glDrawArrays(GL_TRIANGLES, 0, sphereVertices.size() / 3);
-
-        // --- 绘制金星 ---
-        glm::mat4 venusModel = glm::mat4(1.0f);
+    });
+    bodyUpdates.add([&]() { // 金星
+        venusModel = glm::mat4(1.0f);
         venusModel = glm::rotate(venusModel, timeValue * venusOrbitalSpeed, glm::vec3(0.0f, 1.0f, 0.0f)); // 公转
         venusModel = glm::translate(venusModel, glm::vec3(venusOrbitRadius, 0.0f, 0.0f));
         venusModel = glm::rotate(venusModel, venusAxialTilt, glm::vec3(0.0f, 0.0f, 1.0f)); // 轴倾角
         venusModel = glm::rotate(venusModel, timeValue * venusRotationSpeed, glm::vec3(0.0f, 1.0f, 0.0f)); // 自转
         venusModel = glm::scale(venusModel, glm::vec3(venusRadius));
-        glUniformMatrix4fv(modelLoc, 1, GL_FALSE, glm::value_ptr(venusModel));
-        glUniform3fv(colorLoc, 1, glm::value_ptr(venusColor));
-        glDrawArrays(GL_TRIANGLES, 0, sphereVertices.size() / 3);
-
-        // --- 绘制地球 ---
-        glm::mat4 earthModel = glm::mat4(1.0f);
+    });
+    JobGroup::Id earthUpdate = bodyUpdates.add([&]() { // 地球
+        earthModel = glm::mat4(1.0f);
         earthModel = glm::rotate(earthModel, timeValue * earthOrbitalSpeed, glm::vec3(0.0f, 1.0f, 0.0f)); // 公转
         earthModel = glm::translate(earthModel, glm::vec3(earthOrbitRadius, 0.0f, 0.0f));
         // 保存地球的世界坐标变换，用于月球
-        glm::mat4 earthWorldModel = earthModel; 
+        earthWorldModel = earthModel;
         earthModel = glm::rotate(earthModel, earthAxialTilt, glm::vec3(0.0f, 0.0f, 1.0f)); // 地球轴倾角 (先倾斜再自转)
         earthModel = glm::rotate(earthModel, timeValue * earthRotationSpeed, glm::vec3(0.0f, 1.0f, 0.0f)); // 地球自转
         earthModel = glm::scale(earthModel, glm::vec3(earthRadius));
-        glUniformMatrix4fv(modelLoc, 1, GL_FALSE, glm::value_ptr(earthModel));
-        glUniform3fv(colorLoc, 1, glm::value_ptr(earthColor));
-        glDrawArrays(GL_TRIANGLES, 0, sphereVertices.size() / 3);
-
-        // --- 绘制月球 ---
-        glm::mat4 moonModel = earthWorldModel; // 从地球的世界变换开始
+    });
+    bodyUpdates.add([&]() { // 月球
+        moonModel = earthWorldModel; // 从地球的世界变换开始
         moonModel = glm::rotate(moonModel, timeValue * moonOrbitalSpeed, glm::vec3(0.1f, 1.0f, 0.1f)); // 月球公转 (可以稍微倾斜轨道)
         moonModel = glm::translate(moonModel, glm::vec3(moonOrbitRadius, 0.0f, 0.0f));
         // 月球通常是潮汐锁定的，可以不加独立自转或使其与公转同步
         moonModel = glm::scale(moonModel, glm::vec3(moonRadius));
-        glUniformMatrix4fv(modelLoc, 1, GL_FALSE, glm::value_ptr(moonModel));
-        glUniform3fv(colorLoc, 1, glm::value_ptr(moonColor));
-        glDrawArrays(GL_TRIANGLES, 0, sphereVertices.size() / 3);
-
-        // --- 绘制火星 ---
-        glm::mat4 marsModel = glm::mat4(1.0f);
+    }, { earthUpdate });
+    bodyUpdates.add([&]() { // 火星
+        marsModel = glm::mat4(1.0f);
         marsModel = glm::rotate(marsModel, timeValue * marsOrbitalSpeed, glm::vec3(0.0f, 1.0f, 0.0f));
         marsModel = glm::translate(marsModel, glm::vec3(marsOrbitRadius, 0.0f, 0.0f));
         marsModel = glm::rotate(marsModel, marsAxialTilt, glm::vec3(0.0f, 0.0f, 1.0f));
         marsModel = glm::rotate(marsModel, timeValue * marsRotationSpeed, glm::vec3(0.0f, 1.0f, 0.0f));
         marsModel = glm::scale(marsModel, glm::vec3(marsRadius));
-        glUniformMatrix4fv(modelLoc, 1, GL_FALSE, glm::value_ptr(marsModel));
-        glUniform3fv(colorLoc, 1, glm::value_ptr(marsColor));
-        glDrawArrays(GL_TRIANGLES, 0, sphereVertices.size() / 3);
-
-        // --- 绘制木星 ---
-        glm::mat4 jupiterModel = glm::mat4(1.0f);
+    });
+    bodyUpdates.add([&]() { // 木星
+        jupiterModel = glm::mat4(1.0f);
         jupiterModel = glm::rotate(jupiterModel, timeValue * jupiterOrbitalSpeed, glm::vec3(0.0f, 1.0f, 0.0f));
         jupiterModel = glm::translate(jupiterModel, glm::vec3(jupiterOrbitRadius, 0.0f, 0.0f));
         jupiterModel = glm::rotate(jupiterModel, jupiterAxialTilt, glm::vec3(0.0f, 0.0f, 1.0f));
         jupiterModel = glm::rotate(jupiterModel, timeValue * jupiterRotationSpeed, glm::vec3(0.0f, 1.0f, 0.0f));
         jupiterModel = glm::scale(jupiterModel, glm::vec3(jupiterRadius));
-        glUniformMatrix4fv(modelLoc, 1, GL_FALSE, glm::value_ptr(jupiterModel));
-        glUniform3fv(colorLoc, 1, glm::value_ptr(jupiterColor));
-        glDrawArrays(GL_TRIANGLES, 0, sphereVertices.size() / 3);
-
-        // --- 绘制土星 ---
+    });
+    JobGroup::Id saturnUpdate = bodyUpdates.add([&]() { // 土星
         glm::mat4 saturnModel = glm::mat4(1.0f);
         // 1. 轨道倾斜
         saturnModel = glm::rotate(saturnModel, saturnOrbitalTilt, glm::vec3(1.0f, 0.0f, 0.0f)); 
@@ -416,8 +559,8 @@ int main()
         saturnModel = glm::rotate(saturnModel, timeValue * saturnOrbitalSpeed, glm::vec3(0.0f, 1.0f, 0.0f)); // 绕Y轴公转
         // 3. 平移到轨道半径
         saturnModel = glm::translate(saturnModel, glm::vec3(saturnOrbitRadius, 0.0f, 0.0f));
-        
-        glm::mat4 saturnWorldModel = saturnModel; // 保存土星不带自转和轴倾斜的变换，用于环
+    
+        saturnWorldModel = saturnModel; // 保存土星不带自转和轴倾斜的变换，用于环
 
         // 4. 轴倾角 (影响自转轴和环的平面)
         // 重要：轴倾角应相对于轨道平面。如果轨道本身倾斜了，这个旋转轴也应该相应调整。
@@ -439,44 +582,483 @@ int main()
         // A common convention for axial tilt is rotation around an axis like (1,0,0) or (0,0,1) *before* self-rotation.
         // The saturnWorldModel already has orbital placement and orbital tilt.
         // Now apply axial tilt relative to that.
-        
-        glm::mat4 saturnPlanetPart = saturnWorldModel; // Start from here for the planet itself
+    
+        saturnPlanetPart = saturnWorldModel; // Start from here for the planet itself
         saturnPlanetPart = glm::rotate(saturnPlanetPart, saturnAxialTilt, glm::vec3(1.0f, 0.0f, 0.0f)); // Tilt around its X-axis
         saturnPlanetPart = glm::rotate(saturnPlanetPart, timeValue * saturnRotationSpeed, glm::vec3(0.0f, 1.0f, 0.0f)); // 自转
         saturnPlanetPart = glm::scale(saturnPlanetPart, glm::vec3(saturnRadius));
-        
-        glUniformMatrix4fv(modelLoc, 1, GL_FALSE, glm::value_ptr(saturnPlanetPart));
-        glUniform3fv(colorLoc, 1, glm::value_ptr(saturnColor));
-        glDrawArrays(GL_TRIANGLES, 0, sphereVertices.size() / 3);
-
-        // 绘制土星环 - 环应该与土星的赤道面对齐，即受到轴倾角影响
+    });
+    bodyUpdates.add([&]() { // 土星环
+        // 环应该与土星的赤道面对齐，即受到轴倾角影响
         // The ring's model matrix should be based on saturnWorldModel (position in orbit, orbital tilt)
         // and then apply the *same axial tilt* as Saturn itself.
-        glm::mat4 ringBaseModel = saturnWorldModel;
+        ringBaseModel = saturnWorldModel;
         ringBaseModel = glm::rotate(ringBaseModel, saturnAxialTilt, glm::vec3(1.0f, 0.0f, 0.0f)); // Apply same axial tilt
-        // The drawRing function expects the model matrix to position and orient the ring plane.
-        // The vertices of the ring are in its local XY plane.
-        drawRing(shaderProgram, saturnRingInnerRadius, saturnRingOuterRadius, view, projection, ringBaseModel, 0.0f, glm::vec3(0,0,1)); // No additional tilt for drawRing, it's in ringBaseModel
+    }, { saturnUpdate });
+
+    // 星空背景最先绘制
+    if (drawStars) {
+        scene.starfield->draw(scene.starShaderProgram, view, projection, starSizeScale);
+        frameMetrics().countDraw(); // 点精灵, 不计三角形
+    }
+    if (gpuTimer) gpuTimer->mark(1);
+
+    glUseProgram(scene.shaderProgram);
+
+    unsigned int modelLoc = glGetUniformLocation(scene.shaderProgram, "model");
+    unsigned int viewLoc = glGetUniformLocation(scene.shaderProgram, "view");
+    unsigned int projLoc = glGetUniformLocation(scene.shaderProgram, "projection");
+    unsigned int colorLoc = glGetUniformLocation(scene.shaderProgram, "objectColor");
+
+    glUniformMatrix4fv(projLoc, 1, GL_FALSE, glm::value_ptr(projection));
+    glUniformMatrix4fv(viewLoc, 1, GL_FALSE, glm::value_ptr(view));
+
+
+    // 绘制所有轨道 (除了太阳)
+    glUniform1i(glGetUniformLocation(scene.shaderProgram, "useTexture"), 0);
+    drawOrbit(scene.shaderProgram, mercuryOrbitRadius, view, projection);
+    drawOrbit(scene.shaderProgram, venusOrbitRadius, view, projection);
+    drawOrbit(scene.shaderProgram, earthOrbitRadius, view, projection);
+    drawOrbit(scene.shaderProgram, marsOrbitRadius, view, projection);
+    drawOrbit(scene.shaderProgram, jupiterOrbitRadius, view, projection);
+    // 土星轨道需要考虑其轨道倾角
+    drawOrbit(scene.shaderProgram, saturnOrbitRadius, view, projection, saturnOrbitalTilt, glm::vec3(1.0f, 0.0f, 0.0f));
+
+
+    bodyUpdates.wait();
+    glBindVertexArray(scene.sphereVAO); // 绑定一次球体VAO，用于所有球形天体
+
+    // 依次绘制各天体
+    auto drawBody = [&](const glm::mat4& bodyModel, const glm::vec3& color, float radius, int texture) {
+        glUniformMatrix4fv(modelLoc, 1, GL_FALSE, glm::value_ptr(bodyModel));
+        glUniform3fv(colorLoc, 1, glm::value_ptr(color));
+        scene.textureStreamer->requestScreenSize(texture, screenDiameter(bodyModel, radius, cameraPos, fovY, viewportHeight));
+        bindBodyTexture(scene.shaderProgram, *scene.textureStreamer, texture);
+        glDrawElements(GL_TRIANGLES, scene.sphereIndexCount, GL_UNSIGNED_INT, 0);
+        frameMetrics().countDraw(scene.sphereIndexCount / 3);
+    };
+    drawBody(model, glm::vec3(1.0f, 0.8f, 0.0f), sunRadius, scene.sunTexture); // 太阳颜色
+    drawBody(mercuryModel, mercuryColor, mercuryRadius, scene.mercuryTexture);
+    drawBody(venusModel, venusColor, venusRadius, scene.venusTexture);
+    drawBody(earthModel, earthColor, earthRadius, scene.earthTexture);
+    drawBody(moonModel, moonColor, moonRadius, scene.moonTexture);
+    drawBody(marsModel, marsColor, marsRadius, scene.marsTexture);
+    drawBody(jupiterModel, jupiterColor, jupiterRadius, scene.jupiterTexture);
+    drawBody(saturnPlanetPart, saturnColor, saturnRadius, scene.saturnTexture);
+    glUniform1i(glGetUniformLocation(scene.shaderProgram, "useTexture"), 0);
+
+    // 绘制土星环
+    // The drawRing function expects the model matrix to position and orient the ring plane.
+    // The vertices of the ring are in its local XY plane.
+    drawRing(scene.shaderProgram, saturnRingInnerRadius, saturnRingOuterRadius, view, projection, ringBaseModel, 0.0f, glm::vec3(0,0,1)); // No additional tilt for drawRing, it's in ringBaseModel
+
+
+    glBindVertexArray(0); // 解绑VAO
+}
+
+
+int main(int argc, char** argv)
+{
+    startupProfile(); // 启动各阶段从这里开始计时
+    std::chrono::steady_clock::time_point startupBegin = std::chrono::steady_clock::now();
+
+    // 命令行参数: --texture-budget-mb N 设置流式纹理的显存预算
+    //           --gpu-budget-mb N 全部缓冲和纹理的显存预算, 超出时淘汰最久未使用的流式纹理 (默认不限制)
+    //           --star-catalog PATH 指定星表 (不存在时生成合成星表)
+    //           --bench 依次运行基准场景, 打印各场景 GPU 耗时后退出
+    //           --low-latency 渲染前才采样输入, 在途帧数限制为 1
+    //           --latency-ab N 每 N 帧在默认模式和低延迟模式之间切换, 退出时对比两者的延迟
+    //           --serve PATH 无窗口渲染服务, 在 Unix 套接字 PATH 上接收渲染请求
+    //           --startup-json PATH 另把启动耗时分解写成 JSON ("-" 为标准输出)
+    //           --metrics ENDPOINT 以 Prometheus 格式导出帧统计, ENDPOINT 为本机端口或 Unix 套接字路径
+    //           --record-input PATH 把输入和帧时间录制到 PATH, --replay-input PATH 按录制的输入和时间回放
+    const char* startupJson = nullptr;
+    const char* metricsEndpoint = nullptr;
+    const char* recordInput = nullptr;
+    const char* replayInput = nullptr;
+    size_t textureBudgetBytes = 64u << 20;
+    std::string starCatalogPath = "stars.bin";
+    bool benchMode = false;
+    bool lowLatency = false;
+    int latencyAb = 0;
+    const char* servePath = nullptr;
+    for (int i = 1; i < argc; ++i) {
+        if (std::strcmp(argv[i], "--texture-budget-mb") == 0 && i + 1 < argc) {
+            textureBudgetBytes = (size_t)(std::atof(argv[++i]) * 1024.0 * 1024.0);
+        } else if (std::strcmp(argv[i], "--gpu-budget-mb") == 0 && i + 1 < argc) {
+            gpuMemory().setBudget((size_t)(std::atof(argv[++i]) * 1024.0 * 1024.0));
+        } else if (std::strcmp(argv[i], "--star-catalog") == 0 && i + 1 < argc) {
+            starCatalogPath = argv[++i];
+        } else if (std::strcmp(argv[i], "--bench") == 0) {
+            benchMode = true;
+        } else if (std::strcmp(argv[i], "--low-latency") == 0) {
+            lowLatency = true;
+        } else if (std::strcmp(argv[i], "--latency-ab") == 0 && i + 1 < argc) {
+            latencyAb = std::atoi(argv[++i]);
+        } else if (std::strcmp(argv[i], "--serve") == 0 && i + 1 < argc) {
+            servePath = argv[++i];
+        } else if (std::strcmp(argv[i], "--startup-json") == 0 && i + 1 < argc) {
+            startupJson = argv[++i];
+        } else if (std::strcmp(argv[i], "--metrics") == 0 && i + 1 < argc) {
+            metricsEndpoint = argv[++i];
+        } else if (std::strcmp(argv[i], "--record-input") == 0 && i + 1 < argc) {
+            recordInput = argv[++i];
+        } else if (std::strcmp(argv[i], "--replay-input") == 0 && i + 1 < argc) {
+            replayInput = argv[++i];
+        }
+    }
+    // 服务模式没有交互输入, 不录制也不回放
+    if (!servePath && replayInput && !inputTrace().replay(replayInput, "task4")) return -1;
+    if (!servePath && recordInput && !replayInput) inputTrace().record(recordInput, "task4");
+#ifndef _WIN32
+    MetricsExporter metricsExporter("task4");
+    if (metricsEndpoint && !metricsExporter.start(metricsEndpoint)) return -1;
+#endif
+
+    // 1. 初始化 GLFW
+    if (!glfwInit()) {
+        std::cerr << "Failed to initialize GLFW" << std::endl;
+        return -1;
+    }
+    startupProfile().mark("glfwInit");
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+    glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+#ifdef __APPLE__
+    glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE);
+#endif
+    if (servePath) {
+        glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE); // 服务模式只需要 GL 上下文
+    }
+
+    // 2. 创建 GLFW 窗口
+    GLFWwindow* window = glfwCreateWindow(SCR_WIDTH, SCR_HEIGHT, "太阳系模拟", NULL, NULL);
+    if (window == NULL) {
+        std::cerr << "Failed to create GLFW window" << std::endl;
+        glfwTerminate();
+        return -1;
+    }
+    glfwMakeContextCurrent(window);
+    glfwSetFramebufferSizeCallback(window, framebuffer_size_callback);
+    startupProfile().mark("window/context");
 
+    // 3. 初始化 GLAD
+    if (!gladLoadGLLoader((GLADloadproc)glfwGetProcAddress)) {
+        std::cerr << "Failed to initialize GLAD" << std::endl;
+        glfwTerminate();
+        return -1;
+    }
+    startupProfile().mark("gladLoadGLLoader");
+
+    // 4. 发起启动加载: 球体网格、星表和着色器程序
+    // 每项加载是一个协程 (common/async_load.h), CPU 阶段在任务系统上执行, GL 阶段在本线程执行;
+    // 全部发起后在第 5 步一起等待, 首帧前等待的是最慢的一项而不是各项之和
+    GlThreadQueue glQueue;
+    std::chrono::steady_clock::time_point loadBegin = std::chrono::steady_clock::now();
+    LoadTask<SphereMesh> sphereLoad = loadSphereMesh(glQueue, 36, 18);
+    // 持有 GL 对象, 需在 glfwTerminate 之前销毁
+    std::unique_ptr<Starfield> starfield(new Starfield());
+    LoadTask<bool> starfieldLoad = loadStarfield(glQueue, *starfield, starCatalogPath);
+    // 着色器在本线程上立即编译, 与上面两项的工作线程阶段重叠
+    LoadTask<unsigned int> shaderLoad = loadShaderProgram(glQueue, vertexShaderSource, fragmentShaderSource);
+    LoadTask<unsigned int> starShaderLoad = loadShaderProgram(glQueue, starVertexShaderSource, starFragmentShaderSource);
+    startupProfile().mark("start loads");
+
+    // 天体纹理按屏幕尺寸流式加载; 工作目录 textures/ 下没有对应图片时使用程序化纹理
+    // 两个流送工作线程各自生成一张纹理, 每张纹理再按行分给 texgenThreads 个线程
+    const int streamerWorkers = 2;
+    int texgenThreads = std::max(1, (int)std::thread::hardware_concurrency() / streamerWorkers);
+    // 持有 GL 对象的管理器需在 glfwTerminate 之前销毁, 所以放在 unique_ptr 中并在清理阶段显式释放
+    std::unique_ptr<TextureStreamer> textureStreamer(new TextureStreamer(textureBudgetBytes, streamerWorkers));
+    PlanetTextureParams sunParams = planetParams(11, 1024, false, 0.0f,
+        glm::vec3(0.0f), glm::vec3(0.0f), glm::vec3(1.0f, 0.45f, 0.0f), glm::vec3(1.0f, 0.95f, 0.55f));
+    sunParams.frequency = 4.0f;
+    PlanetTextureParams venusParams = planetParams(23, 1024, true, 0.0f,
+        glm::vec3(0.0f), glm::vec3(0.95f, 0.9f, 0.75f), glm::vec3(0.85f, 0.75f, 0.5f), glm::vec3(0.95f, 0.9f, 0.7f));
+    venusParams.bandFrequency = 4.0f;
+    venusParams.turbulence = 1.2f;
+    PlanetTextureParams jupiterParams = planetParams(47, 2048, true, 0.0f,
+        glm::vec3(0.0f), glm::vec3(0.75f, 0.35f, 0.2f), glm::vec3(0.65f, 0.5f, 0.35f), glm::vec3(0.95f, 0.9f, 0.8f));
+    jupiterParams.bandFrequency = 16.0f;
+    PlanetTextureParams saturnParams = planetParams(53, 1024, true, 0.0f,
+        glm::vec3(0.0f), glm::vec3(0.85f, 0.75f, 0.55f), glm::vec3(0.8f, 0.7f, 0.5f), glm::vec3(0.95f, 0.88f, 0.7f));
+    saturnParams.bandFrequency = 10.0f;
+    saturnParams.turbulence = 0.2f;
+
+    int sunTexture = addBodyTexture(*textureStreamer, "sun", sunParams, texgenThreads);
+    int mercuryTexture = addBodyTexture(*textureStreamer, "mercury", planetParams(13, 512, false, 0.0f,
+        glm::vec3(0.0f), glm::vec3(0.0f), glm::vec3(0.35f, 0.33f, 0.3f), glm::vec3(0.75f, 0.72f, 0.7f)), texgenThreads);
+    int venusTexture = addBodyTexture(*textureStreamer, "venus", venusParams, texgenThreads);
+    int earthTexture = addBodyTexture(*textureStreamer, "earth", planetParams(31, 2048, false, 0.55f,
+        glm::vec3(0.02f, 0.05f, 0.25f), glm::vec3(0.1f, 0.35f, 0.65f), glm::vec3(0.2f, 0.45f, 0.15f), glm::vec3(0.85f, 0.85f, 0.8f)), texgenThreads);
+    int moonTexture = addBodyTexture(*textureStreamer, "moon", planetParams(37, 512, false, 0.0f,
+        glm::vec3(0.0f), glm::vec3(0.0f), glm::vec3(0.4f, 0.4f, 0.4f), glm::vec3(0.8f, 0.8f, 0.78f)), texgenThreads);
+    int marsTexture = addBodyTexture(*textureStreamer, "mars", planetParams(41, 1024, false, 0.0f,
+        glm::vec3(0.0f), glm::vec3(0.0f), glm::vec3(0.55f, 0.2f, 0.08f), glm::vec3(0.9f, 0.55f, 0.35f)), texgenThreads);
+    int jupiterTexture = addBodyTexture(*textureStreamer, "jupiter", jupiterParams, texgenThreads);
+    int saturnTexture = addBodyTexture(*textureStreamer, "saturn", saturnParams, texgenThreads);
+    const int bodyTextureCount = 8;
+    bool startupReported = false;
+    startupProfile().mark("texture streamer setup");
+
+    // 5. 等待启动加载 (天体纹理不在其中: 由流送器在之后的帧里逐步驻留)
+    waitAll(glQueue, sphereLoad, starfieldLoad, shaderLoad, starShaderLoad);
+    startupProfile().mark("wait for loads");
+    double loadMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - loadBegin).count();
+    SphereMesh sphere = std::move(sphereLoad.get());
+    unsigned int shaderProgram = shaderLoad.get();
+    unsigned int starShaderProgram = starShaderLoad.get();
+    printLoadTimes(std::cout, loadMs, { { "球体网格", sphereLoad.elapsedMs() }, { "星表", starfieldLoad.elapsedMs() },
+                                        { "着色器", shaderLoad.elapsedMs() }, { "星空着色器", starShaderLoad.elapsedMs() } });
+
+    SolarSystemScene scene;
+    scene.shaderProgram = shaderProgram;
+    scene.starShaderProgram = starShaderProgram;
+    scene.sphereVAO = sphere.vao.get();
+    scene.sphereIndexCount = sphere.indexCount;
+    scene.textureStreamer = textureStreamer.get();
+    scene.starfield = starfield.get();
+    scene.sunTexture = sunTexture;
+    scene.mercuryTexture = mercuryTexture;
+    scene.venusTexture = venusTexture;
+    scene.earthTexture = earthTexture;
+    scene.moonTexture = moonTexture;
+    scene.marsTexture = marsTexture;
+    scene.jupiterTexture = jupiterTexture;
+    scene.saturnTexture = saturnTexture;
+
+    // GPU 分段计时: 标记 0 帧开始, 1 星空结束, 2 帧结束
+    std::unique_ptr<GpuTimer> gpuTimer(new GpuTimer(3));
+
+    // 输入到显示的延迟统计, 退出时打印
+    std::unique_ptr<LatencyTracker> latency(new LatencyTracker(lowLatency));
+    if (latencyAb > 0) latency->alternateModes(latencyAb); // 循环每帧从 latency 读取当前模式
+    latency->attach(window);
+    inputTrace().attach(window);
+
+    // 基准场景: 每个场景预热若干帧后统计, 填充率场景把点精灵放大 8 倍
+    struct BenchScene {
+        const char* name;
+        bool stars;
+        float starSizeScale;
+    };
+    const BenchScene benchScenes[] = {
+        { "行星", false, 1.0f },
+        { "行星 + 星空", true, 1.0f },
+        { "行星 + 星空 (8x 点精灵, 填充率)", true, 8.0f },
+    };
+    const int benchSceneCount = sizeof(benchScenes) / sizeof(benchScenes[0]);
+    const int benchWarmupFrames = 30;
+    const int benchFrames = 300;
+    int benchScene = 0;
+    int benchFrame = 0;
+    std::chrono::steady_clock::time_point benchSceneStart;
+    std::vector<double> benchStarMs(benchSceneCount), benchRestMs(benchSceneCount), benchCpuMs(benchSceneCount);
+    if (benchMode) {
+        glfwSwapInterval(0); // 不受垂直同步限制
+    }
+    glUseProgram(shaderProgram);
+    glUniform1i(glGetUniformLocation(shaderProgram, "bodyTexture"), 0);
 
-        glBindVertexArray(0); // 解绑VAO
+    glEnable(GL_DEPTH_TEST);
+    glEnable(GL_LINE_SMOOTH);
+    glHint(GL_LINE_SMOOTH_HINT, GL_NICEST);
+    glLineWidth(1.0f); // 设置轨道线宽
 
+#ifndef _WIN32
+    if (servePath) {
+        RenderRequest defaults;
+        defaults.eye[0] = 0.0f; defaults.eye[1] = 30.0f; defaults.eye[2] = 60.0f;
+        defaults.fov = 45.0f;
+
+        // 先在默认视角下离屏绘制直到全部天体纹理驻留, 纹理生成/解码不计入请求延迟
+        RenderServer server(defaults);
+        // 某个纹理生成失败时不会驻留, 最多等待 60 秒
+        while (textureStreamer->stats().texturesResident < bodyTextureCount
+               && std::chrono::steady_clock::now() - startupBegin < std::chrono::seconds(60)) {
+            drawSolarSystem(scene, glm::vec3(0.0f, 30.0f, 60.0f), glm::vec3(0.0f), glm::radians(45.0f),
+                            (float)SCR_WIDTH / (float)SCR_HEIGHT, SCR_HEIGHT, 0.0f, true, 1.0f, nullptr);
+            textureStreamer->update();
+            glDeletionQueue().endFrame();
+            frameMetrics().endFrame();
+            std::this_thread::sleep_for(std::chrono::milliseconds(5));
+        }
+        double warmMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - startupBegin).count();
+        std::cout << "[渲染服务] 资源就绪耗时 " << warmMs << " ms" << std::endl;
+        // 服务模式没有交换缓冲, 以预热结束作为启动完成
+        startupProfile().finish("warm-up");
+        startupProfile().report(std::cout, "task4 (serve)", startupJson);
+        printPlanetTexgenStats(std::cout);
+
+        if (server.listen(servePath)) {
+            std::cout << "[渲染服务] 监听 " << servePath << std::endl;
+            server.run([&](const RenderRequest& r) {
+                glm::vec3 eye(r.eye[0], r.eye[1], r.eye[2]);
+                glm::vec3 target(r.target[0], r.target[1], r.target[2]);
+                // 纹理驻留级别每次 update 只升一级, 视角变化导致升级时重绘, 保证返回的图像使用所需的级别
+                for (int pass = 0; pass < 8; ++pass) {
+                    int levelUps = textureStreamer->stats().levelUps;
+                    drawSolarSystem(scene, eye, target, glm::radians(r.fov), (float)r.width / (float)r.height,
+                                    r.height, r.time, r.stars, 1.0f, nullptr);
+                    textureStreamer->update();
+                    glDeletionQueue().endFrame();
+                    if (textureStreamer->stats().levelUps == levelUps) break;
+                }
+                frameMetrics().endFrame(); // 每个请求算一帧
+            });
+            server.printStats(std::cout);
+            gpuMemory().printBreakdown(std::cout);
+            glDeletionQueue().printStats(std::cout);
+        }
+    }
+#endif
+
+    // 6. 渲染循环
+    while (!servePath && !glfwWindowShouldClose(window))
+    {
+        // 低延迟模式: 等上一帧完成、睡到下一次交换前再读取输入; 默认模式在上一帧交换后读取
+        if (latency->lowLatency()) {
+            latency->beginFrame();
+            glfwPollEvents();
+        }
+        latency->inputSampled();
+        gpuMemory().beginFrame();
+
+        float currentFrame = (float)inputTrace().beginFrame(glfwGetTime()); // 回放时取录制的时间
+        deltaTime = currentFrame - lastFrame;
+        lastFrame = currentFrame;
+
+        processInput(window);
+
+        bool drawStars = true;
+        float starSizeScale = 1.0f;
+        if (benchMode) {
+            drawStars = benchScenes[benchScene].stars;
+            starSizeScale = benchScenes[benchScene].starSizeScale;
+            if (benchFrame == benchWarmupFrames) {
+                gpuTimer->reset();
+                benchSceneStart = std::chrono::steady_clock::now();
+            }
+        }
+
+        gpuTimer->beginFrame();
+        gpuTimer->mark(0);
+
+        // 调整摄像机位置以容纳更大的太阳系
+        glm::vec3 cameraPos = glm::vec3(0.0f, 30.0f, 60.0f) * cameraZoom; // 摄像机位置 (更高更远)
+        int framebufferWidth, framebufferHeight;
+        glfwGetFramebufferSize(window, &framebufferWidth, &framebufferHeight);
+        drawSolarSystem(scene, cameraPos, glm::vec3(0.0f), glm::radians(45.0f), (float)SCR_WIDTH / (float)SCR_HEIGHT,
+                        framebufferHeight, currentFrame, drawStars, starSizeScale, gpuTimer.get());
+
+        // 根据本帧上报的屏幕尺寸调整各纹理的驻留级别, 再按全局显存预算淘汰本帧没有绑定的纹理
+        textureStreamer->update();
+        gpuMemory().enforceBudget();
+        // 所有天体纹理首次就绪时报告启动耗时, 以缓存命中情况区分冷/热启动
+        if (!startupReported && textureStreamer->stats().texturesResident == bodyTextureCount) {
+            int cacheHits, generated;
+            planetTexgenCounts(cacheHits, generated);
+            double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - startupBegin).count();
+            std::cout << "[启动] 全部天体纹理就绪耗时 " << ms << " ms ("
+                      << (generated == 0 ? "热启动" : (cacheHits == 0 ? "冷启动" : "部分缓存命中")) << ")" << std::endl;
+            printPlanetTexgenStats(std::cout);
+            startupReported = true;
+        }
+        if (printStreamerStats) {
+            textureStreamer->printStats(std::cout);
+            printStreamerStats = false;
+        }
+        if (printGpuMemory) {
+            gpuMemory().printBreakdown(std::cout);
+            printGpuMemory = false;
+        }
+
+        gpuTimer->mark(2);
         glfwSwapBuffers(window);
-        glfwPollEvents();
+        latency->afterSwap();
+        // 本帧释放的 GL 对象 (轨道/土星环的临时缓冲、被替换的纹理) 在这一帧执行完后删除
+        glDeletionQueue().endFrame();
+        frameMetrics().endFrame();
+        inputTrace().endFrame();
+        if (!startupProfile().finished()) {
+            startupProfile().finish("first frame");
+            startupProfile().report(std::cout, "task4", startupJson);
+        }
+
+        // 等所有天体纹理就绪后再开始计帧, 避免把纹理生成和上传计入基准
+        if (benchMode && startupReported && ++benchFrame == benchWarmupFrames + benchFrames) {
+            double cpuMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - benchSceneStart).count();
+            benchStarMs[benchScene] = gpuTimer->averageMs(0);
+            benchRestMs[benchScene] = gpuTimer->averageMs(1);
+            benchCpuMs[benchScene] = cpuMs / benchFrames;
+            benchFrame = 0;
+            if (++benchScene == benchSceneCount) {
+                std::cout << "[基准] " << SCR_WIDTH << "x" << SCR_HEIGHT << ", 星表 " << starfield->count() << " 颗, 每场景 "
+                          << benchFrames << " 帧" << std::endl;
+                std::cout << "场景\t星空 GPU ms\t其余 GPU ms\t帧间隔 ms" << std::endl;
+                for (int i = 0; i < benchSceneCount; ++i) {
+                    std::cout << benchScenes[i].name << "\t" << benchStarMs[i] << "\t" << benchRestMs[i] << "\t" << benchCpuMs[i] << std::endl;
+                }
+                gpuMemory().printBreakdown(std::cout);
+                glDeletionQueue().printStats(std::cout);
+                glfwSetWindowShouldClose(window, true);
+            }
+        }
+        if (!latency->lowLatency())
+            glfwPollEvents();
     }
 
     // 7. 清理资源
-    glDeleteVertexArrays(1, &VAO);
-    glDeleteBuffers(1, &VBO);
+    textureStreamer->printStats(std::cout);
+    if (!benchMode) {
+        gpuMemory().printBreakdown(std::cout);
+    }
+    textureStreamer.reset();
+    starfield.reset();
+    gpuTimer.reset();
+    if (!servePath) {
+        latency->report(std::cout, "task4");
+        inputTrace().finish(std::cout);
+    }
+    latency.reset();
+    sphere.vao.reset();
+    sphere.vbo.reset();
+    sphere.ebo.reset();
     glDeleteProgram(shaderProgram);
+    glDeleteProgram(starShaderProgram);
+    glDeletionQueue().finish(); // 上下文销毁前删除队列中剩余的对象
+    if (!benchMode) {
+        glDeletionQueue().printStats(std::cout);
+    }
 
     glfwTerminate();
     return 0;
 }
 
 void processInput(GLFWwindow *window) {
-    if(glfwGetKey(window, GLFW_KEY_ESCAPE) == GLFW_PRESS)
+    InputTrace& input = inputTrace(); // 回放时返回录制的按键状态
+    if(input.keyDown(window, GLFW_KEY_ESCAPE))
         glfwSetWindowShouldClose(window, true);
+
+    // W/S 拉近/拉远摄像机
+    if(input.keyDown(window, GLFW_KEY_W))
+        cameraZoom = glm::max(cameraZoom * (1.0f - deltaTime), 0.05f);
+    if(input.keyDown(window, GLFW_KEY_S))
+        cameraZoom = glm::min(cameraZoom * (1.0f + deltaTime), 2.0f);
+
+    // T 打印纹理驻留统计 (按下时触发一次)
+    static bool statsKeyWasDown = false;
+    bool statsKeyDown = input.keyDown(window, GLFW_KEY_T);
+    if (statsKeyDown && !statsKeyWasDown)
+        printStreamerStats = true;
+    statsKeyWasDown = statsKeyDown;
+
+    // M 打印显存分类统计
+    static bool memoryKeyWasDown = false;
+    bool memoryKeyDown = input.keyDown(window, GLFW_KEY_M);
+    if (memoryKeyDown && !memoryKeyWasDown)
+        printGpuMemory = true;
+    memoryKeyWasDown = memoryKeyDown;
 }
 
 void framebuffer_size_callback(GLFWwindow* window, int width, int height) {
@@ -484,6 +1066,7 @@ void framebuffer_size_callback(GLFWwindow* window, int width, int height) {
 }
 
 unsigned int compileShader(unsigned int type, const char* source) {
+    StartupScope scope(type == GL_VERTEX_SHADER ? "compile vertex shader" : "compile fragment shader");
     unsigned int id = glCreateShader(type);
     glShaderSource(id, 1, &source, nullptr);
     glCompileShader(id);
@@ -504,6 +1087,7 @@ unsigned int createShaderProgram(const char* vertexSource, const char* fragmentS
     unsigned int fragmentShader = compileShader(GL_FRAGMENT_SHADER, fragmentSource);
     if (vertexShader == 0 || fragmentShader == 0) return 0;
 
+    StartupScope scope("link program");
     unsigned int program = glCreateProgram();
     glAttachShader(program, vertexShader);
     glAttachShader(program, fragmentShader);
@@ -0,0 +1,319 @@
+#include "texture_streamer.h"
+
+#include <glad/glad.h>
+
+#define STB_IMAGE_IMPLEMENTATION
+#include "stb_image.h"
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+
+// 始终保留在 GPU 上的 mip 尾部: 最长边不超过该值的级别, 保证解码完成后天体不会退回纯色
+static const int kTailMaxDimension = 64;
+
+TextureStreamer::TextureStreamer(size_t gpuBudgetBytes, int workerCount, size_t uploadBytesPerFrame)
+    : budgetBytes_(gpuBudgetBytes), uploadBytesPerFrame_(uploadBytesPerFrame) {
+    if (workerCount < 1) workerCount = 1;
+    for (int i = 0; i < workerCount; ++i) {
+        workers_.push_back(std::thread(&TextureStreamer::workerLoop, this));
+    }
+}
+
+TextureStreamer::~TextureStreamer() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stopping_ = true;
+    }
+    cv_.notify_all();
+    for (size_t i = 0; i < workers_.size(); ++i) {
+        workers_[i].join();
+    }
+}
+
+int TextureStreamer::addTexture(const std::string& path) {
+    return addTexture(path, std::bind(&TextureStreamer::loadImageFile, path,
+                                      std::placeholders::_1, std::placeholders::_2, std::placeholders::_3));
+}
+
+int TextureStreamer::addTexture(const std::string& name, const ImageSource& source) {
+    Entry e;
+    e.name = name;
+    e.source = source;
+    std::lock_guard<std::mutex> lock(mutex_); // 工作线程会在锁内读取 entries_
+    entries_.push_back(std::move(e));
+    return (int)entries_.size() - 1;
+}
+
+void TextureStreamer::requestScreenSize(int id, float screenDiameterPixels) {
+    if (id < 0 || id >= (int)entries_.size()) return;
+    Entry& e = entries_[id];
+    e.screenDiameter = std::max(e.screenDiameter, screenDiameterPixels);
+}
+
+unsigned int TextureStreamer::texture(int id) const {
+    if (id < 0 || id >= (int)entries_.size()) return 0;
+    // 绑定即视为本帧使用, 全局显存预算按此决定淘汰顺序
+    gpuMemory().touch(GpuObjectKind::Texture, entries_[id].glTexture.get());
+    return entries_[id].glTexture.get();
+}
+
+// 工作线程: 从队列取出条目, 取得基础级别图像并生成完整 mip 链
+void TextureStreamer::workerLoop() {
+    for (;;) {
+        int id;
+        ImageSource source;
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            cv_.wait(lock, [this] { return stopping_ || !decodeQueue_.empty(); });
+            if (stopping_) return;
+            id = decodeQueue_.front();
+            decodeQueue_.pop_front();
+            source = entries_[id].source;
+        }
+
+        std::vector<MipLevel> levels(1);
+        bool ok = source(levels[0].width, levels[0].height, levels[0].pixels);
+        if (ok) buildMipChain(levels);
+
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (ok) {
+            decoded_.push_back(std::make_pair(id, std::vector<MipLevel>()));
+            decoded_.back().second.swap(levels);
+        } else {
+            failedDecodes_.push_back(id);
+        }
+    }
+}
+
+bool TextureStreamer::loadImageFile(const std::string& path, int& width, int& height, std::vector<unsigned char>& rgba) {
+    int nrComponents;
+    // 工作线程上只能使用线程局部的翻转设置
+    stbi_set_flip_vertically_on_load_thread(1);
+    // 先读尺寸, 再直接解码到 rgba 里, 省掉 stb_image 自己分配的整幅图像和一次复制
+    bool ok = stbi_info(path.c_str(), &width, &height, &nrComponents) != 0;
+    if (ok) {
+        rgba.resize((size_t)width * height * 4);
+        ok = stbi_load_into(path.c_str(), rgba.data(), (size_t)width * 4, rgba.size(), &width, &height, &nrComponents, 4) != 0;
+    }
+    if (!ok) {
+        std::cerr << "纹理加载失败: " << path << " (" << stbi_failure_reason() << ")" << std::endl;
+        rgba.clear();
+        return false;
+    }
+    return true;
+}
+
+void TextureStreamer::buildMipChain(std::vector<MipLevel>& levels) {
+    // 2x2 盒式滤波逐级降采样, 奇数尺寸时边缘像素重复采样
+    while (levels.back().width > 1 || levels.back().height > 1) {
+        const MipLevel& src = levels.back();
+        MipLevel dst;
+        dst.width = std::max(1, src.width / 2);
+        dst.height = std::max(1, src.height / 2);
+        dst.pixels.resize((size_t)dst.width * dst.height * 4);
+        for (int y = 0; y < dst.height; ++y) {
+            int y0 = std::min(2 * y, src.height - 1);
+            int y1 = std::min(2 * y + 1, src.height - 1);
+            for (int x = 0; x < dst.width; ++x) {
+                int x0 = std::min(2 * x, src.width - 1);
+                int x1 = std::min(2 * x + 1, src.width - 1);
+                for (int c = 0; c < 4; ++c) {
+                    int sum = src.pixels[((size_t)y0 * src.width + x0) * 4 + c]
+                            + src.pixels[((size_t)y0 * src.width + x1) * 4 + c]
+                            + src.pixels[((size_t)y1 * src.width + x0) * 4 + c]
+                            + src.pixels[((size_t)y1 * src.width + x1) * 4 + c];
+                    dst.pixels[((size_t)y * dst.width + x) * 4 + c] = (unsigned char)((sum + 2) / 4);
+                }
+            }
+        }
+        levels.push_back(dst);
+    }
+}
+
+// 球面等距柱状投影: 纹理宽度对应整个赤道, 屏幕上可见的直径约覆盖一半宽度
+int TextureStreamer::levelForScreenSize(const Entry& e, float screenDiameterPixels) const {
+    int coarsest = coarsestResidentLevel(e);
+    if (screenDiameterPixels <= 0.0f) return coarsest;
+    float texelsAcross = e.levels[0].width * 0.5f;
+    int level = (int)std::floor(std::log2(std::max(texelsAcross / screenDiameterPixels, 1.0f)));
+    return std::min(std::max(level, 0), coarsest);
+}
+
+int TextureStreamer::coarsestResidentLevel(const Entry& e) const {
+    for (size_t i = 0; i < e.levels.size(); ++i) {
+        if (std::max(e.levels[i].width, e.levels[i].height) <= kTailMaxDimension) return (int)i;
+    }
+    return (int)e.levels.size() - 1;
+}
+
+size_t TextureStreamer::chainBytes(const Entry& e, int fromLevel) const {
+    size_t bytes = 0;
+    for (size_t i = fromLevel; i < e.levels.size(); ++i) {
+        bytes += e.levels[i].pixels.size();
+    }
+    return bytes;
+}
+
+// 用 [level, 最粗级] 这一段 mip 链重建 GL 纹理, 替换旧纹理
+// GL 3.3 无法单独释放某一 mip 级别, 所以升降级都重新创建纹理对象
+void TextureStreamer::makeResident(Entry& e, int level) {
+    GlTexture tex = GlTexture::create();
+    glBindTexture(GL_TEXTURE_2D, tex.get());
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    for (size_t i = level; i < e.levels.size(); ++i) {
+        const MipLevel& m = e.levels[i];
+        glTexImage2D(GL_TEXTURE_2D, (GLint)(i - level), GL_RGBA8, m.width, m.height, 0, GL_RGBA, GL_UNSIGNED_BYTE, m.pixels.data());
+    }
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, 0);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, (GLint)(e.levels.size() - 1 - level));
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+    if (!e.glTexture) {
+        stats_.texturesResident++;
+    }
+
+    size_t bytes = chainBytes(e, level);
+    // 登记为可淘汰: 全局显存超出预算时整个释放, CPU 侧 mip 链保留, 再次可见时重新上传
+    int id = (int)(&e - &entries_[0]);
+    gpuMemory().track(GpuObjectKind::Texture, tex.get(), GpuCategory::StreamedTexture, bytes);
+    gpuMemory().setEvictable(GpuObjectKind::Texture, tex.get(), [this, id]() { evict(id); });
+    stats_.uploadedBytes += bytes;
+    stats_.residentBytes = stats_.residentBytes - e.gpuBytes + bytes;
+    stats_.peakResidentBytes = std::max(stats_.peakResidentBytes, stats_.residentBytes);
+    e.glTexture = std::move(tex); // 旧纹理进入删除队列, 本帧之前的绘制执行完后才删除
+    e.gpuBytes = bytes;
+    e.residentLevel = level;
+}
+
+// 全局显存预算的淘汰回调: 释放 GPU 纹理, 保留 CPU 侧 mip 链
+void TextureStreamer::evict(int id) {
+    Entry& e = entries_[id];
+    if (!e.glTexture) return;
+    e.glTexture.reset();
+    stats_.residentBytes -= e.gpuBytes;
+    stats_.texturesResident--;
+    stats_.evictions++;
+    e.gpuBytes = 0;
+    e.residentLevel = -1;
+}
+
+void TextureStreamer::update() {
+    // 1. 接收工作线程的解码结果, 新纹理先上传 mip 尾部
+    std::vector<std::pair<int, std::vector<MipLevel> > > decoded;
+    std::vector<int> failed;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        decoded.swap(decoded_);
+        failed.swap(failedDecodes_);
+    }
+    for (size_t i = 0; i < failed.size(); ++i) {
+        entries_[failed[i]].failed = true;
+        entries_[failed[i]].decodeQueued = false;
+    }
+    for (size_t i = 0; i < decoded.size(); ++i) {
+        Entry& e = entries_[decoded[i].first];
+        e.levels.swap(decoded[i].second);
+        e.decodeQueued = false;
+        makeResident(e, coarsestResidentLevel(e));
+    }
+    // 被全局预算淘汰的纹理再次可见时, 先从 mip 尾部重新上传
+    for (size_t i = 0; i < entries_.size(); ++i) {
+        Entry& e = entries_[i];
+        if (e.residentLevel < 0 && !e.levels.empty() && e.screenDiameter > 0.0f) {
+            makeResident(e, coarsestResidentLevel(e));
+        }
+    }
+
+    // 2. 本帧被请求但尚未解码的纹理加入解码队列
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        for (size_t i = 0; i < entries_.size(); ++i) {
+            Entry& e = entries_[i];
+            if (e.screenDiameter > 0.0f && e.levels.empty() && !e.decodeQueued && !e.failed) {
+                e.decodeQueued = true;
+                decodeQueue_.push_back((int)i);
+            }
+        }
+        stats_.pendingDecodes = 0;
+        for (size_t i = 0; i < entries_.size(); ++i) {
+            if (entries_[i].decodeQueued) stats_.pendingDecodes++;
+        }
+    }
+    cv_.notify_all();
+
+    // 按屏幕尺寸从大到小排序, 大的天体优先获得上传额度和显存
+    std::vector<int> order;
+    for (size_t i = 0; i < entries_.size(); ++i) {
+        Entry& e = entries_[i];
+        if (e.residentLevel < 0) continue;
+        e.desiredLevel = levelForScreenSize(e, e.screenDiameter);
+        order.push_back((int)i);
+    }
+    std::sort(order.begin(), order.end(), [this](int a, int b) {
+        return entries_[a].screenDiameter > entries_[b].screenDiameter;
+    });
+
+    // 3. 比需要精细两级以上的纹理降级 (留一级余量避免在边界上来回抖动)
+    for (size_t i = 0; i < order.size(); ++i) {
+        Entry& e = entries_[order[i]];
+        if (e.residentLevel + 1 < e.desiredLevel) {
+            makeResident(e, e.desiredLevel);
+            stats_.levelDrops++;
+        }
+    }
+
+    // 4. 超出预算时从屏幕上最小的天体开始逐级降级
+    for (size_t i = order.size(); i-- > 0 && stats_.residentBytes > budgetBytes_;) {
+        Entry& e = entries_[order[i]];
+        while (stats_.residentBytes > budgetBytes_ && e.residentLevel < coarsestResidentLevel(e)) {
+            makeResident(e, e.residentLevel + 1);
+            stats_.levelDrops++;
+            stats_.budgetDrops++;
+        }
+    }
+
+    // 5. 在预算和每帧上传限额内, 每个纹理最多向精细方向前进一级
+    size_t uploadedThisFrame = 0;
+    for (size_t i = 0; i < order.size(); ++i) {
+        Entry& e = entries_[order[i]];
+        if (e.residentLevel <= e.desiredLevel) continue;
+        int next = e.residentLevel - 1;
+        size_t bytes = chainBytes(e, next);
+        if (stats_.residentBytes - e.gpuBytes + bytes > budgetBytes_) continue;
+        if (uploadedThisFrame > 0 && uploadedThisFrame + bytes > uploadBytesPerFrame_) break;
+        makeResident(e, next);
+        uploadedThisFrame += bytes;
+        stats_.levelUps++;
+    }
+
+    // 屏幕尺寸每帧重新上报, 未上报的天体视为不可见
+    for (size_t i = 0; i < entries_.size(); ++i) {
+        entries_[i].screenDiameter = 0.0f;
+    }
+}
+
+void TextureStreamer::printStats(std::ostream& os) const {
+    os << "[纹理流送] 驻留 " << stats_.residentBytes / 1024 << " KiB / 预算 " << budgetBytes_ / 1024
+       << " KiB (峰值 " << stats_.peakResidentBytes / 1024 << " KiB), 驻留纹理 " << stats_.texturesResident
+       << ", 解码中 " << stats_.pendingDecodes << ", 累计上传 " << stats_.uploadedBytes / 1024 << " KiB"
+       << ", 升级 " << stats_.levelUps << ", 降级 " << stats_.levelDrops
+       << " (预算降级 " << stats_.budgetDrops << "), 被全局显存预算淘汰 " << stats_.evictions << " 次" << std::endl;
+    for (size_t i = 0; i < entries_.size(); ++i) {
+        const Entry& e = entries_[i];
+        os << "    " << e.name << ": ";
+        if (e.failed) {
+            os << "加载失败" << std::endl;
+        } else if (e.residentLevel < 0) {
+            os << (e.decodeQueued ? "解码中" : "未请求") << std::endl;
+        } else {
+            const MipLevel& m = e.levels[e.residentLevel];
+            os << "级别 " << e.residentLevel << " (" << m.width << "x" << m.height << "), 目标级别 "
+               << e.desiredLevel << ", " << e.gpuBytes / 1024 << " KiB" << std::endl;
+        }
+    }
+}
@@ -0,0 +1,107 @@
+#ifndef TASK4_TEXTURE_STREAMER_H
+#define TASK4_TEXTURE_STREAMER_H
+
+#include "common/gl_handle.h"
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <iosfwd>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// 基于屏幕投影大小的天体纹理流式加载管理器
+//
+// 每个纹理在 CPU 侧保存完整的 mip 链 (由工作线程用 stb_image 解码并逐级降采样),
+// GPU 侧只保留 [residentLevel, 最粗级] 这一段: GL 纹理的第 0 级对应源图的 residentLevel 级。
+// 每帧根据天体在屏幕上的直径计算所需的 mip 级别, 逐级向更精细的级别加载,
+// 超出显存预算时优先把屏幕上最小的天体降回更粗的级别。
+// GPU 纹理同时登记在 common/gpu_memory.h 中, 全局预算不足时最久未绑定的纹理会被整个释放。
+class TextureStreamer {
+public:
+    struct Stats {
+        size_t residentBytes = 0;      // 当前 GPU 纹理总字节数
+        size_t peakResidentBytes = 0;  // 峰值
+        size_t uploadedBytes = 0;      // 累计上传字节数
+        int texturesResident = 0;      // 已有 GPU 纹理的条目数
+        int pendingDecodes = 0;        // 排队或正在解码的条目数
+        int levelUps = 0;              // 升到更精细级别的次数
+        int levelDrops = 0;            // 降到更粗级别的次数
+        int budgetDrops = 0;           // 其中因预算不足而降级的次数
+        int evictions = 0;             // 被全局显存预算 (common/gpu_memory.h) 整个释放的次数
+    };
+
+    // gpuBudgetBytes: 所有流式纹理允许占用的显存上限
+    // uploadBytesPerFrame: 每帧最多上传的字节数, 避免一次性上传大纹理导致卡顿
+    TextureStreamer(size_t gpuBudgetBytes, int workerCount = 2, size_t uploadBytesPerFrame = 4u << 20);
+    ~TextureStreamer();
+
+    // 在工作线程上产生基础级别 RGBA8 图像的回调 (解码文件、程序化生成等)
+    typedef std::function<bool(int& width, int& height, std::vector<unsigned char>& rgba)> ImageSource;
+
+    // 注册一个纹理文件, 返回句柄; 解码在首次 requestScreenSize 之后才开始
+    int addTexture(const std::string& path);
+    // 注册一个任意来源的纹理, name 仅用于统计输出
+    int addTexture(const std::string& name, const ImageSource& source);
+
+    // 报告本帧该纹理在屏幕上覆盖的直径 (像素), 每帧对每个可见天体调用
+    void requestScreenSize(int id, float screenDiameterPixels);
+
+    // 主线程每帧调用一次: 接收解码结果, 在预算和上传限额内调整各纹理的驻留级别
+    void update();
+
+    // 返回当前可用于绑定的 GL 纹理, 尚未驻留时返回 0
+    unsigned int texture(int id) const;
+
+    const Stats& stats() const { return stats_; }
+    size_t budget() const { return budgetBytes_; }
+    void printStats(std::ostream& os) const;
+
+private:
+    struct MipLevel {
+        int width = 0;
+        int height = 0;
+        std::vector<unsigned char> pixels; // RGBA8
+    };
+
+    struct Entry {
+        std::string name;
+        ImageSource source;
+        std::vector<MipLevel> levels;  // CPU 侧完整 mip 链, 解码完成前为空
+        GlTexture glTexture;
+        int residentLevel = -1;        // GPU 上最精细的源级别, -1 表示未驻留
+        int desiredLevel = 0;
+        float screenDiameter = 0.0f;
+        size_t gpuBytes = 0;
+        bool decodeQueued = false;
+        bool failed = false;
+    };
+
+    void workerLoop();
+    static bool loadImageFile(const std::string& path, int& width, int& height, std::vector<unsigned char>& rgba);
+    static void buildMipChain(std::vector<MipLevel>& levels);
+    int levelForScreenSize(const Entry& e, float screenDiameterPixels) const;
+    int coarsestResidentLevel(const Entry& e) const;
+    size_t chainBytes(const Entry& e, int fromLevel) const;
+    void makeResident(Entry& e, int level);
+    void evict(int id);
+
+    std::vector<Entry> entries_;
+    size_t budgetBytes_;
+    size_t uploadBytesPerFrame_;
+    Stats stats_;
+
+    // 工作线程与主线程之间的解码队列
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    std::deque<int> decodeQueue_;
+    std::vector<std::pair<int, std::vector<MipLevel> > > decoded_;
+    std::vector<int> failedDecodes_;
+    std::vector<std::thread> workers_;
+    bool stopping_ = false;
+};
+
+#endif
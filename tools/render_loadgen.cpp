@@ -0,0 +1,198 @@
+// 渲染服务的负载生成客户端 (仅 POSIX)
+//
+// 用法: render_loadgen [--socket PATH] [--clients N] [--requests M] [--pipeline K]
+//                      [--width W] [--height H] [--orbit R] [--save FILE] [--shutdown]
+//   --clients   并发连接数, 每个连接一个线程
+//   --requests  每个连接发送的请求数
+//   --pipeline  每个连接同时在途的请求数, 大于 1 时服务端可以把请求合批
+//   --orbit     以半径 R 绕 Y 轴改变每个请求的视点, 省略时使用服务端的默认视角
+//   --save      把收到的第一幅图像保存为 PPM
+//   --shutdown  测试结束后让服务端退出
+// 输出吞吐量和延迟分布 (从发送请求到收齐响应)。
+
+#include "common/render_protocol.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <deque>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+struct LoadgenOptions {
+    std::string socketPath = "/tmp/opengl-task-render.sock";
+    int clients = 4;
+    int requests = 100;
+    int pipeline = 1;
+    int width = 640;
+    int height = 480;
+    float orbit = 0.0f;
+    std::string savePath;
+    bool shutdown = false;
+};
+
+struct ClientResult {
+    std::vector<double> latenciesMs;
+    size_t bytes = 0;
+    int errors = 0;
+};
+
+static int connectTo(const std::string& path) {
+    sockaddr_un addr;
+    std::memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    if (path.size() >= sizeof(addr.sun_path)) return -1;
+    std::strcpy(addr.sun_path, path.c_str());
+    int fd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0) return -1;
+    if (::connect(fd, (sockaddr*)&addr, sizeof(addr)) != 0) {
+        ::close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+static std::string requestLine(const LoadgenOptions& options, int client, int index) {
+    char line[256];
+    // 每个请求的场景时间不同, 避免服务端得到完全相同的画面
+    float time = (float)(client * options.requests + index) * 0.05f;
+    int n = std::snprintf(line, sizeof(line), "RENDER width=%d height=%d time=%g",
+                          options.width, options.height, time);
+    if (options.orbit > 0.0f) {
+        float angle = time * 0.5f;
+        n += std::snprintf(line + n, sizeof(line) - n, " eye=%g,%g,%g",
+                           options.orbit * sinf(angle), options.orbit * 0.3f, options.orbit * cosf(angle));
+    }
+    std::snprintf(line + n, sizeof(line) - n, "\n");
+    return line;
+}
+
+static std::mutex saveMutex;
+static bool imageSaved = false;
+
+static void runClient(const LoadgenOptions& options, int client, ClientResult& result) {
+    int fd = connectTo(options.socketPath);
+    if (fd < 0) {
+        std::cerr << "无法连接渲染服务: " << options.socketPath << std::endl;
+        result.errors = options.requests;
+        return;
+    }
+
+    typedef std::chrono::steady_clock Clock;
+    std::deque<Clock::time_point> inFlight;
+    std::vector<unsigned char> image;
+    std::string header;
+    int sent = 0, received = 0;
+    while (received < options.requests) {
+        while (sent < options.requests && (int)inFlight.size() < options.pipeline) {
+            std::string line = requestLine(options, client, sent);
+            inFlight.push_back(Clock::now());
+            if (!socketWriteAll(fd, line.data(), line.size())) {
+                inFlight.pop_back();
+                break;
+            }
+            sent++;
+        }
+        if (inFlight.empty() || !socketReadLine(fd, header)) break;
+
+        if (header.compare(0, 3, "OK ") == 0) {
+            size_t size = (size_t)std::strtoull(header.c_str() + 3, nullptr, 10);
+            image.resize(size);
+            if (!socketReadAll(fd, image.data(), size)) break;
+            result.bytes += size;
+            if (!options.savePath.empty()) {
+                std::lock_guard<std::mutex> lock(saveMutex);
+                if (!imageSaved) {
+                    FILE* f = std::fopen(options.savePath.c_str(), "wb");
+                    if (f) {
+                        std::fwrite(image.data(), 1, image.size(), f);
+                        std::fclose(f);
+                    }
+                    imageSaved = true;
+                }
+            }
+        } else {
+            std::cerr << "服务端错误: " << header << std::endl;
+            result.errors++;
+        }
+        result.latenciesMs.push_back(std::chrono::duration<double, std::milli>(Clock::now() - inFlight.front()).count());
+        inFlight.pop_front();
+        received++;
+    }
+    result.errors += options.requests - received;
+    ::close(fd);
+}
+
+static double percentile(const std::vector<double>& sorted, double p) {
+    size_t index = (size_t)(p * (sorted.size() - 1) + 0.5);
+    return sorted[std::min(index, sorted.size() - 1)];
+}
+
+int main(int argc, char** argv) {
+    LoadgenOptions options;
+    for (int i = 1; i < argc; ++i) {
+        if (std::strcmp(argv[i], "--socket") == 0 && i + 1 < argc) options.socketPath = argv[++i];
+        else if (std::strcmp(argv[i], "--clients") == 0 && i + 1 < argc) options.clients = std::max(1, std::atoi(argv[++i]));
+        else if (std::strcmp(argv[i], "--requests") == 0 && i + 1 < argc) options.requests = std::max(1, std::atoi(argv[++i]));
+        else if (std::strcmp(argv[i], "--pipeline") == 0 && i + 1 < argc) options.pipeline = std::max(1, std::atoi(argv[++i]));
+        else if (std::strcmp(argv[i], "--width") == 0 && i + 1 < argc) options.width = std::atoi(argv[++i]);
+        else if (std::strcmp(argv[i], "--height") == 0 && i + 1 < argc) options.height = std::atoi(argv[++i]);
+        else if (std::strcmp(argv[i], "--orbit") == 0 && i + 1 < argc) options.orbit = (float)std::atof(argv[++i]);
+        else if (std::strcmp(argv[i], "--save") == 0 && i + 1 < argc) options.savePath = argv[++i];
+        else if (std::strcmp(argv[i], "--shutdown") == 0) options.shutdown = true;
+        else {
+            std::cerr << "未知参数: " << argv[i] << std::endl;
+            return 1;
+        }
+    }
+
+    std::vector<ClientResult> results(options.clients);
+    std::vector<std::thread> threads;
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    for (int i = 0; i < options.clients; ++i) {
+        threads.push_back(std::thread(runClient, std::cref(options), i, std::ref(results[i])));
+    }
+    for (size_t i = 0; i < threads.size(); ++i) threads[i].join();
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    std::vector<double> latencies;
+    size_t bytes = 0;
+    int errors = 0;
+    for (size_t i = 0; i < results.size(); ++i) {
+        latencies.insert(latencies.end(), results[i].latenciesMs.begin(), results[i].latenciesMs.end());
+        bytes += results[i].bytes;
+        errors += results[i].errors;
+    }
+
+    std::cout << "连接 " << options.clients << ", 每连接请求 " << options.requests << ", 在途 " << options.pipeline
+              << ", 分辨率 " << options.width << "x" << options.height << std::endl;
+    std::cout << "完成 " << latencies.size() << " 个请求, 失败 " << errors << ", 耗时 " << seconds << " s" << std::endl;
+    if (!latencies.empty()) {
+        std::sort(latencies.begin(), latencies.end());
+        double sum = 0.0;
+        for (size_t i = 0; i < latencies.size(); ++i) sum += latencies[i];
+        std::cout << "吞吐量 " << latencies.size() / seconds << " 请求/s, " << bytes / seconds / (1024.0 * 1024.0) << " MiB/s" << std::endl;
+        std::cout << "延迟 (ms): 平均 " << sum / latencies.size()
+                  << "  p50 " << percentile(latencies, 0.50)
+                  << "  p90 " << percentile(latencies, 0.90)
+                  << "  p99 " << percentile(latencies, 0.99)
+                  << "  最大 " << latencies.back() << std::endl;
+    }
+
+    if (options.shutdown) {
+        int fd = connectTo(options.socketPath);
+        if (fd >= 0) {
+            socketWriteAll(fd, "SHUTDOWN\n", 9);
+            ::close(fd);
+        }
+    }
+    return errors == 0 ? 0 : 1;
+}